@@ -4,6 +4,15 @@
 TIMEOUT=5
 TOOLCHAIN_TYPE=${TOOLCHAIN_TYPE:-gnu}
 
+# Benchmark results ("BENCH:<name> cycles=<n> ...") are recorded per app.
+# If BENCH_BASELINE names a file holding the APP_BENCH lines of an earlier
+# run, any result more than BENCH_TOLERANCE percent slower is flagged, and
+# BENCH_STRICT=1 turns such a regression into a failure.
+BENCH_BASELINE=${BENCH_BASELINE:-}
+BENCH_TOLERANCE=${BENCH_TOLERANCE:-10}
+BENCH_STRICT=${BENCH_STRICT:-0}
+BENCH_RESULTS=""
+
 # Test a single app: build, run, check
 # Returns: 0=passed, 1=failed, 2=build_failed
 test_app() {
@@ -25,6 +34,14 @@ test_app() {
 	output=$(timeout ${TIMEOUT}s qemu-system-riscv32 -nographic -machine virt -bios none -kernel build/image.elf 2>&1)
 	exit_code=$?
 
+	# Record benchmark lines as "APP_BENCH:<app>:<name>=<cycles>"
+	local line
+	while read -r line; do
+		[ -z "$line" ] && continue
+		BENCH_RESULTS="$BENCH_RESULTS$app:$line"$'\n'
+	done < <(echo "$output" | tr -d '\r' |
+		sed -n 's/^BENCH:\([A-Za-z0-9_]*\) cycles=\([0-9]*\).*/\1=\2/p')
+
 	# Check phase
 	if echo "$output" | grep -qiE "(trap|exception|fault|panic|illegal|segfault)"; then
 		echo "[!] Crash detected"
@@ -95,8 +112,29 @@ for app in $APPS; do
 	fi
 done
 
+printf "%s" "$BENCH_RESULTS" | sed 's/^/APP_BENCH:/'
+
+# Compare benchmark results against the baseline
+BENCH_REGRESSIONS=""
+if [ -n "$BENCH_BASELINE" ] && [ -f "$BENCH_BASELINE" ]; then
+	while IFS='=' read -r key cycles; do
+		[ -z "$key" ] && continue
+		base=$(sed -n "s/^APP_BENCH:$key=\([0-9]*\)$/\1/p" "$BENCH_BASELINE")
+		[ -z "$base" ] || [ "$base" -eq 0 ] && continue
+		if [ $((cycles * 100)) -gt $((base * (100 + BENCH_TOLERANCE))) ]; then
+			echo "APP_BENCH_REGRESSION:$key=$base->$cycles"
+			BENCH_REGRESSIONS="$BENCH_REGRESSIONS $key"
+		fi
+	done < <(printf "%s" "$BENCH_RESULTS")
+fi
+
 # Exit status
-if [ -n "$FAILED_APPS" ] || [ -n "$BUILD_FAILED_APPS" ]; then
+if [ -n "$BENCH_REGRESSIONS" ] && [ "$BENCH_STRICT" = "1" ]; then
+	echo ""
+	echo "[!] Benchmark regressions:$BENCH_REGRESSIONS"
+	echo "[!] Step 2 validation FAILED"
+	exit 1
+elif [ -n "$FAILED_APPS" ] || [ -n "$BUILD_FAILED_APPS" ]; then
 	echo ""
 	echo "[!] Step 2 validation FAILED"
 	exit 1
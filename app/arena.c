@@ -0,0 +1,101 @@
+/* Per-Task Arena Test.
+ *
+ * Purpose:
+ * - mo_task_alloc() bumps through the task's arena: consecutive blocks are
+ *   word-aligned and adjacent, and a request that does not fit fails
+ * - mo_task_arena_reset() hands the same memory out again
+ * - A task spawned without an arena gets NULL from mo_task_alloc()
+ * - mo_task_stats() reports the arena size and its peak use
+ * - Cancelling a task frees its arena: spawning and cancelling tasks with
+ *   16 MiB arenas many times over would exhaust the heap otherwise
+ */
+
+#include <linmo.h>
+
+#define ARENA_SIZE 256
+#define BIG_ARENA (16U << 20)
+#define BIG_ROUNDS 12
+
+static volatile bool worker_done;
+static bool bump_ok, exhaust_ok, reset_ok;
+
+static void worker_task(void)
+{
+    char *a = mo_task_alloc(10);
+    char *b = mo_task_alloc(4);
+    bump_ok = a && b && ((size_t) a & 3) == 0 && b == a + 12;
+    memset(a, 0x5a, 16);
+
+    exhaust_ok = mo_task_alloc(ARENA_SIZE) == NULL &&
+                 mo_task_alloc(ARENA_SIZE - 16) != NULL &&
+                 mo_task_alloc(1) == NULL && mo_task_alloc(0) == NULL;
+
+    mo_task_arena_reset();
+    reset_ok = mo_task_alloc(ARENA_SIZE) == a;
+
+    worker_done = true;
+    mo_task_suspend(mo_task_id());
+}
+
+static void idle_worker(void)
+{
+    while (1)
+        mo_task_delay(100);
+}
+
+static void test_task(void)
+{
+    int32_t worker =
+        mo_task_spawn_arena(worker_task, DEFAULT_STACK_SIZE, ARENA_SIZE);
+    while (!worker_done)
+        mo_task_delay(1);
+
+    task_stats_t st;
+    mo_task_stats((uint16_t) worker, &st);
+    bool stats_ok = st.arena_size == ARENA_SIZE && st.arena_peak == ARENA_SIZE;
+    mo_task_stats(mo_task_id(), &st);
+    stats_ok &= st.arena_size == 0;
+    mo_task_cancel((uint16_t) worker);
+
+    bool none_ok = mo_task_alloc(4) == NULL;
+
+    /* Far more than the heap holds, unless each arena is given back */
+    for (int i = 0; i < BIG_ROUNDS; i++) {
+        int32_t id =
+            mo_task_spawn_arena(idle_worker, DEFAULT_STACK_SIZE, BIG_ARENA);
+        mo_task_delay(1);
+        mo_task_cancel((uint16_t) id);
+    }
+    void *probe = malloc(BIG_ARENA);
+    bool release_ok = probe != NULL;
+    free(probe);
+
+    printf("Arena: bump=%s exhaust=%s reset=%s none=%s stats=%s "
+           "release=%s\n",
+           bump_ok ? "ok" : "bad", exhaust_ok ? "ok" : "bad",
+           reset_ok ? "ok" : "bad", none_ok ? "ok" : "bad",
+           stats_ok ? "ok" : "bad", release_ok ? "ok" : "bad");
+
+    bool ok = bump_ok && exhaust_ok && reset_ok && none_ok && stats_ok &&
+              release_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,139 @@
+/* CPU Budget Test.
+ *
+ * Purpose:
+ * - A high-priority task that never blocks is throttled to its budget, so
+ *   the lower-priority test task still runs
+ * - Two tasks sharing one budget are capped together
+ * - Invalid budgets are rejected
+ *
+ * Shares are measured with mo_task_stats() over a window of whole periods,
+ * with a margin for the tick a period may start late by.
+ */
+
+#include <linmo.h>
+
+#define PERIOD 10
+#define WINDOW (10 * PERIOD)
+
+static volatile uint32_t spins[2];
+
+static void hog_a(void)
+{
+    while (1)
+        spins[0]++;
+}
+
+static void hog_b(void)
+{
+    while (1)
+        spins[1]++;
+}
+
+static uint64_t run_time(int32_t id)
+{
+    task_stats_t st;
+    return mo_task_stats((uint16_t) id, &st) == 0 ? st.run_time_us : 0;
+}
+
+/* CPU share of @a and @b over one window, in percent */
+static uint32_t measure(int32_t a, int32_t b)
+{
+    uint64_t before = run_time(a) + (b > 0 ? run_time(b) : 0);
+    uint32_t t0 = mo_ticks();
+    mo_task_delay(WINDOW);
+    uint32_t elapsed_us = (mo_ticks() - t0) * (1000000U / F_TIMER);
+    uint64_t used = run_time(a) + (b > 0 ? run_time(b) : 0) - before;
+    return (uint32_t) (used * 100U / elapsed_us);
+}
+
+static int32_t spawn_hog(void (*entry)(void), task_budget_t *budget)
+{
+    int32_t id = mo_task_spawn(entry, DEFAULT_STACK_SIZE);
+    if (id < 0)
+        return id;
+    if (mo_task_budget((uint16_t) id, budget) != 0)
+        return -1;
+    mo_task_priority((uint16_t) id, TASK_PRIO_HIGH);
+    return id;
+}
+
+static bool test_single(void)
+{
+    static task_budget_t b = {.budget = 2, .period = PERIOD};
+
+    int32_t hog = spawn_hog(hog_a, &b);
+    if (hog < 0)
+        return false;
+
+    /* Returning at all means the hog was throttled */
+    uint32_t share = measure(hog, 0);
+    printf("single: %lu percent, %lu throttles\n", share, b.throttles);
+    bool ok = share >= 10 && share <= 35 && b.throttles >= WINDOW / PERIOD - 1;
+
+    /* This only runs while the hog is throttled */
+    mo_task_cancel((uint16_t) hog);
+    return ok;
+}
+
+static bool test_group(void)
+{
+    static task_budget_t b = {.budget = 3, .period = PERIOD};
+
+    int32_t a = spawn_hog(hog_a, &b);
+    int32_t c = spawn_hog(hog_b, &b);
+    if (a < 0 || c < 0)
+        return false;
+
+    spins[0] = spins[1] = 0;
+    uint32_t share = measure(a, c);
+    printf("group: %lu percent, %lu throttles\n", share, b.throttles);
+    bool ok = share >= 15 && share <= 50 && spins[0] && spins[1];
+
+    mo_task_cancel((uint16_t) a);
+    mo_task_cancel((uint16_t) c);
+    return ok;
+}
+
+static bool test_args(void)
+{
+    task_budget_t zero = {.budget = 0, .period = PERIOD};
+    task_budget_t over = {.budget = PERIOD + 1, .period = PERIOD};
+    task_budget_t flat = {.budget = 1, .period = 0};
+    uint16_t self = mo_task_id();
+
+    return mo_task_budget(self, &zero) != 0 &&
+           mo_task_budget(self, &over) != 0 &&
+           mo_task_budget(self, &flat) != 0 && mo_task_budget(self, NULL) == 0;
+}
+
+static void test_task(void)
+{
+    bool args_ok = test_args();
+    bool single_ok = test_single();
+    bool group_ok = test_group();
+
+    printf("Budget: args=%s single=%s group=%s\n", args_ok ? "ok" : "bad",
+           single_ok ? "ok" : "bad", group_ok ? "ok" : "bad");
+
+    bool ok = args_ok && single_ok && group_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,93 @@
+/* Time Base Test.
+ *
+ * Purpose:
+ * - The reciprocal conversions of <sys/clock.h> match exact division on
+ *   whole results, edge values and a sweep of remainders
+ * - mo_time_ns() and mo_ticks64() only move forward, and agree with the
+ *   machine timer and mo_ticks()
+ */
+
+#include <linmo.h>
+
+#define ELAPSE_TICKS 5
+
+static bool test_convert(void)
+{
+    bool ok = true;
+
+    /* Whole results are exact */
+    ok &= mo_cycles_to_us(F_CPU) == 1000000U;
+    ok &= mo_cycles_to_ms(F_CPU) == 1000U;
+    ok &= mo_cycles_to_ns(F_CPU) == 1000000000U;
+    ok &= mo_us_to_cycles(1000000U) == F_CPU;
+    ok &= mo_ticks_to_us(F_TIMER) == 1000000U;
+    ok &= mo_ms_to_ticks(1000U) == F_TIMER;
+    ok &= MS_TO_TICKS(0) == 0 && mo_cycles_to_ns(0) == 0;
+
+    /* Everything else rounds down, like the division it replaces */
+    for (uint32_t x = 1; x < 3 * F_CPU / 1000; x += 7) {
+        ok &= mo_cycles_to_us(x) == (uint64_t) x * 1000000U / F_CPU;
+        ok &= mo_cycles_to_ms(x) == (uint64_t) x * 1000U / F_CPU;
+        ok &= mo_ms_to_ticks(x) == (uint64_t) x * F_TIMER / 1000U;
+    }
+
+    /* A year of cycles still converts to the exact millisecond */
+    uint64_t year = (uint64_t) F_CPU * 365 * 24 * 3600;
+    ok &= mo_cycles_to_ms(year) == 365ULL * 24 * 3600 * 1000;
+    return ok;
+}
+
+static bool test_monotonic(void)
+{
+    uint64_t ns0 = mo_time_ns(), t0 = mo_ticks64();
+    bool ok = (uint32_t) t0 == mo_ticks() || (uint32_t) t0 + 1 == mo_ticks();
+
+    uint64_t prev = ns0;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t ns = mo_time_ns();
+        ok &= ns >= prev;
+        prev = ns;
+    }
+
+    mo_task_delay(ELAPSE_TICKS);
+    uint64_t ns1 = mo_time_ns(), t1 = mo_ticks64();
+    uint64_t tick_ns = 1000000000U / F_TIMER;
+
+    printf("%lu ticks took %lu us\n", (uint32_t) (t1 - t0),
+           (uint32_t) ((ns1 - ns0) / 1000U));
+    ok &= t1 - t0 >= ELAPSE_TICKS && t1 - t0 <= ELAPSE_TICKS + 1;
+    ok &= ns1 - ns0 >= (ELAPSE_TICKS - 1) * tick_ns;
+    ok &= mo_uptime() >= ns1 / 1000000U;
+    return ok;
+}
+
+static void test_task(void)
+{
+    bool convert_ok = test_convert();
+    bool monotonic_ok = test_monotonic();
+
+    printf("Clock: convert=%s monotonic=%s\n", convert_ok ? "ok" : "bad",
+           monotonic_ok ? "ok" : "bad");
+
+    bool ok = convert_ok && monotonic_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
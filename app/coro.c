@@ -0,0 +1,190 @@
+/* Stackless Coroutine Test.
+ *
+ * Purpose:
+ * - A thousand coroutines sleep with CORO_DELAY() inside one host task,
+ *   none waking before its delay has passed, including delays longer than
+ *   one revolution of the scheduler's timing wheel
+ * - CORO_YIELD() alternates coroutines in FIFO order
+ * - CORO_AWAIT() is woken by another task, by an interrupt handler through
+ *   mo_coro_wake_from_isr(), and by a wake latched before the await
+ * - CORO_SEM_WAIT() takes a semaphore signalled by another task
+ * - mo_coro_run() returns once every coroutine has finished
+ */
+
+#include <linmo.h>
+
+#define NUM_SLEEPERS 1000
+#define SLEEP_ROUNDS 3
+
+typedef struct {
+    coro_t co; /* First member, so the body can cast its coro_t back */
+    uint32_t start;
+    uint16_t i;
+    uint8_t round;
+} sleeper_t;
+
+static sleeper_t sleepers[NUM_SLEEPERS];
+static volatile uint32_t sleep_rounds, sleep_early;
+
+static coro_sched_t sched;
+static coro_t ping, pong, waiter, taker;
+static hrtimer_t isr_timer;
+static sem_t *sem;
+
+static char name_a = 'A', name_b = 'B';
+static char order[8];
+static uint32_t order_len;
+static volatile uint32_t wakes_seen, sem_taken;
+
+static uint32_t sleep_ticks(const sleeper_t *sl)
+{
+    /* 1 to 61 ticks; the wheel has CORO_WHEEL_SIZE slots */
+    return 1 + (sl->i % 7) * 10;
+}
+
+static coro_state_t sleeper(coro_t *co)
+{
+    sleeper_t *sl = (sleeper_t *) co;
+
+    CORO_BEGIN(co);
+    for (sl->round = 0; sl->round < SLEEP_ROUNDS; sl->round++) {
+        sl->start = mo_ticks();
+        CORO_DELAY(co, sleep_ticks(sl));
+        if (mo_ticks() - sl->start < sleep_ticks(sl))
+            sleep_early++;
+        sleep_rounds++;
+    }
+    CORO_END(co);
+}
+
+static coro_state_t ping_pong(coro_t *co)
+{
+    CORO_BEGIN(co);
+    while (order_len < 6) {
+        order[order_len++] = *(char *) co->arg;
+        CORO_YIELD(co);
+    }
+    CORO_END(co);
+}
+
+static coro_state_t waiter_fn(coro_t *co)
+{
+    CORO_BEGIN(co);
+    CORO_AWAIT(co); /* Woken by wake_task */
+    wakes_seen++;
+    CORO_AWAIT(co); /* Woken by the interrupt handler */
+    wakes_seen++;
+    mo_coro_wake(co);
+    CORO_AWAIT(co); /* Latched just above */
+    wakes_seen++;
+    CORO_END(co);
+}
+
+static coro_state_t taker_fn(coro_t *co)
+{
+    CORO_BEGIN(co);
+    CORO_SEM_WAIT(co, sem);
+    sem_taken++;
+    CORO_SEM_WAIT(co, sem);
+    sem_taken++;
+    CORO_END(co);
+}
+
+static void isr_wake(void *arg)
+{
+    mo_coro_wake_from_isr((coro_t *) arg);
+}
+
+static void wait_for(coro_t *co, uint32_t seen)
+{
+    for (int i = 0; i < 500; i++) {
+        if (co->state == CORO_WAITING && wakes_seen == seen)
+            return;
+        mo_task_delay(1);
+    }
+}
+
+static void wake_task(void)
+{
+    wait_for(&waiter, 0);
+    mo_coro_wake(&waiter);
+
+    wait_for(&waiter, 1);
+    mo_hrtimer_start(&isr_timer, 500);
+
+    mo_task_delay(5);
+    mo_sem_signal(sem);
+    mo_task_delay(5);
+    mo_sem_signal(sem);
+
+    while (1)
+        mo_task_delay(100);
+}
+
+static bool test_start(void)
+{
+    mo_coro_sched_init(&sched);
+    bool ok = mo_coro_wake(&waiter) != 0;
+
+    for (int i = 0; i < NUM_SLEEPERS; i++) {
+        sleepers[i].i = (uint16_t) i;
+        ok &= mo_coro_start(&sched, &sleepers[i].co, sleeper, NULL) == 0;
+    }
+    ok &= mo_coro_start(&sched, &ping, ping_pong, &name_a) == 0;
+    ok &= mo_coro_start(&sched, &pong, ping_pong, &name_b) == 0;
+    ok &= mo_coro_start(&sched, &waiter, waiter_fn, NULL) == 0;
+    ok &= mo_coro_start(&sched, &taker, taker_fn, NULL) == 0;
+
+    /* Already started */
+    ok &= mo_coro_start(&sched, &ping, ping_pong, &name_a) != 0;
+    return ok;
+}
+
+static void test_task(void)
+{
+    sem = mo_sem_create(1, 0);
+    mo_hrtimer_init(&isr_timer, isr_wake, &waiter);
+
+    bool start_ok = sem && test_start();
+    mo_task_spawn(wake_task, DEFAULT_STACK_SIZE);
+
+    uint32_t t0 = mo_ticks();
+    mo_coro_run(&sched);
+    uint32_t elapsed = mo_ticks() - t0;
+
+    bool sleep_ok = sleep_rounds == NUM_SLEEPERS * SLEEP_ROUNDS && !sleep_early;
+    bool yield_ok = !strncmp(order, "ABABAB", 6);
+    bool await_ok = wakes_seen == 3 && waiter.state == CORO_IDLE;
+    bool sem_ok = sem_taken == 2;
+
+    printf("%u coroutines in %u bytes, done in %u ticks\n",
+           (unsigned) (NUM_SLEEPERS + 4),
+           (unsigned) (sizeof(sleepers) + 4 * sizeof(coro_t)),
+           (unsigned) elapsed);
+    printf("Coroutines: start=%s sleep=%s yield=%s await=%s sem=%s\n",
+           start_ok ? "ok" : "bad", sleep_ok ? "ok" : "bad",
+           yield_ok ? "ok" : "bad", await_ok ? "ok" : "bad",
+           sem_ok ? "ok" : "bad");
+
+    bool ok = start_ok && sleep_ok && yield_ok && await_ok && sem_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,420 @@
+/* Kernel Microbenchmark Suite.
+ *
+ * Measures the cost of the kernel's hot paths with the 'mcycle' counter and
+ * the machine timer ('mtime'):
+ * - Context switch by mo_task_yield() between two tasks
+ * - Semaphore ping-pong round trip
+ * - Mutex lock/unlock, uncontended and handed over between two tasks
+ * - Condition variable broadcast to several waiters sharing one mutex
+ * - Pipe write+read by chunk size, and the zero-copy reserve/acquire path
+ * - Message queue enqueue+dequeue, by pointer, by value and lock-free
+ * - Software timer create/start/cancel/destroy
+ * - malloc/free at several sizes
+ * - memcpy/memmove/memset on 1 KiB, with equal and mismatched alignment
+ * - A two-argument mo_log() record against formatting the same message with
+ *   sprintf()
+ * - Task spawn/cancel
+ *
+ * Every result is one line of the form
+ *   BENCH:<name> cycles=<per-op> ns=<per-op>
+ * followed by 'BENCH:done', so CI can record the numbers and compare them
+ * between commits (see .ci/run-app-tests.sh).
+ */
+
+#include <linmo.h>
+
+#define ITERS 1000
+#define BCAST_WAITERS 8
+#define BCAST_ROUNDS 100
+#define MEM_BYTES 1024
+
+/* Start of the current measurement */
+static uint32_t start_cycles, start_time;
+
+/* Partner task handshake */
+static volatile bool partner_stop, partner_done;
+
+static sem_t *ping, *pong;
+static mutex_t lock;
+static cond_t bcast_cv;
+static volatile uint32_t bcast_gen, bcast_woken;
+
+static inline void bench_begin(void)
+{
+    start_time = hal_clock_read();
+    start_cycles = read_csr(mcycle);
+}
+
+static void bench_end(const char *name, uint32_t ops)
+{
+    uint32_t cycles = read_csr(mcycle) - start_cycles;
+    uint32_t ticks = hal_clock_read() - start_time;
+    uint32_t ns = (uint32_t) (((uint64_t) ticks * 1000000000U / F_CPU) / ops);
+
+    printf("BENCH:%s cycles=%lu ns=%lu\n", name, cycles / ops, ns);
+}
+
+/* Partner side: leave the benchmark for good. The main task cancels us once
+ * 'partner_done' is seen, which is safe in READY or SUSPENDED state since we
+ * are not queued on any semaphore or mutex by then.
+ */
+static void partner_exit(void)
+{
+    partner_done = true;
+    mo_task_suspend(mo_task_id());
+    while (1)
+        mo_task_wfi();
+}
+
+static int32_t partner_start(void *entry)
+{
+    partner_stop = false;
+    partner_done = false;
+    return mo_task_spawn(entry, DEFAULT_STACK_SIZE);
+}
+
+static void partner_reap(int32_t id)
+{
+    partner_stop = true;
+    while (!partner_done)
+        mo_task_yield();
+    mo_task_cancel((uint16_t) id);
+}
+
+static void yield_partner(void)
+{
+    while (!partner_stop)
+        mo_task_yield();
+    partner_exit();
+}
+
+static void sem_partner(void)
+{
+    for (int i = 0; i < ITERS; i++) {
+        mo_sem_wait(ping);
+        mo_sem_signal(pong);
+    }
+    partner_exit();
+}
+
+static void mutex_partner(void)
+{
+    for (int i = 0; i < ITERS; i++) {
+        mo_mutex_lock(&lock);
+        mo_task_yield();
+        mo_mutex_unlock(&lock);
+    }
+    partner_exit();
+}
+
+static void bcast_waiter(void)
+{
+    uint32_t seen = 0;
+
+    mo_mutex_lock(&lock);
+    for (int i = 0; i < BCAST_ROUNDS; i++) {
+        while (bcast_gen == seen)
+            mo_cond_wait(&bcast_cv, &lock);
+        seen = bcast_gen;
+        bcast_woken++;
+    }
+    mo_mutex_unlock(&lock);
+    mo_task_suspend(mo_task_id());
+}
+
+/* Spawned and cancelled by the spawn benchmark; never scheduled */
+static void spawn_target(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+static void *timer_noop(void *arg)
+{
+    return arg;
+}
+
+static void bench_yield(void)
+{
+    int32_t id = partner_start(yield_partner);
+    mo_task_yield(); /* Let the partner reach its loop */
+
+    bench_begin();
+    for (int i = 0; i < ITERS; i++)
+        mo_task_yield();
+    /* Each yield switches to the partner and back */
+    bench_end("yield_switch", 2 * ITERS);
+
+    partner_reap(id);
+}
+
+static void bench_sem(void)
+{
+    ping = mo_sem_create(1, 0);
+    pong = mo_sem_create(1, 0);
+    int32_t id = partner_start(sem_partner);
+
+    bench_begin();
+    for (int i = 0; i < ITERS; i++) {
+        mo_sem_signal(ping);
+        mo_sem_wait(pong);
+    }
+    bench_end("sem_pingpong", ITERS);
+
+    partner_reap(id);
+    mo_sem_destroy(ping);
+    mo_sem_destroy(pong);
+}
+
+static void bench_mutex(void)
+{
+    mo_mutex_init(&lock);
+
+    bench_begin();
+    for (int i = 0; i < ITERS; i++) {
+        mo_mutex_lock(&lock);
+        mo_mutex_unlock(&lock);
+    }
+    bench_end("mutex_uncontended", ITERS);
+
+    /* Both tasks yield while holding the mutex, so every lock blocks and
+     * every unlock hands ownership to the other task.
+     */
+    int32_t id = partner_start(mutex_partner);
+    bench_begin();
+    for (int i = 0; i < ITERS; i++) {
+        mo_mutex_lock(&lock);
+        mo_task_yield();
+        mo_mutex_unlock(&lock);
+    }
+    bench_end("mutex_contended", ITERS);
+
+    partner_reap(id);
+    mo_mutex_destroy(&lock);
+}
+
+static void bench_cond(void)
+{
+    int32_t ids[BCAST_WAITERS];
+
+    mo_mutex_init(&lock);
+    mo_cond_init(&bcast_cv);
+    bcast_gen = bcast_woken = 0;
+    for (int i = 0; i < BCAST_WAITERS; i++)
+        ids[i] = mo_task_spawn(bcast_waiter, DEFAULT_STACK_SIZE);
+    while (mo_cond_waiting_count(&bcast_cv) < BCAST_WAITERS)
+        mo_task_yield();
+
+    /* A waiter queues itself again before it drops the mutex, so once all
+     * have counted this round they are all back on the condition.
+     */
+    bench_begin();
+    for (uint32_t r = 1; r <= BCAST_ROUNDS; r++) {
+        mo_mutex_lock(&lock);
+        bcast_gen = r;
+        mo_cond_broadcast(&bcast_cv);
+        mo_mutex_unlock(&lock);
+        while (bcast_woken < r * BCAST_WAITERS)
+            mo_task_yield();
+    }
+    bench_end("cond_broadcast", BCAST_ROUNDS);
+
+    /* Wait for the last waiter to drop the mutex before reaping */
+    mo_mutex_lock(&lock);
+    mo_mutex_unlock(&lock);
+    for (int i = 0; i < BCAST_WAITERS; i++)
+        mo_task_cancel((uint16_t) ids[i]);
+    mo_cond_destroy(&bcast_cv);
+    mo_mutex_destroy(&lock);
+}
+
+static void bench_pipe(void)
+{
+    static const uint16_t chunks[] = {1, 16, 64, 256};
+    static char buf[256];
+    pipe_t *p = mo_pipe_create(512);
+
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        char name[16];
+        sprintf(name, "pipe_rw_%u", chunks[c]);
+
+        bench_begin();
+        for (int i = 0; i < ITERS; i++) {
+            mo_pipe_nbwrite(p, buf, chunks[c]);
+            mo_pipe_nbread(p, buf, chunks[c]);
+        }
+        bench_end(name, ITERS);
+    }
+
+    /* The same 64-byte transfer in place: no copy on either side */
+    pipe_span_t span;
+    bench_begin();
+    for (int i = 0; i < ITERS; i++) {
+        mo_pipe_write_reserve(p, &span, 64);
+        mo_pipe_write_commit(p, 64);
+        mo_pipe_read_acquire(p, &span, 64);
+        mo_pipe_read_release(p, 64);
+    }
+    bench_end("pipe_zc_64", ITERS);
+
+    mo_pipe_destroy(p);
+}
+
+static void bench_mqueue(void)
+{
+    mq_t *mq = mo_mq_create(8);
+    message_t msg = {.payload = NULL, .type = 0, .size = 0};
+
+    bench_begin();
+    for (int i = 0; i < ITERS; i++) {
+        mo_mq_enqueue(mq, &msg);
+        mo_mq_dequeue(mq);
+    }
+    bench_end("mq_enq_deq", ITERS);
+    mo_mq_destroy(mq);
+
+    /* A 16-byte message by value, with no allocation per message */
+    uint32_t payload[4] = {0};
+    mq = mo_mq_create_fixed(8, sizeof(payload), 1);
+    bench_begin();
+    for (int i = 0; i < ITERS; i++) {
+        mo_mq_send_copy(mq, payload, 0, 0);
+        mo_mq_receive_copy(mq, payload, 0);
+    }
+    bench_end("mq_copy_16", ITERS);
+    mo_mq_destroy(mq);
+
+    /* The same round trip with no lock and no interrupt masking */
+    mq = mo_mq_create_lockfree(8);
+    bench_begin();
+    for (int i = 0; i < ITERS; i++) {
+        mo_mq_enqueue(mq, &msg);
+        mo_mq_dequeue(mq);
+    }
+    bench_end("mq_lockfree", ITERS);
+    mo_mq_destroy(mq);
+}
+
+static void bench_timer(void)
+{
+    bench_begin();
+    for (int i = 0; i < ITERS; i++) {
+        int32_t id = mo_timer_create(timer_noop, 1000, NULL);
+        mo_timer_start((uint16_t) id, TIMER_ONESHOT);
+        mo_timer_cancel((uint16_t) id);
+        mo_timer_destroy((uint16_t) id);
+    }
+    bench_end("timer_lifecycle", ITERS);
+}
+
+static void bench_malloc(void)
+{
+    static const uint32_t sizes[] = {16, 64, 256, 1024};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        char name[20];
+        sprintf(name, "malloc_free_%lu", sizes[s]);
+
+        bench_begin();
+        for (int i = 0; i < ITERS; i++)
+            free(malloc(sizes[s]));
+        bench_end(name, ITERS);
+    }
+}
+
+static void bench_memory(void)
+{
+    static uint32_t src[MEM_BYTES / 4 + 1], dst[MEM_BYTES / 4 + 1];
+    char *s = (char *) src, *d = (char *) dst;
+
+    bench_begin();
+    for (int i = 0; i < ITERS; i++)
+        memcpy(d, s, MEM_BYTES);
+    bench_end("memcpy_aligned_1k", ITERS);
+
+    bench_begin();
+    for (int i = 0; i < ITERS; i++)
+        memcpy(d, s + 1, MEM_BYTES);
+    bench_end("memcpy_unaligned_1k", ITERS);
+
+    /* Overlapping, destination above the source: copies backwards */
+    bench_begin();
+    for (int i = 0; i < ITERS; i++)
+        memmove(s + 3, s, MEM_BYTES);
+    bench_end("memmove_overlap_1k", ITERS);
+
+    bench_begin();
+    for (int i = 0; i < ITERS; i++)
+        memset(d + 1, i, MEM_BYTES);
+    bench_end("memset_1k", ITERS);
+}
+
+static void bench_log(void)
+{
+#if CONFIG_LOG
+    static char line[64];
+
+    bench_begin();
+    for (int i = 0; i < ITERS; i++)
+        mo_log("bench %d of %d", i, ITERS);
+    bench_end("log_record", ITERS);
+
+    /* Discard what the loop left in the ring */
+    log_record_t r;
+    while (mo_log_read(&r, 1))
+        ;
+    mo_log_lost();
+
+    bench_begin();
+    for (int i = 0; i < ITERS; i++)
+        sprintf(line, "bench %d of %d", i, ITERS);
+    bench_end("log_sprintf", ITERS);
+#endif
+}
+
+static void bench_spawn(void)
+{
+    bench_begin();
+    for (int i = 0; i < ITERS; i++) {
+        int32_t id = mo_task_spawn(spawn_target, DEFAULT_STACK_SIZE);
+        mo_task_cancel((uint16_t) id);
+    }
+    bench_end("spawn_cancel", ITERS);
+}
+
+static void bench_task(void)
+{
+    printf("ctxbench: iters=%d f_cpu=%d\n", ITERS, F_CPU);
+
+    bench_yield();
+    bench_sem();
+    bench_mutex();
+    bench_cond();
+    bench_pipe();
+    bench_mqueue();
+    bench_timer();
+    bench_malloc();
+    bench_memory();
+    bench_log();
+    bench_spawn();
+
+    printf("BENCH:done\n");
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(bench_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
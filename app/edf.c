@@ -0,0 +1,111 @@
+#include <linmo.h>
+
+#include "private/error.h"
+
+/* Periodic task set, all values in system ticks.
+ * Total utilization is 2/10 + 4/20 + 8/40 = 0.6, which both EDF and RM can
+ * schedule. A fourth task with utilization 0.5 must be rejected.
+ */
+static rt_params_t fast = {.period = 10, .deadline = 10, .wcet = 2};
+static rt_params_t medium = {.period = 20, .deadline = 20, .wcet = 4};
+static rt_params_t slow = {.period = 40, .deadline = 40, .wcet = 8};
+static rt_params_t greedy = {.period = 10, .deadline = 10, .wcet = 5};
+
+static int32_t greedy_result;
+
+/* Busy-wait for about @ticks system ticks to emulate a job's work */
+static void burn(uint32_t ticks)
+{
+    uint32_t start = mo_ticks();
+    while (mo_ticks() - start < ticks)
+        ;
+}
+
+/* Each periodic task runs one job per period and then waits for the next */
+static void fast_task(void)
+{
+    while (1) {
+        burn(fast.wcet - 1);
+        mo_rt_wait_period();
+    }
+}
+
+static void medium_task(void)
+{
+    while (1) {
+        burn(medium.wcet - 1);
+        mo_rt_wait_period();
+    }
+}
+
+static void slow_task(void)
+{
+    while (1) {
+        burn(slow.wcet - 1);
+        mo_rt_wait_period();
+    }
+}
+
+/* Never admitted; only used as the target of the rejected attach */
+static void greedy_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+/* Non-real-time monitor: reports job statistics once per second */
+static void monitor_task(void)
+{
+    for (int round = 1; round <= 3; round++) {
+        mo_task_delay(100);
+        printf("[%d] fast %lu/%lu  medium %lu/%lu  slow %lu/%lu (jobs/misses)\n",
+               round, fast.jobs, fast.misses, medium.jobs, medium.misses,
+               slow.jobs, slow.misses);
+    }
+
+    bool admission_ok = (greedy_result == ERR_RT_ADMISSION);
+    bool deadlines_ok = fast.jobs && medium.jobs && slow.jobs &&
+                        !fast.misses && !medium.misses && !slow.misses;
+
+    printf("Utilization: %lu/1000\n", mo_rt_utilization());
+    printf("Admission Control: %s\n", admission_ok ? "PASS" : "FAIL");
+    printf("Deadlines: %s\n", deadlines_ok ? "PASS" : "FAIL");
+    printf("Overall: %s\n", (admission_ok && deadlines_ok) ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+/* Keeps the system runnable while every other task sleeps */
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    int32_t fast_id = mo_task_spawn(fast_task, DEFAULT_STACK_SIZE);
+    int32_t medium_id = mo_task_spawn(medium_task, DEFAULT_STACK_SIZE);
+    int32_t slow_id = mo_task_spawn(slow_task, DEFAULT_STACK_SIZE);
+    int32_t greedy_id = mo_task_spawn(greedy_task, DEFAULT_STACK_SIZE);
+    mo_task_spawn(monitor_task, DEFAULT_STACK_SIZE);
+    int32_t idle_id = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+
+    mo_task_priority(greedy_id, TASK_PRIO_IDLE);
+    mo_task_priority(idle_id, TASK_PRIO_IDLE);
+
+    /* Install the EDF scheduler and attach the periodic tasks */
+    mo_rt_init(RT_POLICY_EDF);
+    mo_task_rt_priority(fast_id, &fast);
+    mo_task_rt_priority(medium_id, &medium);
+    mo_task_rt_priority(slow_id, &slow);
+
+    /* 0.6 + 0.5 exceeds 1.0, so this must fail */
+    greedy_result = mo_task_rt_priority(greedy_id, &greedy);
+    printf("Admitted utilization: %lu/1000, greedy task: %ld\n",
+           mo_rt_utilization(), greedy_result);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,154 @@
+/* Multi-Region Heap Test.
+ *
+ * Purpose:
+ * - mo_heap_add_region() rejects invalid and overlapping regions and
+ *   accepts a static buffer as an extra fast region
+ * - malloc() and MEM_BULK take slow memory, MEM_FAST and MEM_FAST_ONLY fast
+ *   memory, and free() returns each block to its own region
+ * - Once the fast regions are full, MEM_FAST falls back to slow memory
+ *   while MEM_FAST_ONLY fails
+ * - mo_task_spawn_fast() places the task's stack in fast memory
+ *
+ * The kernel may already have added the linker script's 'fastram' as a
+ * fast region; the test works with whatever fast regions exist.
+ */
+
+#include <linmo.h>
+
+#define EXTRA_BYTES 8192
+#define FILL_BLOCK 4096
+
+static uint32_t extra[EXTRA_BYTES / sizeof(uint32_t)];
+static volatile int32_t fast_stack_region = -2;
+
+static bool in_fast(const void *p)
+{
+    heap_stats_t st;
+    int32_t r = mo_heap_region(p);
+    return r >= 0 && mo_heap_region_stats((uint32_t) r, &st) == 0 &&
+           (st.flags & HEAP_REGION_FAST);
+}
+
+static bool test_add(int32_t *index)
+{
+    bool ok = mo_heap_add_region(NULL, EXTRA_BYTES, HEAP_REGION_FAST) < 0 &&
+              mo_heap_add_region(extra, 16, HEAP_REGION_FAST) < 0;
+
+    *index = mo_heap_add_region(extra, sizeof(extra), HEAP_REGION_FAST);
+    ok &= *index > 0;
+
+    /* The same memory, or part of it, cannot be added twice */
+    ok &= mo_heap_add_region(extra + 16, EXTRA_BYTES / 2, 0) < 0;
+
+    heap_stats_t st;
+    ok &= mo_heap_region_stats((uint32_t) *index, &st) == 0 &&
+          st.regions == 1 && (st.flags & HEAP_REGION_FAST) && !st.used &&
+          st.total <= sizeof(extra);
+    ok &= mo_heap_region_stats(CONFIG_HEAP_REGIONS, &st) < 0;
+    return ok;
+}
+
+static bool test_hints(void)
+{
+    void *any = malloc(64);
+    void *bulk = malloc_region(64, MEM_BULK);
+    void *fast = malloc_region(64, MEM_FAST);
+    void *only = malloc_region(64, MEM_FAST_ONLY);
+
+    bool ok = any && !in_fast(any) && bulk && !in_fast(bulk) && fast &&
+              in_fast(fast) && only && in_fast(only);
+    ok &= !malloc_region(64, MEM_BULK + 1);
+
+    /* Resizing keeps a fast block in fast memory */
+    void *grown = realloc(fast, 256);
+    ok &= grown && in_fast(grown);
+
+    free(any);
+    free(bulk);
+    free(grown ? grown : fast);
+    free(only);
+    return ok;
+}
+
+static bool test_fallback(void)
+{
+    void *chain = NULL;
+    heap_stats_t before, st;
+
+    mo_heap_stats(&before);
+
+    /* Fill the fast regions, linking the blocks through their first word */
+    void *b;
+    while ((b = malloc_region(FILL_BLOCK, MEM_FAST_ONLY))) {
+        *(void **) b = chain;
+        chain = b;
+    }
+
+    bool ok = chain != NULL;
+    ok &= !malloc_region(FILL_BLOCK, MEM_FAST_ONLY);
+    void *spill = malloc_region(FILL_BLOCK, MEM_FAST);
+    ok &= spill && !in_fast(spill);
+    free(spill);
+
+    while (chain) {
+        b = chain;
+        chain = *(void **) b;
+        free(b);
+    }
+
+    mo_heap_stats(&st);
+    return ok && st.used == before.used && st.allocs == before.allocs &&
+           st.free_blocks == before.free_blocks;
+}
+
+static void fast_task(void)
+{
+    int local = 0;
+    fast_stack_region = in_fast(&local) ? 1 : 0;
+    while (1)
+        mo_task_delay(100);
+}
+
+static bool test_stack(void)
+{
+    mo_task_spawn_fast(fast_task, DEFAULT_STACK_SIZE);
+    for (int i = 0; i < 100 && fast_stack_region < 0; i++)
+        mo_task_delay(1);
+    return fast_stack_region == 1;
+}
+
+static void test_task(void)
+{
+    int32_t index = -1;
+    bool add_ok = test_add(&index);
+    bool hints_ok = add_ok && test_hints();
+    bool fallback_ok = add_ok && test_fallback();
+    bool stack_ok = add_ok && test_stack();
+
+    mo_heap_dump();
+    printf("Heap regions: add=%s hints=%s fallback=%s stack=%s\n",
+           add_ok ? "ok" : "bad", hints_ok ? "ok" : "bad",
+           fallback_ok ? "ok" : "bad", stack_ok ? "ok" : "bad");
+
+    bool ok = add_ok && hints_ok && fallback_ok && stack_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
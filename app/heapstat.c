@@ -0,0 +1,95 @@
+/* Heap Statistics Test.
+ *
+ * Purpose:
+ * - mo_heap_stats() accounts every byte: used and free bytes plus one
+ *   header per block add up to the heap size
+ * - Allocating and freeing move 'used', 'allocs' and the peak as expected
+ * - Freeing every other block of a run fragments the free space, which
+ *   shows up in the free-block count, the histogram and frag_pct, and
+ *   freeing the rest coalesces it again
+ * - A request larger than the heap is counted as a failure
+ */
+
+#include <linmo.h>
+
+#define BLOCKS 16
+#define BLOCK_BYTES 1000
+#define HDR 8 /* Header bytes kept on every heap block */
+
+static bool consistent(const heap_stats_t *st)
+{
+    /* One end marker block per region */
+    uint32_t blocks = st->allocs + st->free_blocks + st->regions;
+    uint32_t hist = 0;
+    for (int i = 0; i < HEAP_HIST_BUCKETS; i++)
+        hist += st->free_hist[i];
+
+    return st->used + st->free + blocks * HDR == st->total &&
+           hist == st->free_blocks && st->largest_free <= st->free &&
+           st->peak >= st->used && st->frag_pct <= 100;
+}
+
+static void test_task(void)
+{
+    heap_stats_t before, st;
+    void *blocks[BLOCKS];
+
+    mo_heap_stats(&before);
+    bool ok_before = consistent(&before);
+
+    for (int i = 0; i < BLOCKS; i++)
+        blocks[i] = malloc(BLOCK_BYTES);
+    mo_heap_stats(&st);
+    bool alloc_ok = consistent(&st) && st.allocs == before.allocs + BLOCKS &&
+                    st.used >= before.used + BLOCKS * BLOCK_BYTES &&
+                    st.peak >= st.used;
+
+    /* Holes between live blocks cannot merge */
+    for (int i = 0; i < BLOCKS; i += 2)
+        free(blocks[i]);
+    mo_heap_stats(&st);
+    bool frag_ok = consistent(&st) &&
+                   st.free_blocks >= before.free_blocks + BLOCKS / 2 - 1 &&
+                   st.frag_pct >= before.frag_pct;
+    uint32_t peak = st.peak;
+
+    for (int i = 1; i < BLOCKS; i += 2)
+        free(blocks[i]);
+    mo_heap_stats(&st);
+    bool merge_ok = consistent(&st) && st.used == before.used &&
+                    st.free_blocks == before.free_blocks &&
+                    st.largest_free == before.largest_free &&
+                    st.peak == peak;
+
+    bool fail_ok = malloc(st.total) == NULL;
+    mo_heap_stats(&st);
+    fail_ok &= st.failures == before.failures + 1;
+
+    mo_heap_dump();
+    printf("Heap stats: before=%s alloc=%s frag=%s merge=%s failures=%s\n",
+           ok_before ? "ok" : "bad", alloc_ok ? "ok" : "bad",
+           frag_ok ? "ok" : "bad", merge_ok ? "ok" : "bad",
+           fail_ok ? "ok" : "bad");
+
+    bool ok = ok_before && alloc_ok && frag_ok && merge_ok && fail_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,117 @@
+/* High-Resolution Timer Test.
+ *
+ * Purpose:
+ * - A 2 ms one-shot fires after at least 2 ms and well before the next
+ *   10 ms scheduler tick would have
+ * - Timers armed out of order fire in deadline order
+ * - A callback re-arming itself with mo_hrtimer_forward() keeps a fixed
+ *   period, and can wake a task through mo_sem_signal_from_isr()
+ * - A cancelled timer never fires
+ */
+
+#include <linmo.h>
+
+#include "private/error.h"
+
+#define CYCLES_PER_US (F_CPU / 1000000U)
+#define PERIODS 20
+#define PERIOD_US 500
+
+static hrtimer_t oneshot, ordered[3], periodic, cancelled;
+static volatile uint32_t oneshot_at;
+static volatile int order[3], order_count;
+static volatile int periods;
+static volatile bool cancelled_fired;
+static sem_t *done;
+
+static void oneshot_cb(void *arg)
+{
+    (void) arg;
+    oneshot_at = hal_clock_read();
+}
+
+static void ordered_cb(void *arg)
+{
+    order[order_count++] = (int) (size_t) arg;
+}
+
+static void periodic_cb(void *arg)
+{
+    (void) arg;
+    if (++periods < PERIODS)
+        mo_hrtimer_forward(&periodic, PERIOD_US);
+    else
+        mo_sem_signal_from_isr(done);
+}
+
+static void cancelled_cb(void *arg)
+{
+    (void) arg;
+    cancelled_fired = true;
+}
+
+static void test_task(void)
+{
+    /* One-shot, armed right after a tick so the next one is 10 ms away */
+    mo_hrtimer_init(&oneshot, oneshot_cb, NULL);
+    mo_task_delay(1);
+    uint32_t start = hal_clock_read();
+    mo_hrtimer_start(&oneshot, 2000);
+    while (!oneshot_at)
+        ;
+    uint32_t elapsed_us = (oneshot_at - start) / CYCLES_PER_US;
+    bool oneshot_ok = elapsed_us >= 2000 && elapsed_us < 1000000 / F_TIMER;
+
+    /* Deadline order: armed 3, 1, 2 ms out */
+    static const uint32_t delays[3] = {3000, 1000, 2000};
+    for (int i = 0; i < 3; i++) {
+        mo_hrtimer_init(&ordered[i], ordered_cb, (void *) (size_t) i);
+        mo_hrtimer_start(&ordered[i], delays[i]);
+    }
+    while (order_count < 3)
+        ;
+    bool order_ok = order[0] == 1 && order[1] == 2 && order[2] == 0;
+
+    /* Periodic by forwarding, ending in a task wakeup */
+    mo_hrtimer_init(&periodic, periodic_cb, NULL);
+    mo_hrtimer_init(&cancelled, cancelled_cb, NULL);
+    mo_hrtimer_start(&cancelled, 1000);
+    bool cancel_ok = mo_hrtimer_cancel(&cancelled) == ERR_OK &&
+                     mo_hrtimer_cancel(&cancelled) == ERR_FAIL;
+
+    start = hal_clock_read();
+    mo_hrtimer_start(&periodic, PERIOD_US);
+    mo_sem_wait(done);
+    uint32_t total_us = (hal_clock_read() - start) / CYCLES_PER_US;
+    bool periodic_ok = periods == PERIODS && total_us >= PERIODS * PERIOD_US;
+    mo_task_delay(2);
+    cancel_ok &= !cancelled_fired;
+
+    printf("hrtimer: oneshot=%luus order=%s periodic=%luus cancel=%s\n",
+           elapsed_us, order_ok ? "ok" : "bad", total_us,
+           cancel_ok ? "ok" : "bad");
+
+    bool ok = oneshot_ok && order_ok && periodic_ok && cancel_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    done = mo_sem_create(1, 0);
+
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
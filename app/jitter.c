@@ -0,0 +1,121 @@
+/* Timer Interrupt Jitter Measurement.
+ *
+ * Purpose:
+ * - Characterize how late the tick handler runs against its 'mtimecmp'
+ *   deadline, first on an idle system and then under background load
+ * - The load tasks hammer malloc/free and a message queue, whose
+ *   CRITICAL_ENTER sections hold the tick off
+ *
+ * Requires CONFIG_IRQ_LATENCY=1; results are in 'mtime' cycles and
+ * microseconds, followed by the lateness histogram of each phase.
+ */
+
+#include <linmo.h>
+
+#define PHASE_TICKS 100 /* One second per phase at the default 100 Hz tick */
+
+static volatile bool load_on;
+
+/* Allocates and releases blocks of changing size to exercise the heap */
+static void heap_load(void)
+{
+    uint32_t size = 8;
+
+    while (1) {
+        if (!load_on) {
+            mo_task_wfi();
+            continue;
+        }
+        void *a = malloc(size);
+        void *b = malloc(size * 3);
+        free(a);
+        free(b);
+        size = (size * 7 + 13) & 511;
+    }
+}
+
+/* Moves messages through a queue to exercise its locked paths */
+static void mq_load(void)
+{
+    mq_t *mq = mo_mq_create(16);
+    message_t msg = {.payload = NULL, .type = 0, .size = 0};
+
+    while (1) {
+        if (!load_on) {
+            mo_task_wfi();
+            continue;
+        }
+        for (int i = 0; i < 16; i++)
+            mo_mq_enqueue(mq, &msg);
+        while (mo_mq_dequeue(mq))
+            ;
+        mo_task_yield();
+    }
+}
+
+#if CONFIG_IRQ_LATENCY
+static uint32_t to_us(uint32_t cycles)
+{
+    return (uint32_t) ((uint64_t) cycles * 1000000U / F_CPU);
+}
+
+static void report(const char *phase)
+{
+    hal_latency_t st;
+    hal_tick_latency_read(&st);
+
+    printf("%s: ticks=%lu min=%lu avg=%lu max=%lu cycles (max %lu us)\n",
+           phase, st.count, st.min, st.avg, st.max, to_us(st.max));
+    for (int i = 0; i < HAL_LATENCY_BUCKETS; i++) {
+        if (!st.hist[i])
+            continue;
+        if (i == 0)
+            printf("  late 0: %lu\n", st.hist[i]);
+        else
+            printf("  late < %lu: %lu\n", 1UL << i, st.hist[i]);
+    }
+}
+#endif
+
+static void monitor_task(void)
+{
+#if CONFIG_IRQ_LATENCY
+    /* Idle baseline */
+    hal_tick_latency_reset();
+    mo_task_delay(PHASE_TICKS);
+    report("idle");
+
+    /* Background load */
+    load_on = true;
+    hal_tick_latency_reset();
+    mo_task_delay(PHASE_TICKS);
+    load_on = false;
+    report("loaded");
+#else
+    printf("jitter: rebuild with CONFIG_IRQ_LATENCY=1 to measure\n");
+#endif
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    int32_t monitor = mo_task_spawn(monitor_task, DEFAULT_STACK_SIZE);
+    mo_task_spawn(heap_load, DEFAULT_STACK_SIZE);
+    mo_task_spawn(mq_load, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+
+    /* The monitor must run on time to bracket each phase */
+    mo_task_priority((uint16_t) monitor, TASK_PRIO_HIGH);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,188 @@
+/* Lock Contention Statistics Test.
+ *
+ * Purpose:
+ * - Uncontended mutex and semaphore acquisitions are counted, not timed
+ * - A task that blocks on a held mutex counts as contended, its wait is
+ *   timed, and the holder is charged with the longest hold
+ * - A semaphore wait ended by a signal is timed; a timed-out mutex wait
+ *   still adds to the wait statistics
+ * - mo_lock_stats_dump() ranks the registered locks, and destroy removes
+ *   them from the registry
+ *
+ * Without CONFIG_LOCK_STATS, only checks that the queries report failure.
+ */
+
+#include <linmo.h>
+
+#define HOLD_TICKS 5
+
+static mutex_t lock;
+static sem_t *tokens;
+
+#if CONFIG_LOCK_STATS
+static volatile bool holding, taken;
+
+static void holder_task(void)
+{
+    mo_mutex_lock(&lock);
+    holding = true;
+    mo_task_delay(HOLD_TICKS);
+    mo_mutex_unlock(&lock);
+    while (1)
+        mo_task_delay(100);
+}
+
+static void waiter_task(void)
+{
+    mo_sem_wait(tokens);
+    taken = true;
+    while (1)
+        mo_task_delay(100);
+}
+
+static bool test_uncontended(void)
+{
+    lock_stats_t ms, ss;
+    bool ok = mo_mutex_lock(&lock) == 0 && mo_mutex_unlock(&lock) == 0;
+    ok &= mo_mutex_trylock(&lock) == 0 && mo_mutex_unlock(&lock) == 0;
+    mo_sem_signal(tokens);
+    mo_sem_wait(tokens);
+
+    ok &= mo_mutex_stats(&lock, &ms) == 0 && mo_sem_stats(tokens, &ss) == 0;
+    return ok && ms.acquired == 2 && ms.contended == 0 && !ms.wait_total &&
+           ss.acquired == 1 && ss.contended == 0 && !ss.wait_total;
+}
+
+static bool test_mutex(void)
+{
+    int32_t holder = mo_task_spawn(holder_task, DEFAULT_STACK_SIZE);
+    if (holder < 0)
+        return false;
+    for (int i = 0; i < 50 && !holding; i++)
+        mo_task_delay(1);
+
+    /* Blocks until the holder lets go, HOLD_TICKS later */
+    bool ok = holding && mo_mutex_lock(&lock) == 0;
+    ok &= mo_mutex_unlock(&lock) == 0;
+
+    lock_stats_t st;
+    ok &= mo_mutex_stats(&lock, &st) == 0;
+    printf("mutex: acq=%lu cont=%lu wait_max=%lu hold_max=%lu by %u\n",
+           st.acquired, st.contended, st.wait_max, st.hold_max,
+           st.hold_max_tid);
+    ok &= st.acquired == 4 && st.contended == 1;
+    ok &= st.wait_max > 0 && st.wait_total == st.wait_max;
+    ok &= st.hold_max >= st.wait_max && st.hold_max_tid == holder;
+
+    /* A wait that times out is timed too, but acquires nothing */
+    mo_task_cancel((uint16_t) holder);
+    holding = false;
+    holder = mo_task_spawn(holder_task, DEFAULT_STACK_SIZE);
+    if (holder < 0)
+        return false;
+    for (int i = 0; i < 50 && !holding; i++)
+        mo_task_delay(1);
+
+    lock_stats_t before;
+    ok &= mo_mutex_stats(&lock, &before) == 0;
+    ok &= holding && mo_mutex_timedlock(&lock, 1) != 0;
+    ok &= mo_mutex_stats(&lock, &st) == 0;
+    ok &= st.contended == before.contended + 1 &&
+          st.acquired == before.acquired && st.wait_total > before.wait_total;
+
+    /* Let the holder release it before it goes */
+    mo_task_delay(HOLD_TICKS + 1);
+    mo_task_cancel((uint16_t) holder);
+    return ok && !mo_mutex_waiting_count(&lock);
+}
+
+static bool test_sem(void)
+{
+    int32_t waiter = mo_task_spawn(waiter_task, DEFAULT_STACK_SIZE);
+    if (waiter < 0)
+        return false;
+
+    /* Let it queue, then hand it a token a few ticks later */
+    mo_task_delay(HOLD_TICKS);
+    mo_sem_signal(tokens);
+    for (int i = 0; i < 50 && !taken; i++)
+        mo_task_delay(1);
+
+    lock_stats_t st;
+    bool ok = taken && mo_sem_stats(tokens, &st) == 0;
+    ok &= st.acquired == 2 && st.contended == 1 && st.wait_max > 0;
+    ok &= st.hold_max == 0;
+
+    mo_task_cancel((uint16_t) waiter);
+    return ok;
+}
+
+static bool test_registry(void)
+{
+    sem_t *idle_sem = mo_sem_create(1, 1);
+    bool ok = idle_sem != NULL;
+    ok &= mo_mutex_stats_register(&lock, "test.lock") == 0;
+    ok &= mo_sem_stats_register(tokens, "test.tokens") == 0;
+    ok &= mo_sem_stats_register(idle_sem, "test.idle") == 0;
+    mo_lock_stats_dump(4);
+
+    /* A destroyed lock leaves the registry; reset clears the rest */
+    ok &= mo_sem_destroy(idle_sem) == 0;
+    mo_lock_stats_reset();
+    mo_lock_stats_dump(4);
+
+    lock_stats_t st;
+    ok &= mo_mutex_stats(&lock, &st) == 0;
+    return ok && st.acquired == 0 && st.wait_total == 0 &&
+           st.kind == LOCK_STAT_MUTEX;
+}
+#endif
+
+static void test_task(void)
+{
+    bool create_ok = mo_mutex_init(&lock) == 0;
+    tokens = mo_sem_create(4, 0);
+    create_ok &= tokens != NULL;
+
+#if CONFIG_LOCK_STATS
+    bool plain_ok = create_ok && test_uncontended();
+    bool mutex_ok = create_ok && test_mutex();
+    bool sem_ok = create_ok && test_sem();
+    bool registry_ok = create_ok && test_registry();
+
+    printf("Lockstat: plain=%s mutex=%s sem=%s registry=%s\n",
+           plain_ok ? "ok" : "bad", mutex_ok ? "ok" : "bad",
+           sem_ok ? "ok" : "bad", registry_ok ? "ok" : "bad");
+#else
+    lock_stats_t st;
+    bool plain_ok = create_ok && mo_mutex_stats(&lock, &st) != 0 &&
+                    mo_sem_stats(tokens, &st) != 0;
+    bool mutex_ok = true, sem_ok = true, registry_ok = true;
+    mo_lock_stats_dump(4);
+
+    printf("Lockstat: off=%s (rebuild with CONFIG_LOCK_STATS=1)\n",
+           plain_ok ? "ok" : "bad");
+#endif
+
+    bool ok = plain_ok && mutex_ok && sem_ok && registry_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
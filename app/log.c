@@ -0,0 +1,152 @@
+/* Deferred Log Test.
+ *
+ * Purpose:
+ * - mo_log() stores the format string, the caller's task ID, a timestamp
+ *   and each argument unchanged, for zero to LOG_MAX_ARGS arguments
+ * - Records come back oldest first with non-decreasing timestamps
+ * - A full ring keeps the newest records and counts the overwritten ones
+ * - Interrupt handlers can log
+ * - mo_log_flush() and the logger task format and drain the ring
+ */
+
+#include <linmo.h>
+
+#if CONFIG_LOG
+
+static const char *const fmt_none = "no arguments";
+static const char *const fmt_four = "four: %d %u %x %c";
+
+static hrtimer_t isr_log;
+static volatile bool isr_done;
+
+static void isr_log_cb(void *arg)
+{
+    mo_log("from interrupt handler, arg %lx", 0xC0FFEEu);
+    isr_done = true;
+}
+
+/* Empties the ring and the lost count */
+static void drain(void)
+{
+    log_record_t r;
+    while (mo_log_read(&r, 1))
+        ;
+    mo_log_lost();
+}
+
+static bool test_fields(void)
+{
+    static log_record_t r[4];
+    uint16_t self = mo_task_id();
+
+    drain();
+    mo_log(fmt_none);
+    mo_log("one: %d", -5);
+    mo_log("two: %s %lu", "text", 123456789u);
+    mo_log(fmt_four, 1, 2u, 0xABCDu, 'z');
+
+    bool ok = mo_log_read(r, 4) == 4 && mo_log_read(r, 4) == 0;
+    ok &= r[0].fmt == fmt_none && r[0].nargs == 0 && r[0].task == self;
+    ok &= r[1].nargs == 1 && (int32_t) r[1].args[0] == -5;
+    ok &= r[2].nargs == 2 && !strcmp((const char *) r[2].args[0], "text") &&
+          r[2].args[1] == 123456789u;
+    ok &= r[3].fmt == fmt_four && r[3].nargs == 4 && r[3].args[0] == 1 &&
+          r[3].args[1] == 2 && r[3].args[2] == 0xABCD && r[3].args[3] == 'z';
+    for (int i = 1; i < 4; i++)
+        ok &= (int32_t) (r[i].ts - r[i - 1].ts) >= 0 && r[i].task == self;
+    return ok && mo_log_lost() == 0;
+}
+
+static bool test_overflow(void)
+{
+    log_record_t r;
+    int extra = 10;
+
+    drain();
+    for (int i = 0; i < CONFIG_LOG_RECORDS + extra; i++)
+        mo_log("record %d", i);
+
+    bool ok = mo_log_lost() == (uint32_t) extra && mo_log_lost() == 0;
+
+    /* The oldest records went; the rest are intact and in order */
+    for (int i = extra; i < CONFIG_LOG_RECORDS + extra; i++)
+        ok &= mo_log_read(&r, 1) == 1 && r.args[0] == (uint32_t) i;
+    return ok && mo_log_read(&r, 1) == 0;
+}
+
+static bool test_isr(void)
+{
+    log_record_t r;
+
+    drain();
+    mo_hrtimer_init(&isr_log, isr_log_cb, NULL);
+    mo_hrtimer_start(&isr_log, 1000);
+    for (int i = 0; i < 100 && !isr_done; i++)
+        mo_task_delay(1);
+
+    return isr_done && mo_log_read(&r, 1) == 1 && r.nargs == 1 &&
+           r.args[0] == 0xC0FFEE;
+}
+
+static bool test_flush(void)
+{
+    log_record_t r;
+
+    drain();
+    mo_log("flushed line %d", 1);
+    mo_log("flushed line %d", 2);
+    bool ok = mo_log_flush() == 2 && mo_log_read(&r, 1) == 0;
+
+    /* The logger task drains records on its own */
+    ok &= mo_log_start(5) > 0 && mo_log_start(5) < 0;
+    mo_log("line printed by the logger task, tick %lu", mo_ticks());
+    mo_task_delay(20);
+    return ok && mo_log_read(&r, 1) == 0;
+}
+
+static void test_task(void)
+{
+    bool fields_ok = test_fields();
+    bool overflow_ok = test_overflow();
+    bool isr_ok = test_isr();
+    bool flush_ok = test_flush();
+
+    printf("Log: fields=%s overflow=%s isr=%s flush=%s\n",
+           fields_ok ? "ok" : "bad", overflow_ok ? "ok" : "bad",
+           isr_ok ? "ok" : "bad", flush_ok ? "ok" : "bad");
+
+    bool ok = fields_ok && overflow_ok && isr_ok && flush_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+#else /* !CONFIG_LOG */
+
+static void test_task(void)
+{
+    printf("Log: CONFIG_LOG disabled, nothing to test\n");
+    printf("Overall: PASS\n");
+
+    while (1)
+        mo_task_wfi();
+}
+
+#endif /* CONFIG_LOG */
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
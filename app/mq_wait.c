@@ -0,0 +1,166 @@
+/* Blocking Message Queue Test.
+ *
+ * Purpose:
+ * - A high-priority consumer blocked in mo_mq_receive() gets each message
+ *   the moment it is sent
+ * - Higher-priority messages overtake queued bulk traffic, FIFO per level
+ * - mo_mq_receive() times out on an empty queue, mo_mq_send() on a full one
+ * - A copy-in queue passes messages by value and refuses the pointer calls
+ * - Several producers blocking on a small lock-free queue all get their
+ *   messages through to one consumer, and all of its cells are usable
+ */
+
+#include <linmo.h>
+
+#include "private/error.h"
+
+#define ROUNDS 4
+#define PRODUCERS 3
+#define PER_PRODUCER 10
+
+static mq_t *mq;
+static message_t msgs[ROUNDS];
+static volatile int received;
+static volatile int next_tag;
+
+static void consumer_task(void)
+{
+    for (int i = 0; i < ROUNDS; i++) {
+        if (mo_mq_receive(mq, MQ_WAIT_FOREVER) == &msgs[i])
+            received++;
+    }
+    mo_task_suspend(mo_task_id());
+}
+
+/* Sends msgs[tag] PER_PRODUCER times, so the receiver can tell who sent */
+static void producer_task(void)
+{
+    int tag = next_tag++;
+
+    for (int i = 0; i < PER_PRODUCER; i++)
+        mo_mq_send(mq, &msgs[tag], 0, MQ_WAIT_FOREVER);
+    mo_task_suspend(mo_task_id());
+}
+
+static bool test_lockfree(void)
+{
+    int32_t ids[PRODUCERS];
+    int per[PRODUCERS] = {0};
+
+    mq = mo_mq_create_lockfree(4);
+    next_tag = 0;
+    for (int i = 0; i < PRODUCERS; i++)
+        ids[i] = mo_task_spawn(producer_task, DEFAULT_STACK_SIZE);
+
+    /* The queue fills at once, so the producers take turns blocking */
+    for (int n = 0; n < PRODUCERS * PER_PRODUCER; n++) {
+        message_t *m = mo_mq_receive(mq, 20);
+        if (!m)
+            break;
+        per[m - msgs]++;
+    }
+    for (int i = 0; i < PRODUCERS; i++)
+        mo_task_cancel((uint16_t) ids[i]);
+
+    bool ok = mo_mq_items(mq) == 0 && mo_mq_peek(mq) == NULL;
+    for (int i = 0; i < PRODUCERS; i++)
+        ok &= per[i] == PER_PRODUCER;
+
+    while (mo_mq_enqueue(mq, &msgs[0]) == ERR_OK)
+        ;
+    ok &= mo_mq_items(mq) == 4; /* Unlike queue_t, every cell holds one */
+    while (mo_mq_dequeue(mq))
+        ;
+    ok &= mo_mq_destroy(mq) == ERR_OK;
+    return ok;
+}
+
+static void test_task(void)
+{
+    /* Blocking receive: the consumer outranks us, so it has the message by
+     * the time mo_mq_send() returns.
+     */
+    mq = mo_mq_create(4);
+    int32_t consumer = mo_task_spawn(consumer_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) consumer, TASK_PRIO_HIGH);
+    mo_task_delay(2);
+
+    bool immediate = true;
+    for (int i = 0; i < ROUNDS; i++) {
+        mo_mq_send(mq, &msgs[i], 0, MQ_WAIT_FOREVER);
+        immediate &= received == i + 1;
+    }
+    mo_task_cancel((uint16_t) consumer);
+
+    /* Timeouts */
+    uint32_t start = mo_ticks();
+    bool recv_timeout = mo_mq_receive(mq, 5) == NULL && mo_ticks() - start >= 5;
+    while (mo_mq_enqueue(mq, &msgs[0]) == ERR_OK)
+        ;
+    bool send_timeout = mo_mq_send(mq, &msgs[0], 0, 3) == ERR_TIMEOUT;
+    while (mo_mq_dequeue(mq))
+        ;
+    mo_mq_destroy(mq);
+
+    /* Priorities: bulk, bulk, urgent, mid must come out urgent, mid, bulk,
+     * bulk
+     */
+    mq = mo_mq_create_prio(8, 3);
+    mo_mq_send(mq, &msgs[0], 0, 0);
+    mo_mq_send(mq, &msgs[1], 0, 0);
+    mo_mq_send(mq, &msgs[2], 2, 0);
+    mo_mq_send(mq, &msgs[3], 1, 0);
+    bool prio_ok = mo_mq_send(mq, &msgs[0], 3, 0) == ERR_FAIL;
+    prio_ok &= mo_mq_peek(mq) == &msgs[2];
+    prio_ok &= mo_mq_receive(mq, 0) == &msgs[2];
+    prio_ok &= mo_mq_receive(mq, 0) == &msgs[3];
+    prio_ok &= mo_mq_receive(mq, 0) == &msgs[0];
+    prio_ok &= mo_mq_receive(mq, 0) == &msgs[1];
+    prio_ok &= mo_mq_items(mq) == 0 && mo_mq_destroy(mq) == ERR_OK;
+
+    /* Copy-in: the sender's buffer may change right after the send */
+    mq = mo_mq_create_fixed(4, 6, 1);
+    char out[6] = "abcde", in[6] = {0};
+    bool copy_ok = mo_mq_send_copy(mq, out, 0, 0) == ERR_OK;
+    out[0] = 'X';
+    copy_ok &= mo_mq_receive_copy(mq, in, 0) == ERR_OK && !strcmp(in, "abcde");
+    copy_ok &= mo_mq_receive_copy(mq, in, 2) == ERR_TIMEOUT;
+    copy_ok &= mo_mq_enqueue(mq, &msgs[0]) == ERR_FAIL;
+    while (mo_mq_send_copy(mq, out, 0, 0) == ERR_OK)
+        ;
+    copy_ok &= mo_mq_items(mq) == 3; /* A size of 4 holds 3, like queue_t */
+    while (mo_mq_receive_copy(mq, in, 0) == ERR_OK)
+        ;
+    copy_ok &= mo_mq_destroy(mq) == ERR_OK;
+
+    bool lf_ok = test_lockfree();
+
+    printf("MQ wait: immediate=%s recv_timeout=%s send_timeout=%s prio=%s "
+           "copy=%s lockfree=%s\n",
+           immediate ? "ok" : "bad", recv_timeout ? "ok" : "bad",
+           send_timeout ? "ok" : "bad", prio_ok ? "ok" : "bad",
+           copy_ok ? "ok" : "bad", lf_ok ? "ok" : "bad");
+
+    bool ok = immediate && recv_timeout && send_timeout && prio_ok &&
+              copy_ok && lf_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
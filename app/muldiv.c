@@ -0,0 +1,121 @@
+/* Multiply/Divide Helper Test.
+ *
+ * Purpose:
+ * - __udivmoddi4() and __muldi3(), which 64-bit '/', '%' and '*' compile to,
+ *   agree with the shift-and-add versions on edge values and pseudo-random
+ *   operands of every width
+ * - Reports the machine timer cycles each version takes per operation; with
+ *   the M extension the 'divu' based division should be several times
+ *   faster
+ */
+
+#include <linmo.h>
+
+#define ROUNDS 2000
+
+static uint32_t seed = 0x1234567U;
+static volatile uint64_t sink;
+
+/* xorshift32 */
+static uint32_t next(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+/* Random value of random width, so every path of the division is taken */
+static uint64_t operand(void)
+{
+    uint64_t v = ((uint64_t) next() << 32) | next();
+    return v >> (next() & 63);
+}
+
+static bool test_edges(void)
+{
+    static const uint64_t v[] = {
+        0, 1, 2, 0xFFFFFFFFULL, 0x100000000ULL, 0x7FFFFFFFFFFFFFFFULL,
+        0x8000000000000000ULL, UINT64_MAX,
+    };
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(v) / sizeof(v[0]); i++) {
+        for (size_t j = 0; j < sizeof(v) / sizeof(v[0]); j++) {
+            uint64_t r1, r2;
+            uint64_t q1 = __udivmoddi4(v[i], v[j], &r1);
+            uint64_t q2 = _soft_udivmoddi4(v[i], v[j], &r2);
+            ok &= q1 == q2 && r1 == r2;
+            ok &= __muldi3(v[i], v[j]) == _soft_muldi3(v[i], v[j]);
+        }
+    }
+
+    /* Division by zero saturates rather than faulting */
+    uint64_t r = 1;
+    ok &= __udivmoddi4(5, 0, &r) == UINT64_MAX && r == 0;
+    return ok;
+}
+
+static bool test_random(void)
+{
+    bool ok = true;
+
+    for (int i = 0; i < ROUNDS; i++) {
+        uint64_t a = operand(), b = operand() | 1, r1, r2;
+        uint64_t q1 = __udivmoddi4(a, b, &r1);
+        uint64_t q2 = _soft_udivmoddi4(a, b, &r2);
+        ok &= q1 == q2 && r1 == r2 && q1 * b + r1 == a && r1 < b;
+        ok &= __muldi3(a, b) == _soft_muldi3(a, b);
+    }
+    return ok;
+}
+
+/* Average cycles per call of @div over the same operand sequence,
+ * including the cost of generating the operands
+ */
+static uint32_t time_div(uint64_t (*div)(uint64_t, uint64_t, uint64_t *))
+{
+    uint64_t r;
+
+    seed = 0x1234567U;
+    uint32_t t0 = hal_clock_read();
+    for (int i = 0; i < ROUNDS; i++)
+        sink += div(operand(), operand() | 1, &r);
+    uint32_t cycles = hal_clock_read() - t0;
+
+    return cycles / ROUNDS;
+}
+
+static void test_task(void)
+{
+    bool edges_ok = test_edges();
+    bool random_ok = test_random();
+
+    printf("divide: %lu cycles, soft %lu cycles\n",
+           time_div(__udivmoddi4), time_div(_soft_udivmoddi4));
+
+    printf("Muldiv: edges=%s random=%s\n", edges_ok ? "ok" : "bad",
+           random_ok ? "ok" : "bad");
+
+    bool ok = edges_ok && random_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,78 @@
+/* Direct-to-Task Notification Test.
+ *
+ * Purpose:
+ * - Event flags: a producer sets bits that a consumer waits for by mask
+ * - Counting: increments accumulate while the consumer is busy
+ * - Timeout: a wait with nothing pending returns 0 after the deadline
+ */
+
+#include <linmo.h>
+
+#define EVT_DATA (1U << 0)
+#define EVT_STOP (1U << 1)
+#define ROUNDS 5
+
+static uint16_t consumer_id;
+static int32_t data_events, stop_seen, count_taken, timeout_ok;
+
+static void consumer_task(void)
+{
+    /* Flags: wake for either bit, leave the others pending */
+    while (!stop_seen) {
+        uint32_t bits = mo_task_notify_wait(EVT_DATA | EVT_STOP, 100);
+        if (bits & EVT_DATA)
+            data_events++;
+        if (bits & EVT_STOP)
+            stop_seen = 1;
+    }
+
+    /* Counter: the producer adds ROUNDS while we sleep */
+    mo_task_delay(10);
+    count_taken = (int32_t) mo_task_notify_wait(0, NOTIFY_WAIT_FOREVER);
+
+    /* Nothing else is coming: this must time out */
+    uint32_t start = mo_ticks();
+    timeout_ok = mo_task_notify_wait(0, 5) == 0 && mo_ticks() - start >= 5;
+
+    bool ok = data_events == ROUNDS && count_taken == ROUNDS && timeout_ok;
+    printf("Notify: data=%ld count=%ld timeout=%s\n", data_events,
+           count_taken, timeout_ok ? "ok" : "bad");
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void producer_task(void)
+{
+    for (int i = 0; i < ROUNDS; i++) {
+        mo_task_notify(consumer_id, EVT_DATA, NOTIFY_SET_BITS);
+        mo_task_delay(2);
+    }
+    mo_task_notify(consumer_id, EVT_STOP, NOTIFY_SET_BITS);
+
+    /* Let the consumer go to sleep before counting */
+    mo_task_delay(2);
+    for (int i = 0; i < ROUNDS; i++)
+        mo_task_notify(consumer_id, 0, NOTIFY_INCREMENT);
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    consumer_id = (uint16_t) mo_task_spawn(consumer_task, DEFAULT_STACK_SIZE);
+    mo_task_spawn(producer_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
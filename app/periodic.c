@@ -0,0 +1,131 @@
+/* Periodic Task Test.
+ *
+ * Purpose:
+ * - mo_task_delay_until() releases jobs on exact multiples of the period,
+ *   without the drift of a mo_task_delay() loop
+ * - A job that overruns its period is counted as a miss, reported to the
+ *   miss hook with the number of releases it spanned, and the following
+ *   releases stay in phase
+ * - With CONFIG_TASK_RESPONSE, every job after the first lands in the
+ *   response time histogram
+ */
+
+#include <linmo.h>
+
+#define PERIOD 4
+#define JOBS 10
+#define OVERRUN_JOB 5
+#define OVERRUN_TICKS (2 * PERIOD + 1)
+
+static volatile bool done;
+static volatile uint32_t drift, hook_calls, hook_missed, late_returns;
+static volatile uint16_t hook_id;
+static volatile int32_t periodic_id;
+
+static void on_miss(uint16_t id, uint32_t missed)
+{
+    hook_calls++;
+    hook_id = id;
+    hook_missed = missed;
+}
+
+static void periodic_task(void)
+{
+    uint32_t start = mo_ticks();
+    uint32_t last_wake = start;
+
+    for (uint32_t job = 1; job <= JOBS; job++) {
+        /* The work; one job takes longer than two periods */
+        if (job == OVERRUN_JOB)
+            mo_task_delay(OVERRUN_TICKS);
+
+        if (mo_task_delay_until(&last_wake, PERIOD) != 0)
+            late_returns++;
+
+        /* Every release, missed or not, stays on the period grid */
+        if ((last_wake - start) % PERIOD || mo_ticks() - last_wake > 1)
+            drift++;
+    }
+
+    done = true;
+    while (1)
+        mo_task_delay(100);
+}
+
+static bool test_args(void)
+{
+    uint32_t last_wake = mo_ticks();
+    return mo_task_delay_until(NULL, PERIOD) != 0 &&
+           mo_task_delay_until(&last_wake, 0) != 0;
+}
+
+static bool test_periodic(void)
+{
+    mo_task_miss_hook(on_miss);
+    periodic_id = mo_task_spawn(periodic_task, DEFAULT_STACK_SIZE);
+    if (periodic_id < 0)
+        return false;
+    mo_task_priority((uint16_t) periodic_id, TASK_PRIO_HIGH);
+
+    for (int i = 0; i < 30 * JOBS && !done; i++)
+        mo_task_delay(1);
+
+    task_response_t r;
+    bool ok = done && mo_task_response((uint16_t) periodic_id, &r) == 0;
+    printf("jobs=%lu misses=%lu hook=%lu spanned=%lu drift=%lu\n", r.jobs,
+           r.misses, hook_calls, hook_missed, drift);
+
+    ok &= r.jobs == JOBS && r.misses == 1 && late_returns == 1;
+    ok &= hook_calls == 1 && hook_id == periodic_id &&
+          hook_missed == OVERRUN_TICKS / PERIOD;
+    ok &= !drift;
+
+#if CONFIG_TASK_RESPONSE
+    uint32_t timed = 0;
+    printf("response max %lu us, histogram:", r.max_us);
+    for (int i = 0; i < TASK_RESP_BUCKETS; i++) {
+        printf(" %lu", r.hist[i]);
+        timed += r.hist[i];
+    }
+    printf("\n");
+
+    /* The overrunning job took over two periods */
+    uint32_t tick_us = 1000000U / F_TIMER;
+    ok &= timed == JOBS - 1 && r.max_us >= 2 * PERIOD * tick_us;
+#endif
+
+    mo_task_miss_hook(NULL);
+    mo_task_cancel((uint16_t) periodic_id);
+    return ok;
+}
+
+static void test_task(void)
+{
+    bool args_ok = test_args();
+    bool periodic_ok = test_periodic();
+
+    printf("Periodic: args=%s periodic=%s\n", args_ok ? "ok" : "bad",
+           periodic_ok ? "ok" : "bad");
+
+    bool ok = args_ok && periodic_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,182 @@
+/* Blocking Pipe Test.
+ *
+ * Purpose:
+ * - A high-priority reader blocked on a pipe with an 8-byte read watermark
+ *   is switched in once per 8 bytes, not once per 1-byte write
+ * - mo_pipe_timedread() times out on an empty pipe and returns a partial
+ *   read when only some of the data arrives
+ * - mo_pipe_timedwrite() times out on a full pipe
+ * - A zero-copy reservation that wraps the ring comes back as two spans,
+ *   keeps copying writers out until committed, and reads back intact
+ * - mo_pipe_splice() hands a wrapped region to the sink in two calls, stops
+ *   at a sink that takes less, blocks on an empty pipe, and reaches stdout
+ */
+
+#include <linmo.h>
+
+#include "private/error.h"
+
+#define STREAM_LEN 16
+#define READ_WM 8
+
+static pipe_t *pipe;
+static volatile bool reader_done;
+static uint32_t reader_switches;
+static char stream[STREAM_LEN];
+static char sunk[STREAM_LEN];
+static int sunk_len, sink_room, sink_calls;
+
+/* Splice sink that keeps what it is given, up to 'sink_room' bytes */
+static int record_sink(const char *buf, int len)
+{
+    int n = sink_room - sunk_len < len ? sink_room - sunk_len : len;
+    memcpy(sunk + sunk_len, buf, n);
+    sunk_len += n;
+    sink_calls++;
+    return n;
+}
+
+static void late_writer(void)
+{
+    mo_task_delay(3);
+    mo_pipe_write(pipe, "late", 4);
+    mo_task_suspend(mo_task_id());
+}
+
+static void reader_task(void)
+{
+    task_stats_t before, after;
+
+    mo_task_stats(mo_task_id(), &before);
+    mo_pipe_read(pipe, stream, STREAM_LEN);
+    mo_task_stats(mo_task_id(), &after);
+
+    reader_switches = after.switches - before.switches;
+    reader_done = true;
+    mo_task_suspend(mo_task_id());
+}
+
+static void test_task(void)
+{
+    char buf[4];
+
+    /* Watermarked stream: 1-byte writes, batched reader wakeups */
+    mo_pipe_set_watermarks(pipe, READ_WM, 1);
+    int32_t reader = mo_task_spawn(reader_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) reader, TASK_PRIO_HIGH);
+    mo_task_delay(2); /* Let the reader block */
+
+    for (int i = 0; i < STREAM_LEN; i++) {
+        char c = 'a' + i;
+        mo_pipe_write(pipe, &c, 1);
+    }
+    while (!reader_done)
+        mo_task_delay(1);
+
+    bool stream_ok = true;
+    for (int i = 0; i < STREAM_LEN; i++)
+        stream_ok &= stream[i] == 'a' + i;
+    bool batched = reader_switches <= STREAM_LEN / READ_WM + 1;
+    mo_task_cancel((uint16_t) reader);
+    mo_pipe_set_watermarks(pipe, 1, 1);
+
+    /* Timed read on an empty pipe */
+    uint32_t start = mo_ticks();
+    bool read_timeout = mo_pipe_timedread(pipe, buf, 4, 5) == ERR_TIMEOUT &&
+                        mo_ticks() - start >= 5;
+
+    /* Partial timed read */
+    mo_pipe_nbwrite(pipe, "xy", 2);
+    bool partial = mo_pipe_timedread(pipe, buf, 4, 3) == 2;
+
+    /* Timed write on a full pipe */
+    while (mo_pipe_nbwrite(pipe, "z", 1) == 1)
+        ;
+    bool write_timeout = mo_pipe_timedwrite(pipe, "z", 1, 3) == ERR_TIMEOUT;
+
+    /* Zero-copy across the wrap: head and tail 2 bytes before the end */
+    mo_pipe_flush(pipe);
+    char fill[30] = {0};
+    mo_pipe_nbwrite(pipe, fill, 30);
+    mo_pipe_nbread(pipe, fill, 30);
+
+    pipe_span_t span;
+    bool zc_ok = mo_pipe_write_reserve(pipe, &span, 8) == 8 &&
+                 span.len[0] == 2 && span.len[1] == 6 &&
+                 mo_pipe_nbwrite(pipe, "z", 1) == 0;
+    for (int part = 0; part < 2; part++)
+        for (int i = 0; i < span.len[part]; i++)
+            span.data[part][i] = '0' + part * span.len[0] + i;
+    mo_pipe_write_commit(pipe, 8);
+
+    zc_ok &= mo_pipe_read_acquire(pipe, &span, 16) == 8;
+    int expect = '0';
+    for (int part = 0; part < 2; part++)
+        for (int i = 0; i < span.len[part]; i++)
+            zc_ok &= span.data[part][i] == expect++;
+    zc_ok &= mo_pipe_read_release(pipe, 8) == ERR_OK;
+    zc_ok &= mo_pipe_size(pipe) == 0;
+
+    /* Splice across the wrap: 4 bytes before the end, 5 after */
+    mo_pipe_flush(pipe);
+    mo_pipe_nbwrite(pipe, fill, 28);
+    mo_pipe_nbread(pipe, fill, 28);
+    mo_pipe_nbwrite(pipe, "splice-me", 9);
+    sink_room = STREAM_LEN;
+    bool splice_ok = mo_pipe_splice(pipe, record_sink, 16) == 9 &&
+                     sink_calls == 2 && !memcmp(sunk, "splice-me", 9) &&
+                     mo_pipe_size(pipe) == 0;
+
+    /* A sink with room for 3 bytes leaves the rest buffered */
+    mo_pipe_nbwrite(pipe, "abcdef", 6);
+    sunk_len = 0;
+    sink_room = 3;
+    splice_ok &= mo_pipe_splice(pipe, record_sink, 16) == 3 &&
+                 mo_pipe_size(pipe) == 3 && !memcmp(sunk, "abc", 3);
+    mo_pipe_flush(pipe);
+
+    /* An empty pipe blocks the splice until the writer comes along */
+    sunk_len = 0;
+    sink_room = STREAM_LEN;
+    int32_t writer = mo_task_spawn(late_writer, DEFAULT_STACK_SIZE);
+    start = mo_ticks();
+    splice_ok &= writer > 0 && mo_pipe_splice(pipe, record_sink, 16) == 4 &&
+                 !memcmp(sunk, "late", 4) && mo_ticks() - start >= 3;
+    mo_task_cancel((uint16_t) writer);
+
+    /* No sink: straight to the console */
+    mo_pipe_nbwrite(pipe, "spliced to stdout\n", 18);
+    splice_ok &= mo_pipe_splice(pipe, NULL, 32) == 18;
+
+    printf("Pipe wait: stream=%s switches=%lu timedread=%s partial=%s "
+           "timedwrite=%s zerocopy=%s splice=%s\n",
+           stream_ok ? "ok" : "bad", reader_switches,
+           read_timeout ? "ok" : "bad", partial ? "ok" : "bad",
+           write_timeout ? "ok" : "bad", zc_ok ? "ok" : "bad",
+           splice_ok ? "ok" : "bad");
+
+    bool ok = stream_ok && batched && read_timeout && partial &&
+              write_timeout && zc_ok && splice_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    pipe = mo_pipe_create(32);
+
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
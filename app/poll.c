@@ -0,0 +1,120 @@
+/* Wait-for-Multiple-Objects Test.
+ *
+ * Purpose:
+ * - A gateway task waits in mo_poll() on a pipe, a message queue, a
+ *   semaphore and its notification word at once
+ * - One producer per source feeds it at a different rate; every event must
+ *   arrive exactly once
+ * - A final poll with nothing pending must report a timeout
+ */
+
+#include <linmo.h>
+
+#define ROUNDS 4
+
+static pipe_t *pipe;
+static mq_t *mq;
+static sem_t *sem;
+static uint16_t gateway_id;
+static message_t msgs[ROUNDS];
+
+static void gateway_task(void)
+{
+    poll_item_t items[] = {
+        {.obj = pipe, .type = POLL_PIPE},
+        {.obj = mq, .type = POLL_MQ},
+        {.obj = sem, .type = POLL_SEM},
+        {.obj = NULL, .type = POLL_NOTIFY, .mask = 1},
+    };
+    int32_t bytes = 0, messages = 0, tokens = 0, notes = 0;
+
+    while (bytes < ROUNDS || messages < ROUNDS || tokens < ROUNDS ||
+           notes < ROUNDS) {
+        if (mo_poll(items, 4, 200) <= 0)
+            break;
+
+        char c;
+        if (items[0].ready)
+            while (mo_pipe_nbread(pipe, &c, 1) == 1)
+                bytes++;
+        if (items[1].ready)
+            while (mo_mq_dequeue(mq))
+                messages++;
+        if (items[2].ready)
+            while (mo_sem_trywait(sem) == 0)
+                tokens++;
+        if (items[3].ready)
+            notes += mo_task_notify_wait(1, 0) ? 1 : 0;
+    }
+
+    /* Nothing left: this poll must time out */
+    bool timeout_ok = mo_poll(items, 4, 5) == 0;
+
+    printf("Poll: pipe=%ld mq=%ld sem=%ld notify=%ld timeout=%s\n", bytes,
+           messages, tokens, notes, timeout_ok ? "ok" : "bad");
+    bool ok = bytes == ROUNDS && messages == ROUNDS && tokens == ROUNDS &&
+              notes == ROUNDS && timeout_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void pipe_producer(void)
+{
+    for (int i = 0; i < ROUNDS; i++) {
+        mo_task_delay(3);
+        mo_pipe_nbwrite(pipe, "x", 1);
+    }
+    while (1)
+        mo_task_wfi();
+}
+
+static void mq_producer(void)
+{
+    for (int i = 0; i < ROUNDS; i++) {
+        mo_task_delay(5);
+        mo_mq_enqueue(mq, &msgs[i]);
+    }
+    while (1)
+        mo_task_wfi();
+}
+
+static void event_producer(void)
+{
+    /* Notifications are set bits, so space them out to count each one */
+    for (int i = 0; i < ROUNDS; i++) {
+        mo_task_delay(7);
+        mo_sem_signal(sem);
+        mo_task_delay(2);
+        mo_task_notify(gateway_id, 1, NOTIFY_SET_BITS);
+    }
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    pipe = mo_pipe_create(16);
+    mq = mo_mq_create(ROUNDS);
+    sem = mo_sem_create(1, 0);
+
+    gateway_id = (uint16_t) mo_task_spawn(gateway_task, DEFAULT_STACK_SIZE);
+    mo_task_spawn(pipe_producer, DEFAULT_STACK_SIZE);
+    mo_task_spawn(mq_producer, DEFAULT_STACK_SIZE);
+    mo_task_spawn(event_producer, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+
+    /* The gateway outranks the producers, so each event preempts them */
+    mo_task_priority(gateway_id, TASK_PRIO_HIGH);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,155 @@
+/* Fixed-Block Pool Test.
+ *
+ * Purpose:
+ * - A pool over static storage hands out every block exactly once, each
+ *   word-aligned and inside the storage, then reports itself empty
+ * - Foreign pointers, misaligned pointers and double frees are refused
+ * - mo_pool_alloc() times out on an empty pool
+ * - A high-priority task blocked on an empty pool gets the block the moment
+ *   it is freed
+ * - A block freed from an interrupt handler wakes a blocked task
+ * - A heap-backed pool rounds odd block sizes up and is destroyed cleanly
+ */
+
+#include <linmo.h>
+
+#include "private/error.h"
+
+#define BLOCK_SIZE 24
+#define BLOCKS 6
+
+static char storage[POOL_STORAGE_SIZE(BLOCK_SIZE, BLOCKS)]
+    __attribute__((aligned(4)));
+static pool_t pool;
+static void *blocks[BLOCKS];
+static void *volatile handed;
+static hrtimer_t isr_free;
+
+static void waiter_task(void)
+{
+    handed = mo_pool_alloc(&pool, POOL_WAIT_FOREVER);
+    mo_task_suspend(mo_task_id());
+}
+
+static void isr_free_cb(void *arg)
+{
+    mo_pool_free_from_isr(&pool, arg);
+}
+
+static bool test_static(void)
+{
+    bool ok = mo_pool_init(&pool, storage, BLOCK_SIZE, BLOCKS) == ERR_OK;
+
+    for (int i = 0; i < BLOCKS; i++) {
+        char *b = blocks[i] = mo_pool_alloc(&pool, 0);
+        ok &= b && ((size_t) b & 3) == 0;
+        ok &= b >= storage && b + BLOCK_SIZE <= storage + sizeof(storage);
+        for (int j = 0; j < i; j++)
+            ok &= blocks[j] != b;
+        memset(b, i, BLOCK_SIZE); /* Clobbers the link of a free block */
+    }
+    ok &= mo_pool_alloc(&pool, 0) == NULL && mo_pool_available(&pool) == 0;
+    ok &= mo_pool_min_available(&pool) == 0;
+    ok &= mo_pool_alloc_from_isr(&pool) == NULL;
+
+    /* Invalid frees leave the pool untouched */
+    static uint32_t foreign;
+    ok &= mo_pool_free(&pool, &foreign) == ERR_FAIL;
+    ok &= mo_pool_free(&pool, (char *) blocks[1] + 4) == ERR_FAIL;
+    ok &= mo_pool_free(&pool, NULL) == ERR_FAIL;
+    ok &= mo_pool_available(&pool) == 0;
+
+    for (int i = 0; i < BLOCKS; i++)
+        ok &= mo_pool_free(&pool, blocks[i]) == ERR_OK;
+    ok &= mo_pool_free(&pool, blocks[0]) == ERR_FAIL; /* Double free */
+    ok &= mo_pool_available(&pool) == BLOCKS;
+    return ok;
+}
+
+static bool test_timeout(void)
+{
+    for (int i = 0; i < BLOCKS; i++)
+        blocks[i] = mo_pool_alloc(&pool, 0);
+
+    uint32_t start = mo_ticks();
+    bool ok = mo_pool_alloc(&pool, 5) == NULL && mo_ticks() - start >= 5;
+    return ok;
+}
+
+/* The pool is empty on entry and stays allocated on return */
+static bool test_handoff(void)
+{
+    handed = NULL;
+    int32_t waiter = mo_task_spawn(waiter_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) waiter, TASK_PRIO_HIGH);
+    mo_task_delay(2); /* Let the waiter block */
+
+    bool ok = handed == NULL;
+    mo_pool_free(&pool, blocks[2]);
+    ok &= handed == blocks[2]; /* It outranks us, so it already ran */
+    mo_task_cancel((uint16_t) waiter);
+    return ok;
+}
+
+static bool test_isr(void)
+{
+    mo_hrtimer_init(&isr_free, isr_free_cb, blocks[4]);
+    mo_hrtimer_start(&isr_free, 2000);
+
+    return mo_pool_alloc(&pool, 10) == blocks[4];
+}
+
+static bool test_heap(void)
+{
+    pool_t *p = mo_pool_create(5, 3);
+    if (!p)
+        return false;
+
+    char *a = mo_pool_alloc(p, 0), *b = mo_pool_alloc(p, 0);
+    bool ok = a && b && (b - a == 8 || a - b == 8);
+    ok &= mo_pool_free(p, a) == ERR_OK && mo_pool_free(p, b) == ERR_OK;
+    ok &= mo_pool_min_available(p) == 1;
+    ok &= mo_pool_destroy(p) == ERR_OK;
+    ok &= mo_pool_create(0, 4) == NULL && mo_pool_create(4, 0) == NULL;
+    return ok;
+}
+
+static void test_task(void)
+{
+    bool static_ok = test_static();
+    bool timeout_ok = test_timeout();
+    bool handoff_ok = test_handoff();
+    bool isr_ok = test_isr();
+    bool heap_ok = test_heap();
+    bool destroy_ok = mo_pool_destroy(&pool) == ERR_OK &&
+                      mo_pool_alloc(&pool, 0) == NULL;
+
+    printf("Pool: static=%s timeout=%s handoff=%s isr=%s heap=%s "
+           "destroy=%s\n",
+           static_ok ? "ok" : "bad", timeout_ok ? "ok" : "bad",
+           handoff_ok ? "ok" : "bad", isr_ok ? "ok" : "bad",
+           heap_ok ? "ok" : "bad", destroy_ok ? "ok" : "bad");
+
+    bool ok = static_ok && timeout_ok && handoff_ok && isr_ok && heap_ok &&
+              destroy_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
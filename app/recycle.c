@@ -0,0 +1,148 @@
+/* Task Recycling Test.
+ *
+ * Purpose:
+ * - A task spawned right after another of the same stack size class was
+ *   cancelled reuses its stack, and gets a new ID
+ * - The cancelled task's ID is rejected afterwards
+ * - Many cancel/respawn cycles make no heap allocations once the cache
+ *   holds a task
+ * - A different stack size class, or an arena, gets a fresh stack
+ * - mo_task_recycle_flush() gives the kept memory back to the heap
+ */
+
+#include <linmo.h>
+
+#define CYCLES 50
+#define BIG_STACK (DEFAULT_STACK_SIZE * 4)
+
+static volatile uintptr_t worker_sp;
+
+static void worker(void)
+{
+    int local = 0;
+    worker_sp = (uintptr_t) &local;
+    while (1)
+        mo_task_delay(100);
+}
+
+/* Spawns a worker, waits until it has run, and returns its stack address */
+static uintptr_t run_worker(int32_t *id, uint16_t stack_size, uint32_t arena)
+{
+    worker_sp = 0;
+    *id = arena ? mo_task_spawn_arena(worker, stack_size, arena)
+                : mo_task_spawn(worker, stack_size);
+    for (int i = 0; i < 100 && !worker_sp; i++)
+        mo_task_delay(1);
+    return worker_sp;
+}
+
+#if CONFIG_TASK_RECYCLE
+static bool test_reuse(void)
+{
+    int32_t a, b;
+    uintptr_t sp_a = run_worker(&a, DEFAULT_STACK_SIZE, 0);
+    mo_task_cancel((uint16_t) a);
+    uintptr_t sp_b = run_worker(&b, DEFAULT_STACK_SIZE, 0);
+
+    task_stats_t st;
+    bool ok = sp_a && sp_a == sp_b && a != b;
+    ok &= mo_task_stats((uint16_t) a, &st) != 0;
+    ok &= mo_task_cancel((uint16_t) a) != 0;
+    ok &= mo_task_cancel((uint16_t) b) == 0;
+    return ok;
+}
+
+static bool test_cycles(void)
+{
+    heap_stats_t before, after;
+    int32_t id;
+    bool ok = true;
+
+    run_worker(&id, DEFAULT_STACK_SIZE, 0);
+    mo_task_cancel((uint16_t) id);
+    mo_heap_stats(&before);
+
+    for (int i = 0; i < CYCLES; i++) {
+        ok &= run_worker(&id, DEFAULT_STACK_SIZE, 0) != 0;
+        ok &= mo_task_cancel((uint16_t) id) == 0;
+    }
+
+    mo_heap_stats(&after);
+    return ok && after.used == before.used && after.allocs == before.allocs;
+}
+
+static bool test_classes(void)
+{
+    int32_t small, big, arena;
+    uintptr_t sp_small = run_worker(&small, DEFAULT_STACK_SIZE, 0);
+    mo_task_cancel((uint16_t) small);
+
+    /* Neither may take the kept small stack, which stays cached */
+    uintptr_t sp_big = run_worker(&big, BIG_STACK, 0);
+    uintptr_t sp_arena = run_worker(&arena, DEFAULT_STACK_SIZE, 256);
+    bool ok = sp_big && sp_big != sp_small && sp_arena &&
+              sp_arena != sp_small;
+
+    mo_task_cancel((uint16_t) big);
+    mo_task_cancel((uint16_t) arena);
+    return ok;
+}
+#endif
+
+static bool test_flush(void)
+{
+    heap_stats_t before, after;
+
+    mo_heap_stats(&before);
+    mo_task_recycle_flush();
+    mo_heap_stats(&after);
+
+#if CONFIG_TASK_RECYCLE
+    /* test_classes() left two tasks kept */
+    return after.used < before.used && after.allocs < before.allocs;
+#else
+    return after.used == before.used;
+#endif
+}
+
+static void test_task(void)
+{
+#if CONFIG_TASK_RECYCLE
+    bool reuse_ok = test_reuse();
+    bool cycles_ok = test_cycles();
+    bool classes_ok = test_classes();
+    bool flush_ok = test_flush();
+
+    printf("Recycle: reuse=%s cycles=%s classes=%s flush=%s\n",
+           reuse_ok ? "ok" : "bad", cycles_ok ? "ok" : "bad",
+           classes_ok ? "ok" : "bad", flush_ok ? "ok" : "bad");
+#else
+    bool reuse_ok = true, cycles_ok = true, classes_ok = true;
+    bool flush_ok = test_flush();
+
+    printf("Recycle: flush=%s (rebuild with CONFIG_TASK_RECYCLE > 0)\n",
+           flush_ok ? "ok" : "bad");
+#endif
+
+    bool ok = reuse_ok && cycles_ok && classes_ok && flush_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
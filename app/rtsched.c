@@ -66,27 +66,22 @@ typedef struct {
  */
 static int32_t custom_sched(void)
 {
-    static list_node_t *task_node = NULL; /* resume point */
+    static dlist_node_t *task_node = NULL; /* resume point */
 
-    /* If we have no starting point or we’ve wrapped, begin at head->next */
+    if (dlist_empty(&kcb->tasks))
+        return -1;
+
+    /* If we have no starting point or we’ve wrapped, begin at the first */
     if (!task_node)
-        task_node = list_next(kcb->tasks->head);
+        task_node = dlist_first(&kcb->tasks);
 
     /* Scan at most one full loop of the list */
-    list_node_t *start = task_node;
+    dlist_node_t *start = task_node;
     do {
-        if (!task_node) /* empty list */
-            return -1;
-
-        /* Skip head/tail sentinels and NULL-data nodes */
-        if (task_node == kcb->tasks->head || task_node == kcb->tasks->tail ||
-            !task_node->data) {
-            task_node = list_next(task_node);
-            continue;
-        }
+        tcb_t *task = container_of(task_node, tcb_t, node);
 
-        /* Safe: data is non-NULL here */
-        tcb_t *task = (tcb_t *) task_node->data;
+        /* Next time resume with the following node */
+        task_node = dlist_cnext(&kcb->tasks, task_node);
 
         /* READY + RT-eligible ? */
         if (task->state == TASK_READY && task->rt_prio) {
@@ -95,16 +90,8 @@ static int32_t custom_sched(void)
             if (cp->remaining == 0)
                 cp->remaining = cp->credits;
             cp->remaining--;
-
-            /* Next time resume with the following node */
-            task_node = list_next(task_node);
-            if (task_node == kcb->tasks->head || task_node == kcb->tasks->tail)
-                task_node = list_next(task_node); /* skip sentinel  */
             return task->id;
         }
-
-        /* Otherwise advance */
-        task_node = list_next(task_node);
     } while (task_node != start); /* one full lap */
 
     /* No READY RT task this cycle */
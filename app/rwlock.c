@@ -0,0 +1,133 @@
+/* Reader-Writer Lock Test.
+ *
+ * Purpose:
+ * - Several readers hold the lock at the same time, and writers are kept
+ *   out (trywrlock fails, timedwrlock times out) until the last one leaves
+ * - RWLOCK_PREFER_WRITER hands a released write lock to a waiting writer
+ *   ahead of an earlier reader; RWLOCK_FAIR admits the reader first
+ */
+
+#include <linmo.h>
+
+#include "private/error.h"
+
+#define READERS 3
+
+static rwlock_t rw;
+static volatile int inside, max_inside;
+static volatile int next_tag, order_count;
+static int order[2];
+
+static void park(void)
+{
+    /* Stay out of the way until cancelled */
+    mo_task_suspend(mo_task_id());
+}
+
+static void shared_reader(void)
+{
+    mo_rwlock_rdlock(&rw);
+    if (++inside > max_inside)
+        max_inside = inside;
+    mo_task_delay(5);
+    inside--;
+    mo_rwlock_unlock(&rw);
+    park();
+}
+
+/* Tag 0 reads, tag 1 writes; records the order in which they get in */
+static void ordered_task(void)
+{
+    int tag = next_tag;
+
+    if (tag)
+        mo_rwlock_wrlock(&rw);
+    else
+        mo_rwlock_rdlock(&rw);
+    order[order_count++] = tag;
+    mo_rwlock_unlock(&rw);
+    park();
+}
+
+static bool test_shared(void)
+{
+    int32_t ids[READERS];
+
+    mo_rwlock_init(&rw, RWLOCK_PREFER_WRITER);
+    inside = max_inside = 0;
+    for (int i = 0; i < READERS; i++)
+        ids[i] = mo_task_spawn(shared_reader, DEFAULT_STACK_SIZE);
+    mo_task_delay(2); /* All readers are now inside */
+
+    bool try_busy = mo_rwlock_trywrlock(&rw) == ERR_TASK_BUSY;
+    bool timed_out = mo_rwlock_timedwrlock(&rw, 1) == ERR_TIMEOUT;
+    bool write_ok = mo_rwlock_wrlock(&rw) == ERR_OK && inside == 0;
+    bool read_busy = mo_rwlock_tryrdlock(&rw) == ERR_TASK_BUSY;
+    mo_rwlock_unlock(&rw);
+
+    for (int i = 0; i < READERS; i++)
+        mo_task_cancel((uint16_t) ids[i]);
+    bool destroyed = mo_rwlock_destroy(&rw) == ERR_OK;
+
+    printf("Shared: max_readers=%d trywr=%s timedwr=%s wr=%s tryrd=%s\n",
+           max_inside, try_busy ? "busy" : "bad", timed_out ? "timeout" : "bad",
+           write_ok ? "ok" : "bad", read_busy ? "busy" : "bad");
+    return max_inside == READERS && try_busy && timed_out && write_ok &&
+           read_busy && destroyed;
+}
+
+/* Hold the write lock while a reader, then a writer, queue up behind it,
+ * and return the tag of whichever got in first.
+ */
+static int first_after_writer(rwlock_policy_t policy)
+{
+    int32_t ids[2];
+
+    mo_rwlock_init(&rw, policy);
+    order_count = 0;
+    mo_rwlock_wrlock(&rw);
+    for (int i = 0; i < 2; i++) {
+        next_tag = i;
+        ids[i] = mo_task_spawn(ordered_task, DEFAULT_STACK_SIZE);
+        mo_task_delay(2); /* Let it block before the next one */
+    }
+    mo_rwlock_unlock(&rw);
+    mo_task_delay(3);
+
+    for (int i = 0; i < 2; i++)
+        mo_task_cancel((uint16_t) ids[i]);
+    mo_rwlock_destroy(&rw);
+    return order_count == 2 ? order[0] : -1;
+}
+
+static void test_task(void)
+{
+    bool shared_ok = test_shared();
+    int prefer = first_after_writer(RWLOCK_PREFER_WRITER);
+    int fair = first_after_writer(RWLOCK_FAIR);
+
+    printf("Handover: prefer_writer=%s fair=%s\n",
+           prefer == 1 ? "writer" : "bad", fair == 0 ? "reader" : "bad");
+
+    bool ok = shared_ok && prefer == 1 && fair == 0;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
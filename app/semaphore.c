@@ -139,6 +139,63 @@ void test_fifo_ordering(void)
     mo_sem_destroy(sem);
 }
 
+/* Shared state for the priority ordering test */
+static sem_t *prio_sem;
+static volatile int next_tag, wake_count;
+static int wake_order[4];
+
+static void prio_waiter(void)
+{
+    int tag = next_tag;
+
+    mo_sem_wait(prio_sem);
+    wake_order[wake_count++] = tag;
+
+    /* Park until cancelled; a spinning waiter would starve the test task */
+    mo_task_suspend(mo_task_id());
+}
+
+/* Test priority-ordered wakeup */
+void test_priority_ordering(void)
+{
+    printf("\n=== Testing Priority Ordering ===\n");
+
+    /* Arrival order differs from priority order on purpose */
+    static const uint16_t prios[4] = {TASK_PRIO_LOW, TASK_PRIO_HIGH,
+                                      TASK_PRIO_LOW, TASK_PRIO_ABOVE};
+    int32_t ids[4];
+
+    prio_sem = mo_sem_create(4, 0);
+    TEST_ASSERT(prio_sem != NULL, "Create semaphore for priority test");
+    TEST_ASSERT(mo_sem_set_policy(prio_sem, WAIT_PRIO) == ERR_OK,
+                "Select priority wait policy");
+    TEST_ASSERT(mo_sem_set_policy(prio_sem, 2) == ERR_FAIL,
+                "Reject unknown wait policy");
+
+    wake_count = 0;
+    for (int i = 0; i < 4; i++) {
+        next_tag = i;
+        ids[i] = mo_task_spawn(prio_waiter, 512);
+        mo_task_priority((uint16_t) ids[i], prios[i]);
+        mo_task_delay(3); /* Let it block before the next one */
+    }
+    TEST_ASSERT(mo_sem_waiting_count(prio_sem) == 4, "All waiters queued");
+
+    for (int i = 0; i < 4; i++) {
+        mo_sem_signal(prio_sem);
+        mo_task_delay(2);
+    }
+
+    /* Highest priority first, arrival order among the two LOW waiters */
+    TEST_ASSERT(wake_count == 4 && wake_order[0] == 1 && wake_order[1] == 3 &&
+                    wake_order[2] == 0 && wake_order[3] == 2,
+                "Waiters woken by priority, FIFO among equals");
+
+    for (int i = 0; i < 4; i++)
+        mo_task_cancel((uint16_t) ids[i]);
+    mo_sem_destroy(prio_sem);
+}
+
 /* Test binary semaphore (mutex-like) behavior */
 void test_binary_semaphore(void)
 {
@@ -198,6 +255,7 @@ void semaphore_test_task(void)
     test_overflow_protection();
     test_error_conditions();
     test_fifo_ordering();
+    test_priority_ordering();
     test_binary_semaphore();
 
     print_test_results();
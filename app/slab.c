@@ -0,0 +1,103 @@
+/* Object Cache Test.
+ *
+ * Purpose:
+ * - A cache grows one chunk at a time and never hands out the same object
+ *   twice while it is in use
+ * - A freed object is the next one handed out, without growing the cache
+ * - Usage figures track allocations, the peak and the chunks taken
+ * - Kernel objects (tasks, semaphores, pipes, queues, timers) come from
+ *   their own caches, listed by slab_dump()
+ */
+
+#include <linmo.h>
+
+#define OBJECTS 40
+
+typedef struct {
+    uint32_t words[5];
+} object_t;
+
+static slab_cache_t cache = SLAB_CACHE_INIT("test", object_t);
+
+static void *noop_cb(void *arg)
+{
+    return arg;
+}
+
+static void test_task(void)
+{
+    object_t *objs[OBJECTS];
+    slab_stats_t st;
+
+    bool distinct = true;
+    for (int i = 0; i < OBJECTS; i++) {
+        objs[i] = slab_alloc(&cache);
+        distinct &= objs[i] != NULL;
+        for (int j = 0; objs[i] && j < i; j++)
+            distinct &= objs[j] != objs[i];
+        if (objs[i])
+            objs[i]->words[0] = (uint32_t) i;
+    }
+
+    slab_stats(&cache, &st);
+    uint32_t per_chunk = SLAB_CHUNK_SIZE / sizeof(object_t);
+    bool grew_ok = st.in_use == OBJECTS && st.peak == OBJECTS &&
+                   st.chunks == (OBJECTS + per_chunk - 1) / per_chunk &&
+                   st.capacity >= OBJECTS;
+
+    /* Contents survive the neighbours' allocations */
+    bool intact = true;
+    for (int i = 0; i < OBJECTS; i++)
+        intact &= objs[i]->words[0] == (uint32_t) i;
+
+    /* Free one and get it straight back, without a new chunk */
+    object_t *victim = objs[OBJECTS / 2];
+    slab_free(&cache, victim);
+    uint32_t chunks = st.chunks;
+    objs[OBJECTS / 2] = slab_alloc(&cache);
+    slab_stats(&cache, &st);
+    bool reuse_ok = objs[OBJECTS / 2] == victim && st.chunks == chunks;
+
+    for (int i = 0; i < OBJECTS; i++)
+        slab_free(&cache, objs[i]);
+    slab_stats(&cache, &st);
+    bool freed_ok = st.in_use == 0 && st.peak == OBJECTS;
+
+    /* Make every kernel cache show up in the dump */
+    sem_t *sem = mo_sem_create(1, 0);
+    pipe_t *pipe = mo_pipe_create(16);
+    mq_t *mq = mo_mq_create(4);
+    int32_t timer = mo_timer_create(noop_cb, 100, NULL);
+    slab_dump();
+    mo_timer_destroy((uint16_t) timer);
+    mo_mq_destroy(mq);
+    mo_pipe_destroy(pipe);
+    mo_sem_destroy(sem);
+
+    printf("Slab: distinct=%s grow=%s intact=%s reuse=%s free=%s\n",
+           distinct ? "ok" : "bad", grew_ok ? "ok" : "bad",
+           intact ? "ok" : "bad", reuse_ok ? "ok" : "bad",
+           freed_ok ? "ok" : "bad");
+
+    bool ok = distinct && grew_ok && intact && reuse_ok && freed_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
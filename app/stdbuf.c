@@ -0,0 +1,166 @@
+/* Buffered Task Output Test.
+ *
+ * Purpose:
+ * - Two tasks that build their lines from many small printf() calls, and
+ *   yield to each other in between, still reach the console one whole line
+ *   per write
+ * - A line longer than the buffer goes out in buffer-sized pieces
+ * - fflush() sends an unfinished line at once
+ *
+ * The console write hook is wrapped to record every write it is handed.
+ * Without CONFIG_STDOUT_BUF, only checks that fflush() is harmless.
+ */
+
+#include <linmo.h>
+
+#include "private/stdio.h"
+
+#define LINES 8
+#define DIGITS 8
+#define LINE_LEN (1 + DIGITS + 1) /* Tag, digits, newline */
+
+#if CONFIG_STDOUT_BUF
+#define WRITES_MAX (2 * LINES + 8)
+
+static volatile uint32_t printers_done;
+static uint32_t writes;
+static int write_len[WRITES_MAX];
+static char write_tag[WRITES_MAX];
+static bool write_whole[WRITES_MAX];
+
+/* Records each write, then passes it on byte by byte */
+static int capture(const char *buf, int len)
+{
+    if (writes < WRITES_MAX) {
+        bool whole = buf[len - 1] == '\n';
+        for (int i = 1; i < len - 1; i++)
+            whole &= buf[i] >= '0' && buf[i] <= '9';
+        write_len[writes] = len;
+        write_tag[writes] = buf[0];
+        write_whole[writes] = whole;
+    }
+    writes++;
+
+    for (int i = 0; i < len; i++)
+        _putchar(buf[i]);
+    return len;
+}
+
+static void printer(char tag)
+{
+    for (int line = 0; line < LINES; line++) {
+        printf("%c", tag);
+        for (int i = 0; i < DIGITS; i++) {
+            printf("%d", i);
+            mo_task_yield();
+        }
+        printf("\n");
+    }
+    printers_done++;
+}
+
+static void printer_a(void)
+{
+    printer('A');
+    while (1)
+        mo_task_delay(100);
+}
+
+static void printer_b(void)
+{
+    printer('B');
+    while (1)
+        mo_task_delay(100);
+}
+
+static bool test_records(void)
+{
+    int32_t a = mo_task_spawn(printer_a, DEFAULT_STACK_SIZE);
+    int32_t b = mo_task_spawn(printer_b, DEFAULT_STACK_SIZE);
+    if (a < 0 || b < 0)
+        return false;
+
+    /* Forget the spawn reports; the printers cannot finish a line yet */
+    writes = 0;
+    for (int i = 0; i < 200 && printers_done < 2; i++)
+        mo_task_delay(1);
+    mo_task_cancel((uint16_t) a);
+    mo_task_cancel((uint16_t) b);
+
+    /* Every write is one whole line from one task */
+    uint32_t lines_a = 0, lines_b = 0;
+    bool ok = printers_done == 2 && writes == 2 * LINES;
+    for (uint32_t i = 0; ok && i < writes; i++) {
+        ok &= write_len[i] == LINE_LEN && write_whole[i];
+        lines_a += write_tag[i] == 'A';
+        lines_b += write_tag[i] == 'B';
+    }
+    return ok && lines_a == LINES && lines_b == LINES;
+}
+
+static bool test_long(void)
+{
+    writes = 0;
+    for (int i = 0; i < CONFIG_STDOUT_BUF + 3; i++)
+        printf("-");
+
+    /* The full buffer went out alone; the rest waits for the newline */
+    bool ok = writes == 1 && write_len[0] == CONFIG_STDOUT_BUF;
+    printf("\n");
+    return ok && writes == 2 && write_len[1] == 4;
+}
+
+static bool test_flush(void)
+{
+    writes = 0;
+    printf("partial");
+    bool ok = writes == 0;
+    fflush(NULL);
+    ok &= writes == 1 && write_len[0] == 7;
+    fflush(NULL); /* Nothing left: no write */
+    printf("\n");
+    return ok && writes == 2;
+}
+#endif
+
+static void test_task(void)
+{
+#if CONFIG_STDOUT_BUF
+    _stdwrite_install(capture);
+    bool records_ok = test_records();
+    bool long_ok = test_long();
+    bool flush_ok = test_flush();
+    _stdwrite_install(NULL);
+
+    printf("Stdbuf: records=%s long=%s flush=%s\n", records_ok ? "ok" : "bad",
+           long_ok ? "ok" : "bad", flush_ok ? "ok" : "bad");
+#else
+    printf("partial");
+    bool records_ok = fflush(NULL) == 0, long_ok = true, flush_ok = true;
+
+    printf("\nStdbuf: off=%s (rebuild with CONFIG_STDOUT_BUF=80)\n",
+           records_ok ? "ok" : "bad");
+#endif
+
+    bool ok = records_ok && long_ok && flush_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
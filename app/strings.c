@@ -0,0 +1,185 @@
+/* String and Memory Routine Test.
+ *
+ * Purpose:
+ * - strlen, strcmp, strncmp, strchr, memcmp, memcpy, memmove and memset
+ *   agree with plain byte-at-a-time reference versions for every length up
+ *   to a few words and every combination of source and destination
+ *   alignment, so the word-at-a-time paths (and, when built with RV_ZBB=1,
+ *   the Zbb ones) are checked against the obvious implementation
+ * - strncmp stops at n even when n runs out before the first word boundary
+ * - Bytes above 0x7f compare as unsigned char and can be searched for
+ * - Copies and fills never touch bytes outside the requested range
+ */
+
+#include <linmo.h>
+
+#define MAXLEN 40
+#define BUF (MAXLEN + 16)
+
+static uint8_t buf_a[BUF] __attribute__((aligned(4)));
+static uint8_t buf_b[BUF] __attribute__((aligned(4)));
+static uint8_t expect[2 * BUF] __attribute__((aligned(4)));
+static uint8_t area[2 * BUF] __attribute__((aligned(4)));
+
+static int sign(int32_t v)
+{
+    return (v > 0) - (v < 0);
+}
+
+static size_t ref_strlen(const char *s)
+{
+    size_t n = 0;
+    while (s[n])
+        n++;
+    return n;
+}
+
+static int ref_strncmp(const char *a, const char *b, uint32_t n)
+{
+    for (; n; a++, b++, n--) {
+        if (*a != *b || !*a)
+            return sign((uint8_t) *a - (uint8_t) *b);
+    }
+    return 0;
+}
+
+static int ref_memcmp(const uint8_t *a, const uint8_t *b, uint32_t n)
+{
+    for (; n; a++, b++, n--) {
+        if (*a != *b)
+            return sign(*a - *b);
+    }
+    return 0;
+}
+
+static const char *ref_strchr(const char *s, uint8_t c)
+{
+    for (;; s++) {
+        if ((uint8_t) *s == c)
+            return s;
+        if (!*s)
+            return NULL;
+    }
+}
+
+/* Fills both buffers with the same non-zero pattern, including high bytes */
+static void fill_pattern(void)
+{
+    for (int i = 0; i < BUF; i++)
+        buf_a[i] = buf_b[i] = (uint8_t) (0x61 + (i * 37) % 0x9e);
+}
+
+static bool test_strings(void)
+{
+    bool ok = true;
+
+    for (int oa = 0; oa < 4; oa++) {
+        for (int ob = 0; ob < 4; ob++) {
+            for (int len = 0; len <= MAXLEN; len++) {
+                fill_pattern();
+                char *a = (char *) buf_a + oa, *c = (char *) buf_b + ob;
+                a[len] = 0;
+                memcpy(c, a, len + 1);
+
+                ok &= strlen(a) == ref_strlen(a) && strlen(a) == (size_t) len;
+                ok &= strcmp(a, c) == 0 && strncmp(a, c, len + 5) == 0;
+                ok &= memcmp(a, c, len) == 0;
+                ok &= strchr(a, 0) == a + len;
+                ok &= strchr(a, 1) == NULL;
+
+                /* A difference at every position, both ways round */
+                for (int pos = 0; pos < len; pos++) {
+                    char saved = c[pos];
+                    c[pos] = (char) (saved ^ 0x40);
+                    ok &= sign(strcmp(a, c)) == ref_strncmp(a, c, BUF);
+                    ok &= sign(strcmp(c, a)) == ref_strncmp(c, a, BUF);
+                    ok &= sign(strncmp(a, c, len)) == ref_strncmp(a, c, len);
+                    /* Stopping short of it, even inside the alignment run */
+                    for (int n = 0; n <= pos; n++)
+                        ok &= strncmp(a, c, n) == 0;
+                    ok &= sign(memcmp(a, c, len)) ==
+                          ref_memcmp((uint8_t *) a, (uint8_t *) c, len);
+                    ok &= sign(memcmp(c, a, len)) ==
+                          ref_memcmp((uint8_t *) c, (uint8_t *) a, len);
+
+                    /* A shorter string orders first */
+                    c[pos] = 0;
+                    ok &= sign(strcmp(c, a)) == -1 && sign(strcmp(a, c)) == 1;
+                    c[pos] = saved;
+
+                    uint8_t ch = (uint8_t) a[pos];
+                    ok &= strchr(a, ch) == ref_strchr(a, ch);
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+static bool test_memory(void)
+{
+    bool ok = true;
+
+    for (int od = 0; od < 4; od++) {
+        for (int os = 0; os < 4; os++) {
+            for (int len = 0; len <= MAXLEN; len++) {
+                fill_pattern();
+                uint8_t *src = buf_a + os;
+
+                /* memcpy between separate buffers */
+                memset(area, 0xEE, sizeof(area));
+                memset(expect, 0xEE, sizeof(expect));
+                for (int i = 0; i < len; i++)
+                    expect[od + 4 + i] = src[i];
+                memcpy(area + od + 4, src, len);
+                ok &= ref_memcmp(area, expect, sizeof(area)) == 0;
+
+                /* memset, with a high byte value */
+                memset(expect + od + 4, 0xA5, len);
+                memset(area + od + 4, 0xA5, len);
+                ok &= ref_memcmp(area, expect, sizeof(area)) == 0;
+
+                /* memmove across every overlap, both directions */
+                for (int shift = -7; shift <= 7; shift++) {
+                    for (int i = 0; i < (int) sizeof(area); i++)
+                        area[i] = expect[i] = (uint8_t) (i * 7 + 3);
+                    int from = 12 + os, to = 12 + os + shift + od;
+                    for (int i = 0; i < len; i++)
+                        expect[to + i] = (uint8_t) ((from + i) * 7 + 3);
+                    memmove(area + to, area + from, len);
+                    ok &= ref_memcmp(area, expect, sizeof(area)) == 0;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+static void test_task(void)
+{
+    bool strings_ok = test_strings();
+    bool memory_ok = test_memory();
+
+    printf("Strings: strings=%s memory=%s\n", strings_ok ? "ok" : "bad",
+           memory_ok ? "ok" : "bad");
+    printf("Overall: %s\n", strings_ok && memory_ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
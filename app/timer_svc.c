@@ -0,0 +1,135 @@
+/* Timer Service Task Test.
+ *
+ * Purpose:
+ * - Callbacks run in the timer service task, not in the task that armed them
+ * - More timers than the old batch limit, all due on the same tick, fire on
+ *   that tick
+ * - An auto-reload timer keeps its period without drifting
+ * - A timer far enough out to sit on an upper wheel level fires on time
+ * - A callback that runs longer than its period is reported as an overrun
+ */
+
+#include <linmo.h>
+
+#include "private/error.h"
+
+#define BATCH 8
+
+static volatile uint32_t batch_fired, batch_tick;
+static volatile bool batch_same_tick = true;
+static volatile uint16_t callback_task;
+static volatile uint32_t reload_fired;
+static volatile uint32_t far_fired_at;
+
+static void *batch_cb(void *arg)
+{
+    (void) arg;
+    uint32_t now = mo_ticks();
+
+    if (batch_fired++ == 0)
+        batch_tick = now;
+    else if (now != batch_tick)
+        batch_same_tick = false;
+    callback_task = mo_task_id();
+    return NULL;
+}
+
+static void *reload_cb(void *arg)
+{
+    (void) arg;
+    reload_fired++;
+    return NULL;
+}
+
+static void *far_cb(void *arg)
+{
+    (void) arg;
+    far_fired_at = mo_ticks();
+    return NULL;
+}
+
+/* Spins for two ticks, twice its one-tick period. The service task would
+ * never get off the CPU, so the timer stops itself after a few runs.
+ */
+static void *slow_cb(void *arg)
+{
+    static int runs;
+    uint32_t start = mo_ticks();
+
+    while (mo_ticks() - start < 2)
+        ;
+    if (++runs == 3)
+        mo_timer_cancel(*(uint16_t *) arg);
+    return NULL;
+}
+
+static void test_task(void)
+{
+    int32_t ids[BATCH];
+    timer_stats_t st;
+
+    /* Same-tick batch */
+    for (int i = 0; i < BATCH; i++) {
+        ids[i] = mo_timer_create(batch_cb, 50, NULL);
+        mo_timer_start((uint16_t) ids[i], TIMER_ONESHOT);
+    }
+    mo_task_delay(10);
+
+    bool batch_ok = batch_fired == BATCH && batch_same_tick;
+    bool context_ok = callback_task && callback_task != mo_task_id();
+    for (int i = 0; i < BATCH; i++) {
+        batch_ok &= mo_timer_stats((uint16_t) ids[i], &st) == ERR_OK &&
+                    st.fires == 1 && st.max_late_ticks == 0;
+        mo_timer_destroy((uint16_t) ids[i]);
+    }
+
+    /* Drift-free reload, alongside a timer 100 ticks out on level 1 */
+    int32_t reload = mo_timer_create(reload_cb, 20, NULL);
+    int32_t far = mo_timer_create(far_cb, 1000, NULL);
+    uint32_t start = mo_ticks();
+    mo_timer_start((uint16_t) reload, TIMER_AUTORELOAD);
+    mo_timer_start((uint16_t) far, TIMER_ONESHOT);
+    mo_task_delay(101);
+    mo_timer_cancel((uint16_t) reload);
+
+    bool reload_ok = reload_fired == 50 || reload_fired == 51;
+    bool far_ok = far_fired_at - start == 100;
+    mo_timer_destroy((uint16_t) reload);
+    mo_timer_destroy((uint16_t) far);
+
+    /* Overrun: a one-tick timer whose callback takes two */
+    static uint16_t slow;
+    slow = (uint16_t) mo_timer_create(slow_cb, 10, &slow);
+    mo_timer_start(slow, TIMER_AUTORELOAD);
+    mo_task_delay(10);
+    bool overrun_ok = mo_timer_stats(slow, &st) == ERR_OK && st.fires == 3 &&
+                      st.overruns == 3 && st.max_run_us > 0;
+    mo_timer_destroy(slow);
+
+    printf("Timer service: batch=%s context=%s reload=%lu far=%s "
+           "overruns=%lu\n",
+           batch_ok ? "ok" : "bad", context_ok ? "ok" : "bad", reload_fired,
+           far_ok ? "ok" : "bad", st.overruns);
+
+    bool ok = batch_ok && context_ok && reload_ok && far_ok && overrun_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -0,0 +1,210 @@
+/* Work Queue Test.
+ *
+ * Purpose:
+ * - Submitted jobs all run, and done bits reach the submitter
+ * - Several workers run sleeping jobs concurrently
+ * - The job queue is bounded: a non-blocking submit fails while it is full
+ * - mo_workqueue_destroy() runs the queued jobs before stopping the workers
+ * - A queue whose workers do not all fit in the heap is not created, and
+ *   the workers already spawned for it are gone again
+ */
+
+#include <linmo.h>
+
+#define WORKERS 3
+#define DEPTH 4
+#define JOBS 20
+#define SLEEP_JOBS 6
+#define SLEEP_TICKS 5
+
+#define DONE_BIT (1U << 0)
+
+#define OOM_WORKERS 8 /* Room is left for about two */
+#define FILL_BIG (64 * 1024)
+#define FILL_SMALL 256
+
+static workqueue_t *wq;
+static sem_t *gate;
+static atomic_t sum, ran; /* Updated by all workers */
+
+static void add_job(void *arg)
+{
+    atomic_add_return(&sum, (uint32_t) (uintptr_t) arg);
+    atomic_inc(&ran);
+}
+
+static void sleep_job(void *arg)
+{
+    mo_task_delay(SLEEP_TICKS);
+    atomic_inc(&ran);
+}
+
+static void gate_job(void *arg)
+{
+    mo_sem_wait(gate);
+    atomic_inc(&ran);
+}
+
+static bool test_jobs(void)
+{
+    uint32_t expect = 0;
+    bool ok = true;
+
+    atomic_set(&sum, 0);
+    atomic_set(&ran, 0);
+    for (uint32_t i = 1; i <= JOBS; i++) {
+        expect += i;
+        uint32_t bits = i == JOBS ? DONE_BIT : 0;
+        ok &= mo_workqueue_submit(wq, add_job, (void *) (uintptr_t) i, bits,
+                                  WORKQUEUE_WAIT_FOREVER) == 0;
+    }
+    ok &= mo_workqueue_submit(wq, NULL, NULL, 0, 0) != 0;
+
+    /* The last job may finish before others that started earlier */
+    ok &= mo_task_notify_wait(DONE_BIT, 100) == DONE_BIT;
+    for (int i = 0; i < 100 && atomic_read(&ran) < JOBS; i++)
+        mo_task_delay(1);
+    return ok && atomic_read(&ran) == JOBS &&
+           atomic_read(&sum) == expect;
+}
+
+static bool test_parallel(void)
+{
+    bool ok = true;
+
+    atomic_set(&ran, 0);
+    uint32_t t0 = mo_ticks();
+    for (int i = 0; i < SLEEP_JOBS; i++)
+        ok &= mo_workqueue_submit(wq, sleep_job, NULL, 0,
+                                  WORKQUEUE_WAIT_FOREVER) == 0;
+    while (atomic_read(&ran) < SLEEP_JOBS && mo_ticks() - t0 < 200)
+        mo_task_delay(1);
+    uint32_t elapsed = mo_ticks() - t0;
+
+    /* Run one after another, they would take SLEEP_JOBS * SLEEP_TICKS */
+    printf("%d sleeping jobs on %d workers took %lu ticks\n", SLEEP_JOBS,
+           WORKERS, elapsed);
+    return ok && atomic_read(&ran) == SLEEP_JOBS &&
+           elapsed < SLEEP_JOBS * SLEEP_TICKS * 2 / WORKERS + SLEEP_TICKS;
+}
+
+static bool test_bounded(void)
+{
+    bool ok = true;
+
+    atomic_set(&ran, 0);
+    for (int i = 0; i < WORKERS + DEPTH; i++)
+        ok &= mo_workqueue_submit(wq, gate_job, NULL, 0,
+                                  WORKQUEUE_WAIT_FOREVER) == 0;
+
+    /* Every worker is blocked on the gate and the queue is full */
+    mo_task_delay(2);
+    ok &= mo_workqueue_pending(wq) == DEPTH;
+    ok &= mo_workqueue_submit(wq, gate_job, NULL, 0, 0) != 0;
+    ok &= mo_workqueue_submit(wq, gate_job, NULL, 0, 2) != 0;
+
+    for (int i = 0; i < WORKERS + DEPTH; i++)
+        mo_sem_signal(gate);
+    for (int i = 0; i < 100 && atomic_read(&ran) < WORKERS + DEPTH; i++)
+        mo_task_delay(1);
+    return ok && atomic_read(&ran) == WORKERS + DEPTH &&
+           !mo_workqueue_pending(wq);
+}
+
+static bool test_destroy(void)
+{
+    bool ok = true;
+
+    atomic_set(&ran, 0);
+    for (int i = 0; i < DEPTH; i++)
+        ok &= mo_workqueue_submit(wq, sleep_job, NULL, 0,
+                                  WORKQUEUE_WAIT_FOREVER) == 0;
+
+    ok &= mo_workqueue_destroy(wq) == 0;
+    wq = NULL;
+    return ok && atomic_read(&ran) == DEPTH;
+}
+
+/* Takes blocks of @size until the heap has none, chaining them on @chain */
+static void *heap_fill(void *chain, uint32_t size)
+{
+    void *b;
+    while ((b = malloc(size))) {
+        *(void **) b = chain;
+        chain = b;
+    }
+    return chain;
+}
+
+static bool test_oom(void)
+{
+    uint16_t tasks = mo_task_count();
+
+    /* Keep room for about two workers and fill the rest of the heap */
+    void *spare = malloc(2 * DEFAULT_STACK_SIZE + 1024);
+    if (!spare)
+        return false;
+    void *chain = heap_fill(heap_fill(NULL, FILL_BIG), FILL_SMALL);
+    free(spare);
+
+    workqueue_t *big = mo_workqueue_create(OOM_WORKERS, TASK_PRIO_NORMAL,
+                                           DEPTH, DEFAULT_STACK_SIZE);
+    bool ok = !big && mo_task_count() == tasks;
+
+    while (chain) {
+        void *b = chain;
+        chain = *(void **) b;
+        free(b);
+    }
+
+    /* With the heap back, the same queue can be made and taken down */
+    big = mo_workqueue_create(OOM_WORKERS, TASK_PRIO_NORMAL, DEPTH,
+                              DEFAULT_STACK_SIZE);
+    ok &= big && mo_task_count() == tasks + OOM_WORKERS;
+    ok &= big && mo_workqueue_destroy(big) == 0;
+    return ok && mo_task_count() == tasks;
+}
+
+static void test_task(void)
+{
+    gate = mo_sem_create(WORKERS + DEPTH, 0);
+    wq = mo_workqueue_create(WORKERS, TASK_PRIO_NORMAL, DEPTH,
+                             DEFAULT_STACK_SIZE);
+
+    bool create_ok = gate && wq;
+    create_ok &= !mo_workqueue_create(0, TASK_PRIO_NORMAL, DEPTH, 1024);
+    bool jobs_ok = create_ok && test_jobs();
+    bool parallel_ok = create_ok && test_parallel();
+    bool bounded_ok = create_ok && test_bounded();
+    bool destroy_ok = create_ok && test_destroy();
+    bool oom_ok = create_ok && test_oom();
+
+    printf("Workqueue: create=%s jobs=%s parallel=%s bounded=%s destroy=%s "
+           "oom=%s\n",
+           create_ok ? "ok" : "bad", jobs_ok ? "ok" : "bad",
+           parallel_ok ? "ok" : "bad", bounded_ok ? "ok" : "bad",
+           destroy_ok ? "ok" : "bad", oom_ok ? "ok" : "bad");
+
+    bool ok = create_ok && jobs_ok && parallel_ok && bounded_ok &&
+              destroy_ok && oom_ok;
+    printf("Overall: %s\n", ok ? "PASS" : "FAIL");
+
+    while (1)
+        mo_task_wfi();
+}
+
+static void idle_task(void)
+{
+    while (1)
+        mo_task_wfi();
+}
+
+int32_t app_main(void)
+{
+    mo_task_spawn(test_task, DEFAULT_STACK_SIZE);
+    int32_t idle = mo_task_spawn(idle_task, DEFAULT_STACK_SIZE);
+    mo_task_priority((uint16_t) idle, TASK_PRIO_IDLE);
+
+    /* preemptive scheduling */
+    return 1;
+}
@@ -4,8 +4,11 @@
  * interrupt/exception entry point (_isr). It is placed in the .text.prologue
  * section by the linker script to ensure it is located at the very beginning
  * of the executable image, which is where the CPU begins execution on reset.
+ * The trap entry points and their vector table run from fast RAM instead
+ * (see __fast_text); they stay together so the table's jumps reach them.
  */
 
+#include <hal.h>
 #include <types.h>
 
 #include "csr.h"
@@ -13,11 +16,15 @@
 /* Symbols defined in the linker script */
 extern uint32_t _gp, _stack, _end;
 extern uint32_t _sbss, _ebss;
+extern uint32_t _sfast, _efast, _sifast, _sfast_bss, _efast_bss;
 
 /* C entry points */
 void main(void);
 void do_trap(uint32_t cause, uint32_t epc);
+void hal_irq_dispatch(void);
 void hal_panic(void);
+void _isr(void);
+void _isr_ext(void);
 
 /* Machine-mode entry point ('_entry'). This is the first code executed on
  * reset. It performs essential low-level setup of the processor state,
@@ -38,6 +45,31 @@ __attribute__((naked, section(".text.prologue"))) void _entry(void)
         "addi   tp, tp, 63\n"
         "andi   tp, tp, -64\n" /* Align to 64 bytes */
 
+        /* Copy the hot code and data to fast RAM and clear its BSS. The
+         * fence.i makes the copied instructions visible to instruction
+         * fetch before the first trap or call reaches them.
+         */
+        "la     a0, _sfast\n"
+        "la     a1, _efast\n"
+        "la     a2, _sifast\n"
+        "bgeu   a0, a1, .Lfast_copied\n"
+        ".Lfast_copy_loop:\n"
+        "lw     t0, 0(a2)\n"
+        "sw     t0, 0(a0)\n"
+        "addi   a0, a0, 4\n"
+        "addi   a2, a2, 4\n"
+        "bltu   a0, a1, .Lfast_copy_loop\n"
+        ".Lfast_copied:\n"
+        "fence.i\n"
+        "la     a0, _sfast_bss\n"
+        "la     a1, _efast_bss\n"
+        "bgeu   a0, a1, .Lfast_bss_done\n"
+        ".Lfast_bss_clear_loop:\n"
+        "sw     zero, 0(a0)\n"
+        "addi   a0, a0, 4\n"
+        "bltu   a0, a1, .Lfast_bss_clear_loop\n"
+        ".Lfast_bss_done:\n"
+
         /* Clear the .bss section to zero */
         "la     a0, _sbss\n"
         "la     a1, _ebss\n"
@@ -62,18 +94,25 @@ __attribute__((naked, section(".text.prologue"))) void _entry(void)
         "csrw   mideleg, zero\n" /* No interrupt delegation to S-mode */
         "csrw   medeleg, zero\n" /* No exception delegation to S-mode */
 
-        /* Park secondary harts (cores) - only hart 0 continues */
+        /* Park secondary harts (cores) - only hart 0 continues. The kernel
+         * serializes with per-hart interrupt masking, which does not exclude
+         * other harts, so they must not enter it.
+         */
         "csrr   t0, mhartid\n"
         "bnez   t0, .Lpark_hart\n"
 
-        /* Set the machine trap vector (mtvec) to point to our ISR */
-        "la     t0, _isr\n"
+        /* Install the trap vector table in vectored mode: exceptions and
+         * the timer use the full '_isr' path, external interrupts go
+         * straight to '_isr_ext'.
+         */
+        "la     t0, _isr_vector\n"
+        "ori    t0, t0, %2\n"
         "csrw   mtvec, t0\n"
 
-        /* Enable machine-level external interrupts (MIE.MEIE).
-         * This allows peripherals like the UART to raise interrupts.
-         * Global interrupts remain disabled by mstatus.MIE until the scheduler
-         * is ready.
+        /* Enable machine-level external and software interrupts (MIE.MEIE,
+         * MIE.MSIE). This allows peripherals like the UART, and other harts
+         * through hal_ipi_send(), to raise interrupts. Global interrupts remain
+         * disabled by mstatus.MIE until the scheduler is ready.
          */
         "li     t0, %1\n"
         "csrw   mie, t0\n"
@@ -89,7 +128,8 @@ __attribute__((naked, section(".text.prologue"))) void _entry(void)
         "j      .Lpark_hart\n"
 
         : /* no outputs */
-        : "i"(MSTATUS_MPP_MACH), "i"(MIE_MEIE)
+        : "i"(MSTATUS_MPP_MACH), "i"(MIE_MEIE | MIE_MSIE),
+          "i"(MTVEC_MODE_VECTORED)
         : "memory");
 }
 
@@ -105,7 +145,7 @@ __attribute__((naked, section(".text.prologue"))) void _entry(void)
  * save, creating a complete trap frame on the stack. This makes the C handler
  * robust, as it does not need to preserve any registers itself.
  */
-__attribute__((naked, aligned(4))) void _isr(void)
+__attribute__((naked, aligned(4))) __fast_text void _isr(void)
 {
     asm volatile(
         /* Allocate stack frame for full context save */
@@ -205,3 +245,83 @@ __attribute__((naked, aligned(4))) void _isr(void)
         : "i"(ISR_CONTEXT_SIZE)
         : "memory");
 }
+
+/* Vectored trap table. In vectored mode, exceptions enter at the base and
+ * interrupt N at base + 4 * N, so each slot is a single 4-byte jump. Only
+ * the machine external interrupt has its own entry; everything else needs
+ * the full frame that the scheduler works on.
+ */
+__attribute__((naked, aligned(64))) __fast_text void _isr_vector(void)
+{
+    asm volatile(
+        ".option push\n"
+        ".option norvc\n"
+        "j      _isr\n"     /*  0: exceptions */
+        "j      _isr\n"     /*  1: supervisor software */
+        "j      _isr\n"     /*  2: reserved */
+        "j      _isr\n"     /*  3: machine software (IPI) */
+        "j      _isr\n"     /*  4: user timer */
+        "j      _isr\n"     /*  5: supervisor timer */
+        "j      _isr\n"     /*  6: reserved */
+        "j      _isr\n"     /*  7: machine timer (scheduler tick) */
+        "j      _isr\n"     /*  8: user external */
+        "j      _isr\n"     /*  9: supervisor external */
+        "j      _isr\n"     /* 10: reserved */
+        "j      _isr_ext\n" /* 11: machine external (PLIC) */
+        ".option pop\n");
+}
+
+/* Size of the frame saved by '_isr_ext': the 16 caller-saved registers
+ * (ra, t0-t6, a0-a7), which keeps the stack 16-byte aligned.
+ */
+#define ISR_EXT_CONTEXT_SIZE 64
+
+/* Entry for external interrupts. hal_irq_dispatch() is an ordinary C
+ * function that preserves the callee-saved registers itself, so only the
+ * caller-saved ones are stored here. No scheduler code runs on this path.
+ */
+__attribute__((naked, aligned(4))) __fast_text void _isr_ext(void)
+{
+    asm volatile(
+        "addi   sp, sp, -%0\n"
+        "sw  ra,   0*4(sp)\n"
+        "sw  t0,   1*4(sp)\n"
+        "sw  t1,   2*4(sp)\n"
+        "sw  t2,   3*4(sp)\n"
+        "sw  a0,   4*4(sp)\n"
+        "sw  a1,   5*4(sp)\n"
+        "sw  a2,   6*4(sp)\n"
+        "sw  a3,   7*4(sp)\n"
+        "sw  a4,   8*4(sp)\n"
+        "sw  a5,   9*4(sp)\n"
+        "sw  a6,  10*4(sp)\n"
+        "sw  a7,  11*4(sp)\n"
+        "sw  t3,  12*4(sp)\n"
+        "sw  t4,  13*4(sp)\n"
+        "sw  t5,  14*4(sp)\n"
+        "sw  t6,  15*4(sp)\n"
+
+        "call   hal_irq_dispatch\n"
+
+        "lw  ra,   0*4(sp)\n"
+        "lw  t0,   1*4(sp)\n"
+        "lw  t1,   2*4(sp)\n"
+        "lw  t2,   3*4(sp)\n"
+        "lw  a0,   4*4(sp)\n"
+        "lw  a1,   5*4(sp)\n"
+        "lw  a2,   6*4(sp)\n"
+        "lw  a3,   7*4(sp)\n"
+        "lw  a4,   8*4(sp)\n"
+        "lw  a5,   9*4(sp)\n"
+        "lw  a6,  10*4(sp)\n"
+        "lw  a7,  11*4(sp)\n"
+        "lw  t3,  12*4(sp)\n"
+        "lw  t4,  13*4(sp)\n"
+        "lw  t5,  14*4(sp)\n"
+        "lw  t6,  15*4(sp)\n"
+        "addi   sp, sp, %0\n"
+        "mret\n"
+        : /* no outputs */
+        : "i"(ISR_EXT_CONTEXT_SIZE)
+        : "memory");
+}
@@ -4,17 +4,18 @@ ARCH_DIR := $(SRC_DIR)/arch/$(ARCH)
 INC_DIRS += -I $(ARCH_DIR)
 
 # core speed
-F_CLK := 10000000
+F_CLK ?= 10000000
 
 # uart baud rate
-SERIAL_BAUDRATE := 57600
+SERIAL_BAUDRATE ?= 57600
 
 # timer interrupt frequency (100 -> 100 ints/s -> 10ms tick time. 0 -> timer0 fixed frequency)
-F_TICK := 100
+F_TICK ?= 100
 
 DEFINES := -DF_CPU=$(F_CLK) \
            -DUSART_BAUD=$(SERIAL_BAUDRATE) \
            -DF_TIMER=$(F_TICK) \
+           -include $(AUTOCONF_H) \
            -include config.h
 
 CROSS_COMPILE ?= riscv-none-elf-
@@ -22,8 +23,25 @@ CROSS_COMPILE ?= riscv-none-elf-
 # Detect LLVM/Clang toolchain (allow user override)
 CC_IS_CLANG ?= $(shell $(CROSS_COMPILE)clang --version 2>/dev/null | grep -qi clang && echo 1)
 
+# Atomic instructions: set to 1 to target rv32ima, so kernel spinlocks and
+# atomic counters use AMO/LR-SC instead of masking interrupts
+RV_ATOMICS ?= 0
+
+# Basic bit manipulation: set to 1 to add Zbb, so the string routines in
+# lib/ find zero and differing bytes with orc.b/ctz and the kernel's bit
+# scans use clz/ctz. The portable C versions remain the default.
+RV_ZBB ?= 0
+
 # Architecture flags
-ARCH_FLAGS = -march=rv32imzicsr -mabi=ilp32
+RV_ISA := rv32im
+ifeq ($(RV_ATOMICS),1)
+RV_ISA := $(RV_ISA)a
+endif
+RV_ISA := $(RV_ISA)zicsr_zifencei
+ifeq ($(RV_ZBB),1)
+RV_ISA := $(RV_ISA)_zbb
+endif
+ARCH_FLAGS = -march=$(RV_ISA) -mabi=ilp32
 
 # Common compiler flags
 CFLAGS += -Wall -Wextra -Werror -Wshadow -Wno-unused-parameter
@@ -63,11 +81,11 @@ LDFLAGS += --gc-sections
 ARFLAGS = r
 LDSCRIPT = $(ARCH_DIR)/riscv32-qemu.ld
 
-HAL_OBJS := boot.o hal.o muldiv.o
+HAL_OBJS := boot.o hal.o muldiv.o plic.o uart.o
 HAL_OBJS := $(addprefix $(BUILD_KERNEL_DIR)/,$(HAL_OBJS))
 deps += $(HAL_OBJS:%.o=%.o.d)
 
-$(BUILD_KERNEL_DIR)/%.o: $(ARCH_DIR)/%.c | $(BUILD_DIR)
+$(BUILD_KERNEL_DIR)/%.o: $(ARCH_DIR)/%.c $(AUTOCONF_H) | $(BUILD_DIR)
 	$(VECHO) "  CC\t$@\n"
 	$(Q)$(CC) $(CFLAGS) -o $@ -c -MMD -MF $@.d $<
 
@@ -150,6 +150,50 @@
 #define MTVEC_SET(base, mode) \
     (((base) & ~MTVEC_MODE_MASK) | ((mode) & MTVEC_MODE_MASK))
 
+/* Hardware Performance Counters
+ *
+ * 'mcycle' counts core clock cycles and 'minstret' retired instructions.
+ * The event counters 'mhpmcounter3' to 'mhpmcounter31' each count the event
+ * their 'mhpmeventN' register selects; event numbers are defined by each
+ * core, and 0 counts nothing. On RV32 every counter is 64 bits wide, with
+ * the upper half in a separate '...h' CSR.
+ */
+#define CSR_MCOUNTINHIBIT 0x320          /* Bit N set: counter N is frozen */
+#define MCOUNTINHIBIT_CY (1U << 0)       /* mcycle */
+#define MCOUNTINHIBIT_IR (1U << 2)       /* minstret */
+#define MCOUNTINHIBIT_HPM(n) (1U << (n)) /* mhpmcounterN, 3 <= N <= 31 */
+
+#define HPM_COUNTER_FIRST 3 /* Lowest event counter number */
+
+/* Physical Memory Protection (PMP)
+ *
+ * Each PMP entry has an address register 'pmpaddrN' holding bits [33:2] of
+ * an address and one configuration byte, packed four per 'pmpcfgN' register
+ * on RV32. Entries are matched in order, lowest number first.
+ */
+#define PMPCFG_R (1U << 0) /* Read permission */
+#define PMPCFG_W (1U << 1) /* Write permission */
+#define PMPCFG_X (1U << 2) /* Execute permission */
+
+/* Address matching mode */
+#define PMPCFG_A_OFF (0U << 3)   /* Entry disabled */
+#define PMPCFG_A_TOR (1U << 3)   /* Top of range: pmpaddr[N-1] <= a < [N] */
+#define PMPCFG_A_NA4 (2U << 3)   /* Naturally aligned four-byte region */
+#define PMPCFG_A_NAPOT (3U << 3) /* Naturally aligned power-of-two region */
+
+/* Locked entry: also enforced for M-mode accesses */
+#define PMPCFG_L (1U << 7)
+
+/* Configuration byte of entry @n within its 'pmpcfgN' register */
+#define PMPCFG_ENTRY(n, cfg) ((uint32_t) (cfg) << (((n) & 3) * 8))
+
+/* mseccfg Register (Smepmp Machine Security Configuration) */
+#define CSR_MSECCFG 0x747
+#define MSECCFG_MML (1U << 0)  /* Machine mode lockdown */
+#define MSECCFG_MMWP (1U << 1) /* Machine mode whitelist policy */
+#define MSECCFG_RLB (1U << 2)  /* Rule locking bypass: locked entries stay
+                                * writable */
+
 /* Safety and Validation Macros */
 
 /* Validate that a privilege mode value is legal */
@@ -1,11 +1,14 @@
 #include <hal.h>
 #include <lib/libc.h>
+#include <sys/clock.h>
 #include <sys/task.h>
+#include <sys/trace.h>
 
 #include "csr.h"
-#include "private/stdio.h"
 #include "private/utils.h"
 
+void _hrtimer_expire(uint64_t now);
+
 /* Context frame offsets for jmp_buf (as 32-bit word indices).
  *
  * This layout defines the structure of the jmp_buf. The first 16 elements
@@ -42,78 +45,23 @@
  */
 #define ISR_STACK_FRAME_SIZE 128
 
-/* NS16550A UART0 - Memory-mapped registers for the QEMU 'virt' machine's serial
- * port.
- */
-#define NS16550A_UART0_BASE 0x10000000U
-#define NS16550A_UART0_REG(off) \
-    (*(volatile uint8_t *) (NS16550A_UART0_BASE + (off)))
-
-/* UART register offsets */
-#define NS16550A_THR 0x00 /* Transmit Holding Register (write-only) */
-#define NS16550A_RBR 0x00 /* Receive Buffer Register (read-only) */
-#define NS16550A_DLL 0x00 /* Divisor Latch LSB (when DLAB=1) */
-#define NS16550A_DLM 0x01 /* Divisor Latch MSB (when DLAB=1) */
-#define NS16550A_LCR 0x03 /* Line Control Register */
-#define NS16550A_LSR 0x05 /* Line Status Register */
-
-/* Line Status Register bits */
-#define NS16550A_LSR_DR 0x01 /* Data Ready: byte received */
-/* Transmit Holding Register Empty: ready to send */
-#define NS16550A_LSR_THRE 0x20
-
-/* Line Control Register bits */
-#define NS16550A_LCR_8BIT 0x03 /* 8-bit chars, no parity, 1 stop bit (8N1) */
-#define NS16550A_LCR_DLAB 0x80 /* Divisor Latch Access Bit */
-
 /* CLINT (Core Local Interrupter) - Provides machine-level timer and software
- * interrupts.
+ * interrupts. 'mtime' is shared by all harts; each hart has its own MSIP
+ * word and 'mtimecmp' register, indexed by hart ID.
  */
 #define CLINT_BASE 0x02000000U
-#define MTIMECMP (*(volatile uint64_t *) (CLINT_BASE + 0x4000u))
-#define MTIME (*(volatile uint64_t *) (CLINT_BASE + 0xBFF8u))
+#define CLINT_MSIP(hart) (*(volatile uint32_t *) (CLINT_BASE + 4u * (hart)))
+#define CLINT_MTIMECMP(hart) (CLINT_BASE + 0x4000u + 8u * (hart))
 
-/* Accessors for 32-bit halves of the 64-bit CLINT registers */
-#define MTIMECMP_L (*(volatile uint32_t *) (CLINT_BASE + 0x4000u))
-#define MTIMECMP_H (*(volatile uint32_t *) (CLINT_BASE + 0x4004u))
+/* Accessors for 32-bit halves of the 64-bit CLINT registers. The compare
+ * register is always the calling hart's own.
+ */
+#define MTIMECMP_L (*(volatile uint32_t *) CLINT_MTIMECMP(hal_hart_id()))
+#define MTIMECMP_H (*(volatile uint32_t *) (CLINT_MTIMECMP(hal_hart_id()) + 4u))
 #define MTIME_L (*(volatile uint32_t *) (CLINT_BASE + 0xBFF8u))
 #define MTIME_H (*(volatile uint32_t *) (CLINT_BASE + 0xBFFCu))
 
-/* Low-Level I/O and Delay */
-
-/* Backend for 'putchar', writes a single character to the UART. */
-static int __putchar(int value)
-{
-    /* Spin (busy-wait) until the UART's transmit buffer is ready for a new
-     * character.
-     */
-    volatile uint32_t timeout = 0x100000; /* Reasonable timeout limit */
-    while (!(NS16550A_UART0_REG(NS16550A_LSR) & NS16550A_LSR_THRE)) {
-        if (unlikely(--timeout == 0))
-            return 0; /* Hardware timeout */
-    }
-
-    NS16550A_UART0_REG(NS16550A_THR) = (uint8_t) value;
-    return value;
-}
-
-/* Backend for polling stdin, checks if a character has been received. */
-static int __kbhit(void)
-{
-    /* Check the Data Ready (DR) bit in the Line Status Register */
-    return (NS16550A_UART0_REG(NS16550A_LSR) & NS16550A_LSR_DR) ? 1 : 0;
-}
-
-/* Backend for 'getchar', reads a single character from the UART. */
-static int __getchar(void)
-{
-    /* Block (busy-wait) until a character is available, then read and return
-     * it. No timeout here as this is expected to block.
-     */
-    while (!__kbhit())
-        ;
-    return (int) NS16550A_UART0_REG(NS16550A_RBR);
-}
+/* Machine Timer Access and Delay */
 
 /* Helper macro to combine high and low 32-bit words into a 64-bit value */
 #define CT64(hi, lo) (((uint64_t) (hi) << 32) | (lo))
@@ -166,12 +114,232 @@ static inline void mtimecmp_w(uint64_t val)
     write_csr(mie, old_mie);
 }
 
+/* Length of one scheduler tick in 'mtime' cycles */
+#define TICK_PERIOD (F_CPU / F_TIMER)
+
+/* 'mtimecmp' is shared by the scheduler tick and the high-resolution timers:
+ * it always holds the earlier of the next tick and the earliest hrtimer
+ * deadline, and the trap handler works out which of them came due.
+ */
+static uint64_t tick_next;
+static uint64_t hrt_next = UINT64_MAX; /* UINT64_MAX: no hrtimer armed */
+
+static inline void timer_program(void)
+{
+    mtimecmp_w(tick_next < hrt_next ? tick_next : hrt_next);
+}
+
+#if CONFIG_TICKLESS
+/* Longest tickless sleep, bounded so the elapsed cycle count fits 31 bits */
+#define TICKLESS_MAX_TICKS (0x7FFFFFFFU / TICK_PERIOD)
+
+/* 'mtime' value of the most recent tick boundary accounted in kcb->ticks */
+static uint64_t tick_base;
+
+/* Brings 'tick_base' up to date after a timer interrupt and rearms the next
+ * periodic tick. Returns the number of tick periods that elapsed, which is
+ * more than one when the interrupt had been deferred by tickless idle.
+ */
+static uint32_t tick_catch_up(void)
+{
+    uint32_t delta = (uint32_t) (mtime_r() - tick_base);
+    uint32_t elapsed = delta / TICK_PERIOD;
+    if (unlikely(!elapsed))
+        elapsed = 1;
+
+    tick_base += (uint64_t) elapsed * TICK_PERIOD;
+    tick_next = tick_base + TICK_PERIOD;
+    return elapsed;
+}
+
+/* Defers the next timer interrupt to @ticks periods after the last tick
+ * boundary. Called with interrupts disabled right before entering WFI.
+ */
+void hal_timer_defer(uint32_t ticks)
+{
+    if (ticks > TICKLESS_MAX_TICKS)
+        ticks = TICKLESS_MAX_TICKS;
+    tick_next = tick_base + (uint64_t) ticks * TICK_PERIOD;
+    timer_program();
+}
+#endif /* CONFIG_TICKLESS */
+
+#if CONFIG_IRQ_LATENCY
+static struct {
+    uint32_t count, min, max;
+    uint64_t sum;
+    uint32_t hist[HAL_LATENCY_BUCKETS];
+} tick_latency = {.min = 0xFFFFFFFFU};
+
+/* Records how late this timer interrupt is. Must run on trap entry, before
+ * 'mtimecmp' is moved to the next deadline.
+ */
+static inline void tick_latency_record(void)
+{
+    uint64_t now = mtime_r(), target = mtimecmp_r();
+    uint32_t late = 0;
+    if (likely(now > target))
+        late = (now - target > 0xFFFFFFFFU) ? 0xFFFFFFFFU
+                                           : (uint32_t) (now - target);
+
+    /* Bucket index is the bit length of 'late' */
+    uint32_t bucket = 0;
+    for (uint32_t v = late; v && bucket < HAL_LATENCY_BUCKETS - 1; v >>= 1)
+        bucket++;
+
+    tick_latency.count++;
+    tick_latency.sum += late;
+    tick_latency.hist[bucket]++;
+    if (late < tick_latency.min)
+        tick_latency.min = late;
+    if (late > tick_latency.max)
+        tick_latency.max = late;
+}
+
+void hal_tick_latency_read(hal_latency_t *stats)
+{
+    int32_t irq = hal_interrupt_set(0);
+
+    stats->count = tick_latency.count;
+    stats->min = tick_latency.count ? tick_latency.min : 0;
+    stats->max = tick_latency.max;
+    stats->avg =
+        tick_latency.count ? (uint32_t) (tick_latency.sum / tick_latency.count)
+                           : 0;
+    memcpy(stats->hist, tick_latency.hist, sizeof(stats->hist));
+
+    hal_interrupt_set(irq);
+}
+
+void hal_tick_latency_reset(void)
+{
+    int32_t irq = hal_interrupt_set(0);
+    memset(&tick_latency, 0, sizeof(tick_latency));
+    tick_latency.min = 0xFFFFFFFFU;
+    hal_interrupt_set(irq);
+}
+#endif /* CONFIG_IRQ_LATENCY */
+
 /* Returns number of microseconds since boot by reading the 'mtime' counter */
+uint32_t hal_clock_read(void)
+{
+    return MTIME_L;
+}
+
+uint64_t hal_clock_read64(void)
+{
+    return mtime_r();
+}
+
+/* Performance Counters
+ *
+ * CSR numbers are encoded in the instructions that access them, so each
+ * event counter needs its own switch case; HPM_EACH() generates them for
+ * the eight counters CONFIG_PMU_COUNTERS can select.
+ */
+#define HPM_EACH(op) op(3) op(4) op(5) op(6) op(7) op(8) op(9) op(10)
+
+/* Consistent 64-bit read of counter @reg and its upper half 'reg##h' */
+#define csr_read64(reg)                     \
+    ({                                      \
+        uint32_t __hi, __lo;                \
+        do {                                \
+            __hi = read_csr(reg##h);        \
+            __lo = read_csr(reg);           \
+        } while (__hi != read_csr(reg##h)); \
+        CT64(__hi, __lo);                   \
+    })
+
+#if CONFIG_PMU_COUNTERS
+/* Low 32 bits of event counter @n */
+static inline uint32_t hpm_read(uint32_t n)
+{
+    switch (n) {
+#define HPM_READ(i)             \
+    case i - HPM_COUNTER_FIRST: \
+        return read_csr(mhpmcounter##i);
+        HPM_EACH(HPM_READ)
+#undef HPM_READ
+    }
+    return 0;
+}
+#endif
+
+void hal_pmu_init(void)
+{
+    /* Cores without event counters may predate 'mcountinhibit', so it is
+     * only touched when some are configured.
+     */
+#if CONFIG_PMU_COUNTERS
+    for (uint32_t n = 0; n < CONFIG_PMU_COUNTERS; n++)
+        hal_pmu_event_set(n, 0);
+    write_csr(0x320, 0); /* CSR_MCOUNTINHIBIT */
+#endif
+}
+
+uint64_t hal_pmu_read(uint32_t slot)
+{
+    if (slot == HAL_PMU_CYCLES)
+        return csr_read64(mcycle);
+    if (slot == HAL_PMU_INSTRET)
+        return csr_read64(minstret);
+    if (unlikely(slot >= HAL_PMU_SLOTS))
+        return 0;
+
+    switch (slot - HAL_PMU_EVENT(0)) {
+#define HPM_READ64(i)           \
+    case i - HPM_COUNTER_FIRST: \
+        return csr_read64(mhpmcounter##i);
+        HPM_EACH(HPM_READ64)
+#undef HPM_READ64
+    }
+    return 0;
+}
+
+__fast_text void hal_pmu_sample(uint32_t *out)
+{
+    out[HAL_PMU_CYCLES] = read_csr(mcycle);
+    out[HAL_PMU_INSTRET] = read_csr(minstret);
+#if CONFIG_PMU_COUNTERS
+    for (uint32_t n = 0; n < CONFIG_PMU_COUNTERS; n++)
+        out[HAL_PMU_EVENT(n)] = hpm_read(n);
+#endif
+}
+
+int32_t hal_pmu_event_set(uint32_t n, uint32_t event)
+{
+    if (unlikely(HAL_PMU_EVENT(n) >= HAL_PMU_SLOTS))
+        return -1;
+
+    /* Stop the counter while it is cleared, then start the new event */
+    switch (n) {
+#define HPM_SELECT(i)                    \
+    case i - HPM_COUNTER_FIRST:          \
+        write_csr(mhpmevent##i, 0);      \
+        write_csr(mhpmcounter##i, 0);    \
+        write_csr(mhpmcounter##i##h, 0); \
+        write_csr(mhpmevent##i, event);  \
+        break;
+        HPM_EACH(HPM_SELECT)
+#undef HPM_SELECT
+    }
+    return 0;
+}
+
+void hal_hrtimer_program(uint64_t when)
+{
+    hrt_next = when;
+    timer_program();
+
+    /* A cooperative kernel never enables the tick, but hrtimers need it */
+    if (when != UINT64_MAX)
+        write_csr(mie, read_csr(mie) | MIE_MTIE);
+}
+
 uint64_t _read_us(void)
 {
-    /* Ensure F_CPU is defined and non-zero to prevent division by zero */
     _Static_assert(F_CPU > 0, "F_CPU must be defined and greater than 0");
-    return mtime_r() / (F_CPU / 1000000);
+    return mo_cycles_to_us(mtime_r());
 }
 
 /* Provides a blocking, busy-wait delay. This function monopolizes the CPU.
@@ -200,37 +368,30 @@ void delay_ms(uint32_t msec)
 
 /* Initialization and System Control */
 
-/* Initializes the UART for serial communication at a given baud rate */
-static void uart_init(uint32_t baud)
-{
-    uint32_t divisor = F_CPU / (16 * baud);
-    if (unlikely(!divisor))
-        divisor = 1; /* Ensure non-zero divisor */
-
-    /* Set DLAB to access divisor registers */
-    NS16550A_UART0_REG(NS16550A_LCR) = NS16550A_LCR_DLAB;
-    NS16550A_UART0_REG(NS16550A_DLM) = (divisor >> 8) & 0xff;
-    NS16550A_UART0_REG(NS16550A_DLL) = divisor & 0xff;
-    /* Clear DLAB and set line control to 8N1 mode */
-    NS16550A_UART0_REG(NS16550A_LCR) = NS16550A_LCR_8BIT;
-}
-
 /* Performs all essential hardware initialization at boot */
 void hal_hardware_init(void)
 {
-    uart_init(USART_BAUD);
+    hal_uart_init(USART_BAUD);
+    hal_irq_init();
+    hal_pmu_init();
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_PMP
+    hal_stack_guard_init();
+#endif
     /* Set the first timer interrupt. Subsequent interrupts are set in ISR */
-    mtimecmp_w(mtime_r() + (F_CPU / F_TIMER));
-    /* Install low-level I/O handlers for the C standard library */
-    _stdout_install(__putchar);
-    _stdin_install(__getchar);
-    _stdpoll_install(__kbhit);
+#if CONFIG_TICKLESS
+    tick_base = mtime_r();
+    tick_next = tick_base + TICK_PERIOD;
+#else
+    tick_next = mtime_r() + TICK_PERIOD;
+#endif
+    timer_program();
 }
 
 /* Halts the system in an unrecoverable state */
 void hal_panic(void)
 {
     _di(); /* Disable all interrupts to prevent further execution */
+    hal_console_flush(); /* Get queued output, e.g. the panic report, out */
 
     /* Attempt a clean shutdown via QEMU 'virt' machine's shutdown device */
     *(volatile uint32_t *) 0x100000U = 0x5555U;
@@ -246,13 +407,51 @@ void hal_cpu_idle(void)
     asm volatile("wfi");
 }
 
+void hal_ipi_send(uint32_t hart)
+{
+    CLINT_MSIP(hart) = 1;
+}
+
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_PMP
+/* Guard bounds currently programmed into PMP entries 0 and 1 */
+static uint32_t guard_lo, guard_hi;
+
+void hal_stack_guard_init(void)
+{
+    write_csr(0x747, MSECCFG_RLB); /* CSR_MSECCFG */
+}
+
+/* Entry 0 only supplies the lower bound (A = OFF); entry 1 is the locked,
+ * permissionless TOR region [pmpaddr0, pmpaddr1). Disabling entry 1 first
+ * keeps the pair consistent while the bounds change.
+ */
+void hal_stack_guard_set(void *base)
+{
+    uint32_t lo = ((uint32_t) base + 3U) & ~3U;
+    uint32_t hi = lo + HAL_STACK_GUARD_SIZE;
+
+    write_csr(pmpcfg0, 0);
+    write_csr(pmpaddr0, lo >> 2);
+    write_csr(pmpaddr1, hi >> 2);
+    write_csr(pmpcfg0, PMPCFG_ENTRY(1, PMPCFG_L | PMPCFG_A_TOR));
+
+    guard_lo = lo;
+    guard_hi = hi;
+}
+
+int32_t hal_stack_guard_hit(uint32_t addr)
+{
+    return addr >= guard_lo && addr < guard_hi;
+}
+#endif /* CONFIG_STACK_PROTECTION == STACK_PROTECT_PMP */
+
 /* Interrupt and Trap Handling */
 
 /* C-level trap handler, called by the '_isr' assembly routine.
  * @cause : The value of the 'mcause' CSR, indicating the reason for the trap.
  * @epc   : The value of the 'mepc' CSR, the PC at the time of the trap.
  */
-void do_trap(uint32_t cause, uint32_t epc)
+__fast_text void do_trap(uint32_t cause, uint32_t epc)
 {
     static const char *exc_msg[] = {
         /* For printing helpful debug messages */
@@ -274,15 +473,62 @@ void do_trap(uint32_t cause, uint32_t epc)
         [15] = "Store/AMO page fault",
     };
 
+    TRACE_EVENT(TRACE_ISR_ENTER, MCAUSE_GET_CODE(cause), 0, cause);
+
     if (MCAUSE_IS_INTERRUPT(cause)) { /* Asynchronous Interrupt */
         uint32_t int_code = MCAUSE_GET_CODE(cause);
         if (int_code == MCAUSE_MTI) { /* Machine Timer Interrupt */
-            /* To avoid timer drift, schedule the next interrupt relative to the
-             * previous target time, not the current time. This ensures a
-             * consistent tick frequency even with interrupt latency.
+#if CONFIG_IRQ_LATENCY
+            tick_latency_record();
+#endif
+            uint64_t now = mtime_r();
+
+            /* High-resolution timers first: they are the tighter deadline */
+            if (now >= hrt_next) {
+                hrt_next = UINT64_MAX;
+                _hrtimer_expire(now); /* Programs the next one, if any */
+            }
+
+            bool tick = now >= tick_next;
+            if (tick && unlikely(!sched_preemptive())) {
+                /* Only hrtimers enabled the interrupt: stop the tick */
+                tick_next = UINT64_MAX;
+                tick = false;
+            } else if (tick) {
+#if CONFIG_TICKLESS
+                /* Credit every tick that passed while the timer was deferred;
+                 * dispatcher() accounts for the final one itself.
+                 */
+                _tick_advance(tick_catch_up() - 1);
+#else
+                /* To avoid timer drift, schedule the next tick relative to
+                 * the previous target time, not the current time. This
+                 * ensures a consistent tick frequency even with interrupt
+                 * latency.
+                 */
+                tick_next += TICK_PERIOD;
+#endif
+            }
+            timer_program();
+
+            if (tick)
+                dispatcher(); /* Invoke the OS scheduler */
+        } else if (int_code == MCAUSE_MSI) { /* Machine Software Interrupt */
+            /* Doorbell, from another hart or from a _from_isr call on this
+             * one: acknowledge it, then run the reschedule an interrupt
+             * handler may have requested. Anything else is re-examined by
+             * the interrupted code on return. It often stays pending across
+             * a CRITICAL section and is taken the moment a resumed context
+             * sets MIE, which is why the context routines write mstatus
+             * only after the last register load.
+             */
+            CLINT_MSIP(hal_hart_id()) = 0;
+            dispatcher_resched();
+        } else if (int_code == MCAUSE_MEI) { /* Machine External Interrupt */
+            /* Normally taken through its own vector slot; only reached if
+             * mtvec is in direct mode.
              */
-            mtimecmp_w(mtimecmp_r() + (F_CPU / F_TIMER));
-            dispatcher(); /* Invoke the OS scheduler */
+            hal_irq_dispatch();
         } else {
             /* All other interrupt sources are unexpected and fatal */
             printf("[UNHANDLED INTERRUPT] code=%u, cause=%08x, epc=%08x\n",
@@ -296,14 +542,33 @@ void do_trap(uint32_t cause, uint32_t epc)
             reason = exc_msg[code];
         printf("[EXCEPTION] code=%u (%s), epc=%08x, cause=%08x\n", code, reason,
                epc, cause);
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_PMP
+        /* The trap frame itself may have faulted again, so report the
+         * guard hit from mtval rather than trusting epc.
+         */
+        uint32_t tval = read_csr(mtval);
+        if (code == MCAUSE_STORE_ACCESS_FAULT && hal_stack_guard_hit(tval))
+            printf("*** STACK OVERFLOW: task %u wrote %08x below its stack\n",
+                   mo_task_id(), tval);
+#endif
+#if CONFIG_TRACE
+        mo_trace_dump();
+#endif
         hal_panic();
     }
+
+    /* After a context switch this runs on the resumed task's stack. A task
+     * that had yielded resumes in yield() instead, so it never reaches here
+     * and the host script closes the open ISR slice at the next trap.
+     */
+    TRACE_EVENT(TRACE_ISR_EXIT, MCAUSE_GET_CODE(cause), 0, 0);
 }
 
 /* Enables the machine-level timer interrupt source */
 void hal_timer_enable(void)
 {
-    mtimecmp_w(mtime_r() + (F_CPU / F_TIMER));
+    tick_next = mtime_r() + TICK_PERIOD;
+    timer_program();
     write_csr(mie, read_csr(mie) | MIE_MTIE);
 }
 
@@ -320,7 +585,7 @@ void hal_timer_disable(void)
  */
 void hal_interrupt_tick(void)
 {
-    tcb_t *task = kcb->task_current->data;
+    tcb_t *task = kcb->task_current;
     if (unlikely(!task))
         hal_panic(); /* Fatal error - invalid task state */
 
@@ -414,7 +679,7 @@ __attribute__((noreturn)) void longjmp(jmp_buf env, int32_t val)
  * This is the context switching routine used by the CPU scheduler.
  * Returns 0 when called directly, non-zero when restored.
  */
-int32_t hal_context_save(jmp_buf env)
+__fast_text int32_t hal_context_save(jmp_buf env)
 {
     if (unlikely(!env))
         return -1; /* Invalid parameter */
@@ -457,13 +722,77 @@ int32_t hal_context_save(jmp_buf env)
     return 0;
 }
 
+/* Voluntary context switch: saves the caller's context to @from (a0) and
+ * resumes @to (a1). Only what the ABI requires a callee to preserve is
+ * saved (s0-s11, gp, tp, sp, ra) plus mstatus, stored with MIE rebuilt from
+ * MPIE exactly like hal_context_save(), so contexts saved by either routine
+ * can be resumed by either one. The incoming context sees a non-zero
+ * return value, as a hal_context_save() caller expects. A full switch is
+ * 17 stores, 17 loads, two CSR accesses and the final jump, with no call
+ * into C and no trap frame.
+ */
+__attribute__((naked)) __fast_text void hal_context_switch(jmp_buf from,
+                                                           jmp_buf to)
+{
+    asm volatile(
+        /* Save the outgoing context */
+        "sw  s0,   0*4(a0)\n"
+        "sw  s1,   1*4(a0)\n"
+        "sw  s2,   2*4(a0)\n"
+        "sw  s3,   3*4(a0)\n"
+        "sw  s4,   4*4(a0)\n"
+        "sw  s5,   5*4(a0)\n"
+        "sw  s6,   6*4(a0)\n"
+        "sw  s7,   7*4(a0)\n"
+        "sw  s8,   8*4(a0)\n"
+        "sw  s9,   9*4(a0)\n"
+        "sw  s10, 10*4(a0)\n"
+        "sw  s11, 11*4(a0)\n"
+        "sw  gp,  12*4(a0)\n"
+        "sw  tp,  13*4(a0)\n"
+        "sw  sp,  14*4(a0)\n"
+        "sw  ra,  15*4(a0)\n"
+        "csrr t0, mstatus\n"
+        "andi t1, t0, ~8\n" /* Clear MIE */
+        "srli t2, t0, 4\n"  /* MPIE (bit 7) down to the MIE position */
+        "andi t2, t2, 8\n"
+        "or   t1, t1, t2\n"
+        "sw   t1, 16*4(a0)\n"
+        /* Resume the incoming context. Its mstatus may re-enable interrupts,
+         * so it is written only once sp and every register are back: a
+         * pending tick taken earlier would run on the outgoing stack while
+         * 'task_current' already names the incoming task.
+         */
+        "lw  t0, 16*4(a1)\n"
+        "lw  s0,   0*4(a1)\n"
+        "lw  s1,   1*4(a1)\n"
+        "lw  s2,   2*4(a1)\n"
+        "lw  s3,   3*4(a1)\n"
+        "lw  s4,   4*4(a1)\n"
+        "lw  s5,   5*4(a1)\n"
+        "lw  s6,   6*4(a1)\n"
+        "lw  s7,   7*4(a1)\n"
+        "lw  s8,   8*4(a1)\n"
+        "lw  s9,   9*4(a1)\n"
+        "lw  s10, 10*4(a1)\n"
+        "lw  s11, 11*4(a1)\n"
+        "lw  gp,  12*4(a1)\n"
+        "lw  tp,  13*4(a1)\n"
+        "lw  sp,  14*4(a1)\n"
+        "lw  ra,  15*4(a1)\n"
+        "li  a0, 1\n"
+        "csrw mstatus, t0\n"
+        "ret\n");
+}
+
 /* Restores execution context AND processor state.
  * This is the fast context switching routine used by the scheduler.
  * Never returns to the caller.
  * @env : Pointer to the saved context (must be valid).
  * @val : The value to be returned by 'hal_context_save' (coerced to 1 if 0).
  */
-__attribute__((noreturn)) void hal_context_restore(jmp_buf env, int32_t val)
+__attribute__((noreturn)) __fast_text void hal_context_restore(jmp_buf env,
+                                                               int32_t val)
 {
     if (unlikely(!env))
         hal_panic(); /* Cannot proceed with invalid context */
@@ -471,34 +800,40 @@ __attribute__((noreturn)) void hal_context_restore(jmp_buf env, int32_t val)
     if (val == 0)
         val = 1; /* Must return a non-zero value after restore */
 
+    /* Fixed registers, so that no restored one overwrites an operand */
+    register uint32_t *ctx asm("a1") = (uint32_t *) env;
+    register int32_t ret asm("a0") = val;
+
     asm volatile(
-        /* Restore mstatus FIRST to ensure correct processor state */
-        "lw  t0, 16*4(%0)\n"
-        "csrw mstatus, t0\n"
+        /* The saved mstatus may re-enable interrupts, so it is written only
+         * after sp and every register are back: a tick or device interrupt
+         * taken earlier would run on the outgoing stack, with 'task_current'
+         * already naming the incoming task.
+         */
+        "lw  t0, 16*4(a1)\n"
         /* Restore all registers from the provided 'jmp_buf' */
-        "lw  s0,   0*4(%0)\n"
-        "lw  s1,   1*4(%0)\n"
-        "lw  s2,   2*4(%0)\n"
-        "lw  s3,   3*4(%0)\n"
-        "lw  s4,   4*4(%0)\n"
-        "lw  s5,   5*4(%0)\n"
-        "lw  s6,   6*4(%0)\n"
-        "lw  s7,   7*4(%0)\n"
-        "lw  s8,   8*4(%0)\n"
-        "lw  s9,   9*4(%0)\n"
-        "lw  s10, 10*4(%0)\n"
-        "lw  s11, 11*4(%0)\n"
-        "lw  gp,  12*4(%0)\n"
-        "lw  tp,  13*4(%0)\n"
-        "lw  sp,  14*4(%0)\n"
-        "lw  ra,  15*4(%0)\n"
-        /* Set the return value (in 'a0') */
-        "mv  a0,  %1\n"
-        /* "Return" to the restored 'ra', effectively jumping to new context */
+        "lw  s0,   0*4(a1)\n"
+        "lw  s1,   1*4(a1)\n"
+        "lw  s2,   2*4(a1)\n"
+        "lw  s3,   3*4(a1)\n"
+        "lw  s4,   4*4(a1)\n"
+        "lw  s5,   5*4(a1)\n"
+        "lw  s6,   6*4(a1)\n"
+        "lw  s7,   7*4(a1)\n"
+        "lw  s8,   8*4(a1)\n"
+        "lw  s9,   9*4(a1)\n"
+        "lw  s10, 10*4(a1)\n"
+        "lw  s11, 11*4(a1)\n"
+        "lw  gp,  12*4(a1)\n"
+        "lw  tp,  13*4(a1)\n"
+        "lw  sp,  14*4(a1)\n"
+        "lw  ra,  15*4(a1)\n"
+        "csrw mstatus, t0\n"
+        /* "Return" to the restored 'ra' with 'a0' as the return value */
         "ret\n"
         :
-        : "r"(env), "r"(val)
-        : "memory");
+        : "r"(ctx), "r"(ret)
+        : "t0", "memory");
 
     __builtin_unreachable(); /* Tell compiler this point is never reached */
 }
@@ -534,7 +869,7 @@ __attribute__((noreturn)) void hal_dispatch_init(jmp_buf env)
     if (unlikely(!env))
         hal_panic(); /* Cannot proceed without valid context */
 
-    if (kcb->preemptive)
+    if (sched_preemptive())
         hal_timer_enable();
     _ei(); /* Enable global interrupts just before launching the first task */
 
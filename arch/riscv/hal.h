@@ -6,11 +6,31 @@
 extern uint32_t _stack_start, _stack_end; /* Start/end of the STACK memory */
 extern uint32_t _heap_start, _heap_end;   /* Start/end of the HEAP memory */
 extern uint32_t _heap_size;               /* Size of HEAP memory */
+extern uint32_t _fast_heap_start;         /* Heap region in fast RAM */
+extern uint32_t _fast_heap_size;          /* Size of that region */
 extern uint32_t _sidata;        /* Start address for .data initialization */
 extern uint32_t _sdata, _edata; /* Start/end address for .data section */
 extern uint32_t _sbss, _ebss;   /* Start/end address for .bss section */
 extern uint32_t _end;           /* End of kernel image */
 
+/* Fast-RAM Placement
+ * __fast_text marks a function on the kernel's hot path, and __fast_data
+ * and __fast_bss initialized and zero-initialized data it uses. The linker
+ * script links them to run from the 'fastram' region (tightly coupled
+ * memory on real parts) and stores the code and data after the image;
+ * _entry copies them there and clears the BSS before main() runs. With
+ * CONFIG_FAST_RAM disabled they stay in the ordinary sections.
+ */
+#if CONFIG_FAST_RAM
+#define __fast_text __attribute__((section(".fast_text")))
+#define __fast_data __attribute__((section(".fast_data")))
+#define __fast_bss __attribute__((section(".bss.__fast")))
+#else
+#define __fast_text
+#define __fast_data
+#define __fast_bss
+#endif
+
 /* Read a RISC-V Control and Status Register (CSR).
  * @reg : The symbolic name of the CSR (e.g., mstatus).
  */
@@ -49,6 +69,85 @@ static inline int32_t hal_interrupt_set(int32_t enable)
 #define _di() hal_interrupt_set(0) /* Disable global interrupts */
 #define _ei() hal_interrupt_set(1) /* Enable global interrupts */
 
+/* Atomic Memory Operations
+ *
+ * Built with the A extension (RV_ATOMICS=1, which makes the compiler define
+ * __riscv_atomic) these are single AMO instructions or LR/SC loops with
+ * acquire-release ordering, safe against other harts. Without it they fall
+ * back to briefly masking interrupts, which is atomic on a single hart.
+ */
+
+/* Compiler barrier: keeps memory accesses on their side of this point, which
+ * is enough to order them against an interrupt taken on the same hart.
+ */
+static inline void hal_barrier(void)
+{
+    asm volatile("" ::: "memory");
+}
+
+/* Full memory barrier */
+static inline void hal_fence(void)
+{
+    asm volatile("fence rw, rw" ::: "memory");
+}
+
+/* Hint for busy-wait loops */
+static inline void hal_cpu_relax(void)
+{
+    asm volatile("nop" ::: "memory");
+}
+
+/* Atomically adds @val to *@ptr and returns the previous value */
+static inline uint32_t hal_atomic_fetch_add(volatile uint32_t *ptr,
+                                            uint32_t val)
+{
+#ifdef __riscv_atomic
+    uint32_t old;
+    asm volatile("amoadd.w.aqrl %0, %2, %1"
+                 : "=r"(old), "+A"(*ptr)
+                 : "r"(val)
+                 : "memory");
+    return old;
+#else
+    int32_t irq = hal_interrupt_set(0);
+    uint32_t old = *ptr;
+    *ptr = old + val;
+    if (irq)
+        _ei();
+    return old;
+#endif
+}
+
+/* Atomically replaces *@ptr with @desired if it equals @expected.
+ * Returns the value observed in *@ptr (equal to @expected on success).
+ */
+static inline uint32_t hal_atomic_cas(volatile uint32_t *ptr,
+                                      uint32_t expected,
+                                      uint32_t desired)
+{
+#ifdef __riscv_atomic
+    uint32_t old, fail;
+    asm volatile(
+        "1: lr.w.aqrl %0, %2\n"
+        "   bne       %0, %3, 2f\n"
+        "   sc.w.aqrl %1, %4, %2\n"
+        "   bnez      %1, 1b\n"
+        "2:\n"
+        : "=&r"(old), "=&r"(fail), "+A"(*ptr)
+        : "r"(expected), "r"(desired)
+        : "memory");
+    return old;
+#else
+    int32_t irq = hal_interrupt_set(0);
+    uint32_t old = *ptr;
+    if (old == expected)
+        *ptr = desired;
+    if (irq)
+        _ei();
+    return old;
+#endif
+}
+
 /* Context buffer for task switching. Contains execution context and space
  * for processor state management. The standard C library functions use only
  * the execution context portion, while HAL context switching routines manage
@@ -71,9 +170,20 @@ typedef uint32_t jmp_buf[17];
 int32_t setjmp(jmp_buf env);
 void longjmp(jmp_buf env, int32_t val);
 
-/* HAL context switching routines for complete context management */
+/* HAL context switching routines for complete context management.
+ * The resuming routines write the saved mstatus, which may set MIE, only
+ * after every register and sp are reloaded, so a pending tick, device
+ * interrupt or reschedule doorbell is never taken on a half-restored
+ * context.
+ */
 int32_t hal_context_save(jmp_buf env);
 void hal_context_restore(jmp_buf env, int32_t val);
+
+/* Saves the calling task's context to @from and resumes @to. Returns when
+ * the caller is switched back in. Used for voluntary switches, which need
+ * only the callee-saved registers; see hal.c.
+ */
+void hal_context_switch(jmp_buf from, jmp_buf to);
 void hal_dispatch_init(jmp_buf env);
 
 /* Provides a blocking, busy-wait delay.
@@ -88,12 +198,116 @@ void delay_ms(uint32_t msec);
  */
 uint64_t _read_us(void);
 
+/* Reads the low 32 bits of the free-running machine timer, which counts at
+ * F_CPU Hz. Cheap enough for per-context-switch time accounting; callers
+ * work with wrap-safe differences of successive reads.
+ */
+uint32_t hal_clock_read(void);
+
+/* Reads the full 64-bit machine timer, in F_CPU Hz cycles since boot */
+uint64_t hal_clock_read64(void);
+
+/* Sets the deadline of the high-resolution timers, in absolute machine timer
+ * cycles, or disarms them with UINT64_MAX. The timer compare register holds
+ * the earlier of it and the next scheduler tick; when it comes due, the trap
+ * handler calls the kernel's hrtimer expiry, which programs the next one.
+ * Must be called with interrupts disabled.
+ */
+void hal_hrtimer_program(uint64_t when);
+
+/* Timer Interrupt Latency (CONFIG_IRQ_LATENCY)
+ * Each tick records the lateness of the trap handler against the 'mtimecmp'
+ * deadline, in 'mtime' cycles (F_CPU Hz). hist[0] counts on-time ticks and
+ * hist[i] those late by [2^(i-1), 2^i) cycles; the last bucket also holds
+ * everything beyond.
+ */
+#define HAL_LATENCY_BUCKETS 16
+
+typedef struct {
+    uint32_t count; /* Timer interrupts measured */
+    uint32_t min;   /* Smallest lateness seen */
+    uint32_t max;   /* Largest lateness seen */
+    uint32_t avg;   /* Mean lateness */
+    uint32_t hist[HAL_LATENCY_BUCKETS];
+} hal_latency_t;
+
+/* Copies the statistics gathered since boot or the last reset to @stats */
+void hal_tick_latency_read(hal_latency_t *stats);
+
+/* Clears the statistics, e.g. to measure a single load phase */
+void hal_tick_latency_reset(void);
+
+/* Performance Counters
+ *
+ * Slot HAL_PMU_CYCLES is 'mcycle', which counts core clock cycles rather
+ * than machine timer cycles, HAL_PMU_INSTRET is 'minstret', and
+ * HAL_PMU_EVENT(n) is event counter 'mhpmcounter(3 + n)', for the
+ * CONFIG_PMU_COUNTERS counters the HAL drives. What an event counter
+ * counts, such as cache misses or branch mispredictions, is set with
+ * hal_pmu_event_set() using numbers the core defines; see its manual.
+ */
+#define HAL_PMU_CYCLES 0
+#define HAL_PMU_INSTRET 1
+#define HAL_PMU_EVENT(n) (2 + (n))
+#define HAL_PMU_SLOTS (2 + CONFIG_PMU_COUNTERS)
+
+#if CONFIG_PMU_COUNTERS > 8
+#error "CONFIG_PMU_COUNTERS must be between 0 and 8"
+#endif
+
+/* Starts every counter and stops the event counters from counting anything
+ * until an event is selected. Called once by hal_hardware_init().
+ */
+void hal_pmu_init(void);
+
+/* Reads the full 64-bit value of counter @slot.
+ * Returns 0 for a slot at or beyond HAL_PMU_SLOTS
+ */
+uint64_t hal_pmu_read(uint32_t slot);
+
+/* Stores the low 32 bits of all HAL_PMU_SLOTS counters in @out, read back
+ * to back. Cheap enough for every context switch; callers work with
+ * wrap-safe differences of successive samples.
+ */
+void hal_pmu_sample(uint32_t *out);
+
+/* Makes event counter @n count @event from zero.
+ * @n     : Event counter, 0 to CONFIG_PMU_COUNTERS - 1
+ * @event : Core-specific 'mhpmevent' selector; 0 stops the counter
+ *
+ * Returns 0 on success, -1 if @n is out of range
+ */
+int32_t hal_pmu_event_set(uint32_t n, uint32_t event);
+
+/* Arithmetic Helpers (muldiv.c)
+ *
+ * The compiler calls __muldi3(), __udivmoddi4() and friends for arithmetic
+ * the ISA lacks. With the M extension they use 'mul' and 'divu'; the
+ * shift-and-add versions are kept as the _soft_ variants for comparison.
+ * The _hw_ variants exist only when building with M.
+ */
+uint64_t __muldi3(uint64_t a, uint64_t b);
+uint64_t __udivmoddi4(uint64_t num, uint64_t den, uint64_t *rem);
+uint64_t _soft_muldi3(uint64_t a, uint64_t b);
+uint64_t _soft_udivmoddi4(uint64_t num, uint64_t den, uint64_t *rem);
+#if defined(__riscv_mul) && defined(__riscv_div)
+uint64_t _hw_muldi3(uint64_t a, uint64_t b);
+uint64_t _hw_udivmoddi4(uint64_t num, uint64_t den, uint64_t *rem);
+#endif
+
 /* Hardware Abstraction Layer (HAL) initialization and control functions */
 void hal_hardware_init(void);
 void hal_timer_enable(void);
 void hal_timer_disable(void);
 void hal_interrupt_tick(void);
 
+/* Tickless idle: postpones the next timer interrupt by @ticks scheduler ticks
+ * counted from the last tick boundary (clamped to a hardware-safe maximum).
+ * The trap handler credits all skipped ticks to the system tick counter.
+ * Only available when CONFIG_TICKLESS is enabled.
+ */
+void hal_timer_defer(uint32_t ticks);
+
 /* Initializes the context structure for a new task.
  * @ctx : Pointer to jmp_buf to initialize (must be non-NULL).
  * @sp  : Base address of the task's stack (must be valid).
@@ -108,5 +322,100 @@ void hal_panic(void);
 /* Puts the CPU into a low-power wait-for-interrupt state */
 void hal_cpu_idle(void);
 
+/* Hardware Stack Guard (CONFIG_STACK_PROTECTION == STACK_PROTECT_PMP)
+ *
+ * A locked PMP entry without permissions covers the lowest
+ * HAL_STACK_GUARD_SIZE bytes of the running task's stack, so the first store
+ * past the end of the stack raises a store access fault. Locked entries also
+ * apply to M-mode; Smepmp's rule locking bypass (mseccfg.RLB) keeps them
+ * reprogrammable, so the core must implement Smepmp.
+ */
+#define HAL_STACK_GUARD_SIZE 32
+
+/* Enables rule locking bypass. Must run before any PMP entry is locked. */
+void hal_stack_guard_init(void);
+
+/* Moves the guard to the bottom of the stack at @base. Called at every
+ * context switch for the incoming task.
+ */
+void hal_stack_guard_set(void *base);
+
+/* Returns non-zero if @addr lies inside the active guard region */
+int32_t hal_stack_guard_hit(uint32_t addr);
+
+/* External Interrupts (PLIC)
+ *
+ * Each PLIC source gets its own handler, called from a lightweight trap
+ * entry that saves only caller-saved registers and bypasses the scheduler.
+ * Handlers run with interrupts disabled unless CONFIG_IRQ_NESTING is set,
+ * in which case strictly higher-priority sources may preempt them.
+ */
+#define HAL_IRQ_MAX 64     /* Number of PLIC sources handled (0 is unused) */
+#define HAL_IRQ_PRIO_MIN 1 /* Lowest priority that can interrupt */
+#define HAL_IRQ_PRIO_MAX 7 /* Highest PLIC priority */
+
+/* Interrupt sources of the QEMU 'virt' machine */
+#define HAL_IRQ_UART0 10
+
+typedef void (*hal_irq_handler_t)(uint32_t irq);
+
+/* Masks every source and resets the priority threshold */
+void hal_irq_init(void);
+
+/* Installs @handler for external interrupt source @irq and enables it at
+ * priority @prio. A NULL @handler disables the source.
+ * @irq     : PLIC source number (1 to HAL_IRQ_MAX - 1)
+ * @handler : Function called with the source number, or NULL
+ * @prio    : HAL_IRQ_PRIO_MIN to HAL_IRQ_PRIO_MAX; higher wins
+ *
+ * Returns 0 on success, -1 for an invalid source or priority
+ */
+int32_t hal_irq_register(uint32_t irq, hal_irq_handler_t handler, uint8_t prio);
+
+/* Claims and serves all pending external interrupts. Called by the trap
+ * entry code; not for direct use.
+ */
+void hal_irq_dispatch(void);
+
+/* Returns non-zero while an external interrupt handler is running */
+int32_t hal_irq_active(void);
+
+/* Console (NS16550A UART0)
+ *
+ * The console is polled from boot, which works in any context. Once the
+ * heap is ready, hal_console_init() makes it interrupt-driven when
+ * CONFIG_UART_IRQ is set: output is queued and sent by the UART interrupt,
+ * and tasks sleep rather than spin while waiting for input or for room.
+ */
+
+/* Programs the UART for 8N1 at @baud and installs the polled stdio hooks */
+void hal_uart_init(uint32_t baud);
+
+/* Switches the console to interrupt-driven I/O; stays polled if its buffers
+ * cannot be allocated. Called once by the kernel after heap setup.
+ */
+void hal_console_init(void);
+
+/* Sends all queued console output by polling, e.g. before shutting down */
+void hal_console_flush(void);
+
+/* Multi-Hart Support
+ *
+ * Only hart 0 runs the kernel; secondary harts are parked at boot. These
+ * primitives make the HAL hart-aware (per-hart CLINT timer compare and
+ * software interrupt) as the base for scheduling on more harts.
+ */
+
+/* Gets the ID of the calling hart */
+static inline uint32_t hal_hart_id(void)
+{
+    return read_csr(mhartid);
+}
+
+/* Raises a machine software interrupt (IPI) on @hart through its CLINT
+ * MSIP register. The receiving hart acknowledges it in its trap handler.
+ */
+void hal_ipi_send(uint32_t hart);
+
 /* Default stack size for new tasks if not otherwise specified */
 #define DEFAULT_STACK_SIZE 4096
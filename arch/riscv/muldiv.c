@@ -1,11 +1,25 @@
-/* software implementation of 64-bit multiply/divide */
-
+/* 64-bit multiply/divide helpers
+ *
+ * These are the libgcc arithmetic helpers, which the kernel does not link.
+ * With the M extension (__riscv_mul, __riscv_div), the compiler inlines
+ * every 32-bit operation and 64-bit multiply, and only calls here for
+ * 64-bit division: those helpers then take at most two 'divu' steps per
+ * quotient digit instead of a bit-by-bit loop (Hacker's Delight 9-3). The
+ * shift-and-add versions remain for cores without M, and are always built
+ * as _soft_muldi3() and _soft_udivmoddi4() so app/muldiv can compare them.
+ */
+
+#include <hal.h>
 #include <types.h>
+
 #include "private/utils.h"
 
 /* 32-bit multiplication with overflow detection */
 uint32_t __mulsi3(uint32_t a, uint32_t b)
 {
+#ifdef __riscv_mul
+    return a * b; /* A single 'mul' */
+#else
     /* Early exit for common cases */
     if (unlikely(a == 0 || b == 0))
         return 0;
@@ -30,11 +44,15 @@ uint32_t __mulsi3(uint32_t a, uint32_t b)
         a >>= 1;
     }
     return result;
+#endif
 }
 
 /* 32x32 -> 64-bit multiplication */
 uint64_t __muldsi3(uint32_t a, uint32_t b)
 {
+#ifdef __riscv_mul
+    return (uint64_t) a * b; /* 'mul' and 'mulhu' */
+#else
     /* Early exit optimizations */
     if (unlikely(a == 0 || b == 0))
         return 0;
@@ -54,10 +72,11 @@ uint64_t __muldsi3(uint32_t a, uint32_t b)
     }
 
     return result;
+#endif
 }
 
 /* 64x64 -> 64-bit multiplication using Karatsuba-like decomposition */
-uint64_t __muldi3(uint64_t a, uint64_t b)
+uint64_t _soft_muldi3(uint64_t a, uint64_t b)
 {
     /* Early exit for common cases */
     if (unlikely(a == 0 || b == 0))
@@ -79,6 +98,26 @@ uint64_t __muldi3(uint64_t a, uint64_t b)
     return low + (mid << 32);
 }
 
+#if defined(__riscv_mul) && defined(__riscv_div)
+/* The low 64 bits need one 'mulhu' and three 'mul' */
+uint64_t _hw_muldi3(uint64_t a, uint64_t b)
+{
+    uint32_t al = (uint32_t) a, ah = (uint32_t) (a >> 32);
+    uint32_t bl = (uint32_t) b, bh = (uint32_t) (b >> 32);
+
+    return (uint64_t) al * bl + ((uint64_t) (al * bh + ah * bl) << 32);
+}
+#endif
+
+uint64_t __muldi3(uint64_t a, uint64_t b)
+{
+#if defined(__riscv_mul) && defined(__riscv_div)
+    return _hw_muldi3(a, b);
+#else
+    return _soft_muldi3(a, b);
+#endif
+}
+
 /* Common division helper with comprehensive error handling */
 uint32_t __udivmodsi4(uint32_t num, uint32_t den, int mod)
 {
@@ -88,6 +127,10 @@ uint32_t __udivmodsi4(uint32_t num, uint32_t den, int mod)
         return mod ? 0 : UINT32_MAX;
     }
 
+#ifdef __riscv_div
+    /* 'divu' or 'remu' */
+    return mod ? num % den : num / den;
+#else
     /* Handle trivial cases for efficiency */
     if (unlikely(num < den))
         return mod ? num : 0;
@@ -127,6 +170,7 @@ uint32_t __udivmodsi4(uint32_t num, uint32_t den, int mod)
     }
 
     return mod ? num : quot;
+#endif
 }
 
 /* Signed division with proper handling of edge cases */
@@ -232,7 +276,7 @@ uint64_t __lshrdi3(uint64_t val, int cnt)
 }
 
 /* 64-bit unsigned division with remainder - enhanced version */
-uint64_t __udivmoddi4(uint64_t num, uint64_t den, uint64_t *rem)
+uint64_t _soft_udivmoddi4(uint64_t num, uint64_t den, uint64_t *rem)
 {
     /* Handle division by zero */
     if (unlikely(den == 0)) {
@@ -290,6 +334,95 @@ uint64_t __udivmoddi4(uint64_t num, uint64_t den, uint64_t *rem)
     return quot;
 }
 
+#if defined(__riscv_mul) && defined(__riscv_div)
+/* Divides the 64-bit value @hi:@lo by @den, where @hi < @den, so that the
+ * quotient fits 32 bits. The divisor is normalized so that its top bit is
+ * set; each 16-bit quotient digit is then estimated by one 'divu' on the
+ * divisor's high half, and is at most two too large.
+ */
+static uint32_t divlu(uint32_t hi, uint32_t lo, uint32_t den, uint32_t *rem)
+{
+    const uint32_t b = 1U << 16;
+    uint32_t s = 31 - ilog2(den);
+
+    den <<= s;
+    uint32_t dn1 = den >> 16, dn0 = den & 0xFFFF;
+    uint32_t un32 = s ? (hi << s) | (lo >> (32 - s)) : hi;
+    uint32_t un10 = lo << s;
+    uint32_t un1 = un10 >> 16, un0 = un10 & 0xFFFF;
+
+    uint32_t q1 = un32 / dn1, rhat = un32 - q1 * dn1;
+    while (q1 >= b || q1 * dn0 > b * rhat + un1) {
+        q1--;
+        rhat += dn1;
+        if (rhat >= b)
+            break;
+    }
+
+    uint32_t un21 = un32 * b + un1 - q1 * den;
+    uint32_t q0 = un21 / dn1;
+    rhat = un21 - q0 * dn1;
+    while (q0 >= b || q0 * dn0 > b * rhat + un0) {
+        q0--;
+        rhat += dn1;
+        if (rhat >= b)
+            break;
+    }
+
+    *rem = (un21 * b + un0 - q0 * den) >> s;
+    return q1 * b + q0;
+}
+
+uint64_t _hw_udivmoddi4(uint64_t num, uint64_t den, uint64_t *rem)
+{
+    uint32_t nh = (uint32_t) (num >> 32), nl = (uint32_t) num;
+    uint32_t dh = (uint32_t) (den >> 32), dl = (uint32_t) den;
+    uint32_t r;
+
+    /* Handle division by zero, as the software version does */
+    if (unlikely(den == 0)) {
+        if (rem)
+            *rem = 0;
+        return UINT64_MAX;
+    }
+
+    if (!dh) {
+        /* High quotient word by 'divu', low word from the remainder */
+        uint32_t qh = nh / dl;
+        uint32_t ql = divlu(nh - qh * dl, nl, dl, &r);
+        if (rem)
+            *rem = r;
+        return ((uint64_t) qh << 32) | ql;
+    }
+
+    /* A divisor above 32 bits leaves a quotient below 2^32. Estimate it
+     * from the divisor's normalized high word and half the dividend, which
+     * can be one short; the remainder check corrects that.
+     */
+    uint32_t n = 31 - ilog2(dh);
+    uint32_t dn = n ? (dh << n) | (dl >> (32 - n)) : dh;
+    uint64_t half = num >> 1;
+    uint64_t q = (uint64_t) divlu((uint32_t) (half >> 32), (uint32_t) half,
+                                  dn, &r) << n >> 31;
+    if (q)
+        q--;
+    if (num - q * den >= den)
+        q++;
+    if (rem)
+        *rem = num - q * den;
+    return q;
+}
+#endif
+
+uint64_t __udivmoddi4(uint64_t num, uint64_t den, uint64_t *rem)
+{
+#if defined(__riscv_mul) && defined(__riscv_div)
+    return _hw_udivmoddi4(num, den, rem);
+#else
+    return _soft_udivmoddi4(num, den, rem);
+#endif
+}
+
 /* 64-bit signed division with remainder */
 int64_t __divmoddi4(int64_t num, int64_t den, int64_t *rem)
 {
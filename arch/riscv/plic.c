@@ -0,0 +1,140 @@
+/* Platform-Level Interrupt Controller (PLIC) driver and per-source dispatch.
+ *
+ * External interrupts reach the hart through its own mtvec vector slot
+ * (see '_isr_ext' in boot.c), which saves only the caller-saved registers
+ * and calls hal_irq_dispatch(). Device handlers therefore never go through
+ * the full trap frame or the scheduler; a handler that wakes a task uses the
+ * _from_isr calls, whose task switch is taken through the machine software
+ * interrupt once the handler returns. With CONFIG_IRQ_NESTING, a handler
+ * runs with the PLIC threshold raised to its own priority and interrupts
+ * re-enabled, so only strictly higher-priority sources can preempt it.
+ */
+
+#include <hal.h>
+#include <sys/trace.h>
+
+#include "csr.h"
+#include "private/utils.h"
+
+/* PLIC register map of the QEMU 'virt' machine */
+#define PLIC_BASE 0x0C000000U
+#define PLIC_PRIORITY(irq) \
+    (*(volatile uint32_t *) (PLIC_BASE + 4u * (irq)))
+#define PLIC_ENABLE(ctx, irq)                                           \
+    (*(volatile uint32_t *) (PLIC_BASE + 0x2000u + 0x80u * (ctx) + \
+                             4u * ((irq) / 32u)))
+#define PLIC_THRESHOLD(ctx) \
+    (*(volatile uint32_t *) (PLIC_BASE + 0x200000u + 0x1000u * (ctx)))
+#define PLIC_CLAIM(ctx) \
+    (*(volatile uint32_t *) (PLIC_BASE + 0x200004u + 0x1000u * (ctx)))
+
+/* Interrupt target context of a hart's M-mode (S-mode is the odd one) */
+#define PLIC_CTX_M(hart) (2u * (hart))
+
+static struct {
+    hal_irq_handler_t handler;
+    uint8_t prio;
+} irq_table[HAL_IRQ_MAX];
+
+/* Handlers currently running, more than one when nested */
+static volatile uint32_t irq_depth;
+
+void hal_irq_init(void)
+{
+    uint32_t ctx = PLIC_CTX_M(hal_hart_id());
+
+    for (uint32_t irq = 1; irq < HAL_IRQ_MAX; irq++)
+        PLIC_PRIORITY(irq) = 0;
+    for (uint32_t irq = 0; irq < HAL_IRQ_MAX; irq += 32)
+        PLIC_ENABLE(ctx, irq) = 0;
+    PLIC_THRESHOLD(ctx) = 0;
+}
+
+int32_t hal_irq_register(uint32_t irq, hal_irq_handler_t handler, uint8_t prio)
+{
+    if (unlikely(irq == 0 || irq >= HAL_IRQ_MAX))
+        return -1;
+    if (unlikely(handler && (prio < HAL_IRQ_PRIO_MIN ||
+                             prio > HAL_IRQ_PRIO_MAX)))
+        return -1;
+
+    uint32_t ctx = PLIC_CTX_M(hal_hart_id());
+    uint32_t bit = 1u << (irq % 32u);
+    int32_t irq_on = hal_interrupt_set(0);
+
+    if (handler) {
+        irq_table[irq].handler = handler;
+        irq_table[irq].prio = prio;
+        PLIC_PRIORITY(irq) = prio;
+        PLIC_ENABLE(ctx, irq) |= bit;
+    } else {
+        /* Priority 0 never interrupts; disable the source as well */
+        PLIC_ENABLE(ctx, irq) &= ~bit;
+        PLIC_PRIORITY(irq) = 0;
+        irq_table[irq].handler = NULL;
+        irq_table[irq].prio = 0;
+    }
+
+    if (irq_on)
+        _ei();
+    return 0;
+}
+
+/* Runs the handler of @irq, letting higher-priority sources nest if enabled.
+ * A nested interrupt overwrites mepc and mstatus, so both are kept on this
+ * frame and put back before returning to the trap entry code.
+ */
+static inline void irq_run(uint32_t ctx, uint32_t irq)
+{
+    hal_irq_handler_t handler = irq_table[irq].handler;
+
+#if CONFIG_IRQ_NESTING
+    uint32_t epc = read_csr(mepc);
+    uint32_t status = read_csr(mstatus);
+    uint32_t enabled = read_csr(mie);
+    uint32_t threshold = PLIC_THRESHOLD(ctx);
+
+    /* Only external sources above this one's priority may preempt it; the
+     * tick stays masked so no task switch happens inside a handler.
+     */
+    PLIC_THRESHOLD(ctx) = irq_table[irq].prio;
+    write_csr(mie, MIE_MEIE);
+    _ei();
+
+    handler(irq);
+
+    _di();
+    write_csr(mie, enabled);
+    PLIC_THRESHOLD(ctx) = threshold;
+    write_csr(mepc, epc);
+    write_csr(mstatus, status);
+#else
+    (void) ctx;
+    handler(irq);
+#endif
+}
+
+int32_t hal_irq_active(void)
+{
+    return irq_depth != 0;
+}
+
+__fast_text void hal_irq_dispatch(void)
+{
+    uint32_t ctx = PLIC_CTX_M(hal_hart_id());
+    uint32_t irq;
+
+    /* Serve every pending source before returning */
+    while ((irq = PLIC_CLAIM(ctx)) != 0) {
+        TRACE_EVENT(TRACE_ISR_ENTER, MCAUSE_MEI, irq, MCAUSE_INT | MCAUSE_MEI);
+
+        if (likely(irq < HAL_IRQ_MAX && irq_table[irq].handler)) {
+            irq_depth++;
+            irq_run(ctx, irq);
+            irq_depth--;
+        }
+
+        PLIC_CLAIM(ctx) = irq; /* Complete: the source may fire again */
+        TRACE_EVENT(TRACE_ISR_EXIT, MCAUSE_MEI, irq, 0);
+    }
+}
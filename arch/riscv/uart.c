@@ -0,0 +1,381 @@
+/* NS16550A console UART driver.
+ *
+ * The console starts out polled: every byte waits for the transmitter, and
+ * input is read by spinning on the line status. That is all boot code and
+ * panic reports need. Once the heap is up, hal_console_init() switches to
+ * interrupt-driven I/O over two pipes:
+ *
+ * - Output is queued in the TX pipe and a writer returns at once; the UART
+ *   interrupt refills the 16-byte transmit FIFO from it each time the FIFO
+ *   runs empty. Writers sleep only while the pipe is full.
+ * - Received bytes are moved into the RX pipe by the interrupt handler, and
+ *   readers sleep on the pipe until data arrives.
+ *
+ * Callers that cannot sleep (interrupt handlers, code with interrupts off
+ * or scheduling disabled, and everything before the scheduler starts) still
+ * queue output while there is room, but push a full TX pipe out by polling
+ * and read input by polling, so the console works from any context.
+ */
+
+#include <hal.h>
+#include <lib/libc.h>
+#include <sys/pipe.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
+
+#include "csr.h"
+#include "private/stdio.h"
+#include "private/utils.h"
+
+/* NS16550A UART0 - Memory-mapped registers for the QEMU 'virt' machine's serial
+ * port.
+ */
+#define NS16550A_UART0_BASE 0x10000000U
+#define NS16550A_UART0_REG(off) \
+    (*(volatile uint8_t *) (NS16550A_UART0_BASE + (off)))
+
+/* UART register offsets */
+#define NS16550A_THR 0x00 /* Transmit Holding Register (write-only) */
+#define NS16550A_RBR 0x00 /* Receive Buffer Register (read-only) */
+#define NS16550A_DLL 0x00 /* Divisor Latch LSB (when DLAB=1) */
+#define NS16550A_IER 0x01 /* Interrupt Enable Register */
+#define NS16550A_DLM 0x01 /* Divisor Latch MSB (when DLAB=1) */
+#define NS16550A_IIR 0x02 /* Interrupt Identification Register (read) */
+#define NS16550A_FCR 0x02 /* FIFO Control Register (write) */
+#define NS16550A_LCR 0x03 /* Line Control Register */
+#define NS16550A_LSR 0x05 /* Line Status Register */
+#define NS16550A_MSR 0x06 /* Modem Status Register */
+
+/* Line Status Register bits */
+#define NS16550A_LSR_DR 0x01 /* Data Ready: byte received */
+/* Transmit Holding Register Empty: ready to send */
+#define NS16550A_LSR_THRE 0x20
+#define NS16550A_LSR_TEMT 0x40 /* Transmitter Empty: last bit sent */
+
+/* Line Control Register bits */
+#define NS16550A_LCR_8BIT 0x03 /* 8-bit chars, no parity, 1 stop bit (8N1) */
+#define NS16550A_LCR_DLAB 0x80 /* Divisor Latch Access Bit */
+
+/* Interrupt Enable Register bits */
+#define NS16550A_IER_ERBFI 0x01 /* Received data available */
+#define NS16550A_IER_ETBEI 0x02 /* Transmit holding register empty */
+
+/* Interrupt Identification Register: bit 0 clear means one is pending */
+#define NS16550A_IIR_NONE 0x01
+#define NS16550A_IIR_ID(iir) ((iir) & 0x0E)
+#define NS16550A_IIR_MSR 0x00 /* Modem status changed */
+#define NS16550A_IIR_THRE 0x02 /* Transmit FIFO empty */
+#define NS16550A_IIR_RDA 0x04  /* Receive FIFO reached its trigger level */
+#define NS16550A_IIR_RLS 0x06  /* Receiver line status (error) */
+#define NS16550A_IIR_CTI 0x0C  /* Receive timeout: data below trigger */
+
+/* FIFO Control Register: enable and clear both FIFOs, RX trigger at 8 */
+#define NS16550A_FCR_SETUP 0x87
+
+/* Depth of the transmit and receive FIFOs */
+#define UART_FIFO 16
+
+/* PLIC priority of the console interrupt: the lowest, it is never urgent */
+#define UART_IRQ_PRIO HAL_IRQ_PRIO_MIN
+
+/* Polled Console */
+
+/* Backend for 'putchar', writes a single character to the UART. */
+static int __putchar(int value)
+{
+    /* Spin (busy-wait) until the UART's transmit buffer is ready for a new
+     * character.
+     */
+    volatile uint32_t timeout = 0x100000; /* Reasonable timeout limit */
+    while (!(NS16550A_UART0_REG(NS16550A_LSR) & NS16550A_LSR_THRE)) {
+        if (unlikely(--timeout == 0))
+            return 0; /* Hardware timeout */
+    }
+
+    NS16550A_UART0_REG(NS16550A_THR) = (uint8_t) value;
+    return value;
+}
+
+/* Backend for polling stdin, checks if a character has been received. */
+static int __kbhit(void)
+{
+    /* Check the Data Ready (DR) bit in the Line Status Register */
+    return (NS16550A_UART0_REG(NS16550A_LSR) & NS16550A_LSR_DR) ? 1 : 0;
+}
+
+/* Backend for 'getchar', reads a single character from the UART. */
+static int __getchar(void)
+{
+    /* Block (busy-wait) until a character is available, then read and return
+     * it. No timeout here as this is expected to block.
+     */
+    while (!__kbhit())
+        ;
+    return (int) NS16550A_UART0_REG(NS16550A_RBR);
+}
+
+void hal_uart_init(uint32_t baud)
+{
+    uint32_t divisor = F_CPU / (16 * baud);
+    if (unlikely(!divisor))
+        divisor = 1; /* Ensure non-zero divisor */
+
+    /* Set DLAB to access divisor registers */
+    NS16550A_UART0_REG(NS16550A_LCR) = NS16550A_LCR_DLAB;
+    NS16550A_UART0_REG(NS16550A_DLM) = (divisor >> 8) & 0xff;
+    NS16550A_UART0_REG(NS16550A_DLL) = divisor & 0xff;
+    /* Clear DLAB and set line control to 8N1 mode */
+    NS16550A_UART0_REG(NS16550A_LCR) = NS16550A_LCR_8BIT;
+    NS16550A_UART0_REG(NS16550A_FCR) = NS16550A_FCR_SETUP;
+    NS16550A_UART0_REG(NS16550A_IER) = 0;
+
+    /* Install low-level I/O handlers for the C standard library */
+    _stdout_install(__putchar);
+    _stdin_install(__getchar);
+    _stdpoll_install(__kbhit);
+}
+
+/* Interrupt-Driven Console */
+
+#if CONFIG_UART_IRQ && !CONFIG_PIPE
+#error "CONFIG_UART_IRQ requires CONFIG_PIPE"
+#endif
+
+#if CONFIG_UART_IRQ
+
+/* Writers sleeping on a full TX pipe wake once this much is free again */
+#define UART_TX_WM (CONFIG_UART_TX_RING / 4)
+
+static struct {
+    pipe_t *tx;          /* Output waiting for the transmitter */
+    pipe_t *rx;          /* Input waiting for a reader */
+    volatile bool tx_on; /* Transmit interrupt enabled, FIFO being refilled */
+    spinlock_t lock;     /* Orders FIFO refills between handler and pollers */
+} uart = {.lock = SPINLOCK_INIT};
+
+/* Largest part of @left bytes a single pipe call can take */
+static inline uint16_t uart_chunk(int left)
+{
+    return left > (int) UINT16_MAX ? UINT16_MAX : (uint16_t) left;
+}
+
+/* True if the caller is a task that may block on a pipe */
+static inline bool uart_may_sleep(void)
+{
+    return kcb->task_current && !kcb->preempt_count && !hal_irq_active() &&
+           (read_csr(mstatus) & MSTATUS_MIE);
+}
+
+/* Moves up to one FIFO's worth of queued output to the transmitter, which
+ * must be idle, and stops the transmit interrupt once nothing is left.
+ * Called with the driver lock held.
+ */
+static void uart_tx_fill(void)
+{
+    char buf[UART_FIFO];
+    int32_t len = mo_pipe_read_from_isr(uart.tx, buf, sizeof(buf));
+
+    if (len <= 0) {
+        NS16550A_UART0_REG(NS16550A_IER) = NS16550A_IER_ERBFI;
+        uart.tx_on = false;
+        return;
+    }
+    for (int32_t i = 0; i < len; i++)
+        NS16550A_UART0_REG(NS16550A_THR) = (uint8_t) buf[i];
+}
+
+/* Starts the transmit interrupt if it is not already running. The UART
+ * raises it at once while the FIFO is empty.
+ */
+static void uart_tx_kick(void)
+{
+    /* The handler clears 'tx_on' only after finding the pipe empty, which
+     * it can no longer be, so a set flag means our bytes will be sent.
+     */
+    if (uart.tx_on)
+        return;
+
+    uint32_t flags = spin_lock_irqsave(&uart.lock);
+    if (!uart.tx_on) {
+        uart.tx_on = true;
+        NS16550A_UART0_REG(NS16550A_IER) =
+            NS16550A_IER_ERBFI | NS16550A_IER_ETBEI;
+    }
+    spin_unlock_irqrestore(&uart.lock, flags);
+}
+
+/* Sends queued output by polling until the TX pipe is empty */
+static void uart_tx_drain(void)
+{
+    uint32_t flags = spin_lock_irqsave(&uart.lock);
+    while (mo_pipe_size(uart.tx) > 0) {
+        while (!(NS16550A_UART0_REG(NS16550A_LSR) & NS16550A_LSR_THRE))
+            ;
+        uart_tx_fill();
+    }
+    spin_unlock_irqrestore(&uart.lock, flags);
+}
+
+static void uart_rx_isr(void)
+{
+    char buf[UART_FIFO];
+
+    while (NS16550A_UART0_REG(NS16550A_LSR) & NS16550A_LSR_DR) {
+        uint16_t len = 0;
+        while (len < sizeof(buf) &&
+               (NS16550A_UART0_REG(NS16550A_LSR) & NS16550A_LSR_DR))
+            buf[len++] = (char) NS16550A_UART0_REG(NS16550A_RBR);
+
+        /* Bytes that do not fit are dropped, as by a hardware overrun */
+        mo_pipe_write_from_isr(uart.rx, buf, len);
+    }
+}
+
+static void uart_isr(uint32_t irq)
+{
+    (void) irq;
+    uint8_t iir;
+
+    while (!((iir = NS16550A_UART0_REG(NS16550A_IIR)) & NS16550A_IIR_NONE)) {
+        switch (NS16550A_IIR_ID(iir)) {
+        case NS16550A_IIR_RDA:
+        case NS16550A_IIR_CTI:
+            uart_rx_isr();
+            break;
+        case NS16550A_IIR_THRE: {
+            uint32_t flags = spin_lock_irqsave(&uart.lock);
+            uart_tx_fill();
+            spin_unlock_irqrestore(&uart.lock, flags);
+            break;
+        }
+        case NS16550A_IIR_RLS:
+            (void) NS16550A_UART0_REG(NS16550A_LSR);
+            break;
+        default:
+            (void) NS16550A_UART0_REG(NS16550A_MSR);
+            break;
+        }
+    }
+}
+
+static int uart_write(const char *buf, int len)
+{
+    int done = 0;
+
+    if (uart_may_sleep()) {
+        /* Sleeping in mo_pipe_write() is safe only while the transmitter
+         * runs, so every write into the pipe is followed by a kick. A full
+         * pipe implies bytes queued and the interrupt on.
+         */
+        while (done < len) {
+            uint16_t part = uart_chunk(len - done);
+            int32_t n = mo_pipe_nbwrite(uart.tx, buf + done, part);
+            if (n <= 0)
+                n = mo_pipe_write(uart.tx, buf + done,
+                                  min(part, UART_TX_WM));
+            if (n <= 0)
+                break;
+            done += n;
+            uart_tx_kick();
+        }
+        return done;
+    }
+
+    while (done < len) {
+        uint16_t part = uart_chunk(len - done);
+        int32_t n = mo_pipe_write_from_isr(uart.tx, buf + done, part);
+        if (n > 0) {
+            done += n;
+            continue;
+        }
+
+        /* Full and unable to sleep: make room by sending one FIFO's worth */
+        uint32_t flags = spin_lock_irqsave(&uart.lock);
+        while (!(NS16550A_UART0_REG(NS16550A_LSR) & NS16550A_LSR_THRE))
+            ;
+        uart_tx_fill();
+        spin_unlock_irqrestore(&uart.lock, flags);
+    }
+    uart_tx_kick();
+    return done;
+}
+
+static int uart_putchar(int value)
+{
+    char c = (char) value;
+    uart_write(&c, 1);
+    return value;
+}
+
+static int uart_getchar(void)
+{
+    char c;
+
+    if (uart_may_sleep())
+        return mo_pipe_read(uart.rx, &c, 1) == 1 ? (uint8_t) c : -1;
+    if (mo_pipe_read_from_isr(uart.rx, &c, 1) == 1)
+        return (uint8_t) c;
+    return __kbhit() ? (int) NS16550A_UART0_REG(NS16550A_RBR) : -1;
+}
+
+static int uart_read(char *buf, int len)
+{
+    int done = 0;
+
+    if (!uart_may_sleep()) {
+        for (; done < len; done++)
+            buf[done] = (char) _getchar();
+        return done;
+    }
+
+    while (done < len) {
+        uint16_t part = uart_chunk(len - done);
+        int32_t n = mo_pipe_read(uart.rx, buf + done, part);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    return done;
+}
+
+static int uart_kbhit(void)
+{
+    return mo_pipe_size(uart.rx) > 0 || __kbhit();
+}
+
+#endif /* CONFIG_UART_IRQ */
+
+void hal_console_init(void)
+{
+#if CONFIG_UART_IRQ
+    uart.tx = mo_pipe_create(CONFIG_UART_TX_RING);
+    uart.rx = mo_pipe_create(CONFIG_UART_RX_RING);
+    if (unlikely(!uart.tx || !uart.rx)) {
+        /* Stay polled; destroying a NULL pipe is a no-op */
+        mo_pipe_destroy(uart.tx);
+        mo_pipe_destroy(uart.rx);
+        uart.tx = uart.rx = NULL;
+        return;
+    }
+    mo_pipe_set_watermarks(uart.tx, 1, UART_TX_WM);
+
+    NS16550A_UART0_REG(NS16550A_IER) = NS16550A_IER_ERBFI;
+    hal_irq_register(HAL_IRQ_UART0, uart_isr, UART_IRQ_PRIO);
+
+    _stdout_install(uart_putchar);
+    _stdwrite_install(uart_write);
+    _stdin_install(uart_getchar);
+    _stdread_install(uart_read);
+    _stdpoll_install(uart_kbhit);
+#endif
+}
+
+void hal_console_flush(void)
+{
+#if CONFIG_UART_IRQ
+    if (uart.tx)
+        uart_tx_drain();
+#endif
+    while (!(NS16550A_UART0_REG(NS16550A_LSR) & NS16550A_LSR_TEMT))
+        ;
+}
@@ -1,6 +1,273 @@
 #pragma once
 
-/* Stack Overflow Detection Configuration */
+/* Build Configuration
+ * Every option below is a default. A build overrides them without editing
+ * this file by naming a configuration fragment, 'make CONFIG=configs/...',
+ * or by setting CONFIG_* variables on the make command line; either way
+ * they are written to build/autoconf.h, which is included ahead of this
+ * header (see configs/).
+ */
+
+/* Scheduling Mode Configuration
+ * SCHED_MODE_RUNTIME: app_main()'s return value selects preemptive or
+ *   cooperative scheduling at boot.
+ * SCHED_MODE_PREEMPTIVE, SCHED_MODE_COOPERATIVE: the mode is fixed at build
+ *   time and app_main()'s return value is ignored. The mode tests in
+ *   CRITICAL_ENTER()/CRITICAL_LEAVE(), the tick handler and the scheduler
+ *   become constants, and the dead branches compile away.
+ */
+#define SCHED_MODE_RUNTIME 0
+#define SCHED_MODE_PREEMPTIVE 1
+#define SCHED_MODE_COOPERATIVE 2
+
+#ifndef CONFIG_SCHED_MODE
+#define CONFIG_SCHED_MODE SCHED_MODE_RUNTIME /* Default: app_main() decides */
+#endif
+
+/* Task Table Configuration
+ * The kernel holds at most (1 << CONFIG_TASK_SLOT_BITS) - 1 tasks; each
+ * slot costs 8 bytes of kernel state. Must be between 2 and 8.
+ */
+#ifndef CONFIG_TASK_SLOT_BITS
+#define CONFIG_TASK_SLOT_BITS 5 /* Default: 31 tasks */
+#endif
+
+/* Task Recycling Configuration
+ * mo_task_cancel() keeps up to CONFIG_TASK_RECYCLE dead heap-backed tasks,
+ * TCB and stack together, instead of freeing them; a later spawn whose
+ * stack size falls in the same power-of-two class takes one back and only
+ * reinitializes it. Kept stacks stay allocated until reused or released
+ * with mo_task_recycle_flush(). 0 frees every cancelled task at once.
+ */
+#ifndef CONFIG_TASK_RECYCLE
+#define CONFIG_TASK_RECYCLE 4
+#endif
+
+/* Kernel Subsystem Selection
+ * Each subsystem can be left out of the kernel; its API is then not built
+ * and programs that use it fail to link.
+ * CONFIG_TIMER: software timers (<sys/timer.h>) and their service task.
+ * CONFIG_PIPE: byte pipes (<sys/pipe.h>); the interrupt-driven console
+ *   needs them and is left out with them.
+ * CONFIG_MQUEUE: message queues (<sys/mqueue.h>), and the work queues
+ *   built on them (<sys/workqueue.h>).
+ * CONFIG_COND: condition variables (mo_cond_*() in <sys/mutex.h>).
+ */
+#ifndef CONFIG_TIMER
+#define CONFIG_TIMER 1 /* Default: enabled */
+#endif
+
+#ifndef CONFIG_PIPE
+#define CONFIG_PIPE 1 /* Default: enabled */
+#endif
+
+#ifndef CONFIG_MQUEUE
+#define CONFIG_MQUEUE 1 /* Default: enabled */
+#endif
+
+#ifndef CONFIG_COND
+#define CONFIG_COND 1 /* Default: enabled */
+#endif
+
+/* Fast-RAM Placement Configuration
+ * When enabled, the trap entry, context switch, scheduler and the fast
+ * paths of semaphores and mutexes run from the linker script's 'fastram'
+ * region, next to the kernel control block (ready queues included) and the
+ * first CONFIG_FAST_TCBS task control blocks; see __fast_text in <hal.h>.
+ * Costs one copy of that code at boot.
+ */
+#ifndef CONFIG_FAST_RAM
+#define CONFIG_FAST_RAM 1 /* Default: enabled */
+#endif
+
+#ifndef CONFIG_FAST_TCBS
+#define CONFIG_FAST_TCBS 8
+#endif
+
+/* Stack Overflow Detection Configuration
+ * STACK_PROTECT_CANARY: canary words at both stack ends, checked every
+ *   few context switches; catches an overflow after the fact.
+ * STACK_PROTECT_PMP: a PMP guard region over the bottom of the running
+ *   task's stack, moved at each context switch; the overflowing store
+ *   traps immediately. Requires PMP with Smepmp (QEMU: -cpu rv32,smepmp=on).
+ */
+#define STACK_PROTECT_NONE 0
+#define STACK_PROTECT_CANARY 1
+#define STACK_PROTECT_PMP 2
+
 #ifndef CONFIG_STACK_PROTECTION
-#define CONFIG_STACK_PROTECTION 1 /* Default: enabled for safety */
+#define CONFIG_STACK_PROTECTION STACK_PROTECT_CANARY /* Default: enabled */
+#endif
+
+/* Stack Watermark Configuration
+ * When enabled, every task stack is filled with a known pattern at spawn so
+ * that mo_task_stack_usage() can find the deepest point the task reached.
+ * Filling costs one pass over each stack at spawn time.
+ */
+#ifndef CONFIG_STACK_WATERMARK
+#define CONFIG_STACK_WATERMARK 0 /* Default: disabled */
+#endif
+
+/* Interrupt Nesting Configuration
+ * When enabled, an external interrupt handler registered through
+ * hal_irq_register() can be preempted by sources of higher PLIC priority.
+ */
+#ifndef CONFIG_IRQ_NESTING
+#define CONFIG_IRQ_NESTING 0 /* Default: handlers run to completion */
+#endif
+
+/* Interrupt Latency Measurement
+ * When enabled, every timer interrupt records how far 'mtime' had moved past
+ * the programmed 'mtimecmp' deadline when the trap handler ran; see
+ * hal_tick_latency_read(). Costs two 64-bit timer reads per tick.
+ */
+#ifndef CONFIG_IRQ_LATENCY
+#define CONFIG_IRQ_LATENCY 0 /* Default: disabled */
+#endif
+
+/* Performance Counter Configuration
+ * CONFIG_PMU_COUNTERS: number of event counters, from 'mhpmcounter3' up,
+ *   that the HAL drives (0 to 8). It must not exceed what the core
+ *   implements: accessing a missing counter is an illegal instruction.
+ * CONFIG_TASK_PMU: charges the cycle, instruction and event counts to the
+ *   running task at every context switch, like its run time, so that
+ *   mo_task_stats() reports them and mo_task_stats_dump() shows IPC.
+ *   Costs 2 + CONFIG_PMU_COUNTERS CSR reads per switch.
+ */
+#ifndef CONFIG_PMU_COUNTERS
+#define CONFIG_PMU_COUNTERS 0
+#endif
+
+#ifndef CONFIG_TASK_PMU
+#define CONFIG_TASK_PMU 0 /* Default: disabled */
+#endif
+
+/* Response Time Histogram Configuration
+ * When enabled, each job of a periodic task, ended by its call to
+ * mo_task_delay_until(), is timed from its release to its completion and
+ * recorded in a per-task histogram read with mo_task_response(). Costs 72
+ * bytes per task and a timer read per job and per tick that wakes a task.
+ */
+#ifndef CONFIG_TASK_RESPONSE
+#define CONFIG_TASK_RESPONSE 0 /* Default: disabled */
+#endif
+
+/* Lock Contention Statistics Configuration
+ * When enabled, every mutex and semaphore counts its acquisitions and
+ * contended waits, and times its waits and mutex holds, so that
+ * mo_lock_stats_dump() can rank the hottest ones (see <sys/lockstat.h>).
+ * Costs about 40 bytes per object and a timer read per acquisition.
+ */
+#ifndef CONFIG_LOCK_STATS
+#define CONFIG_LOCK_STATS 0 /* Default: disabled */
+#endif
+
+/* Tickless Idle Configuration
+ * When enabled, an idle-priority task calling mo_task_wfi() with nothing
+ * else runnable stops the periodic tick and sleeps until the next task
+ * delay or software timer deadline.
+ */
+#ifndef CONFIG_TICKLESS
+#define CONFIG_TICKLESS 0 /* Default: periodic tick */
+#endif
+
+/* Scheduler Trace Configuration
+ * When enabled, the kernel records compact binary scheduling events into a
+ * fixed-size RAM ring buffer (see <sys/trace.h>). CONFIG_TRACE_EVENTS must
+ * be a power of two; each event takes 12 bytes.
+ */
+#ifndef CONFIG_TRACE
+#define CONFIG_TRACE 0 /* Default: disabled */
+#endif
+
+#ifndef CONFIG_TRACE_EVENTS
+#define CONFIG_TRACE_EVENTS 256
+#endif
+
+/* Deferred Log Configuration
+ * When enabled, mo_log() stores unformatted records into a RAM ring that
+ * mo_log_flush() or the host decoder formats later (see <sys/log.h>).
+ * When disabled, mo_log() calls compile to nothing. CONFIG_LOG_RECORDS must
+ * be a power of two; each record takes 28 bytes.
+ */
+#ifndef CONFIG_LOG
+#define CONFIG_LOG 1 /* Default: enabled */
+#endif
+
+#ifndef CONFIG_LOG_RECORDS
+#define CONFIG_LOG_RECORDS 64
+#endif
+
+/* Heap Region Configuration
+ * Most memory regions the heap can manage: the one mo_heap_init() sets up
+ * plus those added with mo_heap_add_region(), e.g. a fast on-chip SRAM.
+ * Each region costs about 1.9 KiB of free-list tables.
+ */
+#ifndef CONFIG_HEAP_REGIONS
+#define CONFIG_HEAP_REGIONS 4
+#endif
+
+/* Heap Trace Configuration
+ * When enabled, every heap call records its caller, size and task into a
+ * RAM ring buffer read with mo_heap_trace_read() (see <lib/malloc.h>).
+ * CONFIG_HEAP_TRACE_ENTRIES must be a power of two; each entry takes 16
+ * bytes.
+ */
+#ifndef CONFIG_HEAP_TRACE
+#define CONFIG_HEAP_TRACE 0 /* Default: disabled */
+#endif
+
+#ifndef CONFIG_HEAP_TRACE_ENTRIES
+#define CONFIG_HEAP_TRACE_ENTRIES 128
+#endif
+
+/* Timer Service Task Configuration
+ * Software timer callbacks run in a kernel task spawned with the first
+ * mo_timer_create(). CONFIG_TIMER_DAEMON_PRIO is its priority (one of the
+ * TASK_PRIO_* values) and CONFIG_TIMER_DAEMON_STACK the size of its static
+ * stack in bytes, which every callback runs on.
+ */
+#ifndef CONFIG_TIMER_DAEMON_PRIO
+#define CONFIG_TIMER_DAEMON_PRIO TASK_PRIO_HIGH
+#endif
+
+#ifndef CONFIG_TIMER_DAEMON_STACK
+#define CONFIG_TIMER_DAEMON_STACK 2048
+#endif
+
+/* Software timer IDs are looked up through a hash table of
+ * CONFIG_TIMER_HASH_SIZE buckets (a power of two), 4 bytes each.
+ */
+#ifndef CONFIG_TIMER_HASH_SIZE
+#define CONFIG_TIMER_HASH_SIZE 64
+#endif
+
+/* Interrupt-Driven Console Configuration
+ * When enabled, the console UART switches from polling to interrupts once
+ * the heap is up: output is queued in a CONFIG_UART_TX_RING-byte ring and
+ * writers sleep only while it is full, and input collects in a
+ * CONFIG_UART_RX_RING-byte ring that readers sleep on. Ring sizes are
+ * rounded up to a power of two; the TX ring should be at least 64 bytes.
+ * The rings are pipes, so this requires CONFIG_PIPE.
+ */
+#ifndef CONFIG_UART_IRQ
+#define CONFIG_UART_IRQ CONFIG_PIPE /* Default: enabled with pipes */
+#endif
+
+#ifndef CONFIG_UART_TX_RING
+#define CONFIG_UART_TX_RING 1024
+#endif
+
+#ifndef CONFIG_UART_RX_RING
+#define CONFIG_UART_RX_RING 256
+#endif
+
+/* Buffered Task Output Configuration
+ * When non-zero, printf() and puts() from each task collect in a line
+ * buffer of this many bytes inside its TCB, and every full line reaches the
+ * console in one piece, never interleaved with other tasks' output. At most
+ * 1024; 0 writes every character straight through.
+ */
+#ifndef CONFIG_STDOUT_BUF
+#define CONFIG_STDOUT_BUF 0 /* Default: disabled */
 #endif
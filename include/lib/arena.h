@@ -0,0 +1,50 @@
+/* Bump-pointer arenas.
+ *
+ * An arena serves allocations from one fixed region by advancing an offset,
+ * so allocating is a bounds check and an add. Individual allocations are
+ * never freed; the whole region is recycled at once by arena_reset() or by
+ * releasing the memory behind it. Arenas take no lock: each one is meant to
+ * be used by a single task, such as the per-task arena of a task spawned
+ * with mo_task_spawn_arena().
+ */
+
+#pragma once
+
+#include <lib/libc.h>
+
+typedef struct {
+    char *base;    /* Start of the region, word-aligned */
+    uint32_t size; /* Bytes in the region */
+    uint32_t used; /* Bytes handed out since the last reset */
+    uint32_t peak; /* Highest 'used' seen */
+} arena_t;
+
+/* Sets @a up over @size bytes at @base, which must be word-aligned */
+static inline void arena_init(arena_t *a, void *base, uint32_t size)
+{
+    a->base = base;
+    a->size = size & ~(sizeof(void *) - 1);
+    a->used = a->peak = 0;
+}
+
+/* Returns @size bytes, word-aligned and not cleared, or NULL if the arena
+ * has too little room left or has no region at all.
+ */
+static inline void *arena_alloc(arena_t *a, uint32_t size)
+{
+    uint32_t want = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (!size || want < size || want > a->size - a->used)
+        return NULL;
+
+    void *p = a->base + a->used;
+    a->used += want;
+    if (a->used > a->peak)
+        a->peak = a->used;
+    return p;
+}
+
+/* Releases every allocation of @a at once */
+static inline void arena_reset(arena_t *a)
+{
+    a->used = 0;
+}
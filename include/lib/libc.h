@@ -141,6 +141,11 @@ int random_r(struct random_data *buf, int32_t *result);
 /* Character and string output */
 int32_t puts(const char *str);
 
+/* Sends the calling task's buffered output to the console now, whatever
+ * @f; a no-op unless CONFIG_STDOUT_BUF is set. Returns 0.
+ */
+int fflush(void *f);
+
 /* Character and string input */
 int getchar(void);
 char *gets(char *s);
@@ -1,8 +1,17 @@
-/* Singly-linked list
- * – Two sentinel nodes (head and tail) eliminate edge-case tests.
- * – The list stores generic data pointers ('void *').
- * – All primitives are defined 'static inline' so they can live entirely
- *   in the header without multiple-definition issues.
+/* Linked lists
+ *
+ * Two flavours are provided, both entirely 'static inline':
+ *
+ * dlist_t – intrusive, circular, doubly-linked list. The link (dlist_node_t)
+ *   is embedded in the object it chains, and container_of() recovers the
+ *   object from its link, so linking never allocates, unlinking is O(1) and
+ *   reaching the object costs no extra pointer load. This is what the
+ *   kernel uses for its own object lists.
+ *
+ * list_t – singly-linked list of generic data pointers ('void *') between
+ *   two sentinel nodes. list_pushback() and list_pop() allocate and free a
+ *   node per element; the '_node' / 'unlink' / 'init' variants work on
+ *   caller-owned storage and never touch the heap.
  */
 
 #pragma once
@@ -12,6 +21,98 @@
 
 #include "private/utils.h"
 
+/* Intrusive Doubly-Linked List */
+
+/* Object of type @type whose member @member is at @ptr */
+#define container_of(ptr, type, member) \
+    ((type *) ((char *) (ptr) - __builtin_offsetof(type, member)))
+
+typedef struct dlist_node {
+    struct dlist_node *next;
+    struct dlist_node *prev;
+} dlist_node_t;
+
+/* List head: a sentinel node closing the circle, plus a cached length */
+typedef struct {
+    dlist_node_t head;
+    size_t length;
+} dlist_t;
+
+/* Static initializer for the dlist_t named @name */
+#define DLIST_INIT(name) {{&(name).head, &(name).head}, 0}
+
+static inline void dlist_init(dlist_t *list)
+{
+    list->head.next = list->head.prev = &list->head;
+    list->length = 0U;
+}
+
+static inline bool dlist_empty(const dlist_t *list)
+{
+    return list->head.next == &list->head;
+}
+
+static inline void dlist_insert_between(dlist_node_t *node,
+                                        dlist_node_t *prev,
+                                        dlist_node_t *next)
+{
+    node->prev = prev;
+    node->next = next;
+    prev->next = node;
+    next->prev = node;
+}
+
+static inline void dlist_push_back(dlist_t *list, dlist_node_t *node)
+{
+    dlist_insert_between(node, list->head.prev, &list->head);
+    list->length++;
+}
+
+static inline void dlist_push_front(dlist_t *list, dlist_node_t *node)
+{
+    dlist_insert_between(node, &list->head, list->head.next);
+    list->length++;
+}
+
+/* Unlinks @node, which must be on @list */
+static inline void dlist_remove(dlist_t *list, dlist_node_t *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = node->prev = NULL;
+    list->length--;
+}
+
+/* First node, or NULL if @list is empty */
+static inline dlist_node_t *dlist_first(const dlist_t *list)
+{
+    return dlist_empty(list) ? NULL : list->head.next;
+}
+
+/* Successor of @node, or NULL at the end of @list */
+static inline dlist_node_t *dlist_next(const dlist_t *list,
+                                       const dlist_node_t *node)
+{
+    return node->next == &list->head ? NULL : node->next;
+}
+
+/* Circular successor: wraps from the last node to the first */
+static inline dlist_node_t *dlist_cnext(const dlist_t *list,
+                                        const dlist_node_t *node)
+{
+    return node->next == &list->head ? list->head.next : node->next;
+}
+
+/* Iterate @pos, of type @type *, over the objects linked through @member.
+ * @pos may not be unlinked inside the loop body.
+ */
+#define dlist_for_each_entry(pos, list, type, member)                 \
+    for (pos = container_of((list)->head.next, type, member);          \
+         &pos->member != &(list)->head;                                \
+         pos = container_of(pos->member.next, type, member))
+
+/* Generic Singly-Linked List */
+
 /* List node */
 typedef struct list_node {
     struct list_node *next;
@@ -25,6 +126,20 @@ typedef struct {
     size_t length;     /* number of data nodes */
 } list_t;
 
+/* Initialize @list over caller-provided sentinel nodes */
+static inline void list_init(list_t *list, list_node_t *head, list_node_t *tail)
+{
+    head->next = tail;
+    head->data = NULL;
+
+    tail->next = NULL;
+    tail->data = NULL;
+
+    list->head = head;
+    list->tail = tail;
+    list->length = 0U;
+}
+
 static inline list_t *list_create(void)
 {
     list_t *list = malloc(sizeof(*list));
@@ -44,15 +159,7 @@ static inline list_t *list_create(void)
         return NULL;
     }
 
-    head->next = tail;
-    head->data = NULL;
-
-    tail->next = NULL;
-    tail->data = NULL;
-
-    list->head = head;
-    list->tail = tail;
-    list->length = 0U;
+    list_init(list, head, tail);
     return list;
 }
 
@@ -78,13 +185,12 @@ static inline list_node_t *list_cnext(const list_t *list,
 
 /* Push and pop */
 
-static inline list_node_t *list_pushback(list_t *list, void *data)
+/* Append a caller-owned @node carrying @data */
+static inline list_node_t *list_pushback_node(list_t *list,
+                                              list_node_t *node,
+                                              void *data)
 {
-    if (unlikely(!list))
-        return NULL;
-
-    list_node_t *node = malloc(sizeof(*node));
-    if (unlikely(!node))
+    if (unlikely(!list || !node))
         return NULL;
 
     node->data = data;
@@ -100,6 +206,18 @@ static inline list_node_t *list_pushback(list_t *list, void *data)
     return node;
 }
 
+static inline list_node_t *list_pushback(list_t *list, void *data)
+{
+    if (unlikely(!list))
+        return NULL;
+
+    list_node_t *node = malloc(sizeof(*node));
+    if (unlikely(!node))
+        return NULL;
+
+    return list_pushback_node(list, node, data);
+}
+
 static inline void *list_pop(list_t *list)
 {
     if (unlikely(list_is_empty(list)))
@@ -114,23 +232,32 @@ static inline void *list_pop(list_t *list)
     return data;
 }
 
-/* Remove a specific node; returns its data */
-static inline void *list_remove(list_t *list, list_node_t *target)
+/* Detach a specific node without freeing it; returns false if not found */
+static inline bool list_unlink(list_t *list, list_node_t *target)
 {
     if (unlikely(!list || !target || list_is_empty(list)))
-        return NULL;
+        return false;
 
     list_node_t *prev = list->head;
     while (prev->next != list->tail && prev->next != target)
         prev = prev->next;
 
     if (unlikely(prev->next != target))
-        return NULL; /* node not found */
+        return false; /* node not found */
 
     prev->next = target->next;
+    list->length--;
+    return true;
+}
+
+/* Remove a specific node; returns its data */
+static inline void *list_remove(list_t *list, list_node_t *target)
+{
+    if (unlikely(!list_unlink(list, target)))
+        return NULL;
+
     void *data = target->data;
     free(target);
-    list->length--;
     return data;
 }
 
@@ -14,3 +14,134 @@ void *realloc(void *ptr, uint32_t size);
 
 /* Heap management */
 void mo_heap_init(size_t *zone, uint32_t len);
+
+/* Memory Regions
+ *
+ * The heap can span several disjoint regions of different speed, such as a
+ * small on-chip SRAM next to a large external DRAM. mo_heap_init() sets up
+ * region 0, the general-purpose memory; mo_heap_add_region() adds up to
+ * CONFIG_HEAP_REGIONS - 1 more. Each region is a heap of its own, and free()
+ * and realloc() find a block's region from its address.
+ *
+ * malloc() takes memory from regions without HEAP_REGION_FAST first and
+ * turns to fast ones only when those are exhausted, so fast memory stays
+ * available for objects placed there on purpose with malloc_region().
+ */
+#define HEAP_REGION_FAST (1U << 0) /* Region attribute: fast memory */
+
+/* Placement hints for malloc_region() */
+enum mem_hint {
+    MEM_ANY,       /* Like malloc(): slow memory first, then fast memory */
+    MEM_FAST,      /* Fast memory first, then slow memory */
+    MEM_FAST_ONLY, /* Fast memory or nothing */
+    MEM_BULK,      /* Slow memory or nothing, e.g. for large buffers */
+};
+
+/* Allocates @size bytes like malloc(), in the kind of region @hint names.
+ * Regions of the same kind are tried in the order they were added.
+ * @size : Bytes to allocate
+ * @hint : One of enum mem_hint
+ *
+ * Returns the block, or NULL if no allowed region has room or @hint is
+ * invalid
+ */
+void *malloc_region(uint32_t size, uint32_t hint);
+
+/* Adds the @len bytes at @base to the heap as a new region. The memory
+ * must not overlap any other region and is never handed back.
+ * @base  : Start of the region, aligned up to a word if needed
+ * @len   : Size of the region in bytes
+ * @flags : HEAP_REGION_* attributes
+ *
+ * Returns the index of the new region, or ERR_FAIL if the parameters are
+ * invalid or CONFIG_HEAP_REGIONS are in use
+ */
+int32_t mo_heap_add_region(void *base, uint32_t len, uint32_t flags);
+
+/* Returns the index of the region holding @ptr, or -1 if it is not in the
+ * heap
+ */
+int32_t mo_heap_region(const void *ptr);
+
+/* Heap Statistics
+ *
+ * Byte and block counts are maintained as blocks change hands, so reading
+ * them costs no heap walk; only the largest free block is looked up, in
+ * the highest non-empty size class.
+ */
+
+/* Free-block histogram buckets: bucket 0 counts blocks under 64 bytes, and
+ * bucket i > 0 those of 2^(i+5) up to 2^(i+6) - 1 bytes.
+ */
+#define HEAP_HIST_BUCKETS 26
+
+typedef struct {
+    uint32_t total;        /* Bytes managed, block headers included */
+    uint32_t used;         /* Bytes in allocated blocks, excluding headers */
+    uint32_t peak;         /* Highest 'used' seen since mo_heap_init() */
+    uint32_t free;         /* Bytes in free blocks, excluding headers */
+    uint32_t largest_free; /* Largest single allocation that would succeed */
+    uint32_t free_blocks;  /* Number of free blocks */
+    uint32_t allocs;       /* Allocations currently outstanding */
+    uint32_t failures;     /* Allocations that found no fitting block */
+    uint32_t frag_pct;     /* Free bytes outside the largest block, percent */
+    uint32_t regions;      /* Regions covered, each ending in a marker block */
+    uint32_t flags;        /* HEAP_REGION_* attributes of those regions, OR'd */
+    uint32_t free_hist[HEAP_HIST_BUCKETS]; /* Free blocks per size class */
+} heap_stats_t;
+
+/* Takes a consistent snapshot of the heap counters, summed over every
+ * region.
+ * @stats : Where to store the statistics (must not be NULL)
+ */
+void mo_heap_stats(heap_stats_t *stats);
+
+/* Takes the same snapshot for one region. Its 'failures' count every
+ * request the region could not satisfy, including those another region
+ * then served; 'peak' is the region's own.
+ * @region : Region index, as returned by mo_heap_add_region()
+ * @stats  : Where to store the statistics (must not be NULL)
+ *
+ * Returns ERR_OK, or ERR_FAIL for an unknown region
+ */
+int32_t mo_heap_region_stats(uint32_t region, heap_stats_t *stats);
+
+/* Prints the heap statistics and the non-empty histogram buckets, then a
+ * line per region when there are several
+ */
+void mo_heap_dump(void);
+
+/* Allocation Tracing
+ *
+ * With CONFIG_HEAP_TRACE, every malloc(), calloc(), realloc() and free()
+ * appends a record to a ring buffer of CONFIG_HEAP_TRACE_ENTRIES, the
+ * oldest being overwritten when it is full. Aggregating the records by
+ * caller shows which code allocates most, and which sizes it asks for.
+ */
+
+enum heap_trace_op {
+    HEAP_OP_MALLOC = 1, /* malloc() or calloc(); ptr is NULL on failure */
+    HEAP_OP_REALLOC,    /* realloc(); ptr is the new block, or NULL */
+    HEAP_OP_FREE,       /* free(); size is 0 */
+};
+
+typedef struct {
+    uint32_t caller; /* Return address into the calling code */
+    void *ptr;       /* Block returned or freed */
+    uint32_t size;   /* Bytes requested */
+    uint16_t task;   /* ID of the calling task, 0 before the scheduler runs */
+    uint8_t op;      /* enum heap_trace_op */
+    uint8_t reserved;
+} heap_trace_t;
+
+/* Moves up to @max of the oldest buffered records into @out and removes
+ * them from the buffer.
+ *
+ * Returns the number of records copied, always 0 without CONFIG_HEAP_TRACE
+ */
+uint32_t mo_heap_trace_read(heap_trace_t *out, uint32_t max);
+
+/* Returns the number of records overwritten before being read, and resets
+ * the count.
+ */
+uint32_t mo_heap_trace_lost(void);
@@ -5,7 +5,7 @@
  * require mutexes for SPSC scenarios, but it is NOT thread-safe for
  * multiple producers or multiple consumers. For multi-producer/consumer
  * use, access must be protected by an external synchronization primitive
- * like a mutex.
+ * like a mutex, or the mpmc_queue_t below used instead.
  */
 
 #pragma once
@@ -78,3 +78,71 @@ void *queue_dequeue(queue_t *q);
 
 /* Returns the element at the head of the queue without removing it. */
 void *queue_peek(const queue_t *q);
+
+/* Bounded multi-producer, multi-consumer queue.
+ *
+ * Every cell carries a sequence number that tells producers and consumers
+ * whose turn it is (D. Vyukov's bounded MPMC design). A producer claims a
+ * cell by advancing 'enq_pos' with compare-and-swap, fills it, then
+ * publishes it by bumping its sequence; consumers do the same on the other
+ * side. No lock is held at any point, so any number of tasks and interrupt
+ * handlers may enqueue and dequeue concurrently. With the A extension
+ * (RV_ATOMICS=1) the CAS is an LR/SC loop; without it each CAS masks
+ * interrupts for a few instructions only.
+ *
+ * Unlike queue_t, all 'size' cells are usable.
+ */
+typedef struct {
+    volatile uint32_t seq; /* Turn marker, see above */
+    void *data;            /* Stored element */
+} mpmc_cell_t;
+
+typedef struct {
+    mpmc_cell_t *cells;        /* 'mask + 1' cells (a power of 2) */
+    uint32_t mask;             /* Capacity - 1 */
+    volatile uint32_t enq_pos; /* Next cell to fill */
+    volatile uint32_t deq_pos; /* Next cell to drain */
+} mpmc_queue_t;
+
+/* Creates a queue holding at least @capacity elements; the capacity is
+ * rounded up to the next power of two.
+ * Return A pointer to the new queue, or NULL on failure.
+ */
+mpmc_queue_t *mpmc_create(uint32_t capacity);
+
+/* Destroys a queue, failing if it is not empty.
+ * Return 0 on success, or a negative error code on failure.
+ */
+int32_t mpmc_destroy(mpmc_queue_t *q);
+
+/* Number of queued elements. Exact only while nobody else is operating on
+ * the queue; a snapshot otherwise.
+ */
+static inline uint32_t mpmc_count(const mpmc_queue_t *q)
+{
+    if (unlikely(!q))
+        return 0u;
+    return q->enq_pos - q->deq_pos;
+}
+
+/* Checks whether the next dequeue would come back empty. Unlike
+ * mpmc_count(), this ignores cells a producer has claimed but not yet
+ * published.
+ */
+static inline bool mpmc_is_empty(const mpmc_queue_t *q)
+{
+    if (unlikely(!q))
+        return true;
+    uint32_t pos = q->deq_pos;
+    return q->cells[pos & q->mask].seq != pos + 1;
+}
+
+/* Adds an element at the tail. Never blocks.
+ * Return 0 on success, or a negative error code if the queue is full.
+ */
+int32_t mpmc_enqueue(mpmc_queue_t *q, void *ptr);
+
+/* Removes the element at the head. Never blocks.
+ * Return the element, or NULL if the queue is empty.
+ */
+void *mpmc_dequeue(mpmc_queue_t *q);
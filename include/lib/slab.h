@@ -0,0 +1,86 @@
+/* Object caches for fixed-size kernel objects.
+ *
+ * Each object type the kernel allocates (TCBs, semaphores, pipes, message
+ * queues, software timers) has its own cache. A cache grows by carving a
+ * SLAB_CHUNK_SIZE chunk from the heap into equal objects and keeps the free
+ * ones on a list linked through their first word, so allocating and freeing
+ * an object are both O(1) once the cache has grown. Chunks are never handed
+ * back to the heap: a long-running system reuses the same memory for the
+ * same object type instead of fragmenting the heap with small blocks.
+ *
+ * Caches are statically initialized with SLAB_CACHE_INIT and register
+ * themselves for slab_dump() the first time they grow or are seeded.
+ * SLAB_CACHE_INIT_HINT also names the kind of memory the chunks come from
+ * (see malloc_region()), e.g. to keep a hot object type in fast memory.
+ */
+
+#pragma once
+
+#include <lib/libc.h>
+#include <lib/malloc.h>
+
+/* Bytes requested from the heap each time a cache grows. An object larger
+ * than this gets a chunk to itself.
+ */
+#define SLAB_CHUNK_SIZE 1024
+
+typedef struct slab_cache {
+    const char *name;        /* Shown by slab_dump() */
+    uint16_t size;           /* Object size, rounded up to a word */
+    uint16_t per_chunk;      /* Objects per chunk, set on first growth */
+    uint32_t hint;           /* malloc_region() hint for new chunks */
+    void *free_list;         /* Free objects, linked through their first word */
+    struct slab_cache *next; /* Registry of caches that have grown */
+    uint32_t chunks;         /* Chunks taken from the heap */
+    uint32_t capacity;       /* Objects held, in chunks and seeded storage */
+    uint32_t in_use;         /* Objects currently allocated */
+    uint32_t peak;           /* Highest 'in_use' seen */
+    uint32_t failures;       /* Allocations the heap could not back */
+} slab_cache_t;
+
+#define SLAB_CACHE_INIT_HINT(label, type, mem_hint)                         \
+    {                                                                       \
+        .name = (label),                                                    \
+        .size = (uint16_t) ((sizeof(type) + sizeof(void *) - 1) &          \
+                            ~(sizeof(void *) - 1)),                         \
+        .hint = (mem_hint),                                                 \
+    }
+
+#define SLAB_CACHE_INIT(label, type) SLAB_CACHE_INIT_HINT(label, type, MEM_ANY)
+
+/* Per-cache usage, as reported by slab_stats() */
+typedef struct {
+    uint32_t size;     /* Object size in bytes */
+    uint32_t in_use;   /* Objects currently allocated */
+    uint32_t peak;     /* Highest number allocated at once */
+    uint32_t capacity; /* Objects the cache can hold */
+    uint32_t chunks;   /* Chunks taken from the heap */
+    uint32_t failures; /* Allocations that failed for lack of heap */
+} slab_stats_t;
+
+/* Allocates one object from @c, growing the cache by a chunk when it has no
+ * free object left. The contents are not cleared.
+ *
+ * Returns the object, or NULL if the heap cannot back a new chunk
+ */
+void *slab_alloc(slab_cache_t *c);
+
+/* Returns @obj, which must have come from slab_alloc(@c), to @c. NULL is
+ * ignored.
+ */
+void slab_free(slab_cache_t *c, void *obj);
+
+/* Adds the objects that fit in @bytes of static storage at @mem to @c, to
+ * be handed out before the cache grows from the heap, e.g. to keep a hot
+ * object type in a faster memory region. @mem must be word aligned and is
+ * never returned to the heap.
+ */
+void slab_seed(slab_cache_t *c, void *mem, uint32_t bytes);
+
+/* Copies the usage figures of @c to @st */
+void slab_stats(const slab_cache_t *c, slab_stats_t *st);
+
+/* Prints one line per cache that has grown: object size, objects in use,
+ * peak, capacity and the heap bytes its chunks take.
+ */
+void slab_dump(void);
@@ -4,12 +4,25 @@
 
 #include <lib/libc.h>
 #include <lib/malloc.h>
+#include <lib/slab.h>
 
+#include <sys/clock.h>
+#include <sys/coro.h>
+#include <sys/defer.h>
 #include <sys/errno.h>
+#include <sys/hrtimer.h>
+#include <sys/lockstat.h>
+#include <sys/log.h>
 #include <sys/mqueue.h>
 #include <sys/mutex.h>
 #include <sys/pipe.h>
+#include <sys/poll.h>
+#include <sys/pool.h>
+#include <sys/rt.h>
 #include <sys/semaphore.h>
+#include <sys/spinlock.h>
 #include <sys/syscall.h>
 #include <sys/task.h>
 #include <sys/timer.h>
+#include <sys/trace.h>
+#include <sys/workqueue.h>
@@ -24,6 +24,8 @@ enum {
     ERR_TASK_INVALID_ENTRY, /* Invalid task entry point */
     ERR_TASK_BUSY,          /* Task is busy or in wrong state */
     ERR_NOT_OWNER,          /* Operation requires ownership */
+    ERR_RT_PARAMS,          /* Invalid real-time task parameters */
+    ERR_RT_ADMISSION,       /* Real-time task set would not be schedulable */
 
     /* Memory Protection Errors */
     ERR_STACK_CHECK, /* Stack overflow or corruption detected */
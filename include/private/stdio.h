@@ -25,6 +25,12 @@ void _stdin_install(int (*hook)(void));
 /* Install polling hook for input readiness check */
 void _stdpoll_install(int (*hook)(void));
 
+/* Install hooks that move whole buffers, for drivers that can do better than
+ * one call per byte. Without them, the single-character hooks are looped.
+ */
+void _stdwrite_install(int (*hook)(const char *buf, int len));
+void _stdread_install(int (*hook)(char *buf, int len));
+
 /* Hook Interface Functions
  *
  * These functions provide a consistent interface to the installed hooks,
@@ -40,3 +46,9 @@ int _getchar(void);
 
 /* Non-blocking poll for input readiness */
 int _kbhit(void);
+
+/* Blocking output of @len bytes; returns the number written */
+int _putbuf(const char *buf, int len);
+
+/* Blocking input of exactly @len bytes; returns the number read */
+int _getbuf(char *buf, int len);
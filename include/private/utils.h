@@ -60,3 +60,59 @@ static inline uint32_t nextpowerof2(uint32_t x)
 
     return x;
 }
+
+/* Bit Scanning
+ *
+ * With Zbb (RV_ZBB=1) the builtins below compile to single clz/ctz
+ * instructions. Otherwise they are plain C binary searches, so no libgcc
+ * helper is needed on cores without count-leading-zeros instructions; both
+ * take a fixed five steps.
+ */
+
+#ifdef __riscv_zbb
+
+/* Index of the most significant set bit, i.e. floor(log2(x)); @x != 0 */
+static inline uint32_t ilog2(uint32_t x)
+{
+    return 31 - (uint32_t) __builtin_clz(x);
+}
+
+/* Index of the least significant set bit; @x != 0 */
+static inline uint32_t ctz32(uint32_t x)
+{
+    return (uint32_t) __builtin_ctz(x);
+}
+
+#else
+
+/* Index of the most significant set bit, i.e. floor(log2(x)); @x != 0 */
+static inline uint32_t ilog2(uint32_t x)
+{
+    uint32_t n = 0;
+
+    if (x >> 16) {
+        x >>= 16;
+        n += 16;
+    }
+    if (x >> 8) {
+        x >>= 8;
+        n += 8;
+    }
+    if (x >> 4) {
+        x >>= 4;
+        n += 4;
+    }
+    if (x >> 2) {
+        x >>= 2;
+        n += 2;
+    }
+    return n + (x >> 1);
+}
+
+/* Index of the least significant set bit; @x != 0 */
+static inline uint32_t ctz32(uint32_t x)
+{
+    return ilog2(x & -x);
+}
+
+#endif
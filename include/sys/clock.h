@@ -0,0 +1,78 @@
+#pragma once
+
+/* Time Conversions
+ *
+ * Converts between machine timer cycles (F_CPU Hz, see hal_clock_read()),
+ * scheduler ticks (F_TIMER Hz) and wall-clock units without dividing at run
+ * time: each conversion multiplies by a factor precomputed from F_CPU or
+ * F_TIMER, split into its whole part and its fraction in 0.64 fixed point,
+ * which costs a few 32-bit multiplies instead of a software 64-bit
+ * division.
+ *
+ * The fractions are rounded up, so a result is the exact quotient rounded
+ * down, except that it is one higher when that quotient lies within x / 2^64
+ * below a whole unit, for an input x. Even a year of 10 MHz cycles keeps
+ * that window under 2e-5 of a unit; whole results are always exact.
+ */
+
+#include <types.h>
+
+/* Whole part and 0.64 fraction of num / den, evaluated at compile time.
+ * The fraction is long division in two 32-bit steps, its last digit
+ * rounded up; @den must be below 2^32.
+ */
+#define CLOCK_WHOLE(num, den) ((uint64_t) (num) / (uint64_t) (den))
+#define CLOCK_REM(num, den) ((uint64_t) (num) % (uint64_t) (den))
+#define CLOCK_FRAC(num, den)                                              \
+    ((((CLOCK_REM(num, den) << 32) / (uint64_t) (den)) << 32) +           \
+     ((((CLOCK_REM(num, den) << 32) % (uint64_t) (den) << 32) +           \
+       (uint64_t) (den) - 1) /                                            \
+      (uint64_t) (den)))
+
+/* Returns @x * num / den for the factor of CLOCK_WHOLE() and CLOCK_FRAC() */
+static inline uint64_t clock_scale(uint64_t x, uint64_t whole, uint64_t frac)
+{
+    uint32_t xl = (uint32_t) x, xh = (uint32_t) (x >> 32);
+    uint32_t fl = (uint32_t) frac, fh = (uint32_t) (frac >> 32);
+
+    /* High half of the 128-bit product x * frac */
+    uint64_t ll = (uint64_t) xl * fl, lh = (uint64_t) xl * fh;
+    uint64_t hl = (uint64_t) xh * fl, hh = (uint64_t) xh * fh;
+    uint64_t mid = (ll >> 32) + (uint32_t) lh + (uint32_t) hl;
+
+    return x * whole + hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+}
+
+#define CLOCK_SCALE(x, num, den) \
+    clock_scale(x, CLOCK_WHOLE(num, den), CLOCK_FRAC(num, den))
+
+static inline uint64_t mo_cycles_to_ns(uint64_t cycles)
+{
+    return CLOCK_SCALE(cycles, 1000000000U, F_CPU);
+}
+
+static inline uint64_t mo_cycles_to_us(uint64_t cycles)
+{
+    return CLOCK_SCALE(cycles, 1000000U, F_CPU);
+}
+
+static inline uint64_t mo_cycles_to_ms(uint64_t cycles)
+{
+    return CLOCK_SCALE(cycles, 1000U, F_CPU);
+}
+
+static inline uint64_t mo_us_to_cycles(uint64_t us)
+{
+    return CLOCK_SCALE(us, F_CPU, 1000000U);
+}
+
+static inline uint64_t mo_ticks_to_us(uint64_t ticks)
+{
+    return CLOCK_SCALE(ticks, 1000000U, F_TIMER);
+}
+
+/* Whole ticks in @ms, rounded down like MS_TO_TICKS() */
+static inline uint64_t mo_ms_to_ticks(uint64_t ms)
+{
+    return CLOCK_SCALE(ms, F_TIMER, 1000U);
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+/* Stackless Coroutines
+ *
+ * A coroutine is a caller-owned record of 24 bytes and a function; many of
+ * them run cooperatively inside one host task that calls mo_coro_run(), all
+ * on that task's stack. Thousands of small state machines (protocol
+ * sessions, LED blinkers, sensor pollers) thus cost no stack and no TCB
+ * each, which a task per activity would.
+ *
+ * A coroutine body is written as straight-line code between CORO_BEGIN()
+ * and CORO_END(), and gives up the CPU only at the CORO_*() wait points
+ * below. Each wait point returns from the function and records where to
+ * resume (protothread style, a 'switch' on a line number), so:
+ * - Local variables do not survive a wait point; keep state in a structure
+ *   that embeds the coro_t or is reached through its 'arg'.
+ * - Wait points may appear only in the body function itself, not in a
+ *   function it calls, and not inside a 'switch' of its own; at most one
+ *   per source line.
+ * - A body that runs long without a wait point delays every other
+ *   coroutine of its scheduler, as a task would with preemption off.
+ *
+ * Waits:
+ * - CORO_YIELD(): lets the other ready coroutines run first.
+ * - CORO_DELAY(): sleeps for a number of ticks, on a small timing wheel in
+ *   the scheduler.
+ * - CORO_AWAIT(): sleeps until mo_coro_wake() or mo_coro_wake_from_isr(),
+ *   which is how a device handler or another task hands over an event
+ *   without the coroutine polling. A wake that comes while the coroutine is
+ *   not awaiting is latched, so the next CORO_AWAIT() returns at once.
+ * - CORO_WAIT_UNTIL(): re-tests a condition at every pass of the
+ *   scheduler, which runs at least once a tick while any coroutine polls;
+ *   this suits non-blocking kernel calls such as mo_sem_trywait()
+ *   (CORO_SEM_WAIT()), mo_mq_dequeue() or mo_pipe_nbread().
+ *
+ * The host task sleeps on its notification word whenever no coroutine is
+ * ready, and bit CORO_NOTIFY_BIT of that word is reserved for waking it.
+ */
+
+#include <lib/libc.h>
+#include <sys/semaphore.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
+
+/* Coroutine States. A body's return value, set by the macros below, is the
+ * state it enters.
+ */
+typedef enum {
+    CORO_IDLE = 0,     /* Not started, or finished */
+    CORO_READY = 1,    /* Queued to run at the next pass */
+    CORO_RUNNING = 2,  /* Its body is executing */
+    CORO_SLEEPING = 3, /* In CORO_DELAY() */
+    CORO_POLLING = 4,  /* In CORO_WAIT_UNTIL() */
+    CORO_WAITING = 5,  /* In CORO_AWAIT() */
+} coro_state_t;
+
+typedef struct coro coro_t;
+typedef struct coro_sched coro_sched_t;
+
+/* Coroutine body. Called once per resumption with the record it runs for. */
+typedef coro_state_t (*coro_fn_t)(coro_t *co);
+
+/* Coroutine record. Fields are kernel-owned while the coroutine runs; the
+ * body may read 'arg', and anyone may read 'state'.
+ */
+struct coro {
+    struct coro *next;     /* List link (kernel-owned) */
+    coro_fn_t fn;          /* Body function */
+    void *arg;             /* Argument for the body */
+    coro_sched_t *sched;   /* Scheduler it runs on */
+    uint32_t wake;         /* Tick to resume at, in CORO_DELAY() */
+    uint16_t resume;       /* Resume point: line of the last wait, 0 = top */
+    volatile uint8_t state;    /* coro_state_t */
+    volatile uint8_t signaled; /* A wake is latched */
+};
+
+/* Slots of the scheduler's timing wheel; a power of two */
+#define CORO_WHEEL_SIZE 32
+
+/* Notification bit the host task is woken with */
+#define CORO_NOTIFY_BIT (1U << 31)
+
+/* Coroutine Scheduler. Caller-owned; set up with mo_coro_sched_init(). */
+struct coro_sched {
+    coro_t *ready, *ready_tail; /* FIFO of coroutines to run */
+    coro_t *polling;            /* In CORO_WAIT_UNTIL(), run every pass */
+    coro_t *wheel[CORO_WHEEL_SIZE]; /* Sleepers, by wake tick */
+    uint32_t tick;              /* Last tick the wheel was advanced to */
+    uint32_t count;             /* Coroutines started and not finished */
+    spinlock_t lock;            /* Guards 'ready', 'count' and wakes */
+    volatile uint16_t host;     /* ID of the task in mo_coro_run(), or 0 */
+};
+
+/* Body Macros */
+
+#define CORO_BEGIN(co)        \
+    switch ((co)->resume) {   \
+    case 0:
+
+#define CORO_END(co)      \
+    }                     \
+    (co)->resume = 0;     \
+    return CORO_IDLE
+
+/* Finishes the coroutine early */
+#define CORO_EXIT(co)     \
+    do {                  \
+        (co)->resume = 0; \
+        return CORO_IDLE; \
+    } while (0)
+
+/* Records a resume point and returns to the scheduler in state @st */
+#define CORO_SUSPEND(co, st)        \
+    do {                            \
+        (co)->resume = __LINE__;    \
+        return (st);                \
+    case __LINE__:;                 \
+    } while (0)
+
+#define CORO_YIELD(co) CORO_SUSPEND(co, CORO_READY)
+
+/* Sleeps for @ticks ticks; 0 behaves like CORO_YIELD() */
+#define CORO_DELAY(co, ticks)                    \
+    do {                                         \
+        (co)->wake = mo_ticks() + (ticks);       \
+        CORO_SUSPEND(co, CORO_SLEEPING);         \
+    } while (0)
+
+/* Sleeps until woken by mo_coro_wake() or mo_coro_wake_from_isr() */
+#define CORO_AWAIT(co) CORO_SUSPEND(co, CORO_WAITING)
+
+/* Continues once @cond is true; it is evaluated now and then at every pass.
+ * Locals are not preserved, so @cond must use the coroutine's own state.
+ */
+#define CORO_WAIT_UNTIL(co, cond)      \
+    do {                               \
+        (co)->resume = __LINE__;       \
+        __attribute__((fallthrough));  \
+    case __LINE__:                     \
+        if (!(cond))                   \
+            return CORO_POLLING;       \
+    } while (0)
+
+/* Takes semaphore @s, polling it at every pass while it is unavailable */
+#define CORO_SEM_WAIT(co, s) CORO_WAIT_UNTIL(co, mo_sem_trywait(s) == 0)
+
+/* Scheduler API */
+
+/* Initializes a scheduler with no coroutines.
+ * @s : Scheduler to initialize (must not be NULL)
+ */
+void mo_coro_sched_init(coro_sched_t *s);
+
+/* Starts a coroutine; its body first runs at the scheduler's next pass.
+ * May be called from any task, including from a coroutine body.
+ * @s   : Scheduler to run on
+ * @co  : Coroutine record; must stay valid until the coroutine finishes
+ * @fn  : Body function
+ * @arg : Stored in @co->arg for the body
+ *
+ * Returns ERR_OK, or ERR_FAIL on invalid arguments or if @co is running
+ */
+int32_t mo_coro_start(coro_sched_t *s, coro_t *co, coro_fn_t fn, void *arg);
+
+/* Wakes a coroutine from CORO_AWAIT(), or latches the wake for its next
+ * CORO_AWAIT() if it is elsewhere. Must be called from task context.
+ * @co : A started coroutine
+ *
+ * Returns ERR_OK, or ERR_FAIL if @co is not started
+ */
+int32_t mo_coro_wake(coro_t *co);
+
+/* Interrupt-handler variant of mo_coro_wake(). Never blocks or switches. */
+int32_t mo_coro_wake_from_isr(coro_t *co);
+
+/* Runs one pass: expires due sleepers, then runs every coroutine that was
+ * ready or polling when the pass started, once each. Must be called from
+ * the one task that hosts @s.
+ * @s : Scheduler to run
+ *
+ * Returns the number of coroutine bodies run
+ */
+uint32_t mo_coro_poll(coro_sched_t *s);
+
+/* Hosts @s in the calling task: runs passes, sleeping whenever no coroutine
+ * is ready, until every started coroutine has finished.
+ * @s : Scheduler to run
+ */
+void mo_coro_run(coro_sched_t *s);
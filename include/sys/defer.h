@@ -0,0 +1,68 @@
+#pragma once
+
+/* Deferred Work
+ *
+ * Lets interrupt handlers hand work to task context instead of doing it
+ * inline, so they stay short. A work item is a caller-owned record holding a
+ * function and its argument; posting it appends it to a single kernel FIFO.
+ *
+ * The queue is drained at the scheduler's switch point: every yield, delay,
+ * blocking call and deferred reschedule, and before an idle task waits for
+ * the next interrupt. Each drain runs the items that were pending when it
+ * started, in posting order, with interrupts enabled but preemption off
+ * (as under NOSCHED), so a batch is never left half-run on a task that
+ * lost the CPU; items posted meanwhile wait for the next drain.
+ *
+ * Work functions must therefore not block, sleep or yield. One that wakes a
+ * task which should preempt calls mo_defer_resched() instead, and the drain
+ * yields once, after the whole batch has run.
+ *
+ * Posting an item that is already queued is a no-op, so a burst of
+ * interrupts coalesces into a single run. The kernel's own tick work (timer
+ * callbacks) goes through the same queue.
+ */
+
+#include <lib/libc.h>
+
+/* Deferred Work Item */
+typedef struct defer_work {
+    struct defer_work *next; /* Queue link (kernel-owned) */
+    void (*fn)(void *arg);   /* Work function, run in task context */
+    void *arg;               /* Argument passed to 'fn' */
+    volatile bool pending;   /* Queued and not yet started */
+} defer_work_t;
+
+#define DEFER_WORK_INIT(f, a) {NULL, (f), (a), false}
+
+/* Initializes a work item. Must not be called while the item is pending.
+ * @work : Work item to initialize (must not be NULL)
+ * @fn   : Function to run
+ * @arg  : Argument passed to @fn
+ */
+void mo_defer_init(defer_work_t *work, void (*fn)(void *arg), void *arg);
+
+/* Queues @work for the next drain. Safe to call from interrupt handlers.
+ * The item must stay valid until its function has started.
+ * @work : Work item to queue (must not be NULL)
+ *
+ * Returns ERR_OK if queued or already pending, ERR_FAIL on invalid item
+ */
+int32_t mo_defer_post(defer_work_t *work);
+
+/* Asks the running drain to yield once its batch is done. Only for work
+ * functions, in place of mo_task_yield().
+ */
+void mo_defer_resched(void);
+
+/* Returns true if work is queued. Used by the idle path. */
+bool _defer_pending(void);
+
+/* Runs the pending work items, then yields if one asked to. Called by the
+ * scheduler; does nothing when called from a work function.
+ */
+void _defer_run(void);
+
+/* Like _defer_run(), but leaves the reschedule to the caller, which is about
+ * to switch anyway. Returns true if a work function asked for one.
+ */
+bool _defer_drain(void);
@@ -0,0 +1,58 @@
+#pragma once
+
+/* High-Resolution Timers
+ *
+ * One-shot timers with microsecond resolution, for deadlines finer than the
+ * scheduler tick (motor PWM correction, protocol inter-frame gaps). They are
+ * counted in machine timer cycles and share the timer compare register with
+ * the tick: it is always programmed with whichever comes first, so an
+ * hrtimer neither waits for nor shifts the next tick.
+ *
+ * Callbacks run in the timer interrupt with interrupts disabled, so they must
+ * be short and may only use the _from_isr calls. Every function here masks
+ * interrupts internally and may be called from task or interrupt context,
+ * including from a callback to re-arm its own timer.
+ */
+
+#include <types.h>
+
+#include <lib/libc.h>
+
+typedef struct hrtimer {
+    struct hrtimer *next;  /* Armed list, sorted by deadline */
+    uint64_t expires;      /* Deadline in machine timer cycles */
+    void (*fn)(void *arg); /* Runs in interrupt context */
+    void *arg;             /* Passed to @fn */
+    bool armed;            /* Linked into the armed list */
+} hrtimer_t;
+
+/* Prepares @t for use. An armed timer must not be re-initialized.
+ * @t   : Timer storage, owned by the caller (must be non-NULL)
+ * @fn  : Callback to run on expiry (must be non-NULL)
+ * @arg : Argument passed to @fn
+ *
+ * Returns ERR_OK on success, ERR_FAIL on invalid arguments
+ */
+int32_t mo_hrtimer_init(hrtimer_t *t, void (*fn)(void *arg), void *arg);
+
+/* Arms @t to fire once, @delay_us microseconds from now. A timer that is
+ * already armed is moved to the new deadline.
+ *
+ * Returns ERR_OK on success, ERR_FAIL if @t was never initialized
+ */
+int32_t mo_hrtimer_start(hrtimer_t *t, uint32_t delay_us);
+
+/* Arms @t to fire @interval_us after its previous deadline rather than after
+ * now, so a callback that re-arms its own timer this way keeps a fixed
+ * period regardless of interrupt latency. A deadline that has already
+ * passed fires at once.
+ *
+ * Returns ERR_OK on success, ERR_FAIL if @t was never initialized
+ */
+int32_t mo_hrtimer_forward(hrtimer_t *t, uint32_t interval_us);
+
+/* Disarms @t. Its callback will not run unless it is started again.
+ *
+ * Returns ERR_OK on success, ERR_FAIL if @t was not armed
+ */
+int32_t mo_hrtimer_cancel(hrtimer_t *t);
@@ -0,0 +1,76 @@
+#pragma once
+
+/* Lock Contention Statistics
+ *
+ * With CONFIG_LOCK_STATS, every mutex and semaphore keeps a history of how
+ * it was contended, so the shared resources worth splitting can be found.
+ * Times are in machine timer cycles (F_CPU Hz, see hal_clock_read()):
+ * - A wait runs from the moment a task queues on the object until it is
+ *   handed the mutex or a token, or its timeout expires; the scheduling
+ *   delay after the handover is not included.
+ * - A mutex hold runs from acquisition to release, and is charged to the
+ *   task that released it.
+ *
+ * The counters are updated under the object's own lock, and cost one timer
+ * read per acquisition, plus two per contended wait. Objects named with
+ * mo_mutex_stats_register() or mo_sem_stats_register() join a registry that
+ * mo_lock_stats_dump() ranks by total wait time.
+ */
+
+#include <hal.h>
+#include <lib/libc.h>
+
+/* Object kinds */
+#define LOCK_STAT_MUTEX 0
+#define LOCK_STAT_SEM 1
+
+/* Most entries mo_lock_stats_dump() prints */
+#define LOCK_STATS_TOP_MAX 8
+
+/* Contention statistics of one lock */
+typedef struct lock_stats {
+    struct lock_stats *next; /* Registry link (kernel-owned) */
+    const char *name;        /* Registered name, or NULL */
+    uint32_t acquired;       /* Successful lock or wait calls */
+    uint32_t contended;      /* Calls that had to queue */
+    uint64_t wait_total;     /* Cycles spent queued, summed */
+    uint32_t wait_max;       /* Longest single wait */
+    uint32_t hold_max;       /* Longest mutex hold; 0 for semaphores */
+    uint16_t hold_max_tid;   /* Task that held the mutex that long */
+    uint8_t kind;            /* LOCK_STAT_MUTEX or LOCK_STAT_SEM */
+} lock_stats_t;
+
+/* Prints the registered locks with the most total wait time, hottest
+ * first, and how many locks are registered.
+ * @top : Most locks to list, up to LOCK_STATS_TOP_MAX
+ */
+void mo_lock_stats_dump(uint32_t top);
+
+/* Clears the statistics of every registered lock */
+void mo_lock_stats_reset(void);
+
+/* Kernel Hooks */
+
+#if CONFIG_LOCK_STATS
+/* Adds a finished wait that began at timer value @since */
+static inline void _lock_stats_wait(lock_stats_t *st, uint32_t since)
+{
+    uint32_t waited = hal_clock_read() - since;
+    st->wait_total += waited;
+    if (waited > st->wait_max)
+        st->wait_max = waited;
+}
+
+/* Links @st into the registry under @name; registering again renames it */
+void _lock_stats_register(lock_stats_t *st, const char *name);
+
+/* Unlinks @st, if registered. Called when its object is destroyed. */
+void _lock_stats_unregister(lock_stats_t *st);
+
+/* Zeroes @st, which must not be registered, for an object of @kind */
+static inline void _lock_stats_init(lock_stats_t *st, uint8_t kind)
+{
+    memset(st, 0, sizeof(*st));
+    st->kind = kind;
+}
+#endif
@@ -0,0 +1,107 @@
+#pragma once
+
+/* Deferred Binary Logging
+ *
+ * mo_log() is a printf-style call that does no formatting: it stores the
+ * format string's address, a timestamp, the running task's ID and up to
+ * LOG_MAX_ARGS raw 32-bit arguments as one fixed-size record in a RAM ring,
+ * which takes a few dozen cycles with interrupts masked for a handful of
+ * stores. It is safe to call from tasks and interrupt handlers.
+ *
+ * The records are formatted later and elsewhere: by mo_log_flush(), usually
+ * from the low-priority logger task started with mo_log_start(), or on the
+ * host, where scripts/log2text.py decodes the raw mo_log_dump() output
+ * against the ELF image. When the ring is full the oldest records are
+ * overwritten and counted as lost.
+ *
+ * Format strings must live for the whole run (string literals do), and the
+ * arguments must each fit 32 bits: integers, characters and pointers, but
+ * no 64-bit values. '%s' arguments are dereferenced only when the record is
+ * formatted, so they must still be valid then; host decoding prints their
+ * address instead.
+ *
+ * With CONFIG_LOG disabled, mo_log() compiles to nothing.
+ */
+
+#include <types.h>
+
+/* Most arguments one record holds */
+#define LOG_MAX_ARGS 4
+
+/* Log Record (28 bytes) */
+typedef struct {
+    const char *fmt; /* Format string, printf() syntax */
+    uint32_t ts;     /* Machine timer, low 32 bits (see hal_clock_read()) */
+    uint16_t task;   /* Running task, or 0 before the scheduler started */
+    uint8_t nargs;   /* Arguments recorded */
+    uint8_t reserved;
+    uint32_t args[LOG_MAX_ARGS];
+} log_record_t;
+
+/* Number of arguments passed, 0 to 5; 5 means too many */
+#define LOG_NARGS(...) LOG_NARGS_(0, ##__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(_z, _1, _2, _3, _4, _5, n, ...) n
+
+/* The first four arguments, padded with zeros */
+#define LOG_ARGS(...) LOG_ARGS_(0, ##__VA_ARGS__, 0, 0, 0, 0)
+#define LOG_ARGS_(_z, a, b, c, d, ...) \
+    (uint32_t) (a), (uint32_t) (b), (uint32_t) (c), (uint32_t) (d)
+
+#if CONFIG_LOG
+/* Appends one record to the ring. Use mo_log() instead. */
+void _log_record(const char *fmt,
+                 uint32_t nargs,
+                 uint32_t a,
+                 uint32_t b,
+                 uint32_t c,
+                 uint32_t d);
+
+#define mo_log(fmt, ...)                                                   \
+    do {                                                                   \
+        _Static_assert(LOG_NARGS(__VA_ARGS__) <= LOG_MAX_ARGS,             \
+                       "mo_log() takes at most LOG_MAX_ARGS arguments");   \
+        _log_record((fmt), LOG_NARGS(__VA_ARGS__), LOG_ARGS(__VA_ARGS__)); \
+    } while (0)
+#else
+#define mo_log(fmt, ...) \
+    do {                 \
+    } while (0)
+#endif
+
+/* Formats every buffered record to stdout, oldest first, and removes it.
+ * Each record becomes one line: the timestamp in microseconds and the task
+ * ID in brackets, then the formatted message, so format strings need no
+ * trailing newline.
+ *
+ * Returns the number of records printed
+ */
+int32_t mo_log_flush(void);
+
+/* Moves up to @max of the oldest buffered records to @out, removing them
+ * from the ring, for applications that ship records elsewhere.
+ * @out : Destination array (must not be NULL)
+ * @max : Capacity of @out, in records
+ *
+ * Returns the number of records copied
+ */
+int32_t mo_log_read(log_record_t *out, uint32_t max);
+
+/* Writes every buffered record to stdout in raw form and removes it, for
+ * decoding on the host with scripts/log2text.py. The output is line based:
+ * a 'log: begin' header carrying the timer frequency and the records lost
+ * so far, one hex-encoded line per record and a 'log: end' trailer.
+ */
+void mo_log_dump(void);
+
+/* Returns the number of records overwritten before being read, and resets
+ * the count
+ */
+uint32_t mo_log_lost(void);
+
+/* Spawns the logger task, which runs mo_log_flush() at TASK_PRIO_LOW every
+ * @period ticks.
+ * @period : Ticks between flushes (> 0)
+ *
+ * Returns the logger's task ID, or a negative error code
+ */
+int32_t mo_log_start(uint32_t period);
@@ -1,14 +1,47 @@
 #pragma once
 
 #include <lib/queue.h>
+#include <sys/defer.h>
+#include <sys/poll.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
 
 /* Message Queue
  *
  * Provides FIFO message passing between tasks with type-safe message
  * containers. Messages consist of a user-allocated payload, a type
  * discriminator, and size information.
+ *
+ * A queue created with several priority levels keeps one FIFO per level and
+ * always delivers from the highest non-empty level, so urgent messages
+ * overtake queued bulk traffic. mo_mq_send() and mo_mq_receive() block on
+ * a full or empty queue, with an optional timeout.
+ *
+ * A queue created with mo_mq_create_fixed() instead stores fixed-size
+ * messages by value in one preallocated slab: mo_mq_send_copy() copies the
+ * caller's data in and mo_mq_receive_copy() copies it out, so passing a
+ * message needs no allocation at all. The pointer calls (enqueue, dequeue,
+ * peek, send, receive) are rejected on such a queue, and the copy calls on
+ * a pointer queue.
+ *
+ * A queue from mo_mq_create_lockfree() stores its messages in a bounded
+ * MPMC ring (mpmc_queue_t, <lib/queue.h>). Sending to it and receiving from
+ * it neither takes a lock nor masks interrupts unless a task has to sleep
+ * or be woken, so any mix of tasks and interrupt handlers can feed one
+ * consumer cheaply. It has a single priority level and mo_mq_peek() always
+ * returns NULL on it.
+ *
+ * Interrupt handlers post to a pointer queue with mo_mq_send_from_isr(),
+ * which never blocks and leaves the switch to a woken receiver for after
+ * the handler.
  */
 
+/* Maximum number of message priority levels */
+#define MQ_PRIO_MAX 8
+
+/* Timeout for mo_mq_send() / mo_mq_receive() that never expires */
+#define MQ_WAIT_FOREVER 0xFFFFFFFFU
+
 /* Message container structure */
 typedef struct {
     void *payload; /* Pointer to user-allocated buffer */
@@ -18,7 +51,26 @@ typedef struct {
 
 /* Message queue descriptor structure */
 typedef struct {
-    queue_t *q; /* FIFO queue of (message_t *) pointers */
+    queue_t *q;           /* FIFO of (message_t *) at priority 0, or NULL */
+    queue_t **prio_q;     /* FIFOs for priorities 1..levels-1, or NULL */
+    uint8_t levels;       /* Number of priority levels (1 = plain FIFO) */
+    uint16_t count;       /* Messages queued across all levels */
+    uint16_t capacity;    /* Maximum messages across all levels */
+    spinlock_t lock;      /* Protects the queue */
+    poll_link_t *pollers; /* Tasks waiting in mo_poll() for a message */
+
+    /* Blocking Operations */
+    wait_queue_t senders;   /* Tasks blocked on a full queue */
+    wait_queue_t receivers; /* Tasks blocked on an empty queue */
+
+    /* Copy-in Mode */
+    char *slab;        /* Inline message storage, NULL for a pointer queue */
+    void *free_slots;  /* Unused slots, linked through their first word */
+    uint16_t msg_size; /* Bytes per message */
+
+    mpmc_queue_t *lf; /* Lock-free storage instead of 'q', or NULL */
+
+    defer_work_t isr_work; /* Receiver wakeup deferred by a _from_isr send */
 } mq_t;
 
 /* Message Queue Management */
@@ -30,17 +82,45 @@ typedef struct {
  */
 mq_t *mo_mq_create(uint16_t size);
 
+/* Creates a new message queue with message priority levels.
+ * @size   : Maximum number of messages the queue can hold, over all levels
+ * @levels : Number of priority levels, 1 to MQ_PRIO_MAX; level 0 is the
+ *           lowest
+ *
+ * Returns pointer to new message queue on success, NULL on failure
+ */
+mq_t *mo_mq_create_prio(uint16_t size, uint8_t levels);
+
+/* Creates a copy-in message queue for messages of a fixed size.
+ * All 'size' message slots come from a single allocation made here.
+ * @size     : Maximum number of messages the queue can hold, over all levels
+ * @msg_size : Bytes per message (must be > 0)
+ * @levels   : Number of priority levels, 1 to MQ_PRIO_MAX
+ *
+ * Returns pointer to new message queue on success, NULL on failure
+ */
+mq_t *mo_mq_create_fixed(uint16_t size, uint16_t msg_size, uint8_t levels);
+
+/* Creates a lock-free message queue (see above).
+ * @size : Maximum number of messages, rounded up to a power of two
+ *
+ * Returns pointer to new message queue on success, NULL on failure
+ */
+mq_t *mo_mq_create_lockfree(uint16_t size);
+
 /* Destroys a message queue and frees its resources.
  * Note: Does not free individual message payloads - caller responsibility
  * @mq : Pointer to message queue (NULL is safe no-op)
  *
- * Returns ERR_OK on success, ERR_FAIL on failure
+ * Returns ERR_OK on success, ERR_MQ_NOTEMPTY if messages are queued,
+ * ERR_TASK_BUSY if tasks are blocked on it or a wakeup from an interrupt
+ * handler is pending, ERR_FAIL on failure
  */
 int32_t mo_mq_destroy(mq_t *mq);
 
 /* Message Queue Operations */
 
-/* Enqueues a message to the tail of the queue.
+/* Enqueues a message to the tail of the queue at priority 0.
  * @mq : Pointer to message queue (must be valid)
  * @m  : Pointer to message to enqueue (must be valid)
  *
@@ -48,7 +128,7 @@ int32_t mo_mq_destroy(mq_t *mq);
  */
 int32_t mo_mq_enqueue(mq_t *mq, message_t *m);
 
-/* Dequeues a message from the head of the queue.
+/* Dequeues the oldest message of the highest non-empty priority.
  * @mq : Pointer to message queue (must be valid)
  *
  * Returns pointer to dequeued message on success, NULL if empty or invalid
@@ -62,6 +142,65 @@ message_t *mo_mq_dequeue(mq_t *mq);
  */
 message_t *mo_mq_peek(mq_t *mq);
 
+/* Sends a message, blocking while the queue is full (task context only).
+ * @mq      : Pointer to message queue (must be valid)
+ * @m       : Pointer to message to send (must be valid)
+ * @prio    : Message priority, below the queue's number of levels
+ * @timeout : Ticks to wait; 0 does not block, MQ_WAIT_FOREVER never expires
+ *
+ * Returns ERR_OK on success, ERR_TIMEOUT if still full at the deadline,
+ * ERR_FAIL on invalid arguments
+ */
+int32_t mo_mq_send(mq_t *mq, message_t *m, uint8_t prio, uint32_t timeout);
+
+/* Interrupt-handler variant of mo_mq_send() that never blocks or switches;
+ * a woken receiver that outranks the interrupted task runs once the handler
+ * returns.
+ * @mq   : Pointer to message queue (must be valid)
+ * @m    : Pointer to message to send (must be valid)
+ * @prio : Message priority, below the queue's number of levels
+ *
+ * Returns ERR_OK on success, ERR_FAIL if the queue is full or on invalid
+ * arguments
+ */
+int32_t mo_mq_send_from_isr(mq_t *mq, message_t *m, uint8_t prio);
+
+/* Receives the next message, blocking while the queue is empty (task
+ * context only).
+ * @mq      : Pointer to message queue (must be valid)
+ * @timeout : Ticks to wait; 0 does not block, MQ_WAIT_FOREVER never expires
+ *
+ * Returns the oldest message of the highest non-empty priority, or NULL on
+ * timeout or invalid queue
+ */
+message_t *mo_mq_receive(mq_t *mq, uint32_t timeout);
+
+/* Copies a message into a copy-in queue, blocking while it is full (task
+ * context only). The copy itself runs with interrupts enabled.
+ * @mq      : Pointer to a queue from mo_mq_create_fixed()
+ * @data    : Message to copy, 'msg_size' bytes (must be non-NULL)
+ * @prio    : Message priority, below the queue's number of levels
+ * @timeout : Ticks to wait; 0 does not block, MQ_WAIT_FOREVER never expires
+ *
+ * Returns ERR_OK on success, ERR_TIMEOUT if still full at the deadline,
+ * ERR_FAIL on invalid arguments
+ */
+int32_t mo_mq_send_copy(mq_t *mq,
+                        const void *data,
+                        uint8_t prio,
+                        uint32_t timeout);
+
+/* Copies the next message out of a copy-in queue, blocking while it is
+ * empty (task context only).
+ * @mq      : Pointer to a queue from mo_mq_create_fixed()
+ * @buf     : Receives 'msg_size' bytes (must be non-NULL)
+ * @timeout : Ticks to wait; 0 does not block, MQ_WAIT_FOREVER never expires
+ *
+ * Returns ERR_OK on success, ERR_TIMEOUT if still empty at the deadline,
+ * ERR_FAIL on invalid arguments
+ */
+int32_t mo_mq_receive_copy(mq_t *mq, void *buf, uint32_t timeout);
+
 /* Gets the current number of messages in the queue.
  * @mq : Pointer to message queue
  *
@@ -70,7 +209,9 @@ message_t *mo_mq_peek(mq_t *mq);
 static inline int32_t mo_mq_items(mq_t *mq)
 {
     /* Add NULL safety to prevent crashes */
-    if (unlikely(!mq || !mq->q))
+    if (unlikely(!mq))
         return 0;
-    return queue_count(mq->q);
+    if (mq->lf)
+        return mpmc_count(mq->lf);
+    return mq->q ? mq->count : 0;
 }
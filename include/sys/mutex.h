@@ -1,21 +1,31 @@
 #pragma once
 
-/* Lightweight (non-recursive) mutexes and POSIX-style condition variables.
+/* Lightweight (non-recursive) mutexes, POSIX-style condition variables and
+ * reader-writer locks.
  *
  * Mutex Implementation:
  * - Binary semaphore with owner tracking
- * - FIFO queuing of blocked tasks
+ * - FIFO queuing of blocked tasks, or priority order (see
+ *   mo_mutex_set_policy())
  * - Non-recursive (error if already owned by caller)
  * - Owner-based validation for unlock operations
+ * - Priority inheritance: the owner runs at the best priority level of all
+ *   tasks waiting on the mutexes it holds, transitively across nested
+ *   ownership chains, and drops back as soon as those waiters leave
  *
  * Condition Variable Implementation:
- * - FIFO list of blocked TCBs
+ * - FIFO or priority-ordered wait queue of blocked TCBs
  * - Atomic mutex release/re-acquire during wait operations
  * - Signal (wake one) and broadcast (wake all) operations
+ * - Wait morphing: signalled waiters move straight onto the mutex's wait
+ *   queue and wake once, owning the mutex, so a broadcast to N waiters costs
+ *   N handovers instead of N wakeups that immediately block again
  */
 
-#include <lib/list.h>
+#include <sys/lockstat.h>
 #include <sys/semaphore.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
 
 /* Magic numbers for validation and corruption detection */
 #define MUTEX_MAGIC 0x4D555458 /* "MUTX" */
@@ -27,10 +37,20 @@
  * maintains its own queue of waiting tasks. Does not rely on semaphores
  * for core functionality.
  */
-typedef struct {
-    list_t *waiters;    /* List of 'tcb_t *' blocked on this mutex */
-    uint16_t owner_tid; /* 0 if unlocked, otherwise task ID of owner */
-    uint32_t magic;     /* Magic number for validation */
+typedef struct mutex {
+    wait_queue_t waiters; /* Tasks blocked on this mutex */
+    uint16_t owner_tid;   /* 0 if unlocked, otherwise task ID of owner */
+    uint32_t magic;       /* Magic number for validation */
+    spinlock_t lock;      /* Protects the fields above */
+
+    /* Priority Inheritance */
+    struct tcb *owner;        /* Owning task, NULL if unlocked */
+    struct mutex *next_held;  /* Next mutex held by the same owner */
+
+#if CONFIG_LOCK_STATS
+    lock_stats_t stats; /* Contention history, see <sys/lockstat.h> */
+    uint32_t locked_at; /* hal_clock_read() at the current acquisition */
+#endif
 } mutex_t;
 
 /* Mutex Management Functions */
@@ -83,8 +103,8 @@ int32_t mo_mutex_trylock(mutex_t *m);
 int32_t mo_mutex_timedlock(mutex_t *m, uint32_t ticks);
 
 /* Release mutex lock.
- * If tasks are waiting, ownership is transferred to the next task in FIFO
- * order. The released task is marked ready but may not run immediately
+ * If tasks are waiting, ownership is transferred to the next task under the
+ * mutex's wait policy (FIFO by default). The released task is marked ready but may not run immediately
  * depending on scheduler priority.
  * @m : Pointer to mutex structure (must be valid)
  *
@@ -92,6 +112,17 @@ int32_t mo_mutex_timedlock(mutex_t *m, uint32_t ticks);
  */
 int32_t mo_mutex_unlock(mutex_t *m);
 
+/* Select the order in which waiters acquire the mutex.
+ * WAIT_FIFO (default) hands it to the oldest waiter; WAIT_PRIO to the
+ * waiter with the best effective priority, the oldest among equals. Applies
+ * to tasks already waiting as well.
+ * @m      : Pointer to mutex structure (must be valid)
+ * @policy : WAIT_FIFO or WAIT_PRIO
+ *
+ * Returns ERR_OK on success, ERR_FAIL if mutex or policy invalid
+ */
+int32_t mo_mutex_set_policy(mutex_t *m, wait_policy_t policy);
+
 /* Mutex Query Functions */
 
 /* Check if the current task owns the specified mutex.
@@ -108,6 +139,21 @@ bool mo_mutex_owned_by_current(mutex_t *m);
  */
 int32_t mo_mutex_waiting_count(mutex_t *m);
 
+/* Copies the mutex's contention statistics (see <sys/lockstat.h>).
+ * @m     : Pointer to mutex structure (must be valid)
+ * @stats : Receives the statistics
+ *
+ * Returns ERR_OK, or ERR_FAIL if @m is invalid or CONFIG_LOCK_STATS is off
+ */
+int32_t mo_mutex_stats(mutex_t *m, lock_stats_t *stats);
+
+/* Names the mutex and adds it to the registry mo_lock_stats_dump() ranks;
+ * mo_mutex_destroy() removes it. @name must stay valid.
+ *
+ * Returns ERR_OK, or ERR_FAIL if @m is invalid or CONFIG_LOCK_STATS is off
+ */
+int32_t mo_mutex_stats_register(mutex_t *m, const char *name);
+
 /* Condition Variable Control Block
  *
  * A condition variable allows tasks to wait for arbitrary conditions to become
@@ -116,9 +162,9 @@ int32_t mo_mutex_waiting_count(mutex_t *m);
  * the wait operation returns.
  */
 typedef struct {
-    list_t
-        *waiters; /* List of 'tcb_t *' blocked on this condition (FIFO order) */
-    uint32_t magic; /* Magic number for validation and corruption detection */
+    wait_queue_t waiters; /* Tasks blocked on this condition */
+    uint32_t magic;       /* Magic number for validation and corruption */
+    spinlock_t lock;      /* Protects the waiter queue */
 } cond_t;
 
 /* Condition Variable Management Functions */
@@ -166,8 +212,9 @@ int32_t mo_cond_timedwait(cond_t *c, mutex_t *m, uint32_t ticks);
 /* Condition Variable Signal Operations */
 
 /* Signal one waiting task.
- * Wakes up the oldest task waiting on the condition variable (FIFO order).
- * The signaled task will attempt to re-acquire the associated mutex.
+ * Wakes up the next task under the condition variable's wait policy: the
+ * oldest waiter by default, the highest-priority one with WAIT_PRIO.
+ * The signaled task is queued on its mutex and runs once it owns it.
  * @c : Pointer to condition variable structure (must be valid)
  *
  * Returns ERR_OK on success, ERR_FAIL if invalid
@@ -175,15 +222,23 @@ int32_t mo_cond_timedwait(cond_t *c, mutex_t *m, uint32_t ticks);
 int32_t mo_cond_signal(cond_t *c);
 
 /* Signal all waiting tasks.
- * Wakes up all tasks waiting on the condition variable. All tasks will
- * attempt to re-acquire their associated mutexes, but only one will succeed
- * immediately (others will block on the mutex).
+ * Moves all tasks waiting on the condition variable onto their mutexes'
+ * wait queues. Each one runs only when the mutex is handed to it, one at a
+ * time, rather than all waking to contend for it.
  * @c : Pointer to condition variable structure (must be valid)
  *
  * Returns ERR_OK on success, ERR_FAIL if invalid
  */
 int32_t mo_cond_broadcast(cond_t *c);
 
+/* Select the order in which signalled waiters are woken.
+ * @c      : Pointer to condition variable structure (must be valid)
+ * @policy : WAIT_FIFO (default) or WAIT_PRIO, as for mo_mutex_set_policy()
+ *
+ * Returns ERR_OK on success, ERR_FAIL if condition variable or policy invalid
+ */
+int32_t mo_cond_set_policy(cond_t *c, wait_policy_t policy);
+
 /* Condition Variable Query Functions */
 
 /* Get the number of tasks currently waiting on the condition variable.
@@ -192,3 +247,117 @@ int32_t mo_cond_broadcast(cond_t *c);
  * Returns number of waiting tasks, or -1 if condition variable is invalid
  */
 int32_t mo_cond_waiting_count(cond_t *c);
+
+/* Reader-Writer Locks
+ *
+ * Any number of readers may hold the lock at once, or a single writer. A
+ * reader takes the lock without blocking while no writer holds it or waits
+ * for it, so an uncontended read is one lock round trip and never switches.
+ * Ownership is handed over directly on release: a released writer's
+ * successor, or every reader woken together, already holds the lock when it
+ * runs.
+ *
+ * Policies (chosen at init):
+ * - RWLOCK_PREFER_WRITER: a releasing writer hands over to the next waiting
+ *   writer before any reader. Writers never wait behind new readers, but a
+ *   steady stream of writers can starve readers.
+ * - RWLOCK_FAIR: a releasing writer admits every reader that queued behind
+ *   it, and the last of those readers hands over to the next writer, so
+ *   read and write phases alternate and neither side starves.
+ *
+ * Read locks are not recursive and not owner-tracked, and there is no
+ * priority inheritance: keep critical sections short or use mutex_t where
+ * inversion matters.
+ */
+
+#define RWLOCK_MAGIC 0x52574C4B /* "RWLK" */
+
+typedef enum {
+    RWLOCK_PREFER_WRITER = 0, /* Waiting writers go first (default) */
+    RWLOCK_FAIR = 1,          /* Alternate read and write phases */
+} rwlock_policy_t;
+
+typedef struct {
+    wait_queue_t rd_waiters; /* Tasks waiting for shared access */
+    wait_queue_t wr_waiters; /* Tasks waiting for exclusive access */
+    uint16_t readers;        /* Number of tasks holding shared access */
+    uint16_t writer_tid;     /* Task ID of the writer, 0 if none */
+    uint8_t policy;          /* Handover policy (rwlock_policy_t) */
+    uint32_t magic;          /* Magic number for validation */
+    spinlock_t lock;         /* Protects the fields above */
+} rwlock_t;
+
+/* Initialize a reader-writer lock to the unlocked state.
+ * @rw     : Pointer to lock structure (must be non-NULL)
+ * @policy : RWLOCK_PREFER_WRITER or RWLOCK_FAIR
+ *
+ * Returns ERR_OK on success, ERR_FAIL on invalid arguments
+ */
+int32_t mo_rwlock_init(rwlock_t *rw, rwlock_policy_t policy);
+
+/* Destroy a reader-writer lock.
+ * @rw : Pointer to lock structure (NULL is no-op)
+ *
+ * Returns ERR_OK on success, ERR_TASK_BUSY if held or waited on, ERR_FAIL if
+ * invalid
+ */
+int32_t mo_rwlock_destroy(rwlock_t *rw);
+
+/* Acquire shared (read) access, blocking while a writer holds or waits for
+ * the lock.
+ * @rw : Pointer to lock structure (must be valid)
+ *
+ * Returns ERR_OK on success, ERR_TASK_BUSY if the caller holds write access
+ */
+int32_t mo_rwlock_rdlock(rwlock_t *rw);
+
+/* Acquire shared access without blocking.
+ * @rw : Pointer to lock structure
+ *
+ * Returns ERR_OK if acquired, ERR_TASK_BUSY if unavailable, ERR_FAIL if
+ * invalid
+ */
+int32_t mo_rwlock_tryrdlock(rwlock_t *rw);
+
+/* Acquire shared access, waiting at most 'ticks' scheduler ticks.
+ * @rw    : Pointer to lock structure
+ * @ticks : Maximum time to wait (0 = tryrdlock behavior)
+ *
+ * Returns ERR_OK if acquired, ERR_TIMEOUT if timed out, ERR_TASK_BUSY if the
+ * caller holds write access, ERR_FAIL if invalid
+ */
+int32_t mo_rwlock_timedrdlock(rwlock_t *rw, uint32_t ticks);
+
+/* Acquire exclusive (write) access, blocking until no reader or writer
+ * holds the lock.
+ * @rw : Pointer to lock structure (must be valid)
+ *
+ * Returns ERR_OK on success, ERR_TASK_BUSY if already owned by caller
+ */
+int32_t mo_rwlock_wrlock(rwlock_t *rw);
+
+/* Acquire exclusive access without blocking.
+ * @rw : Pointer to lock structure
+ *
+ * Returns ERR_OK if acquired, ERR_TASK_BUSY if unavailable, ERR_FAIL if
+ * invalid
+ */
+int32_t mo_rwlock_trywrlock(rwlock_t *rw);
+
+/* Acquire exclusive access, waiting at most 'ticks' scheduler ticks.
+ * @rw    : Pointer to lock structure
+ * @ticks : Maximum time to wait (0 = trywrlock behavior)
+ *
+ * Returns ERR_OK if acquired, ERR_TIMEOUT if timed out, ERR_TASK_BUSY if
+ * recursive, ERR_FAIL if invalid
+ */
+int32_t mo_rwlock_timedwrlock(rwlock_t *rw, uint32_t ticks);
+
+/* Release the caller's read or write access and hand the lock over to the
+ * waiters whose turn it is.
+ * @rw : Pointer to lock structure
+ *
+ * Returns ERR_OK on success, ERR_NOT_OWNER if neither held, ERR_FAIL if
+ * invalid
+ */
+int32_t mo_rwlock_unlock(rwlock_t *rw);
@@ -5,10 +5,24 @@
  * Pipes provide a unidirectional FIFO communication channel between tasks.
  * They support both blocking and non-blocking I/O operations with automatic
  * buffer management using power-of-2 sizing for efficient masking operations.
+ *
+ * A blocked reader or writer sleeps on the pipe's wait queue and is woken
+ * by the other side as soon as it can make progress. Watermarks batch those
+ * wakeups: a reader sleeps until at least 'read_wm' bytes (or all it still
+ * needs) are buffered, a writer until 'write_wm' bytes are free.
+ *
+ * Interrupt handlers feed a pipe with mo_pipe_write_from_isr() and drain one
+ * with mo_pipe_read_from_isr(); neither blocks, and a switch to a woken task
+ * is left for after the handler.
  */
 
 #include <types.h>
 
+#include <sys/defer.h>
+#include <sys/poll.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
+
 /* Magic number for pipe validation and corruption detection */
 #define PIPE_MAGIC 0x50495045 /* "PIPE" */
 
@@ -25,8 +39,39 @@ typedef struct {
     volatile uint16_t tail; /* Write index (producer position) */
     volatile uint16_t used; /* Bytes currently stored (0 to capacity) */
     uint32_t magic;         /* Magic number for validation */
+    spinlock_t lock;        /* Protects indices and buffer contents */
+    poll_link_t *pollers;   /* Tasks waiting in mo_poll() for data */
+
+    /* Blocking I/O */
+    wait_queue_t readers; /* Tasks blocked until data arrives */
+    wait_queue_t writers; /* Tasks blocked until space frees up */
+    uint16_t read_wm;     /* Buffered bytes that wake a reader (default 1) */
+    uint16_t write_wm;    /* Free bytes that wake a writer (default 1) */
+    uint16_t read_need;   /* Smallest wake threshold among blocked readers */
+    uint16_t write_need;  /* Smallest wake threshold among blocked writers */
+
+    /* Zero-copy access */
+    uint16_t wr_claim; /* Bytes reserved by mo_pipe_write_reserve() */
+    uint16_t rd_claim; /* Bytes held by mo_pipe_read_acquire() */
+
+    defer_work_t isr_work; /* Wakeup deferred by a _from_isr read or write */
 } pipe_t;
 
+/* A region of the ring buffer handed out for zero-copy access. When the
+ * region wraps around the end of the buffer it comes in two parts; 'len[1]'
+ * is 0 otherwise.
+ */
+typedef struct {
+    char *data[2];   /* Start of each part */
+    uint16_t len[2]; /* Bytes in each part */
+} pipe_span_t;
+
+/* Consumer of spliced bytes: takes up to @len bytes at @buf and returns how
+ * many it took, blocking while it has no room, or a negative value on error.
+ * The stdio buffer hook, _putbuf(), has this shape.
+ */
+typedef int (*pipe_sink_t)(const char *buf, int len);
+
 /* Pipe Management Functions */
 
 /* Create a new pipe with specified buffer size.
@@ -40,7 +85,8 @@ pipe_t *mo_pipe_create(uint16_t size);
 /* Destroy a pipe and free its resources.
  * @pipe : Pointer to pipe structure (NULL is safe no-op)
  *
- * Returns ERR_OK on success, ERR_FAIL if pipe is invalid
+ * Returns ERR_OK on success, ERR_TASK_BUSY if tasks are blocked on it or a
+ * wakeup from an interrupt handler is pending, ERR_FAIL if pipe is invalid
  */
 int32_t mo_pipe_destroy(pipe_t *pipe);
 
@@ -72,6 +118,20 @@ int32_t mo_pipe_capacity(pipe_t *pipe);
  */
 int32_t mo_pipe_free_space(pipe_t *pipe);
 
+/* Set the wakeup watermarks for blocked readers and writers.
+ * A blocked reader is woken once @read_wm bytes are buffered, or fewer if
+ * that is all it still needs; a blocked writer once @write_wm bytes are free,
+ * or fewer if that is all it still has to write. Larger values trade latency
+ * for fewer context switches. Both are clamped to 1..capacity.
+ * @pipe     : Pointer to pipe structure (must be valid)
+ * @read_wm  : Reader wakeup threshold in bytes
+ * @write_wm : Writer wakeup threshold in bytes
+ *
+ * Returns ERR_OK on success, ERR_FAIL if pipe is invalid
+ */
+int32_t mo_pipe_set_watermarks(pipe_t *pipe, uint16_t read_wm,
+                               uint16_t write_wm);
+
 /* Blocking I/O Operations (runs in task context only) */
 
 /* Read data from pipe, blocking until all requested bytes are available.
@@ -94,6 +154,31 @@ int32_t mo_pipe_read(pipe_t *pipe, char *data, uint16_t size);
  */
 int32_t mo_pipe_write(pipe_t *pipe, const char *data, uint16_t size);
 
+/* Read data from pipe, blocking for at most @ticks scheduler ticks.
+ * @pipe  : Pointer to pipe structure (must be valid)
+ * @data  : Buffer to store read data (must be non-NULL)
+ * @size  : Number of bytes to read (must be > 0)
+ * @ticks : Maximum time to wait (0 = do not block)
+ *
+ * Returns number of bytes read, fewer than size if the timeout expired
+ * first, ERR_TIMEOUT if nothing could be read, ERR_FAIL on invalid arguments
+ */
+int32_t mo_pipe_timedread(pipe_t *pipe, char *data, uint16_t size,
+                          uint32_t ticks);
+
+/* Write data to pipe, blocking for at most @ticks scheduler ticks.
+ * @pipe  : Pointer to pipe structure (must be valid)
+ * @data  : Data to write (must be non-NULL)
+ * @size  : Number of bytes to write (must be > 0)
+ * @ticks : Maximum time to wait (0 = do not block)
+ *
+ * Returns number of bytes written, fewer than size if the timeout expired
+ * first, ERR_TIMEOUT if nothing could be written, ERR_FAIL on invalid
+ * arguments
+ */
+int32_t mo_pipe_timedwrite(pipe_t *pipe, const char *data, uint16_t size,
+                           uint32_t ticks);
+
 /* Non-blocking I/O Operations (returns immediately with partial results) */
 
 /* Read available data from pipe without blocking.
@@ -115,3 +200,89 @@ int32_t mo_pipe_nbread(pipe_t *pipe, char *data, uint16_t size);
  * Note: Returns immediately even if no space is available
  */
 int32_t mo_pipe_nbwrite(pipe_t *pipe, const char *data, uint16_t size);
+
+/* Interrupt-handler variant of mo_pipe_nbwrite(). Never blocks or switches;
+ * a woken reader that outranks the interrupted task runs once the handler
+ * returns.
+ * @pipe : Pointer to pipe structure (must be valid)
+ * @data : Data to write (must be non-NULL)
+ * @size : Number of bytes to write
+ *
+ * Returns number of bytes actually written (0 to size), negative on error
+ */
+int32_t mo_pipe_write_from_isr(pipe_t *pipe, const char *data, uint16_t size);
+
+/* Interrupt-handler variant of mo_pipe_nbread(). Never blocks or switches;
+ * a woken writer that outranks the interrupted task runs once the handler
+ * returns.
+ * @pipe : Pointer to pipe structure (must be valid)
+ * @data : Buffer to store read data (must be non-NULL)
+ * @size : Maximum number of bytes to read
+ *
+ * Returns number of bytes actually read (0 to size), negative on error
+ */
+int32_t mo_pipe_read_from_isr(pipe_t *pipe, char *data, uint16_t size);
+
+/* Zero-copy I/O Operations (never block)
+ *
+ * The producer fills the ring in place between reserve and commit, and the
+ * consumer reads it in place between acquire and release, so each byte is
+ * written once and read once with no intermediate copy. Each side may hold
+ * one region at a time; while it does, the copying calls on that side see
+ * the pipe as full (write) or empty (read) and block or return short, so
+ * no other task ever touches a claimed byte.
+ */
+
+/* Reserve up to @max free bytes for direct writing.
+ * @pipe : Pointer to pipe structure (must be valid)
+ * @span : Receives the reserved region (must be non-NULL)
+ * @max  : Maximum number of bytes to reserve
+ *
+ * Returns the number of bytes reserved (may be 0 if full), ERR_TASK_BUSY if
+ * a reservation is already open, ERR_FAIL on invalid arguments
+ */
+int32_t mo_pipe_write_reserve(pipe_t *pipe, pipe_span_t *span, uint16_t max);
+
+/* Publish the first @size bytes of the open reservation and close it.
+ * Wakes readers like a regular write. A @size of 0 cancels the reservation.
+ * @pipe : Pointer to pipe structure (must be valid)
+ * @size : Bytes written into the reserved region, at most the reserved size
+ *
+ * Returns ERR_OK on success, ERR_FAIL if @size exceeds the reservation
+ */
+int32_t mo_pipe_write_commit(pipe_t *pipe, uint16_t size);
+
+/* Expose up to @max buffered bytes for direct reading.
+ * @pipe : Pointer to pipe structure (must be valid)
+ * @span : Receives the readable region (must be non-NULL)
+ * @max  : Maximum number of bytes to expose
+ *
+ * Returns the number of bytes exposed (may be 0 if empty), ERR_TASK_BUSY if
+ * a region is already held, ERR_FAIL on invalid arguments
+ */
+int32_t mo_pipe_read_acquire(pipe_t *pipe, pipe_span_t *span, uint16_t max);
+
+/* Consume the first @size bytes of the held region and release it.
+ * Wakes writers like a regular read. A @size of 0 consumes nothing.
+ * @pipe : Pointer to pipe structure (must be valid)
+ * @size : Bytes consumed, at most the acquired size
+ *
+ * Returns ERR_OK on success, ERR_FAIL if @size exceeds the held region
+ */
+int32_t mo_pipe_read_release(pipe_t *pipe, uint16_t size);
+
+/* Drain up to @size buffered bytes into @sink, which reads them in place
+ * from the ring, so they are never copied into an intermediate buffer.
+ * An empty pipe blocks the caller until the read watermark is buffered.
+ * The sink then gets one call per contiguous part; one that takes fewer
+ * bytes than offered ends the splice, leaving the rest buffered. The bytes
+ * are held like a mo_pipe_read_acquire() region meanwhile. Task context
+ * only.
+ * @pipe : Pointer to pipe structure (must be valid)
+ * @sink : Output sink; NULL sends to stdout through the console driver
+ * @size : Maximum number of bytes to move (must be > 0)
+ *
+ * Returns number of bytes moved, ERR_FAIL on invalid arguments or if the
+ * sink failed before taking anything
+ */
+int32_t mo_pipe_splice(pipe_t *pipe, pipe_sink_t sink, uint16_t size);
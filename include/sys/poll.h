@@ -0,0 +1,79 @@
+#pragma once
+
+/* Waiting on Multiple Objects
+ *
+ * mo_poll() blocks the caller until any of a set of pipes, message queues,
+ * semaphores or its own notification word becomes ready, or a timeout
+ * expires. While waiting, each item links itself into its object's list of
+ * pollers, so the object wakes the task at the moment it becomes ready
+ * instead of the task polling every tick.
+ *
+ * Readiness is level-triggered and nothing is consumed: a pipe is ready
+ * when it holds data, a message queue when it holds a message, a semaphore
+ * when its count is positive and a notification item when any of its bits
+ * is pending. The caller then reads with the usual non-blocking calls.
+ * Another task may get there first, so a ready report is a hint, not a
+ * reservation. An object must not be destroyed while it is being polled.
+ */
+
+#include <lib/libc.h>
+
+struct tcb;
+
+/* Object Types */
+typedef enum {
+    POLL_PIPE = 0,   /* 'obj' is a pipe_t *, ready when readable */
+    POLL_MQ = 1,     /* 'obj' is an mq_t *, ready when not empty */
+    POLL_SEM = 2,    /* 'obj' is a sem_t *, ready when its count is > 0 */
+    POLL_NOTIFY = 3, /* The caller's notification word, ready on 'mask' */
+} poll_type_t;
+
+/* mo_poll() rejects POLL_PIPE and POLL_MQ items when CONFIG_PIPE or
+ * CONFIG_MQUEUE leaves pipes or message queues out of the kernel.
+ */
+
+/* Timeout for mo_poll() that never expires */
+#define POLL_FOREVER 0xFFFFFFFFU
+
+/* Poller list link, embedded in each polled object's list (kernel-owned) */
+typedef struct poll_link {
+    struct poll_link *next;
+    struct tcb *task;
+} poll_link_t;
+
+/* Poll Set Entry */
+typedef struct {
+    void *obj;        /* Object to wait on; unused for POLL_NOTIFY */
+    uint32_t mask;    /* POLL_NOTIFY: bits to wait for, 0 means all */
+    uint8_t type;     /* Object type (poll_type_t) */
+    bool ready;       /* Output: set if the object was ready on return */
+    poll_link_t link; /* Kernel linkage while waiting */
+} poll_item_t;
+
+/* Waits until at least one item is ready.
+ * @items   : Array of poll items (must not be NULL)
+ * @count   : Number of items (must be > 0)
+ * @timeout : Ticks to wait; 0 only checks, POLL_FOREVER never expires
+ *
+ * Returns the number of ready items (each has 'ready' set), 0 on timeout,
+ * or ERR_FAIL for an invalid item
+ */
+int32_t mo_poll(poll_item_t *items, uint16_t count, uint32_t timeout);
+
+/* Per-object hooks used by mo_poll(). Each links @link into (@attach) or
+ * unlinks it from the object's poller list under the object's lock, and
+ * returns whether the object is ready.
+ */
+bool _pipe_poll(void *pipe, poll_link_t *link, bool attach);
+bool _mq_poll(void *mq, poll_link_t *link, bool attach);
+bool _sem_poll(void *sem, poll_link_t *link, bool attach);
+
+/* Links or unlinks @link in the poller list at @head */
+void _poll_list_update(poll_link_t **head, poll_link_t *link, bool attach);
+
+/* Wakes every task waiting in mo_poll() on the list at @head. Called by an
+ * object that just became ready, with scheduling disabled.
+ *
+ * Returns true if a woken task should preempt the caller
+ */
+bool _poll_wake(poll_link_t *head);
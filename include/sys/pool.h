@@ -0,0 +1,118 @@
+#pragma once
+
+#include <sys/defer.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
+
+/* Fixed-Block Memory Pools
+ *
+ * A pool hands out equally sized blocks carved from one contiguous region,
+ * either supplied by the caller (mo_pool_init(), e.g. a static array) or
+ * taken from the heap (mo_pool_create()). Free blocks are linked through
+ * their own first word, so allocating and freeing are O(1), need no
+ * per-block header and never fragment the region.
+ *
+ * mo_pool_alloc() blocks on an empty pool, with an optional timeout, until
+ * another task or an interrupt handler frees a block. Interrupt handlers use
+ * mo_pool_alloc_from_isr() and mo_pool_free_from_isr(), which never block
+ * and leave the switch to a woken task for after the handler.
+ */
+
+/* Timeout for mo_pool_alloc() that never expires */
+#define POOL_WAIT_FOREVER 0xFFFFFFFFU
+
+/* Pool descriptor. Treat as opaque; it is public so pools can be static. */
+typedef struct {
+    char *base;        /* First block */
+    char *end;         /* One past the last block */
+    void *free_list;   /* Free blocks, linked through their first word */
+    uint32_t stride;   /* Distance between blocks (block size, word-aligned) */
+    uint16_t count;    /* Number of blocks */
+    uint16_t nfree;    /* Blocks currently free */
+    uint16_t min_free; /* Lowest 'nfree' seen, for sizing the pool */
+    bool owns_storage; /* Region came from malloc() in mo_pool_create() */
+    spinlock_t lock;   /* Protects the free list and the wait queue */
+
+    wait_queue_t waiters;  /* Tasks blocked on an empty pool */
+    defer_work_t isr_work; /* Waiter wakeup deferred by a _from_isr free */
+} pool_t;
+
+/* Bytes of storage mo_pool_init() needs for @count blocks of @size bytes */
+#define POOL_STORAGE_SIZE(size, count) \
+    ((((size) < sizeof(void *) ? sizeof(void *) : (size)) + 3u) / 4u * 4u * \
+     (count))
+
+/* Pool Management */
+
+/* Initializes a pool over caller-provided storage.
+ * @pool    : Pool descriptor to initialize (must not be NULL)
+ * @storage : Word-aligned region of at least POOL_STORAGE_SIZE(size, count)
+ *            bytes. It belongs to the pool until the pool is destroyed.
+ * @size    : Block size in bytes (> 0); rounded up to a whole word
+ * @count   : Number of blocks (> 0)
+ *
+ * Returns ERR_OK on success, or ERR_FAIL on invalid arguments
+ */
+int32_t mo_pool_init(pool_t *pool, void *storage, uint32_t size,
+                     uint16_t count);
+
+/* Creates a pool of @count blocks of @size bytes from the heap.
+ * @size  : Block size in bytes (> 0); rounded up to a whole word
+ * @count : Number of blocks (> 0)
+ *
+ * Returns the new pool, or NULL on invalid arguments or lack of memory
+ */
+pool_t *mo_pool_create(uint32_t size, uint16_t count);
+
+/* Destroys a pool. A pool from mo_pool_create() is freed along with its
+ * storage; for one from mo_pool_init(), the storage is handed back to the
+ * caller. Blocks still allocated become invalid.
+ * @pool : The pool to destroy. Can be NULL (no-op).
+ *
+ * Returns ERR_OK on success, or ERR_TASK_BUSY if tasks are waiting on it
+ */
+int32_t mo_pool_destroy(pool_t *pool);
+
+/* Block Operations */
+
+/* Takes a block from the pool, sleeping on an empty pool.
+ * @pool    : The pool (must not be NULL)
+ * @timeout : Ticks to wait for a free block: 0 never waits, and
+ *            POOL_WAIT_FOREVER waits indefinitely
+ *
+ * Returns the block, or NULL if none became free in time
+ */
+void *mo_pool_alloc(pool_t *pool, uint32_t timeout);
+
+/* Returns a block to its pool, waking one task waiting for a block.
+ * @pool  : The pool the block came from
+ * @block : Block returned by an allocation from @pool
+ *
+ * Returns ERR_OK on success, or ERR_FAIL if @block is not a block of @pool
+ *         or the pool has no block outstanding (a double free)
+ */
+int32_t mo_pool_free(pool_t *pool, void *block);
+
+/* Interrupt-handler variant of mo_pool_alloc() that never waits.
+ *
+ * Returns the block, or NULL if the pool is empty
+ */
+void *mo_pool_alloc_from_isr(pool_t *pool);
+
+/* Interrupt-handler variant of mo_pool_free(). Never blocks or switches; a
+ * woken waiter that outranks the interrupted task runs once the handler
+ * returns.
+ *
+ * Returns ERR_OK on success, or ERR_FAIL if @block is not a block of @pool
+ */
+int32_t mo_pool_free_from_isr(pool_t *pool, void *block);
+
+/* Pool Query Functions */
+
+/* Returns the number of free blocks, or -1 if @pool is NULL */
+int32_t mo_pool_available(const pool_t *pool);
+
+/* Returns the lowest number of free blocks seen since the pool was set up,
+ * or -1 if @pool is NULL. A low-water mark of 0 means the pool ran dry.
+ */
+int32_t mo_pool_min_available(const pool_t *pool);
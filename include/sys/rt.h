@@ -0,0 +1,79 @@
+#pragma once
+
+/* Built-in Real-Time Schedulers
+ *
+ * Provides Earliest-Deadline-First (EDF) and Rate-Monotonic (RM) scheduling
+ * for periodic tasks through the kernel's real-time scheduler hook. Each
+ * real-time task is described by an 'rt_params_t' record that the
+ * application owns and attaches with 'mo_task_rt_priority()'. Attaching runs
+ * utilization-based admission control, so a task set is only accepted when
+ * the selected policy can guarantee every deadline.
+ *
+ * Real-time tasks always take precedence over the priority scheduler. When
+ * no real-time job is ready, the regular priority levels run as usual.
+ */
+
+#include <types.h>
+
+struct tcb;
+
+/* Scheduling policies */
+typedef enum {
+    RT_POLICY_EDF = 0, /* Earliest absolute deadline first (dynamic) */
+    RT_POLICY_RM = 1,  /* Shortest period first (static priorities) */
+} rt_policy_t;
+
+/* Maximum number of tasks that can be attached to the RT scheduler */
+#define RT_MAX_TASKS 16
+
+/* Periodic Task Parameters
+ *
+ * The first three fields describe the task and must be filled in by the
+ * application before the record is attached. The remaining fields are
+ * maintained by the scheduler and may be read for statistics; they must be
+ * zero-initialized (e.g. by static storage). The record must stay valid for
+ * as long as it is attached to a task.
+ */
+typedef struct {
+    /* Task Model (set by the application, all in system ticks) */
+    uint32_t period;   /* Release period T (must be > 0) */
+    uint32_t deadline; /* Relative deadline D (0 means D = T, must be <= T) */
+    uint32_t wcet;     /* Worst-case execution time C per job (0 < C <= D) */
+
+    /* Job State (maintained by the scheduler) */
+    uint32_t release;      /* Release tick of the current job */
+    uint32_t abs_deadline; /* Absolute deadline of the current job */
+    uint32_t jobs;         /* Number of completed jobs */
+    uint32_t misses;       /* Jobs that completed after their deadline */
+
+    /* Internal Bookkeeping */
+    struct tcb *task; /* Owning task control block */
+    uint32_t util;    /* Admitted share of the CPU (Q16 fixed point) */
+    int16_t heap_idx; /* Position in the scheduler heap, -1 if none */
+    uint8_t state;    /* Job state (ready, waiting for release) */
+    uint8_t _reserved;
+} rt_params_t;
+
+/* Installs the built-in real-time scheduler on the kernel hook.
+ * Tasks are then attached with 'mo_task_rt_priority(id, &params)' and
+ * detached with 'mo_task_rt_priority(id, NULL)'. The policy cannot be changed
+ * while tasks are attached.
+ * @policy : RT_POLICY_EDF or RT_POLICY_RM
+ *
+ * Returns ERR_OK on success, ERR_TASK_BUSY if tasks are attached, or
+ * ERR_RT_PARAMS for an unknown policy
+ */
+int32_t mo_rt_init(rt_policy_t policy);
+
+/* Completes the current job and sleeps until the task's next release.
+ * Must be called by an attached real-time task at the end of each job. A job
+ * that finishes after its absolute deadline is counted in 'misses'; if the
+ * next release has already passed, the next job starts immediately.
+ */
+void mo_rt_wait_period(void);
+
+/* Gets the total admitted CPU utilization of all attached tasks.
+ *
+ * Returns the utilization in parts per thousand (1000 = fully loaded)
+ */
+uint32_t mo_rt_utilization(void);
@@ -2,12 +2,14 @@
 
 /* Counting Semaphores for Task Synchronization
  *
- * Provides counting semaphores with FIFO queuing for blocked tasks.
- * Supports both binary semaphores (initial_count = 1) and general
- * counting semaphores for resource management.
+ * Provides counting semaphores with FIFO or priority-ordered queuing for
+ * blocked tasks. Supports both binary semaphores (initial_count = 1) and
+ * general counting semaphores for resource management.
  */
 
 #include <lib/queue.h>
+#include <sys/lockstat.h>
+#include <sys/task.h>
 
 /* Forward declaration of the opaque semaphore type */
 typedef struct sem_t sem_t;
@@ -18,9 +20,8 @@ typedef struct sem_t sem_t;
 /* Semaphore Management Functions */
 
 /* Creates and initializes a counting semaphore.
- * @max_waiters   : The maximum number of tasks that can be blocked on the
- *                  semaphore at one time. This determines the size of the
- *                  internal wait queue. Must be > 0.
+ * @max_waiters   : Must be > 0. Kept for compatibility: waiters are linked
+ *                  through their TCBs, so their number is not limited.
  * @initial_count : The initial number of available resources (tokens).
  *                  Must be >= 0 and <= SEM_MAX_COUNT.
  *                  For a binary semaphore, this should be 1.
@@ -66,13 +67,25 @@ int32_t mo_sem_trywait(sem_t *s);
 /* Releases the semaphore (a "V" or "post" operation), potentially unblocking
  * a waiter.
  *
- * If there are tasks blocked in the wait queue, the oldest waiting task is
- * unblocked (FIFO order). If the wait queue is empty, the semaphore's
- * resource count is incremented up to SEM_MAX_COUNT.
+ * If there are tasks blocked in the wait queue, the next one under the
+ * semaphore's wait policy is unblocked (the oldest by default). If the wait
+ * queue is empty, the semaphore's resource count is incremented up to
+ * SEM_MAX_COUNT.
  * @s : A pointer to the semaphore. Must not be NULL.
  */
 void mo_sem_signal(sem_t *s);
 
+/* Interrupt-handler variant of mo_sem_signal(). Never blocks or switches
+ * and never takes the semaphore's lock: the token is banked and reaches the
+ * count, or the next waiter, at the switch the call requests. A woken
+ * waiter that outranks the interrupted task then runs once the handler
+ * returns.
+ * @s : A pointer to the semaphore. Must not be NULL.
+ *
+ * Returns ERR_OK on success, or ERR_FAIL for an invalid semaphore.
+ */
+int32_t mo_sem_signal_from_isr(sem_t *s);
+
 /* Semaphore Query Functions */
 
 /* Gets the current count of available resources.
@@ -91,3 +104,30 @@ int32_t mo_sem_getvalue(sem_t *s);
  * Returns the number of waiting tasks, or -1 if s is NULL.
  */
 int32_t mo_sem_waiting_count(sem_t *s);
+
+/* Copies the semaphore's contention statistics (see <sys/lockstat.h>). A
+ * wait counts as acquired once it has a token, whether taken at once by
+ * mo_sem_wait() or mo_sem_trywait(), or handed over by a signal.
+ * @s     : A pointer to the semaphore. Must not be NULL.
+ * @stats : Receives the statistics
+ *
+ * Returns ERR_OK, or ERR_FAIL if @s is invalid or CONFIG_LOCK_STATS is off
+ */
+int32_t mo_sem_stats(sem_t *s, lock_stats_t *stats);
+
+/* Names the semaphore and adds it to the registry mo_lock_stats_dump()
+ * ranks; mo_sem_destroy() removes it. @name must stay valid.
+ *
+ * Returns ERR_OK, or ERR_FAIL if @s is invalid or CONFIG_LOCK_STATS is off
+ */
+int32_t mo_sem_stats_register(sem_t *s, const char *name);
+
+/* Selects the order in which blocked tasks are woken.
+ * @s      : A pointer to the semaphore. Must not be NULL.
+ * @policy : WAIT_FIFO (default) wakes the oldest waiter; WAIT_PRIO wakes the
+ *           highest-priority waiter, the oldest among equals. Applies to
+ *           tasks already waiting as well.
+ *
+ * Returns ERR_OK on success, or ERR_FAIL for an invalid semaphore or policy.
+ */
+int32_t mo_sem_set_policy(sem_t *s, wait_policy_t policy);
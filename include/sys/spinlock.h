@@ -0,0 +1,119 @@
+#pragma once
+
+/* Kernel Locks and Atomic Counters
+ *
+ * Ticket spinlocks give waiters the lock in arrival order, so no contender
+ * starves. Each IPC object embeds one, which makes protection per object
+ * rather than a single global interrupt-masking section.
+ *
+ * A lock that is also taken from interrupt context must be acquired with
+ * spin_lock_irqsave(), which masks interrupts on the local hart while the
+ * lock is held. Otherwise an ISR could spin forever on a lock held by the
+ * task it interrupted. Plain spin_lock() is for data only used by tasks and
+ * must be taken inside NOSCHED_ENTER(), so the holder cannot be preempted.
+ *
+ * The arch layer provides the atomics: AMO/LR-SC when the kernel is built
+ * for rv32ima (RV_ATOMICS=1), interrupt masking on single-hart rv32im. On a
+ * single hart a plain lock holder can never be contended, so there the
+ * ticket update is an ordinary increment and costs no CSR access.
+ * Locks must never be held across a context switch.
+ */
+
+#include <hal.h>
+
+/* Ticket Spinlock */
+typedef struct {
+    volatile uint32_t next;  /* Next ticket to hand out */
+    volatile uint32_t owner; /* Ticket currently allowed to hold the lock */
+} spinlock_t;
+
+#define SPINLOCK_INIT {0, 0}
+
+static inline void spin_lock_init(spinlock_t *lock)
+{
+    lock->next = 0;
+    lock->owner = 0;
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+#ifdef __riscv_atomic
+    uint32_t ticket = hal_atomic_fetch_add(&lock->next, 1);
+#else
+    uint32_t ticket = lock->next++;
+#endif
+    while (lock->owner != ticket)
+        hal_cpu_relax();
+    hal_fence(); /* Acquire: critical section loads stay after this */
+}
+
+/* Returns true if the lock was free and is now held */
+static inline bool spin_trylock(spinlock_t *lock)
+{
+    uint32_t owner = lock->owner;
+    return hal_atomic_cas(&lock->next, owner, owner + 1) == owner;
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+    hal_fence(); /* Release: critical section stores complete first */
+    lock->owner = lock->owner + 1; /* Only the holder writes 'owner' */
+}
+
+/* Masks local interrupts, then takes @lock.
+ * Returns the previous interrupt state for spin_unlock_irqrestore().
+ */
+static inline uint32_t spin_lock_irqsave(spinlock_t *lock)
+{
+    uint32_t flags = (uint32_t) hal_interrupt_set(0);
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags)
+{
+    spin_unlock(lock);
+    if (flags)
+        _ei();
+}
+
+/* Atomic Counter */
+typedef struct {
+    volatile uint32_t value;
+} atomic_t;
+
+#define ATOMIC_INIT(v) {(v)}
+
+static inline uint32_t atomic_read(const atomic_t *a)
+{
+    return a->value;
+}
+
+static inline void atomic_set(atomic_t *a, uint32_t v)
+{
+    a->value = v;
+}
+
+/* Adds @v and returns the new value */
+static inline uint32_t atomic_add_return(atomic_t *a, uint32_t v)
+{
+    return hal_atomic_fetch_add(&a->value, v) + v;
+}
+
+static inline uint32_t atomic_inc(atomic_t *a)
+{
+    return atomic_add_return(a, 1);
+}
+
+static inline uint32_t atomic_dec(atomic_t *a)
+{
+    return atomic_add_return(a, (uint32_t) -1);
+}
+
+/* Stores @desired if the counter holds @expected; returns true on success */
+static inline bool atomic_cmpxchg(atomic_t *a,
+                                  uint32_t expected,
+                                  uint32_t desired)
+{
+    return hal_atomic_cas(&a->value, expected, desired) == expected;
+}
@@ -2,17 +2,16 @@
 
 /* Task Management and Scheduling
  *
- * Provides a lightweight task model with shared address space and
- * efficient round-robin scheduling. The scheduler uses the master task
- * list with optimized algorithms for better performance than naive O(n)
- * implementations, while maintaining simplicity and compatibility.
- *
- * The scheduler provides O(n) complexity but with small constant factors
- * and excellent practical performance for typical embedded workloads.
+ * Provides a lightweight task model with shared address space and a
+ * strict-priority preemptive scheduler with round-robin inside each level.
+ * Every priority level owns a FIFO ready queue, and a bitmap records which
+ * levels are non-empty, so selecting the next task is O(1) regardless of
+ * how many tasks exist or how many of them are blocked.
  * Priority-aware time slice allocation ensures good responsiveness.
  */
 
 #include <hal.h>
+#include <lib/arena.h>
 #include <lib/list.h>
 #include <lib/queue.h>
 
@@ -59,6 +58,19 @@ enum task_states {
 #define TASK_TIMESLICE_LOW 10     /* Low priority: longer slice */
 #define TASK_TIMESLICE_IDLE 15    /* Idle tasks: longest slice */
 
+/* Task Flags */
+#define TASK_FLAG_STATIC (1U << 0) /* TCB and stack are owned by the caller */
+#define TASK_FLAG_POLL (1U << 1)   /* Waiting in mo_poll(), see <sys/poll.h> */
+#define TASK_FLAG_FAST (1U << 2)   /* Stack was asked of fast memory */
+#define TASK_FLAG_RELEASED (1U << 3) /* Job released by mo_task_delay_until */
+
+/* Buckets of the per-task response time histogram (see mo_task_response) */
+#define TASK_RESP_BUCKETS 16
+
+#if CONFIG_STDOUT_BUF > 1024
+#error "CONFIG_STDOUT_BUF must be between 0 and 1024"
+#endif
+
 /* Task Control Block (TCB)
  *
  * Contains all essential information about a single task, including saved
@@ -73,17 +85,195 @@ typedef struct tcb {
 
     /* Scheduling Parameters */
     uint16_t prio;      /* Encoded priority (base and time slice counter) */
-    uint8_t prio_level; /* Priority level (0-7, 0 = highest) */
+    uint8_t prio_level; /* Effective priority level (0-7, 0 = highest) */
+    uint8_t base_level; /* Priority level set by mo_task_priority() */
     uint8_t time_slice; /* Current time slice remaining */
-    uint16_t delay;     /* Ticks remaining for task in TASK_BLOCKED state */
     uint16_t id;        /* Unique task ID, assigned by kernel upon creation */
     uint8_t state;      /* Current lifecycle state (e.g., TASK_READY) */
-    uint8_t flags;      /* Task flags for future extensions (reserved) */
+    uint8_t flags;      /* Task flags (TASK_FLAG_*) */
+    uint32_t wake_tick; /* Absolute tick to wake at, while in the sleep list */
 
     /* Real-time Scheduling Support */
     void *rt_prio; /* Opaque pointer for custom real-time scheduler hook */
+    struct task_budget *budget; /* CPU budget charged, see mo_task_budget */
+
+    /* Scheduler Linkage */
+    dlist_node_t node;   /* Link in the master task list (kcb->tasks) */
+    struct tcb *rq_next; /* Next task in the same-level ready queue */
+    struct tcb *rq_prev; /* Previous task in the same-level ready queue */
+    struct tcb *dl_next; /* Next sleeper, in ascending wake_tick order */
+    struct tcb *dl_prev; /* Previous sleeper in the sleep list */
+    struct wait_queue *wq; /* Wait queue the task is blocked on, if any */
+    struct tcb *wq_next;   /* Next waiter in the same wait queue */
+    struct tcb *wq_prev;   /* Previous waiter in the same wait queue */
+
+    /* Direct-to-Task Notification (see mo_task_notify) */
+    uint32_t notify_value; /* Pending notification bits or count */
+    uint32_t notify_mask;  /* Bits the task is blocked on, 0 if not waiting */
+
+    /* Per-Task Arena (see mo_task_spawn_arena), empty unless opted into */
+    arena_t arena;
+
+    /* Priority Inheritance */
+    struct mutex *held_mutexes; /* Mutexes owned by this task */
+    struct mutex *blocked_on;   /* Mutex this task is waiting for, if any */
+    struct mutex *cond_mutex;   /* Mutex to re-acquire after a cond wait */
+#if CONFIG_LOCK_STATS
+    uint32_t lock_wait_start; /* hal_clock_read() when it last queued */
+#endif
+
+    /* CPU Accounting (machine timer units, see hal_clock_read()) */
+    uint64_t run_time;    /* Total time spent running */
+    uint32_t switches;    /* Times the task was switched in */
+    uint32_t preemptions; /* Times it was switched out while still runnable */
+#if CONFIG_TASK_PMU
+    uint64_t pmu[HAL_PMU_SLOTS]; /* Counter totals, see hal_pmu_sample() */
+#endif
+
+    /* Periodic Execution (see mo_task_delay_until) */
+    uint32_t jobs;   /* Jobs ended by mo_task_delay_until() */
+    uint32_t misses; /* Jobs that overran their period */
+#if CONFIG_TASK_RESPONSE
+    uint32_t release_at; /* hal_clock_read() when the current job was due */
+    uint32_t resp_max;   /* Longest response time, in microseconds */
+    uint32_t resp_hist[TASK_RESP_BUCKETS];
+#endif
+
+#if CONFIG_STDOUT_BUF
+    /* Line Buffer for printf() and puts() (see fflush) */
+    uint16_t stdout_len;                /* Bytes waiting in 'stdout_buf' */
+    char stdout_buf[CONFIG_STDOUT_BUF]; /* Unfinished console record */
+#endif
 } tcb_t;
 
+/* Per-Priority Ready Queue
+ *
+ * Intrusive FIFO of READY tasks threaded through tcb_t::rq_next/rq_prev.
+ * The running task is never linked into a ready queue.
+ */
+typedef struct {
+    tcb_t *head; /* Next task to run at this level */
+    tcb_t *tail; /* Most recently queued task at this level */
+} ready_queue_t;
+
+/* Wait Queue
+ *
+ * Intrusive list of the tasks blocked on one kernel object (mutex, condition
+ * variable, semaphore), threaded through tcb_t::wq_next/wq_prev and kept in
+ * arrival order. A task waits on at most one queue, recorded in tcb_t::wq,
+ * so blocking and withdrawing after a timeout are O(1) and never allocate,
+ * and the number of waiters is unbounded. Callers hold the owning object's
+ * lock with scheduling disabled.
+ *
+ * The queue's policy only decides who is woken. WAIT_FIFO wakes the oldest
+ * waiter in O(1). WAIT_PRIO wakes the waiter with the best effective
+ * priority, the oldest among equals; it scans the queue on wakeup, so a
+ * priority changed while waiting (e.g. by inheritance) is always honored.
+ */
+typedef enum {
+    WAIT_FIFO = 0, /* Wake in arrival order (default) */
+    WAIT_PRIO = 1, /* Wake the highest-priority waiter first */
+} wait_policy_t;
+
+typedef struct wait_queue {
+    tcb_t *head;    /* Oldest queued task */
+    tcb_t *tail;    /* Most recently queued task */
+    uint16_t count; /* Number of queued tasks */
+    uint8_t policy; /* Wakeup order (wait_policy_t) */
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT {NULL, NULL, 0, WAIT_FIFO}
+
+static inline void wq_init(wait_queue_t *q)
+{
+    q->head = q->tail = NULL;
+    q->count = 0;
+    q->policy = WAIT_FIFO;
+}
+
+static inline bool wq_empty(const wait_queue_t *q)
+{
+    return !q->head;
+}
+
+/* Queues @task at the tail of @q */
+static inline void wq_push(wait_queue_t *q, tcb_t *task)
+{
+    task->wq = q;
+    task->wq_next = NULL;
+    task->wq_prev = q->tail;
+    if (q->tail)
+        q->tail->wq_next = task;
+    else
+        q->head = task;
+    q->tail = task;
+    q->count++;
+}
+
+/* Unlinks @task from @q. Returns false if it was not queued there. */
+static inline bool wq_remove(wait_queue_t *q, tcb_t *task)
+{
+    if (task->wq != q)
+        return false;
+
+    if (task->wq_prev)
+        task->wq_prev->wq_next = task->wq_next;
+    else
+        q->head = task->wq_next;
+    if (task->wq_next)
+        task->wq_next->wq_prev = task->wq_prev;
+    else
+        q->tail = task->wq_prev;
+
+    task->wq = NULL;
+    task->wq_next = task->wq_prev = NULL;
+    q->count--;
+    return true;
+}
+
+/* Returns the waiter to wake next under the queue's policy, or NULL */
+static inline tcb_t *wq_peek(const wait_queue_t *q)
+{
+    tcb_t *task = q->head;
+    if (task && q->policy == WAIT_PRIO) {
+        /* Strictly better only, so equal priorities stay FIFO */
+        for (tcb_t *t = task->wq_next; t; t = t->wq_next)
+            if (t->prio_level < task->prio_level)
+                task = t;
+    }
+    return task;
+}
+
+/* Unlinks and returns the next waiter to wake, or NULL if @q is empty */
+static inline tcb_t *wq_pop(wait_queue_t *q)
+{
+    tcb_t *task = wq_peek(q);
+    if (task)
+        wq_remove(q, task);
+    return task;
+}
+
+/* Task Table
+ *
+ * Task IDs are handles into a fixed table: the low TASK_SLOT_BITS select the
+ * slot holding the TCB and the remaining bits carry the slot's generation,
+ * which is bumped whenever the slot is freed. A lookup is a single indexed
+ * load plus an ID comparison, and a stale ID whose task was cancelled never
+ * resolves to a newer task that reused the slot. Slot 0 is reserved so that
+ * ID 0 stays invalid.
+ */
+#define TASK_SLOT_BITS CONFIG_TASK_SLOT_BITS
+#if TASK_SLOT_BITS < 2 || TASK_SLOT_BITS > 8
+#error "CONFIG_TASK_SLOT_BITS must be between 2 and 8"
+#endif
+#define TASK_MAX_TASKS (1U << TASK_SLOT_BITS) /* Slots, including slot 0 */
+#define TASK_SLOT_MASK (TASK_MAX_TASKS - 1)
+
+typedef struct {
+    tcb_t *task;  /* Task occupying the slot, NULL if free */
+    uint16_t gen; /* Generation, incremented each time the slot is freed */
+} task_slot_t;
+
 /* Kernel Control Block (KCB)
  *
  * Singleton structure holding global kernel state, including task lists,
@@ -91,37 +281,81 @@ typedef struct tcb {
  */
 typedef struct {
     /* Task Management */
-    list_t *tasks; /* Master list of all tasks (nodes contain tcb_t) */
-    list_node_t *task_current; /* Node of currently running task */
+    dlist_t tasks;       /* Master list of all tasks, via tcb_t::node */
+    tcb_t *task_current; /* Currently running task */
     jmp_buf context; /* Saved context of main kernel thread before scheduling */
-    uint16_t next_tid;   /* Monotonically increasing ID for next new task */
+    task_slot_t task_table[TASK_MAX_TASKS]; /* ID to TCB map, see above */
+    uint8_t next_slot;   /* Slot to try first when spawning the next task */
     uint16_t task_count; /* Cached count of active tasks for quick access */
     bool preemptive;     /* true = preemptive; false = cooperative */
 
-    /* Real-Time Scheduler Hook */
+    /* Ready Queues */
+    ready_queue_t ready_queue[TASK_PRIORITY_LEVELS]; /* One FIFO per level */
+    uint8_t ready_bitmap; /* Bit N set when ready_queue[N] is non-empty */
+
+    /* Real-Time Scheduler Hooks */
     int32_t (*rt_sched)(void); /* Custom real-time scheduler function */
+    /* Optional: validates and admits RT parameters set through
+     * mo_task_rt_priority(); called with NULL params to detach a task.
+     */
+    int32_t (*rt_attach)(tcb_t *task, void *params);
+
+    /* Preemption Control (see NOSCHED_ENTER) */
+    volatile uint32_t preempt_count; /* Nesting depth of NOSCHED sections */
+    volatile bool resched_pending;   /* A tick arrived while it was non-zero */
+
+    /* CPU Accounting */
+    uint32_t switch_stamp; /* hal_clock_read() at the last context switch */
+#if CONFIG_TASK_PMU
+    uint32_t pmu_stamp[HAL_PMU_SLOTS]; /* hal_pmu_sample() at that switch */
+#endif
 
     /* Timer Management */
-    list_t *timer_list;      /* List of active software timers */
-    volatile uint32_t ticks; /* Global system tick, incremented by timer */
+    tcb_t *delay_list;          /* Sleeping tasks, sorted by wake_tick */
+    volatile uint32_t ticks;    /* Global system tick, incremented by timer */
+    volatile uint32_t ticks_hi; /* Wraps of 'ticks', see mo_ticks64() */
 } kcb_t;
 
 /* Global pointer to the singleton Kernel Control Block */
 extern kcb_t *kcb;
 
+/* Advances the system tick by @n, carrying into its high word. Called with
+ * interrupts disabled, by the tick interrupt or a cooperative yield.
+ */
+static inline void _tick_advance(uint32_t n)
+{
+    uint32_t ticks = kcb->ticks + n;
+    if (ticks < kcb->ticks)
+        kcb->ticks_hi++;
+    kcb->ticks = ticks;
+}
+
+/* True when tasks are preempted by the tick. With CONFIG_SCHED_MODE fixing
+ * the mode at build time this is a constant, so every test of it folds away.
+ */
+#if CONFIG_SCHED_MODE == SCHED_MODE_PREEMPTIVE
+#define sched_preemptive() true
+#elif CONFIG_SCHED_MODE == SCHED_MODE_COOPERATIVE
+#define sched_preemptive() false
+#else
+#define sched_preemptive() (kcb->preemptive)
+#endif
+
 /* System Configuration Constants */
-#define SCHED_IMAX \
-    500 /* Safety limit for scheduler iterations to prevent livelock */
 #define MIN_TASK_STACK_SIZE \
     256 /* Minimum stack size to prevent stack overflow */
-#define TASK_CACHE_SIZE \
-    4 /* Task lookup cache size for frequently accessed tasks */
+
+/* Wrap-safe tick comparison: true once @now has reached or passed @when */
+static inline bool tick_reached(uint32_t now, uint32_t when)
+{
+    return (int32_t) (now - when) >= 0;
+}
 
 /* Critical Section Macros
  *
  * Two levels of protection are provided:
  * 1. CRITICAL_* macros disable ALL maskable interrupts globally
- * 2. NOSCHED_* macros disable ONLY the scheduler timer interrupt
+ * 2. NOSCHED_* macros disable only task preemption
  */
 
 /* Disable/enable ALL maskable interrupts globally.
@@ -130,33 +364,37 @@ extern kcb_t *kcb;
  * WARNING: Increases interrupt latency - use NOSCHED macros if protection
  * is only needed against task preemption.
  */
-#define CRITICAL_ENTER()     \
-    do {                     \
-        if (kcb->preemptive) \
-            _di();           \
+#define CRITICAL_ENTER()        \
+    do {                        \
+        if (sched_preemptive()) \
+            _di();              \
     } while (0)
 
-#define CRITICAL_LEAVE()     \
-    do {                     \
-        if (kcb->preemptive) \
-            _ei();           \
+#define CRITICAL_LEAVE()        \
+    do {                        \
+        if (sched_preemptive()) \
+            _ei();              \
     } while (0)
 
-/* Disable/enable ONLY the scheduler timer interrupt.
- * Lighter-weight critical section that prevents task preemption but allows
- * other hardware interrupts (e.g., UART) to be serviced, minimizing latency.
- * Use when protecting data shared between tasks.
+/* Disable/enable task preemption.
+ * Nestable: only the outermost NOSCHED_LEAVE() re-enables preemption. The
+ * tick interrupt keeps running and counting time, but while the count is
+ * non-zero it only flags the reschedule, which then runs on the outermost
+ * leave. Both macros are plain memory operations; they touch neither CSRs
+ * nor the CLINT, so the tick period is not disturbed. Use when protecting
+ * data shared between tasks; the section must not block or yield.
  */
-#define NOSCHED_ENTER()          \
-    do {                         \
-        if (kcb->preemptive)     \
-            hal_timer_disable(); \
+#define NOSCHED_ENTER()       \
+    do {                      \
+        kcb->preempt_count++; \
+        hal_barrier();        \
     } while (0)
 
-#define NOSCHED_LEAVE()         \
-    do {                        \
-        if (kcb->preemptive)    \
-            hal_timer_enable(); \
+#define NOSCHED_LEAVE()                                                  \
+    do {                                                                 \
+        hal_barrier();                                                   \
+        if (--kcb->preempt_count == 0 && unlikely(kcb->resched_pending)) \
+            _sched_resched();                                            \
     } while (0)
 
 /* Core Kernel and Task Management API */
@@ -169,6 +407,12 @@ void panic(int32_t ecode);
 /* Main scheduler dispatch function, called by the timer ISR */
 void dispatcher(void);
 
+/* Runs the reschedule requested by sched_isr_resched(), called by the
+ * software interrupt handler. Inside a NOSCHED section it leaves the request
+ * to the outermost NOSCHED_LEAVE().
+ */
+void dispatcher_resched(void);
+
 /* Architecture-specific context switch implementations */
 void _dispatch(void);
 void _yield(void);
@@ -179,17 +423,86 @@ void _yield(void);
  * @task_entry : Pointer to the task's entry function (void func(void))
  * @stack_size : The desired stack size in bytes (minimum is enforced)
  *
- * Returns the new task's ID on success. Panics on memory allocation failure.
+ * Returns the new task's ID on success, ERR_STACK_ALLOC if the stack does
+ * not fit in the heap, or ERR_TCB_ALLOC if no TCB can be allocated or all
+ * TASK_MAX_TASKS - 1 task slots are in use.
  */
 int32_t mo_task_spawn(void *task_entry, uint16_t stack_size);
 
+/* Creates and starts a new task whose stack is taken from a fast heap
+ * region (HEAP_REGION_FAST) when one has room, and from ordinary memory
+ * otherwise. Worth it for tasks whose stack traffic dominates, such as
+ * interrupt-driven workers. Parameters and return value as mo_task_spawn().
+ */
+int32_t mo_task_spawn_fast(void *task_entry, uint16_t stack_size);
+
+/* Creates and starts a new task in caller-provided storage.
+ * Nothing is allocated from the heap, so the memory footprint is fixed at
+ * link time and spawning takes deterministic time. The caller chooses where
+ * the storage lives (e.g. with a section attribute). Both objects must stay
+ * valid until the task is cancelled; mo_task_cancel() never frees them, after
+ * which they may be reused for a new task.
+ * @tcb        : Storage for the task control block
+ * @stack      : Stack memory, at least 4-byte aligned
+ * @stack_size : Size of @stack in bytes (at least MIN_TASK_STACK_SIZE)
+ * @task_entry : Pointer to the task's entry function (void func(void))
+ *
+ * Returns the new task's ID on success, ERR_TASK_INVALID_ENTRY or
+ * ERR_STACK_ALLOC for invalid arguments, or ERR_TCB_ALLOC if all task slots
+ * are in use. Never panics.
+ */
+int32_t mo_task_spawn_static(tcb_t *tcb,
+                             void *stack,
+                             size_t stack_size,
+                             void *task_entry);
+
+/* Creates and starts a new task with a private arena of @arena_size bytes.
+ * The arena shares one heap block with the stack, so cancelling the task
+ * releases both with a single free(), together with everything the task
+ * took from the arena through mo_task_alloc().
+ * @task_entry : Pointer to the task's entry function (void func(void))
+ * @stack_size : The desired stack size in bytes (minimum is enforced)
+ * @arena_size : Bytes of arena, rounded down to a whole word
+ *
+ * Returns the new task's ID on success, or an error like mo_task_spawn().
+ */
+int32_t mo_task_spawn_arena(void *task_entry,
+                            uint16_t stack_size,
+                            uint32_t arena_size);
+
 /* Cancels and removes a task from the system. A task cannot cancel itself.
+ * A task's stack and arena are freed along with it, unless it was spawned
+ * with mo_task_spawn_static(). With CONFIG_TASK_RECYCLE, a task without an
+ * arena may instead be kept, TCB and stack, for the next spawn of a similar
+ * stack size; its ID is retired either way and never matches the new task.
  * @id : The ID of the task to cancel
  *
  * Returns 0 on success, or a negative error code
  */
 int32_t mo_task_cancel(uint16_t id);
 
+/* Frees the TCBs and stacks that mo_task_cancel() kept for reuse, e.g.
+ * before a large allocation. A spawn that finds the heap full does the same
+ * on its own before giving up.
+ */
+void mo_task_recycle_flush(void);
+
+/* Per-Task Arena Allocation */
+
+/* Allocates @size bytes from the calling task's arena in constant time.
+ * The memory is word-aligned and not cleared, and is only released as a
+ * whole by mo_task_arena_reset() or when the task is cancelled. Task
+ * context only.
+ *
+ * Returns the memory, or NULL if the task has no arena or too little room
+ */
+void *mo_task_alloc(uint32_t size);
+
+/* Releases everything the calling task allocated from its arena, e.g. at
+ * the end of each iteration of a worker loop.
+ */
+void mo_task_arena_reset(void);
+
 /* Task Scheduling Control */
 
 /* Voluntarily yields the CPU, allowing the scheduler to run another task */
@@ -197,9 +510,34 @@ void mo_task_yield(void);
 
 /* Blocks the current task for a specified number of system ticks.
  * @ticks : The number of system ticks to sleep. The task will be unblocked
- *          after this duration has passed.
+ *          after this duration has passed. In cooperative mode each yield
+ *          in the system advances the sleep clock by one tick.
  */
-void mo_task_delay(uint16_t ticks);
+void mo_task_delay(uint32_t ticks);
+
+/* Blocks the current task until an absolute release tick, for periodic
+ * jobs whose phase must not drift. The job released at *@last_wake ends
+ * here; the next is due one @period later. Whole periods that have already
+ * passed are skipped, keeping the phase, and the job that overran them is
+ * counted as a miss and reported to the hook set by mo_task_miss_hook().
+ * @last_wake : Release tick of the current job, advanced to the next one.
+ *              Initialize it with mo_ticks() before the first call.
+ * @period    : Ticks between releases (must be > 0)
+ *
+ * Returns ERR_OK after sleeping until the release, ERR_TIMEOUT if it had
+ * already passed and the next job starts at once, or ERR_FAIL on invalid
+ * arguments
+ */
+int32_t mo_task_delay_until(uint32_t *last_wake, uint32_t period);
+
+/* Called in the context of a task whose job overran its period, from its
+ * mo_task_delay_until() call, with the number of releases that were due
+ * meanwhile (at least 1). It may log or raise an alarm, but not block.
+ */
+typedef void (*task_miss_hook_t)(uint16_t id, uint32_t missed);
+
+/* Installs the deadline miss hook for all tasks, or removes it with NULL */
+void mo_task_miss_hook(task_miss_hook_t hook);
 
 /* Suspends a task, removing it from scheduling temporarily.
  * @id : The ID of the task to suspend. A task can suspend itself.
@@ -215,6 +553,52 @@ int32_t mo_task_suspend(uint16_t id);
  */
 int32_t mo_task_resume(uint16_t id);
 
+/* Direct-to-Task Notifications
+ *
+ * Every task has a 32-bit notification word in its TCB, so signalling a
+ * single known waiter needs no semaphore, no allocation and no wait queue.
+ * The word can carry event flags (NOTIFY_SET_BITS), a counter
+ * (NOTIFY_INCREMENT) or a value (NOTIFY_OVERWRITE).
+ */
+typedef enum {
+    NOTIFY_SET_BITS = 0,  /* OR @bits into the word */
+    NOTIFY_INCREMENT = 1, /* Add one to the word; @bits is ignored */
+    NOTIFY_OVERWRITE = 2, /* Replace the word with @bits */
+} notify_action_t;
+
+/* Timeout for mo_task_notify_wait() that never expires */
+#define NOTIFY_WAIT_FOREVER 0xFFFFFFFFU
+
+/* Updates a task's notification word and wakes the task if it is waiting
+ * for any of the bits that are now set.
+ * @id     : The ID of the task to notify
+ * @bits   : Operand of @action
+ * @action : How to update the word (notify_action_t)
+ *
+ * Returns ERR_OK, ERR_TASK_NOT_FOUND, or ERR_FAIL for an unknown action
+ */
+int32_t mo_task_notify(uint16_t id, uint32_t bits, notify_action_t action);
+
+/* Interrupt-handler variant of mo_task_notify(). Never blocks or switches;
+ * a wakeup that should preempt the interrupted task is run once the handler
+ * returns (see sched_isr_resched()).
+ *
+ * Returns ERR_OK, ERR_TASK_NOT_FOUND, or ERR_FAIL for an unknown action
+ */
+int32_t mo_task_notify_from_isr(uint16_t id,
+                                uint32_t bits,
+                                notify_action_t action);
+
+/* Waits until the caller's notification word has a bit of @mask set, then
+ * clears those bits and returns them. With NOTIFY_INCREMENT and a @mask of
+ * 0, this takes the whole count.
+ * @mask    : Bits to wait for; 0 means all bits
+ * @timeout : Ticks to wait; 0 polls, NOTIFY_WAIT_FOREVER never expires
+ *
+ * Returns the bits of @mask that were set, or 0 on timeout
+ */
+uint32_t mo_task_notify_wait(uint32_t mask, uint32_t timeout);
+
 /* Task Priority Management */
 
 /* Changes a task's base priority.
@@ -226,13 +610,56 @@ int32_t mo_task_resume(uint16_t id);
 int32_t mo_task_priority(uint16_t id, uint16_t priority);
 
 /* Assigns a task to a custom real-time scheduler.
+ * If the installed scheduler provides an admission hook (e.g. the built-in
+ * EDF/RM scheduler from <sys/rt.h>), the parameters are validated first.
  * @id       : The ID of the task to modify
- * @priority : Opaque pointer to custom priority data for the RT scheduler
+ * @priority : Opaque pointer to custom priority data for the RT scheduler,
+ *             or NULL to detach the task from it
  *
  * Returns 0 on success, or a negative error code
  */
 int32_t mo_task_rt_priority(uint16_t id, void *priority);
 
+/* CPU Budgets
+ *
+ * A budget caps how much CPU time its tasks get, whatever their priority,
+ * so a runaway task cannot starve the levels below it. Each tick charges
+ * one tick to the budget of the task it interrupts. Once a period's budget
+ * is spent, the scheduler blocks a task charged to it until the period
+ * ends, when the budget is replenished in full. A period starts at the
+ * first tick charged after the previous one has ended, so the tasks of a
+ * budget never run more than 2 * @budget ticks in any @period ticks.
+ *
+ * Several tasks may share one budget, which then caps the group. A task
+ * holding a mutex is not blocked until it has released all of them, so a
+ * throttled task never keeps a higher-priority waiter blocked; the ticks
+ * it overran are not carried into the next period. Ticks that arrive
+ * inside a NOSCHED section are not charged, and nothing is charged under
+ * cooperative scheduling, which has no tick.
+ *
+ * The first two fields are set by the application and the rest must be
+ * zero-initialized. The record must stay valid while attached.
+ */
+typedef struct task_budget {
+    uint32_t budget; /* Ticks of CPU time per period (0 < budget <= period) */
+    uint32_t period; /* Replenishment period, in ticks */
+
+    /* Maintained by the scheduler */
+    uint32_t start;     /* Tick the current period started at */
+    uint32_t used;      /* Ticks charged in the current period */
+    uint32_t throttles; /* Times a task was blocked for a spent budget */
+} task_budget_t;
+
+/* Attaches a task to a CPU budget, or detaches it with NULL. A throttled
+ * task stays blocked until its period ends. The idle task, which must
+ * always be runnable, must not be given a budget.
+ * @id     : The ID of the task to modify
+ * @budget : Budget to charge, possibly shared with other tasks, or NULL
+ *
+ * Returns ERR_OK, ERR_TASK_NOT_FOUND, or ERR_FAIL for an invalid budget
+ */
+int32_t mo_task_budget(uint16_t id, task_budget_t *budget);
+
 /* Task Information and Status */
 
 /* Gets the ID of the currently running task.
@@ -241,6 +668,79 @@ int32_t mo_task_rt_priority(uint16_t id, void *priority);
  */
 uint16_t mo_task_id(void);
 
+/* Per-Task CPU Statistics, as reported by mo_task_stats() */
+typedef struct {
+    uint16_t id;          /* Task ID */
+    uint8_t state;        /* Current lifecycle state */
+    uint8_t prio_level;   /* Effective priority level */
+    uint64_t run_time_us; /* Total time spent running, in microseconds */
+    uint32_t switches;    /* Times the task was switched in */
+    uint32_t preemptions; /* Times it was switched out while still runnable */
+    uint32_t arena_size;  /* Bytes in the task's arena, 0 if it has none */
+    uint32_t arena_peak;  /* Most arena bytes in use at once */
+    /* Performance counter totals indexed by HAL_PMU_CYCLES, HAL_PMU_INSTRET
+     * and HAL_PMU_EVENT(n); all zero unless CONFIG_TASK_PMU is set.
+     */
+    uint64_t pmu[HAL_PMU_SLOTS];
+} task_stats_t;
+
+/* Per-Task Response Times, as reported by mo_task_response()
+ * A job runs from its release, the tick mo_task_delay_until() slept until,
+ * to the task's next mo_task_delay_until() call. hist[0] counts jobs that
+ * took under 1 microsecond and hist[i] those taking [2^(i-1), 2^i) us; the
+ * last bucket also holds everything beyond. A task's first job is not
+ * timed, and one started late after a miss is timed from its start.
+ */
+typedef struct {
+    uint32_t jobs;   /* Jobs ended by mo_task_delay_until() */
+    uint32_t misses; /* Jobs that overran their period */
+    /* Longest response and histogram; zero unless CONFIG_TASK_RESPONSE */
+    uint32_t max_us;
+    uint32_t hist[TASK_RESP_BUCKETS];
+} task_response_t;
+
+/* Gets a task's periodic job statistics.
+ * @id   : The ID of the task to query
+ * @resp : Where to store the statistics
+ *
+ * Returns ERR_OK on success, or ERR_TASK_NOT_FOUND
+ */
+int32_t mo_task_response(uint16_t id, task_response_t *resp);
+
+/* Gets a task's CPU accounting.
+ * Run time is sampled from the machine timer at every context switch, so
+ * it covers all time a task owns the CPU, including any ISRs that interrupt
+ * it. The time of the running task is included up to the moment of the call.
+ * With CONFIG_TASK_PMU, the performance counters are charged the same way.
+ * @id    : The ID of the task to query
+ * @stats : Where to store the statistics
+ *
+ * Returns ERR_OK on success, or ERR_TASK_NOT_FOUND
+ */
+int32_t mo_task_stats(uint16_t id, task_stats_t *stats);
+
+/* Prints a top-like table of all tasks: state, priority, share of CPU time,
+ * run time, switches and preemptions, and with CONFIG_TASK_PMU the
+ * instructions retired per cycle.
+ */
+void mo_task_stats_dump(void);
+
+/* Gets the deepest stack usage a task has reached so far.
+ * Requires CONFIG_STACK_WATERMARK, which fills every stack with a pattern at
+ * spawn; the scan finds the lowest word the task has overwritten.
+ * @id : The ID of the task to query
+ *
+ * Returns the peak usage in bytes, ERR_TASK_NOT_FOUND, or ERR_FAIL when
+ * watermarking is disabled
+ */
+int32_t mo_task_stack_usage(uint16_t id);
+
+/* Prints each task's stack size, peak usage and a shrink-to-fit size (the
+ * peak plus headroom), followed by the total number of bytes that resizing
+ * every stack to its suggestion would save.
+ */
+void mo_task_stack_report(void);
+
 /* Gets a task's ID from its entry function pointer.
  * @task_entry : Pointer to the task's entry function
  *
@@ -256,25 +756,113 @@ uint16_t mo_task_count(void);
 
 /* System Time Functions */
 
-/* Gets the current value of the system tick counter */
+/* Gets the current value of the system tick counter. It wraps after 2^32
+ * ticks; compare values with tick_reached() or wrap-safe differences.
+ */
 uint32_t mo_ticks(void);
 
+/* Gets the system tick counter extended to 64 bits, which never wraps */
+uint64_t mo_ticks64(void);
+
 /* Gets the system uptime in milliseconds */
 uint64_t mo_uptime(void);
 
+/* Gets the time since boot in nanoseconds, read from the machine timer and
+ * so as fine as one of its cycles (see <sys/clock.h>)
+ */
+uint64_t mo_time_ns(void);
+
 /* Internal Kernel Primitives */
 
+/* Makes a task runnable and links it at the tail of its level's ready queue.
+ * Safe to call on a task that is already queued. Must be called with
+ * scheduling disabled (NOSCHED_ENTER or CRITICAL_ENTER).
+ * @task : The task to wake
+ */
+void sched_wakeup_task(tcb_t *task);
+
+/* Decides whether a task that was just woken should preempt the caller.
+ * True when the woken task is at a better priority level than the current
+ * task, or when a real-time scheduler hook is installed and must arbitrate.
+ * Wakeup paths call mo_task_yield() after leaving their critical section only
+ * when this returns true, so waking a lower-priority task costs no switch.
+ * @task : The task that was woken
+ *
+ * Returns true if the caller should yield
+ */
+bool sched_wakeup_preempts(const tcb_t *task);
+
+/* Interrupt-Context Wakeups
+ *
+ * The _from_isr calls never block or switch. Task context changes the ready
+ * queues and the sleep list under NOSCHED or CRITICAL only, so a handler may
+ * wake tasks itself only if it did not interrupt a NOSCHED section. When it
+ * did, or in cooperative mode, the object posts a deferred kick instead,
+ * which the interrupted task runs at its next switch point.
+ */
+
+/* Returns true if the running interrupt handler may wake tasks directly */
+static inline bool sched_isr_may_wake(void)
+{
+    return sched_preemptive() && !kcb->preempt_count;
+}
+
+/* Requests a reschedule from an interrupt handler whose wakeup should
+ * preempt the interrupted task, or that posted a kick. Raises this hart's
+ * software interrupt, which is taken right after the handler returns, or
+ * inside a NOSCHED section flags the outermost NOSCHED_LEAVE(). Does
+ * nothing in cooperative mode.
+ */
+void sched_isr_resched(void);
+
+/* Unlinks a task from its ready queue, if it is queued.
+ * @task : The task to remove
+ */
+void sched_dequeue_task(tcb_t *task);
+
+/* Blocks a task until @ticks system ticks from now.
+ * Sets the task's state to TASK_BLOCKED and links it into the sleep list.
+ * The tick handler wakes it on expiry unless sched_wakeup_task() wakes it
+ * first. Must be called with scheduling disabled.
+ * @task  : The task to put to sleep (normally the current task)
+ * @ticks : Relative timeout in system ticks
+ */
+void sched_delay_task(tcb_t *task, uint32_t ticks);
+
+/* Removes a task's pending timeout, if any, without changing its state.
+ * @task : The task whose timeout is cancelled
+ */
+void sched_cancel_delay(tcb_t *task);
+
+/* Changes a task's effective priority level, moving it to the matching
+ * ready queue if it is queued. The base level is left untouched; this is the
+ * primitive used by priority inheritance.
+ * @task  : The task to modify
+ * @level : New effective level (0-7)
+ */
+void sched_set_prio_level(tcb_t *task, uint8_t level);
+
+/* Picks the highest-priority ready task and makes it current.
+ *
+ * Returns the ID of the selected task. Panics if no task is runnable.
+ */
+uint16_t sched_select_next_task(void);
+
+/* Runs the reschedule deferred by a tick that arrived inside a NOSCHED
+ * section. Called by the outermost NOSCHED_LEAVE(); not for direct use.
+ */
+void _sched_resched(void);
+
 /* Atomically blocks the current task and invokes the scheduler.
  *
  * This internal kernel primitive is the basis for all blocking operations. It
- * must be called from within a NOSCHED_ENTER critical section. It enqueues the
- * current task, sets its state to blocked, and calls the scheduler. The
- * scheduler lock is NOT released by this function; it is released implicitly
- * when the kernel context switches to a new task.
+ * must be called from within an outermost NOSCHED_ENTER section. It enqueues
+ * the current task, sets its state to blocked, ends the NOSCHED section and
+ * calls the scheduler, so the caller must not call NOSCHED_LEAVE afterwards.
  *
  * @wait_q : The wait queue to which the current task will be added
  */
-void _sched_block(queue_t *wait_q);
+void _sched_block(wait_queue_t *wait_q);
 
 /* Application Entry Point */
 
@@ -4,10 +4,16 @@
  *
  * Provides software timers with callback functionality. Timers can operate
  * in one-shot or auto-reload modes and execute user-defined callbacks upon
- * expiration. All timers are managed by the kernel and serviced during
- * system timer interrupts.
+ * expiration. All timers are managed by the kernel; their callbacks run in
+ * a dedicated timer service task (see CONFIG_TIMER_DAEMON_PRIO).
+ *
+ * Armed timers sit in a hierarchical timing wheel, so starting, cancelling
+ * and expiring a timer all take constant time however many are armed. An
+ * auto-reload timer is re-armed from its previous deadline rather than from
+ * the time its callback ran, so its period does not drift.
  */
 
+#include <sys/clock.h>
 #include <types.h>
 
 /* Timer Operating Modes */
@@ -23,10 +29,11 @@ typedef enum {
  * structure is managed entirely by the kernel; user code interacts with
  * timers via their unique ID handles.
  */
-typedef struct {
+typedef struct timer {
     /* Timing Parameters */
     uint32_t deadline_ticks; /* Expiration time in absolute system ticks */
     uint32_t period_ms;      /* Reload period in milliseconds */
+    uint32_t period_ticks;   /* The same period in ticks, at least 1 */
 
     /* Timer Identification and State */
     uint16_t id;       /* Unique handle assigned by the kernel */
@@ -36,6 +43,15 @@ typedef struct {
     /* Callback Configuration */
     void *(*callback)(void *arg); /* Function to execute upon timer expiry */
     void *arg;                    /* User-defined argument passed to callback */
+
+    /* Service Task Accounting (see mo_timer_stats) */
+    uint32_t fires, overruns;
+    uint32_t max_late_ticks, max_run_cycles;
+
+    /* Kernel Links */
+    struct timer *next, *prev; /* Circular list of the wheel slot */
+    struct timer **slot;       /* Head of that slot, NULL while not armed */
+    struct timer *hash_next;   /* Chain of the ID hash bucket */
 } timer_t;
 
 /* Timer Management Functions */
@@ -70,7 +86,7 @@ int32_t mo_timer_destroy(uint16_t id);
 
 /* Starts or restarts a software timer.
  *
- * This function arms the timer and adds it to the active list. If the timer
+ * This function arms the timer on the kernel's timer wheel. If the timer
  * was already running, its deadline is recalculated and it is rescheduled.
  * The timer will fire after its configured period has elapsed.
  *
@@ -83,7 +99,7 @@ int32_t mo_timer_start(uint16_t id, uint8_t mode);
 
 /* Cancels a running software timer.
  *
- * This function disarms the timer and removes it from the active list. The
+ * This function disarms the timer and takes it off the timer wheel. The
  * timer object itself is not destroyed and can be restarted later with
  * 'mo_timer_start()'.
  *
@@ -94,13 +110,34 @@ int32_t mo_timer_start(uint16_t id, uint8_t mode);
  */
 int32_t mo_timer_cancel(uint16_t id);
 
+/* Per-Timer Statistics, as reported by mo_timer_stats() */
+typedef struct {
+    uint32_t fires;          /* Callbacks run so far */
+    uint32_t overruns;       /* Runs a whole period late or a period long */
+    uint32_t max_late_ticks; /* Worst delay from deadline to callback */
+    uint32_t max_run_us;     /* Longest callback, in microseconds */
+} timer_stats_t;
+
+/* Gets a timer's callback accounting, kept by the timer service task.
+ *
+ * A run counts as an overrun when the callback started one or more full
+ * periods after its deadline, or took at least one period to return; either
+ * way the timer could not keep up with its period.
+ *
+ * @id    : The ID of the timer to query
+ * @stats : Where to store the statistics
+ *
+ * Returns ERR_OK on success, or ERR_FAIL if the timer is not found
+ */
+int32_t mo_timer_stats(uint16_t id, timer_stats_t *stats);
+
 /* Timer Utility Macros */
 
 /* Convert milliseconds to system ticks.
  *
  * F_TIMER is the scheduler tick frequency (in Hz), which must be defined at
  * build-time. This calculation is performed with 64-bit integers to prevent
- * overflow with large millisecond values.
+ * overflow with large millisecond values, and with a precomputed reciprocal
+ * so that nothing is divided at run time (see <sys/clock.h>).
  */
-#define MS_TO_TICKS(ms) \
-    ((uint32_t) (((uint64_t) (ms) * (uint64_t) (F_TIMER)) / 1000U))
+#define MS_TO_TICKS(ms) ((uint32_t) mo_ms_to_ticks(ms))
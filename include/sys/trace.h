@@ -0,0 +1,59 @@
+#pragma once
+
+/* Scheduler Event Tracing
+ *
+ * A compile-time option (CONFIG_TRACE) that records scheduling activity as
+ * compact binary events in a fixed-size in-RAM ring buffer. Recording costs
+ * a timer read and a 12-byte store, without any formatting, so tracing can
+ * stay enabled under load without perturbing timing the way printf() does.
+ * When the buffer is full, the oldest events are overwritten.
+ *
+ * The buffer is emitted as text by mo_trace_dump(), either from an
+ * application drain task or automatically on kernel panic. The host script
+ * scripts/trace2json.py turns that output into a Chrome trace / Perfetto
+ * JSON timeline.
+ *
+ * With CONFIG_TRACE disabled, all hooks compile to nothing.
+ */
+
+#include <types.h>
+
+/* Event Types */
+enum trace_event_type {
+    TRACE_SWITCH = 1, /* Context switch: a = from task, b = to task */
+    TRACE_WAKEUP,     /* Task made ready: a = task */
+    TRACE_BLOCK,      /* Task blocked: a = task */
+    TRACE_TIMER,      /* Software timer fired: a = timer ID */
+    TRACE_ISR_ENTER,  /* Trap entry: aux = interrupt code, b = mcause */
+    TRACE_ISR_EXIT,   /* Trap exit: aux = interrupt code */
+    TRACE_MUTEX_WAIT, /* Mutex contention: a = waiter, b = owner task */
+};
+
+/* Trace Event Record (12 bytes) */
+typedef struct {
+    uint32_t ts;  /* Machine timer, low 32 bits (see hal_clock_read()) */
+    uint8_t type; /* Event type (enum trace_event_type) */
+    uint8_t aux;  /* Event-specific small argument */
+    uint16_t a;   /* Event-specific argument, usually a task ID */
+    uint32_t b;   /* Event-specific argument */
+} trace_event_t;
+
+#if CONFIG_TRACE
+/* Appends one event to the ring buffer. Safe to call from tasks and ISRs. */
+void _trace_record(uint8_t type, uint8_t aux, uint16_t a, uint32_t b);
+
+#define TRACE_EVENT(type, aux, a, b) \
+    _trace_record((type), (uint8_t) (aux), (uint16_t) (a), (uint32_t) (b))
+#else
+#define TRACE_EVENT(type, aux, a, b) \
+    do {                             \
+    } while (0)
+#endif
+
+/* Writes all buffered events to stdout and empties the buffer.
+ * The output is line based: a 'trace: begin' header carrying the timer
+ * frequency and the number of events lost to overwriting, one hex-encoded
+ * line per event in chronological order, and a 'trace: end' trailer.
+ * Does nothing when CONFIG_TRACE is disabled.
+ */
+void mo_trace_dump(void);
@@ -0,0 +1,83 @@
+#pragma once
+
+/* Work Queues
+ *
+ * A pool of worker tasks at one priority that run submitted jobs, so
+ * offloading a short job needs neither a task spawn nor a hand-built
+ * producer/consumer. A job is a function and its argument, copied by value
+ * into a bounded queue; submitting blocks while the queue is full.
+ *
+ * A submitter that wants to know when its job is done passes notification
+ * bits: the worker sets them in the submitter's notification word after
+ * the function returns, and mo_task_notify_wait() collects them.
+ *
+ * Jobs run to completion in the order they were queued, one per worker at
+ * a time; with several workers, jobs run concurrently and may finish out of
+ * order. Interrupt handlers hand work to task context with mo_defer_post()
+ * (<sys/defer.h>) instead.
+ *
+ * Work queues are built on copy-in message queues and need CONFIG_MQUEUE.
+ */
+
+#include <sys/mqueue.h>
+#include <sys/spinlock.h>
+
+/* Work Queue Descriptor */
+typedef struct {
+    mq_t *jobs;         /* Bounded job queue */
+    atomic_t completed; /* Jobs run to completion */
+    atomic_t stopped;   /* Workers that acknowledged destroy */
+    uint8_t count;      /* Number of workers */
+    uint16_t workers[]; /* Their task IDs */
+} workqueue_t;
+
+/* Timeout for mo_workqueue_submit() that never expires */
+#define WORKQUEUE_WAIT_FOREVER MQ_WAIT_FOREVER
+
+/* Creates a work queue and spawns its workers.
+ * @workers    : Number of worker tasks, at least 1
+ * @priority   : Their priority (one of the TASK_PRIO_* values)
+ * @depth      : Most jobs queued and not yet started
+ * @stack_size : Stack size of each worker, which every job runs on
+ *
+ * Returns the work queue, or NULL on invalid arguments or out of memory
+ */
+workqueue_t *mo_workqueue_create(uint8_t workers,
+                                 uint16_t priority,
+                                 uint16_t depth,
+                                 uint16_t stack_size);
+
+/* Stops the workers once the jobs already queued have run, cancels them
+ * and frees the queue. Blocks until then. Nothing may submit meanwhile.
+ * @wq : Work queue to destroy
+ *
+ * Returns ERR_OK, or ERR_FAIL on an invalid queue or if called from one of
+ * its own workers
+ */
+int32_t mo_workqueue_destroy(workqueue_t *wq);
+
+/* Queues a job, blocking while the queue is full (task context only).
+ * @wq        : Work queue
+ * @fn        : Function to run on a worker (must not be NULL)
+ * @arg       : Argument passed to @fn
+ * @done_bits : Set in the caller's notification word once @fn has
+ *              returned; 0 for no notification
+ * @timeout   : Ticks to wait for room; 0 does not block,
+ *              WORKQUEUE_WAIT_FOREVER never expires
+ *
+ * Returns ERR_OK, ERR_TIMEOUT if the queue is still full at the deadline,
+ * or ERR_FAIL on invalid arguments
+ */
+int32_t mo_workqueue_submit(workqueue_t *wq,
+                            void (*fn)(void *arg),
+                            void *arg,
+                            uint32_t done_bits,
+                            uint32_t timeout);
+
+/* Gets the number of jobs queued and not yet started.
+ * @wq : Work queue
+ */
+static inline int32_t mo_workqueue_pending(workqueue_t *wq)
+{
+    return wq ? mo_mq_items(wq->jobs) : 0;
+}
@@ -0,0 +1,266 @@
+/* Stackless coroutines.
+ *
+ * Only the host task touches the polling list and the timing wheel, so
+ * those need no lock. The ready FIFO, the live count and the transition out
+ * of CORO_WAITING are shared with mo_coro_start() and the wake calls, and
+ * are guarded by the scheduler lock with interrupts masked; the lock is
+ * never held while a body runs.
+ */
+
+#include <hal.h>
+#include <lib/libc.h>
+#include <sys/coro.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
+
+#include "private/error.h"
+#include "private/utils.h"
+
+#define WHEEL_MASK (CORO_WHEEL_SIZE - 1)
+
+/* Appends @co to the ready FIFO. Caller holds the lock. */
+static inline void ready_push(coro_sched_t *s, coro_t *co)
+{
+    co->state = CORO_READY;
+    co->next = NULL;
+    if (s->ready_tail)
+        s->ready_tail->next = co;
+    else
+        s->ready = co;
+    s->ready_tail = co;
+}
+
+/* Wakes the host task, if any, out of mo_task_notify_wait(). A body that
+ * wakes a sibling notifies its own host, which only costs an extra pass.
+ */
+static void host_kick(coro_sched_t *s, bool isr)
+{
+    uint16_t host = s->host;
+    if (!host)
+        return;
+    if (isr)
+        mo_task_notify_from_isr(host, CORO_NOTIFY_BIT, NOTIFY_SET_BITS);
+    else
+        mo_task_notify(host, CORO_NOTIFY_BIT, NOTIFY_SET_BITS);
+}
+
+void mo_coro_sched_init(coro_sched_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    spin_lock_init(&s->lock);
+    s->tick = mo_ticks();
+}
+
+int32_t mo_coro_start(coro_sched_t *s, coro_t *co, coro_fn_t fn, void *arg)
+{
+    if (unlikely(!s || !co || !fn))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&s->lock);
+    if (co->state != CORO_IDLE) {
+        spin_unlock_irqrestore(&s->lock, flags);
+        return ERR_FAIL;
+    }
+
+    co->fn = fn;
+    co->arg = arg;
+    co->sched = s;
+    co->resume = 0;
+    co->signaled = 0;
+    s->count++;
+    ready_push(s, co);
+    spin_unlock_irqrestore(&s->lock, flags);
+
+    host_kick(s, false);
+    return ERR_OK;
+}
+
+static int32_t coro_wake(coro_t *co, bool isr)
+{
+    if (unlikely(!co || !co->sched))
+        return ERR_FAIL;
+
+    coro_sched_t *s = co->sched;
+    bool kick = false;
+    uint32_t flags = spin_lock_irqsave(&s->lock);
+
+    if (co->state == CORO_IDLE) {
+        spin_unlock_irqrestore(&s->lock, flags);
+        return ERR_FAIL;
+    }
+    if (co->state == CORO_WAITING) {
+        ready_push(s, co);
+        kick = true;
+    } else {
+        co->signaled = 1;
+    }
+    spin_unlock_irqrestore(&s->lock, flags);
+
+    if (kick)
+        host_kick(s, isr);
+    return ERR_OK;
+}
+
+int32_t mo_coro_wake(coro_t *co)
+{
+    return coro_wake(co, false);
+}
+
+int32_t mo_coro_wake_from_isr(coro_t *co)
+{
+    return coro_wake(co, true);
+}
+
+/* Files a sleeper under its wake tick, or readies it if that has passed */
+static void wheel_add(coro_sched_t *s, coro_t *co)
+{
+    if ((int32_t) (co->wake - s->tick) <= 0) {
+        uint32_t flags = spin_lock_irqsave(&s->lock);
+        ready_push(s, co);
+        spin_unlock_irqrestore(&s->lock, flags);
+        return;
+    }
+
+    coro_t **slot = &s->wheel[co->wake & WHEEL_MASK];
+    co->next = *slot;
+    *slot = co;
+}
+
+/* Advances the wheel to @now, moving due sleepers onto @due.
+ * A sleeper more than one revolution away stays in its slot until a later
+ * revolution reaches its tick.
+ */
+static void wheel_advance(coro_sched_t *s, uint32_t now, coro_t **due)
+{
+    uint32_t n = now - s->tick;
+    if (n > CORO_WHEEL_SIZE)
+        n = CORO_WHEEL_SIZE;
+
+    for (uint32_t t = now - n + 1; n; t++, n--) {
+        coro_t **link = &s->wheel[t & WHEEL_MASK];
+        while (*link) {
+            coro_t *co = *link;
+            if ((int32_t) (now - co->wake) >= 0) {
+                *link = co->next;
+                co->next = *due;
+                *due = co;
+            } else {
+                link = &co->next;
+            }
+        }
+    }
+    s->tick = now;
+}
+
+/* Ticks from now until the wheel's next occupied slot, or 0 if it is
+ * empty. The slot may hold only later revolutions; waking for it early
+ * just costs a pass.
+ */
+static uint32_t wheel_next(const coro_sched_t *s)
+{
+    uint32_t late = mo_ticks() - s->tick;
+
+    for (uint32_t i = 1; i <= CORO_WHEEL_SIZE; i++) {
+        if (s->wheel[(s->tick + i) & WHEEL_MASK])
+            return i > late ? i - late : 1;
+    }
+    return 0;
+}
+
+/* Files @co according to the state its body returned */
+static void coro_park(coro_sched_t *s, coro_t *co, coro_state_t next)
+{
+    uint32_t flags;
+
+    switch (next) {
+    case CORO_SLEEPING:
+        co->state = CORO_SLEEPING;
+        wheel_add(s, co);
+        return;
+    case CORO_POLLING:
+        co->state = CORO_POLLING;
+        co->next = s->polling;
+        s->polling = co;
+        return;
+    case CORO_WAITING:
+        flags = spin_lock_irqsave(&s->lock);
+        if (co->signaled) {
+            co->signaled = 0;
+            ready_push(s, co);
+        } else {
+            co->state = CORO_WAITING;
+        }
+        spin_unlock_irqrestore(&s->lock, flags);
+        return;
+    case CORO_IDLE:
+        flags = spin_lock_irqsave(&s->lock);
+        co->state = CORO_IDLE;
+        s->count--;
+        spin_unlock_irqrestore(&s->lock, flags);
+        return;
+    default: /* CORO_READY, or a bad value: run again next pass */
+        flags = spin_lock_irqsave(&s->lock);
+        ready_push(s, co);
+        spin_unlock_irqrestore(&s->lock, flags);
+        return;
+    }
+}
+
+static void run_list(coro_sched_t *s, coro_t *co, uint32_t *ran)
+{
+    while (co) {
+        coro_t *next = co->next;
+        co->state = CORO_RUNNING;
+        coro_park(s, co, co->fn(co));
+        (*ran)++;
+        co = next;
+    }
+}
+
+uint32_t mo_coro_poll(coro_sched_t *s)
+{
+    uint32_t ran = 0;
+    coro_t *due = NULL;
+
+    wheel_advance(s, mo_ticks(), &due);
+
+    /* Detach this pass's work, so bodies that yield run again next pass */
+    coro_t *polling = s->polling;
+    s->polling = NULL;
+
+    uint32_t flags = spin_lock_irqsave(&s->lock);
+    coro_t *ready = s->ready;
+    s->ready = s->ready_tail = NULL;
+    spin_unlock_irqrestore(&s->lock, flags);
+
+    run_list(s, ready, &ran);
+    run_list(s, due, &ran);
+    run_list(s, polling, &ran);
+    return ran;
+}
+
+void mo_coro_run(coro_sched_t *s)
+{
+    s->host = mo_task_id();
+
+    while (s->count) {
+        mo_coro_poll(s);
+
+        uint32_t timeout;
+        if (s->ready) {
+            /* Let other tasks of this priority in between passes */
+            mo_task_yield();
+            continue;
+        }
+        if (s->polling)
+            timeout = 1;
+        else if (!(timeout = wheel_next(s)))
+            timeout = NOTIFY_WAIT_FOREVER;
+
+        /* A wake since the pass left the bit set, so none is lost */
+        if (s->count)
+            mo_task_notify_wait(CORO_NOTIFY_BIT, timeout);
+    }
+
+    s->host = 0;
+}
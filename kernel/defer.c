@@ -0,0 +1,111 @@
+/* Deferred work queue.
+ *
+ * A singly linked FIFO of caller-owned items. Posting and detaching the
+ * pending batch take the queue lock with interrupts masked, which is the
+ * only interrupt latency this adds; work functions run unlocked, with only
+ * preemption held off, so every task's next switch point finds the queue
+ * free to drain again.
+ */
+
+#include <hal.h>
+#include <lib/libc.h>
+#include <sys/defer.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
+
+#include "private/error.h"
+#include "private/utils.h"
+
+static struct {
+    defer_work_t *head, *tail;
+    spinlock_t lock;
+    volatile bool running; /* A batch is running; guards against re-entry */
+    volatile bool resched; /* A work function asked for a reschedule */
+} defer_q = {NULL, NULL, SPINLOCK_INIT, false, false};
+
+void mo_defer_init(defer_work_t *work, void (*fn)(void *arg), void *arg)
+{
+    work->next = NULL;
+    work->fn = fn;
+    work->arg = arg;
+    work->pending = false;
+}
+
+int32_t mo_defer_post(defer_work_t *work)
+{
+    if (unlikely(!work || !work->fn))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&defer_q.lock);
+
+    if (!work->pending) {
+        work->pending = true;
+        work->next = NULL;
+        if (defer_q.tail)
+            defer_q.tail->next = work;
+        else
+            defer_q.head = work;
+        defer_q.tail = work;
+    }
+
+    spin_unlock_irqrestore(&defer_q.lock, flags);
+    return ERR_OK;
+}
+
+void mo_defer_resched(void)
+{
+    defer_q.resched = true;
+}
+
+bool _defer_pending(void)
+{
+    return defer_q.head != NULL;
+}
+
+bool _defer_drain(void)
+{
+    /* Unlocked peek: the common case is an empty queue */
+    if (likely(!defer_q.head))
+        return false;
+
+    uint32_t flags = spin_lock_irqsave(&defer_q.lock);
+    if (defer_q.running) {
+        spin_unlock_irqrestore(&defer_q.lock, flags);
+        return false;
+    }
+
+    /* Detach the current batch so the work done here stays bounded */
+    defer_work_t *work = defer_q.head;
+    defer_q.head = defer_q.tail = NULL;
+    defer_q.running = true;
+    spin_unlock_irqrestore(&defer_q.lock, flags);
+
+    /* A tick during the batch only flags the reschedule; it runs at the
+     * leave below, once the batch is done and the queue open again.
+     */
+    NOSCHED_ENTER();
+    while (work) {
+        defer_work_t *next = work->next;
+        void (*fn)(void *) = work->fn;
+        void *arg = work->arg;
+
+        /* Clear before running, so the item may be posted again (even by
+         * its own function) and the caller may reuse its storage.
+         */
+        work->pending = false;
+        fn(arg);
+        work = next;
+    }
+
+    bool resched = defer_q.resched;
+    defer_q.resched = false;
+    defer_q.running = false;
+    NOSCHED_LEAVE();
+    return resched;
+}
+
+void _defer_run(void)
+{
+    if (_defer_drain())
+        mo_task_yield();
+}
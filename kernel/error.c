@@ -19,6 +19,8 @@ static const struct error_code error_desc[] = {
     {ERR_TASK_INVALID_PRIO, "invalid task priority"},
     {ERR_TASK_BUSY, "resource busy"},
     {ERR_NOT_OWNER, "operation not permitted"},
+    {ERR_RT_PARAMS, "invalid real-time parameters"},
+    {ERR_RT_ADMISSION, "real-time admission rejected"},
 
     /* stack guard */
     {ERR_STACK_CHECK, "stack corruption"},
@@ -0,0 +1,126 @@
+/* High-resolution one-shot timers.
+ *
+ * Armed timers are kept on a single list sorted by deadline, so the head is
+ * always the next one due and expiry is O(1) per timer; arming walks the
+ * list, which stays short since hrtimers serve a few hard deadlines rather
+ * than general timeouts. The head's deadline is handed to the HAL, which
+ * multiplexes it with the scheduler tick on the timer compare register.
+ *
+ * The list is only touched with interrupts disabled, which also covers the
+ * expiry path: it runs from the timer trap, where they are already off.
+ */
+
+#include <hal.h>
+#include <sys/clock.h>
+#include <sys/hrtimer.h>
+
+#include "private/error.h"
+#include "private/utils.h"
+
+static hrtimer_t *hrt_head;
+
+static void hrt_unlink(hrtimer_t *t)
+{
+    hrtimer_t **link = &hrt_head;
+
+    while (*link != t)
+        link = &(*link)->next;
+    *link = t->next;
+    t->armed = false;
+}
+
+/* Inserts @t after any timer with the same deadline, keeping FIFO order */
+static void hrt_insert(hrtimer_t *t)
+{
+    hrtimer_t **link = &hrt_head;
+
+    while (*link && (*link)->expires <= t->expires)
+        link = &(*link)->next;
+    t->next = *link;
+    *link = t;
+    t->armed = true;
+}
+
+static inline void hrt_program(void)
+{
+    hal_hrtimer_program(hrt_head ? hrt_head->expires : UINT64_MAX);
+}
+
+/* Called from the timer trap once the programmed deadline has passed */
+void _hrtimer_expire(uint64_t now)
+{
+    hrtimer_t *t;
+
+    while ((t = hrt_head) && t->expires <= now) {
+        hrt_head = t->next;
+        t->armed = false;
+
+        /* The callback may re-arm this or any other timer */
+        t->fn(t->arg);
+    }
+
+    /* A deadline that passed while callbacks ran fires again at once */
+    hrt_program();
+}
+
+int32_t mo_hrtimer_init(hrtimer_t *t, void (*fn)(void *arg), void *arg)
+{
+    if (unlikely(!t || !fn))
+        return ERR_FAIL;
+
+    t->next = NULL;
+    t->expires = 0;
+    t->fn = fn;
+    t->arg = arg;
+    t->armed = false;
+    return ERR_OK;
+}
+
+/* Re-arms @t @us microseconds after now, or after its previous deadline */
+static int32_t hrt_arm(hrtimer_t *t, uint32_t us, bool from_now)
+{
+    if (unlikely(!t || !t->fn))
+        return ERR_FAIL;
+
+    int32_t irq = hal_interrupt_set(0);
+    bool was_head = hrt_head == t;
+    if (t->armed)
+        hrt_unlink(t);
+
+    uint64_t base = from_now ? hal_clock_read64() : t->expires;
+    t->expires = base + mo_us_to_cycles(us);
+    hrt_insert(t);
+    if (was_head || hrt_head == t)
+        hrt_program();
+    hal_interrupt_set(irq);
+    return ERR_OK;
+}
+
+int32_t mo_hrtimer_start(hrtimer_t *t, uint32_t delay_us)
+{
+    return hrt_arm(t, delay_us, true);
+}
+
+int32_t mo_hrtimer_forward(hrtimer_t *t, uint32_t interval_us)
+{
+    return hrt_arm(t, interval_us, false);
+}
+
+int32_t mo_hrtimer_cancel(hrtimer_t *t)
+{
+    if (unlikely(!t))
+        return ERR_FAIL;
+
+    int32_t irq = hal_interrupt_set(0);
+    if (unlikely(!t->armed)) {
+        hal_interrupt_set(irq);
+        return ERR_FAIL;
+    }
+
+    bool was_head = hrt_head == t;
+    hrt_unlink(t);
+    if (was_head)
+        hrt_program();
+    hal_interrupt_set(irq);
+    return ERR_OK;
+}
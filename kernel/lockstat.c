@@ -0,0 +1,126 @@
+/* Lock contention statistics registry.
+ *
+ * The statistics live in the mutexes and semaphores themselves; this file
+ * only links the registered ones into a list, ranks them and prints them.
+ * The list lock masks interrupts, so that it may be taken from any context
+ * that destroys a lock, but it is held only while linking or while taking a
+ * snapshot; printing runs unlocked.
+ */
+
+#include <hal.h>
+#include <lib/libc.h>
+#include <sys/clock.h>
+#include <sys/lockstat.h>
+#include <sys/spinlock.h>
+
+#include "private/utils.h"
+
+#if CONFIG_LOCK_STATS
+
+static lock_stats_t *registry;
+static spinlock_t registry_lock = SPINLOCK_INIT;
+
+/* Returns the link pointing at @st, or NULL. Caller holds the lock. */
+static lock_stats_t **registry_find(lock_stats_t *st)
+{
+    lock_stats_t **link = &registry;
+    while (*link && *link != st)
+        link = &(*link)->next;
+    return *link ? link : NULL;
+}
+
+void _lock_stats_register(lock_stats_t *st, const char *name)
+{
+    uint32_t flags = spin_lock_irqsave(&registry_lock);
+    st->name = name;
+    if (!registry_find(st)) {
+        st->next = registry;
+        registry = st;
+    }
+    spin_unlock_irqrestore(&registry_lock, flags);
+}
+
+void _lock_stats_unregister(lock_stats_t *st)
+{
+    uint32_t flags = spin_lock_irqsave(&registry_lock);
+    lock_stats_t **link = registry_find(st);
+    if (link)
+        *link = st->next;
+    st->next = NULL;
+    spin_unlock_irqrestore(&registry_lock, flags);
+}
+
+/* Cycles to microseconds, saturated to 32 bits */
+static uint32_t cycles_to_us(uint64_t cycles)
+{
+    uint64_t us = mo_cycles_to_us(cycles);
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t) us;
+}
+
+void mo_lock_stats_dump(uint32_t top)
+{
+    lock_stats_t snap[LOCK_STATS_TOP_MAX];
+    uint32_t n = 0, registered = 0;
+
+    if (top > LOCK_STATS_TOP_MAX)
+        top = LOCK_STATS_TOP_MAX;
+
+    /* Keep the @top hottest, sorted by total wait, by insertion. The rows
+     * are copied without their objects' locks, so one may be mid-update.
+     */
+    uint32_t flags = spin_lock_irqsave(&registry_lock);
+    for (lock_stats_t *st = registry; st; st = st->next) {
+        registered++;
+        uint32_t i = n < top ? n++ : top;
+        while (i > 0 && snap[i - 1].wait_total < st->wait_total) {
+            if (i < top)
+                snap[i] = snap[i - 1];
+            i--;
+        }
+        if (i < top)
+            snap[i] = *st;
+    }
+    spin_unlock_irqrestore(&registry_lock, flags);
+
+    printf("LOCK             KIND        ACQ      CONT  WAIT(us)   MAX(us)"
+           "  HOLD(us) HOLDER\n");
+    for (uint32_t i = 0; i < n; i++) {
+        const lock_stats_t *st = &snap[i];
+        printf("%16s %5s %9lu %9lu %9lu %9lu", st->name ? st->name : "?",
+               st->kind == LOCK_STAT_MUTEX ? "mutex" : "sem", st->acquired,
+               st->contended, cycles_to_us(st->wait_total),
+               cycles_to_us(st->wait_max));
+        if (st->kind == LOCK_STAT_MUTEX)
+            printf(" %9lu %6u\n", cycles_to_us(st->hold_max),
+                   st->hold_max_tid);
+        else
+            printf("\n");
+    }
+    printf("%lu locks registered\n", registered);
+}
+
+void mo_lock_stats_reset(void)
+{
+    uint32_t flags = spin_lock_irqsave(&registry_lock);
+    for (lock_stats_t *st = registry; st; st = st->next) {
+        st->acquired = 0;
+        st->contended = 0;
+        st->wait_total = 0;
+        st->wait_max = 0;
+        st->hold_max = 0;
+        st->hold_max_tid = 0;
+    }
+    spin_unlock_irqrestore(&registry_lock, flags);
+}
+
+#else /* !CONFIG_LOCK_STATS */
+
+void mo_lock_stats_dump(uint32_t top)
+{
+    (void) top;
+    printf("Lock statistics disabled (CONFIG_LOCK_STATS=0)\n");
+}
+
+void mo_lock_stats_reset(void) {}
+
+#endif /* CONFIG_LOCK_STATS */
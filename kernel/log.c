@@ -0,0 +1,169 @@
+/* Deferred binary log ring.
+ *
+ * Records are stored by value in a power-of-two array indexed by
+ * free-running head and tail counters, the same scheme as the trace buffer.
+ * Recording only masks interrupts for the stores it performs; on this
+ * single-hart kernel that makes it atomic against every other logger
+ * without a lock.
+ */
+
+#include <hal.h>
+#include <lib/libc.h>
+#include <sys/log.h>
+#include <sys/task.h>
+
+#include "private/error.h"
+
+#if CONFIG_LOG
+
+#if CONFIG_LOG_RECORDS & (CONFIG_LOG_RECORDS - 1)
+#error "CONFIG_LOG_RECORDS must be a power of two"
+#endif
+
+#define LOG_MASK (CONFIG_LOG_RECORDS - 1)
+
+/* Machine timer cycles per microsecond, for printed timestamps */
+#define LOG_CYCLES_PER_US (F_CPU / 1000000 ? F_CPU / 1000000 : 1)
+
+static log_record_t log_buf[CONFIG_LOG_RECORDS];
+static uint32_t log_head; /* Next slot to write */
+static uint32_t log_tail; /* Oldest buffered record */
+static uint32_t log_lost; /* Records overwritten before being read */
+static uint32_t log_period;
+
+void _log_record(const char *fmt,
+                 uint32_t nargs,
+                 uint32_t a,
+                 uint32_t b,
+                 uint32_t c,
+                 uint32_t d)
+{
+    int32_t irq = hal_interrupt_set(0);
+
+    log_record_t *r = &log_buf[log_head & LOG_MASK];
+    r->fmt = fmt;
+    r->ts = hal_clock_read();
+    r->task = kcb->task_current ? kcb->task_current->id : 0;
+    r->nargs = (uint8_t) nargs;
+    r->args[0] = a;
+    r->args[1] = b;
+    r->args[2] = c;
+    r->args[3] = d;
+
+    /* Full: drop the oldest record */
+    if (++log_head - log_tail > CONFIG_LOG_RECORDS) {
+        log_tail++;
+        log_lost++;
+    }
+
+    if (irq)
+        _ei();
+}
+
+/* Takes the oldest record out of the ring. Returns false if it is empty. */
+static bool log_pop(log_record_t *out)
+{
+    int32_t irq = hal_interrupt_set(0);
+    bool found = log_tail != log_head;
+    if (found)
+        *out = log_buf[log_tail++ & LOG_MASK];
+    if (irq)
+        _ei();
+    return found;
+}
+
+int32_t mo_log_flush(void)
+{
+    log_record_t r;
+    int32_t count = 0;
+
+    while (log_pop(&r)) {
+        printf("[%lu %u] ", r.ts / LOG_CYCLES_PER_US, r.task);
+        printf(r.fmt, r.args[0], r.args[1], r.args[2], r.args[3]);
+        printf("\n");
+        count++;
+    }
+    return count;
+}
+
+int32_t mo_log_read(log_record_t *out, uint32_t max)
+{
+    if (unlikely(!out))
+        return 0;
+
+    uint32_t count = 0;
+    while (count < max && log_pop(&out[count]))
+        count++;
+    return (int32_t) count;
+}
+
+void mo_log_dump(void)
+{
+    log_record_t r;
+
+    printf("log: begin hz=%lu lost=%lu\n", (uint32_t) F_CPU, log_lost);
+    while (log_pop(&r))
+        printf("log: %08lx %08lx %04x %u %08lx %08lx %08lx %08lx\n",
+               (uint32_t) r.fmt, r.ts, r.task, r.nargs, r.args[0], r.args[1],
+               r.args[2], r.args[3]);
+    printf("log: end\n");
+}
+
+uint32_t mo_log_lost(void)
+{
+    int32_t irq = hal_interrupt_set(0);
+    uint32_t lost = log_lost;
+    log_lost = 0;
+    if (irq)
+        _ei();
+    return lost;
+}
+
+static void log_task(void)
+{
+    while (1) {
+        mo_log_flush();
+        mo_task_delay(log_period);
+    }
+}
+
+int32_t mo_log_start(uint32_t period)
+{
+    if (unlikely(!period || log_period))
+        return ERR_FAIL;
+
+    log_period = period;
+    int32_t id = mo_task_spawn(log_task, DEFAULT_STACK_SIZE);
+    if (id < 0) {
+        log_period = 0;
+        return id;
+    }
+    mo_task_priority((uint16_t) id, TASK_PRIO_LOW);
+    return id;
+}
+
+#else /* !CONFIG_LOG */
+
+int32_t mo_log_flush(void)
+{
+    return 0;
+}
+
+int32_t mo_log_read(log_record_t *out, uint32_t max)
+{
+    return 0;
+}
+
+void mo_log_dump(void) {}
+
+uint32_t mo_log_lost(void)
+{
+    return 0;
+}
+
+int32_t mo_log_start(uint32_t period)
+{
+    return ERR_FAIL;
+}
+
+#endif /* CONFIG_LOG */
@@ -22,9 +22,23 @@ int32_t main(void)
     mo_heap_init((void *) &_heap_start, (size_t) &_heap_size);
     printf("Heap initialized, %u bytes available\n",
            (unsigned int) (size_t) &_heap_size);
+    if (mo_heap_add_region((void *) &_fast_heap_start,
+                           (size_t) &_fast_heap_size, HEAP_REGION_FAST) > 0)
+        printf("Fast heap region, %u bytes\n",
+               (unsigned int) (size_t) &_fast_heap_size);
+
+    /* The console buffers come from the heap */
+    hal_console_init();
 
     /* Call the application's main entry point to create initial tasks. */
-    kcb->preemptive = (bool) app_main();
+    bool preemptive = (bool) app_main();
+#if CONFIG_SCHED_MODE != SCHED_MODE_RUNTIME
+    /* The mode was fixed at build time */
+    if (preemptive != sched_preemptive())
+        printf("Note: CONFIG_SCHED_MODE overrides app_main()'s choice\n");
+    preemptive = sched_preemptive();
+#endif
+    kcb->preemptive = preemptive;
     printf("Scheduler mode: %s\n",
            kcb->preemptive ? "Preemptive" : "Cooperative");
 
@@ -41,13 +55,26 @@ int32_t main(void)
     setjmp(kcb->context);
 
     /* Launch the first task.
-     * 'kcb->task_current' was set by the first call to mo_task_spawn.
-     * This function transfers control and does not return.
+     * Pick the highest-priority ready task so it leaves the ready queues and
+     * enters the RUNNING state like any other scheduled task. This function
+     * transfers control and does not return.
      */
-    tcb_t *first_task = kcb->task_current->data;
+    sched_select_next_task();
+    tcb_t *first_task = kcb->task_current;
     if (!first_task)
         panic(ERR_NO_TASKS);
 
+    /* Start CPU accounting with the first task switched in */
+    kcb->switch_stamp = hal_clock_read();
+#if CONFIG_TASK_PMU
+    hal_pmu_sample(kcb->pmu_stamp);
+#endif
+    first_task->switches++;
+
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_PMP
+    hal_stack_guard_set(first_task->stack);
+#endif
+
     hal_dispatch_init(first_task->context);
 
     /* This line should be unreachable. */
@@ -1,25 +1,166 @@
-/* message queues backed by the generic queue_t */
+/* message queues backed by the generic queue_t
+ *
+ * A lock-free queue keeps its messages in an mpmc_queue_t instead, so a
+ * sender that finds room and a receiver that finds a message take no lock
+ * and mask no interrupts. The lock then only guards the wait queues. Each
+ * side checks for waiters on the other side after its own operation, and a
+ * task about to sleep retries its operation after linking itself onto its
+ * wait queue; with a fence on both sides, one of the two always sees the
+ * other, so no wakeup is lost.
+ *
+ * A copy-in queue queues pointers to slots of its slab. A sender takes a
+ * slot off the free list, fills it with interrupts enabled and queues it; a
+ * receiver dequeues it, copies it out and puts it back. Senders therefore
+ * wait for a free slot rather than for room in the queue, and are woken
+ * when a slot is returned.
+ */
 
+#include <lib/libc.h>
 #include <lib/malloc.h>
 #include <lib/queue.h>
+#include <lib/slab.h>
 
 #include <sys/mqueue.h>
+#include <sys/spinlock.h>
 #include <sys/task.h>
+#include <sys/trace.h>
 
 #include "private/error.h"
 #include "private/utils.h"
 
+#if CONFIG_MQUEUE
+
+static void mq_isr_kick(void *arg);
+
+static slab_cache_t mq_cache = SLAB_CACHE_INIT_HINT("mqueue", mq_t, MEM_FAST);
+
+static inline bool mq_is_valid(const mq_t *mq)
+{
+    return mq && (mq->q || mq->lf);
+}
+
+/* FIFO holding messages of priority @prio */
+static inline queue_t *mq_level(const mq_t *mq, uint8_t prio)
+{
+    return prio ? mq->prio_q[prio - 1] : mq->q;
+}
+
+/* Destroy the queues of levels 0..@levels-1 */
+static void mq_free_levels(mq_t *mq, uint8_t levels)
+{
+    for (uint8_t l = 0; l < levels; l++)
+        queue_destroy(mq_level(mq, l));
+    free(mq->prio_q);
+}
+
+/* Set up the blocking and polling state shared by all queue kinds */
+static void mq_init_waits(mq_t *mq)
+{
+    mq->pollers = NULL;
+    wq_init(&mq->senders);
+    wq_init(&mq->receivers);
+    mo_defer_init(&mq->isr_work, mq_isr_kick, mq);
+    spin_lock_init(&mq->lock);
+}
+
+static mq_t *mq_create(uint16_t max_items, uint8_t levels, uint16_t msg_size)
+{
+    if (unlikely(!levels || levels > MQ_PRIO_MAX))
+        return NULL;
+
+    mq_t *mq = slab_alloc(&mq_cache);
+    if (unlikely(!mq))
+        return NULL;
+
+    mq->slab = NULL;
+    mq->free_slots = NULL;
+    mq->msg_size = msg_size;
+    mq->lf = NULL;
+    mq->prio_q = NULL;
+    if (levels > 1) {
+        mq->prio_q = calloc(levels - 1, sizeof(queue_t *));
+        if (unlikely(!mq->prio_q)) {
+            slab_free(&mq_cache, mq);
+            return NULL;
+        }
+    }
+
+    /* Every level can hold the full capacity, so any mix of priorities fits */
+    for (uint8_t l = 0; l < levels; l++) {
+        queue_t *q = queue_create(max_items);
+        if (unlikely(!q)) {
+            mq_free_levels(mq, l);
+            slab_free(&mq_cache, mq);
+            return NULL;
+        }
+        if (l)
+            mq->prio_q[l - 1] = q;
+        else
+            mq->q = q;
+    }
+
+    mq->levels = levels;
+    mq->count = 0;
+    mq->capacity = mq->q->mask; /* queue_t holds one less than its size */
+
+    if (msg_size) {
+        /* Word-sized, word-aligned slots: a free slot holds the link */
+        size_t slot = (msg_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+        mq->slab = malloc_region(slot * mq->capacity, MEM_BULK);
+        if (unlikely(!mq->slab)) {
+            mq_free_levels(mq, levels);
+            slab_free(&mq_cache, mq);
+            return NULL;
+        }
+        for (uint16_t i = mq->capacity; i-- > 0;) {
+            void **link = (void **) (mq->slab + i * slot);
+            *link = mq->free_slots;
+            mq->free_slots = link;
+        }
+    }
+
+    mq_init_waits(mq);
+    return mq;
+}
+
 mq_t *mo_mq_create(uint16_t max_items)
 {
-    mq_t *mq = malloc(sizeof *mq);
+    return mq_create(max_items, 1, 0);
+}
+
+mq_t *mo_mq_create_prio(uint16_t max_items, uint8_t levels)
+{
+    return mq_create(max_items, levels, 0);
+}
+
+mq_t *mo_mq_create_fixed(uint16_t max_items, uint16_t msg_size, uint8_t levels)
+{
+    if (unlikely(!msg_size))
+        return NULL;
+    return mq_create(max_items, levels, msg_size);
+}
+
+mq_t *mo_mq_create_lockfree(uint16_t max_items)
+{
+    mq_t *mq = slab_alloc(&mq_cache);
     if (unlikely(!mq))
         return NULL;
 
-    mq->q = queue_create(max_items);
-    if (unlikely(!mq->q)) {
-        free(mq);
+    mq->lf = mpmc_create(max_items);
+    if (unlikely(!mq->lf)) {
+        slab_free(&mq_cache, mq);
         return NULL;
     }
+
+    mq->q = NULL;
+    mq->prio_q = NULL;
+    mq->levels = 1;
+    mq->count = 0; /* Unused: the MPMC positions give the count */
+    mq->capacity = mq->lf->mask + 1;
+    mq->slab = NULL;
+    mq->free_slots = NULL;
+    mq->msg_size = 0;
+    mq_init_waits(mq);
     return mq;
 }
 
@@ -28,65 +169,493 @@ int32_t mo_mq_destroy(mq_t *mq)
     if (unlikely(!mq))
         return ERR_OK; /* Destroying NULL is no-op */
 
-    if (unlikely(!mq->q))
+    if (unlikely(!mq_is_valid(mq)))
         return ERR_FAIL; /* Invalid mqueue state */
 
-    CRITICAL_ENTER();
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
 
-    if (unlikely(queue_count(mq->q) != 0)) { /* refuse to destroy non-empty q */
-        CRITICAL_LEAVE();
+    if (unlikely(mo_mq_items(mq) != 0)) { /* refuse to destroy non-empty q */
+        spin_unlock_irqrestore(&mq->lock, flags);
         return ERR_MQ_NOTEMPTY;
     }
 
-    /* Safe to destroy now - no need to hold critical section */
-    CRITICAL_LEAVE();
+    /* Blocked tasks, or a pending kick, would be left on freed memory */
+    if (unlikely(!wq_empty(&mq->senders) || !wq_empty(&mq->receivers) ||
+                 mq->isr_work.pending)) {
+        spin_unlock_irqrestore(&mq->lock, flags);
+        return ERR_TASK_BUSY;
+    }
+
+    /* Safe to destroy now - no need to hold the lock */
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    if (mq->lf)
+        mpmc_destroy(mq->lf);
+    else
+        mq_free_levels(mq, mq->levels);
+    free(mq->slab);
+    slab_free(&mq_cache, mq);
+
+    return ERR_OK;
+}
+
+/* Wake the oldest task on @q, if any. Called with the queue lock held.
+ *
+ * Returns true if the woken task should preempt the caller
+ */
+static bool mq_wake_one(wait_queue_t *q)
+{
+    tcb_t *task = wq_pop(q);
+    if (!task)
+        return false;
+
+    sched_wakeup_task(task);
+    return sched_wakeup_preempts(task);
+}
+
+/* Queue @msg at @prio. Called with the lock held. */
+static bool mq_store(mq_t *mq, message_t *msg, uint8_t prio)
+{
+    if (mq->count >= mq->capacity)
+        return false;
+
+    queue_enqueue(mq_level(mq, prio), msg);
+    mq->count++;
+    return true;
+}
+
+/* Queue @msg at @prio and wake a receiver. Called with the lock held. */
+static bool mq_push(mq_t *mq, message_t *msg, uint8_t prio, bool *preempt)
+{
+    if (!mq_store(mq, msg, prio))
+        return false;
+
+    *preempt |= mq_wake_one(&mq->receivers);
+    if (mq->pollers)
+        *preempt |= _poll_wake(mq->pollers);
+    return true;
+}
+
+/* Deferred half of mo_mq_send_from_isr(): one receiver per queued message,
+ * plus the pollers.
+ */
+static void mq_isr_kick(void *arg)
+{
+    mq_t *mq = arg;
+    bool preempt = false;
+
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    int32_t items = mo_mq_items(mq);
+    for (int32_t n = items; n && !wq_empty(&mq->receivers); n--)
+        preempt |= mq_wake_one(&mq->receivers);
+    if (items && mq->pollers)
+        preempt |= _poll_wake(mq->pollers);
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    if (preempt)
+        mo_defer_resched();
+}
+
+/* Take the next message, highest priority first, and wake a sender unless
+ * this is a copy-in queue (see mq_put_slot()). Called with the lock held.
+ */
+static message_t *mq_pop(mq_t *mq, bool *preempt)
+{
+    if (!mq->count)
+        return NULL;
+
+    uint8_t prio = mq->levels;
+    queue_t *q;
+    do {
+        q = mq_level(mq, --prio);
+    } while (queue_is_empty(q));
+
+    mq->count--;
+    if (!mq->slab)
+        *preempt |= mq_wake_one(&mq->senders);
+    return queue_dequeue(q);
+}
+
+/* Copy-in slots; called with the lock held */
+static void *mq_get_slot(mq_t *mq)
+{
+    void **slot = mq->free_slots;
+    if (slot)
+        mq->free_slots = *slot;
+    return slot;
+}
+
+static bool mq_put_slot(mq_t *mq, void *slot)
+{
+    *(void **) slot = mq->free_slots;
+    mq->free_slots = slot;
+    return mq_wake_one(&mq->senders);
+}
+
+/* Sleep on @q until woken or until @deadline, unless @timeout is
+ * MQ_WAIT_FOREVER. Called and returns with the lock held; @flags carries the
+ * saved interrupt state across.
+ *
+ * Returns false without sleeping if the deadline has already passed
+ */
+static bool mq_block(mq_t *mq,
+                     wait_queue_t *q,
+                     uint32_t timeout,
+                     uint32_t deadline,
+                     uint32_t *flags)
+{
+    tcb_t *self = kcb->task_current;
+    uint32_t now = mo_ticks();
+
+    if (timeout != MQ_WAIT_FOREVER && tick_reached(now, deadline))
+        return false;
+
+    wq_push(q, self);
+    if (timeout == MQ_WAIT_FOREVER) {
+        self->state = TASK_BLOCKED;
+        TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+    } else {
+        sched_delay_task(self, deadline - now);
+    }
+    spin_unlock_irqrestore(&mq->lock, *flags);
+
+    mo_task_yield();
+
+    *flags = spin_lock_irqsave(&mq->lock);
+    /* Still queued after a timeout: withdraw */
+    wq_remove(q, self);
+    return true;
+}
+
+/* Lock-free Queues */
+
+/* After a lock-free transfer: wake a task waiting on the other side, and for
+ * a send the pollers too. The lock is only taken if there is someone.
+ *
+ * Returns true if the woken task should preempt the caller
+ */
+static bool mq_lf_wake(mq_t *mq, bool sent)
+{
+    wait_queue_t *q = sent ? &mq->receivers : &mq->senders;
+
+    hal_fence(); /* Our transfer is visible before we look for waiters */
+    if (wq_empty(q) && !(sent && mq->pollers))
+        return false;
+
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    bool preempt = mq_wake_one(q);
+    if (sent && mq->pollers)
+        preempt |= _poll_wake(mq->pollers);
+    spin_unlock_irqrestore(&mq->lock, flags);
+    return preempt;
+}
+
+/* One attempt at moving a message: *@msg in when @sending, out otherwise */
+static inline bool mq_lf_try(mq_t *mq, message_t **msg, bool sending)
+{
+    if (sending)
+        return mpmc_enqueue(mq->lf, *msg) == ERR_OK;
+    return (*msg = mpmc_dequeue(mq->lf)) != NULL;
+}
+
+/* Blocking transfer through a lock-free queue, with the same timeout rules
+ * as mq_block().
+ *
+ * Returns ERR_OK, or ERR_TIMEOUT if the deadline passed first
+ */
+static int32_t mq_lf_transfer(mq_t *mq,
+                              message_t **msg,
+                              bool sending,
+                              uint32_t timeout)
+{
+    wait_queue_t *q = sending ? &mq->senders : &mq->receivers;
+    tcb_t *self = kcb->task_current;
+    uint32_t deadline = mo_ticks() + timeout;
+
+    while (!mq_lf_try(mq, msg, sending)) {
+        uint32_t now = mo_ticks();
+        if (timeout != MQ_WAIT_FOREVER && tick_reached(now, deadline))
+            return ERR_TIMEOUT;
+
+        uint32_t flags = spin_lock_irqsave(&mq->lock);
+        wq_push(q, self);
+        hal_fence(); /* Linked in before the retry reads the queue */
+
+        /* The other side may have finished in the meantime and found
+         * nobody to wake
+         */
+        if (mq_lf_try(mq, msg, sending)) {
+            wq_remove(q, self);
+            spin_unlock_irqrestore(&mq->lock, flags);
+            break;
+        }
 
-    queue_destroy(mq->q);
-    free(mq);
+        if (timeout == MQ_WAIT_FOREVER) {
+            self->state = TASK_BLOCKED;
+            TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+        } else {
+            sched_delay_task(self, deadline - now);
+        }
+        spin_unlock_irqrestore(&mq->lock, flags);
+
+        mo_task_yield();
+
+        flags = spin_lock_irqsave(&mq->lock);
+        wq_remove(q, self); /* Still queued after a timeout: withdraw */
+        spin_unlock_irqrestore(&mq->lock, flags);
+    }
 
+    if (mq_lf_wake(mq, sending))
+        mo_task_yield();
     return ERR_OK;
 }
 
 int32_t mo_mq_enqueue(mq_t *mq, message_t *msg)
 {
-    if (unlikely(!mq || !mq->q || !msg))
+    if (unlikely(!mq_is_valid(mq) || mq->slab || !msg))
         return ERR_FAIL;
 
-    int32_t rc;
+    if (mq->lf) {
+        if (mpmc_enqueue(mq->lf, msg) != ERR_OK)
+            return ERR_FAIL;
+        if (mq_lf_wake(mq, true))
+            mo_task_yield();
+        return ERR_OK;
+    }
+
+    bool preempt = false;
 
-    CRITICAL_ENTER();
-    rc = queue_enqueue(mq->q, msg);
-    CRITICAL_LEAVE();
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    int32_t rc = mq_push(mq, msg, 0, &preempt) ? ERR_OK : ERR_FAIL;
+    spin_unlock_irqrestore(&mq->lock, flags);
 
+    if (preempt)
+        mo_task_yield();
     return rc; /* 0 on success, −1 on full */
 }
 
-/* remove oldest message (FIFO) */
+/* remove oldest message of the highest priority */
 message_t *mo_mq_dequeue(mq_t *mq)
 {
-    if (unlikely(!mq || !mq->q))
+    if (unlikely(!mq_is_valid(mq) || mq->slab))
         return NULL;
 
-    message_t *msg;
+    if (mq->lf) {
+        message_t *msg = mpmc_dequeue(mq->lf);
+        if (msg && mq_lf_wake(mq, false))
+            mo_task_yield();
+        return msg;
+    }
+
+    bool preempt = false;
 
-    CRITICAL_ENTER();
-    msg = queue_dequeue(mq->q);
-    CRITICAL_LEAVE();
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    message_t *msg = mq_pop(mq, &preempt);
+    spin_unlock_irqrestore(&mq->lock, flags);
 
+    if (preempt)
+        mo_task_yield();
     return msg; /* NULL when queue is empty */
 }
 
 /* inspect head without removing */
 message_t *mo_mq_peek(mq_t *mq)
 {
-    if (unlikely(!mq || !mq->q))
+    /* The head of a lock-free queue may be taken at any moment */
+    if (unlikely(!mq_is_valid(mq) || mq->slab || mq->lf))
         return NULL;
 
-    message_t *msg;
+    message_t *msg = NULL;
 
-    CRITICAL_ENTER();
-    msg = queue_peek(mq->q);
-    CRITICAL_LEAVE();
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    for (uint8_t prio = mq->levels; prio-- > 0 && !msg;)
+        msg = queue_peek(mq_level(mq, prio));
+    spin_unlock_irqrestore(&mq->lock, flags);
 
     return msg; /* NULL when queue is empty */
 }
+
+int32_t mo_mq_send(mq_t *mq, message_t *msg, uint8_t prio, uint32_t timeout)
+{
+    if (unlikely(!mq_is_valid(mq) || mq->slab || !msg || prio >= mq->levels))
+        return ERR_FAIL;
+
+    if (mq->lf)
+        return mq_lf_transfer(mq, &msg, true, timeout);
+
+    uint32_t deadline = mo_ticks() + timeout;
+    bool preempt = false;
+    int32_t rc = ERR_OK;
+
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    while (!mq_push(mq, msg, prio, &preempt)) {
+        if (!mq_block(mq, &mq->senders, timeout, deadline, &flags)) {
+            rc = ERR_TIMEOUT;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    if (preempt)
+        mo_task_yield();
+    return rc;
+}
+
+/* Receiver wakeup from an interrupt handler, inline when the scheduler
+ * allows it and deferred to mq_isr_kick() otherwise. Called with the lock
+ * held.
+ *
+ * Returns true if the handler should request a reschedule
+ */
+static bool mq_isr_wake(mq_t *mq)
+{
+    if (wq_empty(&mq->receivers) && !mq->pollers)
+        return false;
+
+    if (sched_isr_may_wake()) {
+        bool preempt = mq_wake_one(&mq->receivers);
+        if (mq->pollers)
+            preempt |= _poll_wake(mq->pollers);
+        return preempt;
+    }
+
+    mo_defer_post(&mq->isr_work);
+    return true;
+}
+
+int32_t mo_mq_send_from_isr(mq_t *mq, message_t *msg, uint8_t prio)
+{
+    if (unlikely(!mq_is_valid(mq) || mq->slab || !msg || prio >= mq->levels))
+        return ERR_FAIL;
+
+    bool resched = false;
+    int32_t rc = ERR_FAIL;
+    uint32_t flags;
+
+    if (mq->lf) {
+        if (mpmc_enqueue(mq->lf, msg) != ERR_OK)
+            return ERR_FAIL;
+        hal_fence();
+        if (wq_empty(&mq->receivers) && !mq->pollers)
+            return ERR_OK;
+
+        flags = spin_lock_irqsave(&mq->lock);
+        rc = ERR_OK;
+        resched = mq_isr_wake(mq);
+    } else {
+        flags = spin_lock_irqsave(&mq->lock);
+        if (mq_store(mq, msg, prio)) {
+            rc = ERR_OK;
+            resched = mq_isr_wake(mq);
+        }
+    }
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    if (resched)
+        sched_isr_resched();
+    return rc;
+}
+
+message_t *mo_mq_receive(mq_t *mq, uint32_t timeout)
+{
+    if (unlikely(!mq_is_valid(mq) || mq->slab))
+        return NULL;
+
+    message_t *msg;
+    if (mq->lf)
+        return mq_lf_transfer(mq, &msg, false, timeout) == ERR_OK ? msg : NULL;
+
+    uint32_t deadline = mo_ticks() + timeout;
+    bool preempt = false;
+
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    while (!(msg = mq_pop(mq, &preempt))) {
+        if (!mq_block(mq, &mq->receivers, timeout, deadline, &flags))
+            break;
+    }
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    if (preempt)
+        mo_task_yield();
+    return msg;
+}
+
+int32_t mo_mq_send_copy(mq_t *mq,
+                        const void *data,
+                        uint8_t prio,
+                        uint32_t timeout)
+{
+    if (unlikely(!mq || !mq->slab || !data || prio >= mq->levels))
+        return ERR_FAIL;
+
+    uint32_t deadline = mo_ticks() + timeout;
+    bool preempt = false;
+    void *slot;
+
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    while (!(slot = mq_get_slot(mq))) {
+        if (!mq_block(mq, &mq->senders, timeout, deadline, &flags)) {
+            spin_unlock_irqrestore(&mq->lock, flags);
+            return ERR_TIMEOUT;
+        }
+    }
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    /* The slot is ours alone until queued */
+    memcpy(slot, data, mq->msg_size);
+
+    /* Cannot fail: there are no more queued messages than slots */
+    flags = spin_lock_irqsave(&mq->lock);
+    mq_push(mq, slot, prio, &preempt);
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    if (preempt)
+        mo_task_yield();
+    return ERR_OK;
+}
+
+int32_t mo_mq_receive_copy(mq_t *mq, void *buf, uint32_t timeout)
+{
+    if (unlikely(!mq || !mq->slab || !buf))
+        return ERR_FAIL;
+
+    uint32_t deadline = mo_ticks() + timeout;
+    bool preempt = false;
+    void *slot;
+
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    while (!(slot = mq_pop(mq, &preempt))) {
+        if (!mq_block(mq, &mq->receivers, timeout, deadline, &flags)) {
+            spin_unlock_irqrestore(&mq->lock, flags);
+            return ERR_TIMEOUT;
+        }
+    }
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    memcpy(buf, slot, mq->msg_size);
+
+    flags = spin_lock_irqsave(&mq->lock);
+    preempt |= mq_put_slot(mq, slot);
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    if (preempt)
+        mo_task_yield();
+    return ERR_OK;
+}
+
+bool _mq_poll(void *obj, poll_link_t *link, bool attach)
+{
+    mq_t *mq = obj;
+    if (unlikely(!mq_is_valid(mq)))
+        return false;
+
+    uint32_t flags = spin_lock_irqsave(&mq->lock);
+    _poll_list_update(&mq->pollers, link, attach);
+    hal_fence(); /* Lock-free senders check 'pollers' after publishing */
+    bool ready = mq->lf ? !mpmc_is_empty(mq->lf) : mq->count > 0;
+    spin_unlock_irqrestore(&mq->lock, flags);
+
+    return ready;
+}
+
+#endif /* CONFIG_MQUEUE */
@@ -2,11 +2,19 @@
  *
  * This implementation provides non-recursive mutexes and condition variables
  * that are independent of the semaphore module.
+ *
+ * Mutexes implement priority inheritance. Each task keeps a singly linked
+ * list of the mutexes it owns and a pointer to the mutex it is blocked on.
+ * A task's effective level is the best of its base level and the levels of
+ * all waiters on the mutexes it holds. Whenever a waiter arrives or leaves,
+ * the change is propagated along the blocked_on -> owner chain, so nested
+ * ownership boosts every task in the chain.
  */
 
 #include <lib/libc.h>
 #include <sys/mutex.h>
 #include <sys/task.h>
+#include <sys/trace.h>
 
 #include "private/error.h"
 #include "private/utils.h"
@@ -14,14 +22,14 @@
 /* Validate mutex pointer and structure integrity */
 static inline bool mutex_is_valid(const mutex_t *m)
 {
-    return m && m->magic == MUTEX_MAGIC && m->waiters &&
+    return m && m->magic == MUTEX_MAGIC &&
            (m->owner_tid == 0 || m->owner_tid < UINT16_MAX);
 }
 
 /* Validate condition variable pointer and structure integrity */
 static inline bool cond_is_valid(const cond_t *c)
 {
-    return c && c->magic == COND_MAGIC && c->waiters;
+    return c && c->magic == COND_MAGIC;
 }
 
 /* Invalidate mutex during destruction to prevent reuse */
@@ -40,46 +48,194 @@ static inline void cond_invalidate(cond_t *c)
         c->magic = 0xDEADBEEF;
 }
 
-/* Remove current task from waiter list, avoiding the need to search through
- * the entire list.
+/* A waiter is normally BLOCKED. A timed waiter whose timeout already fired is
+ * READY but stays queued until it runs and removes itself; handing it the
+ * mutex or the signal at that point is still correct.
  */
-static bool remove_self_from_waiters(list_t *waiters)
+static inline bool waiter_state_valid(const tcb_t *t)
 {
-    if (unlikely(!waiters || !kcb || !kcb->task_current ||
-                 !kcb->task_current->data))
-        return false;
+    return t->state == TASK_BLOCKED || t->state == TASK_READY;
+}
 
-    tcb_t *self = kcb->task_current->data;
+/* Remove the current task from @waiters. Returns false if it had already
+ * been dequeued by a wakeup.
+ */
+static inline bool remove_self_from_waiters(wait_queue_t *waiters)
+{
+    return wq_remove(waiters, kcb->task_current);
+}
 
-    /* Search for and remove self from waiters list */
-    list_node_t *curr = waiters->head->next;
-    while (curr && curr != waiters->tail) {
-        if (curr->data == self) {
-            list_remove(waiters, curr);
-            free(curr);
-            return true;
-        }
-        curr = curr->next;
+/* Priority Inheritance
+ *
+ * All helpers below run with preemption disabled, either under a mutex lock
+ * (NOSCHED plus the object lock) or inside CRITICAL. The owner chain walk
+ * touches other mutexes and the ready queues without taking their locks;
+ * that is safe only while a single hart runs the kernel.
+ */
+
+/* Upper bound on the length of a blocked_on -> owner chain that is walked.
+ * Longer chains only arise from lock-order bugs; bounding the walk keeps
+ * the time spent with the scheduler locked deterministic.
+ */
+#define MUTEX_PI_MAX_DEPTH 16
+
+/* Best (numerically lowest) level among the tasks waiting on @m */
+static uint8_t mutex_top_waiter_level(const mutex_t *m)
+{
+    uint8_t level = TASK_PRIORITY_LEVELS;
+
+    for (tcb_t *waiter = m->waiters.head; waiter; waiter = waiter->wq_next) {
+        if (waiter->prio_level < level)
+            level = waiter->prio_level;
     }
-    return false;
+    return level;
 }
 
-/* Atomic block operation with enhanced error checking */
-static void mutex_block_atomic(list_t *waiters)
+/* Level @task should run at: its base level or any inherited level */
+static uint8_t pi_effective_level(const tcb_t *task)
 {
-    if (unlikely(!waiters || !kcb || !kcb->task_current ||
-                 !kcb->task_current->data))
-        panic(ERR_SEM_OPERATION);
+    uint8_t level = task->base_level;
+
+    for (mutex_t *m = task->held_mutexes; m; m = m->next_held) {
+        uint8_t top = mutex_top_waiter_level(m);
+        if (top < level)
+            level = top;
+    }
+    return level;
+}
+
+/* Recompute the effective level of @task and push the change down the chain
+ * of owners it is (transitively) blocked on. Stops at the first task whose
+ * level does not change.
+ */
+static void pi_propagate(tcb_t *task)
+{
+    for (int depth = 0; task && depth < MUTEX_PI_MAX_DEPTH; depth++) {
+        uint8_t level = pi_effective_level(task);
+        if (level == task->prio_level)
+            return;
+
+        sched_set_prio_level(task, level);
+
+        if (!task->blocked_on)
+            return;
+        task = task->blocked_on->owner;
+    }
+}
+
+/* Called by mo_task_priority() after a task's base level changed */
+void _mutex_pi_refresh(tcb_t *task)
+{
+    pi_propagate(task);
+}
+
+/* Called by mo_task_cancel() before @task is freed: leave any waiter list
+ * and drop the back-references from mutexes it still owns. Those mutexes
+ * stay locked, as before, but no longer point to freed memory.
+ */
+void _mutex_task_exit(tcb_t *task)
+{
+    mutex_t *m = task->blocked_on;
+    if (m) {
+        wq_remove(&m->waiters, task);
+        task->blocked_on = NULL;
+        pi_propagate(m->owner);
+    }
+
+    while (task->held_mutexes) {
+        m = task->held_mutexes;
+        task->held_mutexes = m->next_held;
+        m->next_held = NULL;
+        m->owner = NULL;
+    }
+}
 
-    tcb_t *self = kcb->task_current->data;
+#if CONFIG_LOCK_STATS
+/* Note that @task queued on @m, and when */
+static inline void mutex_stats_queued(mutex_t *m, tcb_t *task)
+{
+    m->stats.contended++;
+    task->lock_wait_start = hal_clock_read();
+}
+
+/* Charge the hold ending now to the current owner */
+static inline void mutex_stats_released(mutex_t *m)
+{
+    uint32_t held = hal_clock_read() - m->locked_at;
+    if (held > m->stats.hold_max) {
+        m->stats.hold_max = held;
+        m->stats.hold_max_tid = m->owner_tid;
+    }
+}
+#define mutex_stats_waited(m, task) \
+    _lock_stats_wait(&(m)->stats, (task)->lock_wait_start)
+#else
+#define mutex_stats_queued(m, task) ((void) 0)
+#define mutex_stats_released(m) ((void) 0)
+#define mutex_stats_waited(m, task) ((void) 0)
+#endif
+
+/* Record @task as owner of @m */
+static inline void mutex_set_owner(mutex_t *m, tcb_t *task)
+{
+#if CONFIG_LOCK_STATS
+    m->stats.acquired++;
+    m->locked_at = hal_clock_read();
+#endif
+    m->owner_tid = task->id;
+    m->owner = task;
+    m->next_held = task->held_mutexes;
+    task->held_mutexes = m;
+}
+
+/* Unlink @m from its owner's held list and mark it free */
+static void mutex_clear_owner(mutex_t *m)
+{
+    tcb_t *owner = m->owner;
+
+    if (owner) {
+        mutex_stats_released(m);
+        mutex_t **link = &owner->held_mutexes;
+        while (*link && *link != m)
+            link = &(*link)->next_held;
+        if (*link)
+            *link = m->next_held;
+    }
+
+    m->next_held = NULL;
+    m->owner = NULL;
+    m->owner_tid = 0;
+}
 
-    /* Add to waiters list */
-    if (unlikely(!list_pushback(waiters, self)))
+/* Queue the current task on @m and lend its priority to the owner chain */
+static tcb_t *mutex_enqueue_self(mutex_t *m)
+{
+    if (unlikely(!kcb || !kcb->task_current))
         panic(ERR_SEM_OPERATION);
 
-    /* Block and yield atomically */
+    tcb_t *self = kcb->task_current;
+
+    wq_push(&m->waiters, self);
+    self->blocked_on = m;
+    mutex_stats_queued(m, self);
+    TRACE_EVENT(TRACE_MUTEX_WAIT, 0, self->id, m->owner_tid);
+    pi_propagate(m->owner);
+    return self;
+}
+
+/* Queue the caller on @m, drop the mutex lock and switch away. The task is
+ * marked blocked before the lock is released, so a concurrent unlock either
+ * sees it in the queue or has already handed over ownership.
+ */
+static void mutex_block_atomic(mutex_t *m)
+{
+    tcb_t *self = mutex_enqueue_self(m);
+
     self->state = TASK_BLOCKED;
-    _yield(); /* This releases NOSCHED when we context switch */
+    TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+    spin_unlock(&m->lock);
+    NOSCHED_LEAVE();
+    mo_task_yield();
 }
 
 int32_t mo_mutex_init(mutex_t *m)
@@ -87,18 +243,16 @@ int32_t mo_mutex_init(mutex_t *m)
     if (unlikely(!m))
         return ERR_FAIL;
 
-    /* Initialize to known safe state */
-    m->waiters = NULL;
-    m->owner_tid = 0;
-    m->magic = 0;
-
-    /* Create waiters list */
-    m->waiters = list_create();
-    if (unlikely(!m->waiters))
-        return ERR_FAIL;
-
-    /* Mark as valid atomically (last step) */
+    wq_init(&m->waiters);
     m->owner_tid = 0;
+    m->owner = NULL;
+    m->next_held = NULL;
+    spin_lock_init(&m->lock);
+#if CONFIG_LOCK_STATS
+    _lock_stats_init(&m->stats, LOCK_STAT_MUTEX);
+#endif
+
+    /* Mark as valid last */
     m->magic = MUTEX_MAGIC;
 
     return ERR_OK;
@@ -113,33 +267,35 @@ int32_t mo_mutex_destroy(mutex_t *m)
         return ERR_FAIL;
 
     NOSCHED_ENTER();
+    spin_lock(&m->lock);
 
     /* Check if any tasks are waiting */
-    if (unlikely(!list_is_empty(m->waiters))) {
+    if (unlikely(!wq_empty(&m->waiters))) {
+        spin_unlock(&m->lock);
         NOSCHED_LEAVE();
         return ERR_TASK_BUSY;
     }
 
     /* Check if mutex is still owned */
     if (unlikely(m->owner_tid != 0)) {
+        spin_unlock(&m->lock);
         NOSCHED_LEAVE();
         return ERR_TASK_BUSY;
     }
 
-    /* Invalidate atomically and cleanup */
+    /* Invalidate atomically */
     mutex_invalidate(m);
-    list_t *waiters = m->waiters;
-    m->waiters = NULL;
     m->owner_tid = 0;
 
+    spin_unlock(&m->lock);
     NOSCHED_LEAVE();
-
-    /* Clean up resources outside critical section */
-    list_destroy(waiters);
+#if CONFIG_LOCK_STATS
+    _lock_stats_unregister(&m->stats);
+#endif
     return ERR_OK;
 }
 
-int32_t mo_mutex_lock(mutex_t *m)
+__fast_text int32_t mo_mutex_lock(mutex_t *m)
 {
     if (unlikely(!mutex_is_valid(m)))
         panic(ERR_SEM_OPERATION); /* Invalid mutex is programming error */
@@ -147,29 +303,32 @@ int32_t mo_mutex_lock(mutex_t *m)
     uint16_t self_tid = mo_task_id();
 
     NOSCHED_ENTER();
+    spin_lock(&m->lock);
 
     /* Non-recursive: reject if caller already owns it */
     if (unlikely(m->owner_tid == self_tid)) {
+        spin_unlock(&m->lock);
         NOSCHED_LEAVE();
         return ERR_TASK_BUSY;
     }
 
     /* Fast path: mutex is free, acquire immediately */
     if (likely(m->owner_tid == 0)) {
-        m->owner_tid = self_tid;
+        mutex_set_owner(m, kcb->task_current);
+        spin_unlock(&m->lock);
         NOSCHED_LEAVE();
         return ERR_OK;
     }
 
-    /* Slow path: mutex is owned, must block atomically */
-    mutex_block_atomic(m->waiters);
+    /* Slow path: mutex is owned, boost the owner and block atomically */
+    mutex_block_atomic(m);
 
     /* When we return here, we've been woken by mo_mutex_unlock()
      * and ownership has been transferred to us. */
     return ERR_OK;
 }
 
-int32_t mo_mutex_trylock(mutex_t *m)
+__fast_text int32_t mo_mutex_trylock(mutex_t *m)
 {
     if (unlikely(!mutex_is_valid(m)))
         return ERR_FAIL;
@@ -178,17 +337,19 @@ int32_t mo_mutex_trylock(mutex_t *m)
     int32_t result = ERR_TASK_BUSY;
 
     NOSCHED_ENTER();
+    spin_lock(&m->lock);
 
     if (unlikely(m->owner_tid == self_tid)) {
         /* Already owned by caller (non-recursive) */
         result = ERR_TASK_BUSY;
     } else if (m->owner_tid == 0) {
         /* Mutex is free, acquire it */
-        m->owner_tid = self_tid;
+        mutex_set_owner(m, kcb->task_current);
         result = ERR_OK;
     }
     /* else: owned by someone else, return ERR_TASK_BUSY */
 
+    spin_unlock(&m->lock);
     NOSCHED_LEAVE();
     return result;
 }
@@ -204,60 +365,59 @@ int32_t mo_mutex_timedlock(mutex_t *m, uint32_t ticks)
     uint16_t self_tid = mo_task_id();
 
     NOSCHED_ENTER();
+    spin_lock(&m->lock);
 
     /* Non-recursive check */
     if (unlikely(m->owner_tid == self_tid)) {
+        spin_unlock(&m->lock);
         NOSCHED_LEAVE();
         return ERR_TASK_BUSY;
     }
 
     /* Fast path: mutex is free */
     if (m->owner_tid == 0) {
-        m->owner_tid = self_tid;
+        mutex_set_owner(m, kcb->task_current);
+        spin_unlock(&m->lock);
         NOSCHED_LEAVE();
         return ERR_OK;
     }
 
-    /* Slow path: must block with timeout using delay mechanism */
-    tcb_t *self = kcb->task_current->data;
-    if (unlikely(!list_pushback(m->waiters, self))) {
-        NOSCHED_LEAVE();
-        panic(ERR_SEM_OPERATION);
-    }
+    /* Slow path: boost the owner, then block with a timeout */
+    tcb_t *self = mutex_enqueue_self(m);
 
-    /* Set up timeout using task delay mechanism */
-    self->delay = ticks;
-    self->state = TASK_BLOCKED;
+    /* Block with a wakeup armed in the sleep list */
+    sched_delay_task(self, ticks);
 
+    spin_unlock(&m->lock);
     NOSCHED_LEAVE();
 
-    /* Yield and let the scheduler handle timeout via delay mechanism */
+    /* Yield and let the tick handler wake us if the timeout expires */
     mo_task_yield();
 
     /* Check result after waking up */
     int32_t result;
 
     NOSCHED_ENTER();
-    if (self->state == TASK_BLOCKED) {
-        /* We woke up due to timeout, not mutex unlock */
-        if (remove_self_from_waiters(m->waiters)) {
-            self->state = TASK_READY;
-            result = ERR_TIMEOUT;
-        } else {
-            /* Race condition: we were both timed out and unlocked */
-            /* Check if we now own the mutex */
-            result = (m->owner_tid == self_tid) ? ERR_OK : ERR_TIMEOUT;
-        }
+    spin_lock(&m->lock);
+    if (remove_self_from_waiters(&m->waiters)) {
+        /* Still queued on the mutex: the timeout expired first. Withdraw the
+         * priority this task lent to the owner chain.
+         */
+        self->blocked_on = NULL;
+        mutex_stats_waited(m, self);
+        pi_propagate(m->owner);
+        result = ERR_TIMEOUT;
     } else {
-        /* We were woken by mutex unlock - check ownership */
+        /* Dequeued by mo_mutex_unlock(), which handed over ownership */
         result = (m->owner_tid == self_tid) ? ERR_OK : ERR_FAIL;
     }
+    spin_unlock(&m->lock);
     NOSCHED_LEAVE();
 
     return result;
 }
 
-int32_t mo_mutex_unlock(mutex_t *m)
+__fast_text int32_t mo_mutex_unlock(mutex_t *m)
 {
     if (unlikely(!mutex_is_valid(m)))
         return ERR_FAIL;
@@ -265,38 +425,54 @@ int32_t mo_mutex_unlock(mutex_t *m)
     uint16_t self_tid = mo_task_id();
 
     NOSCHED_ENTER();
+    spin_lock(&m->lock);
 
     /* Verify caller owns the mutex */
     if (unlikely(m->owner_tid != self_tid)) {
+        spin_unlock(&m->lock);
         NOSCHED_LEAVE();
         return ERR_NOT_OWNER;
     }
 
-    /* Check for waiting tasks */
-    if (list_is_empty(m->waiters)) {
-        /* No waiters - mutex becomes free */
-        m->owner_tid = 0;
-    } else {
-        /* Transfer ownership to next waiter (FIFO) */
-        tcb_t *next_owner = (tcb_t *) list_pop(m->waiters);
+    tcb_t *self = m->owner;
+    tcb_t *woken = NULL;
+    mutex_clear_owner(m);
+
+    /* Check for waiting tasks; with none, the mutex simply becomes free */
+    if (!wq_empty(&m->waiters)) {
+        /* Transfer ownership to the next waiter under the wait policy */
+        tcb_t *next_owner = wq_pop(&m->waiters);
         if (likely(next_owner)) {
             /* Validate task state before waking */
-            if (likely(next_owner->state == TASK_BLOCKED)) {
-                m->owner_tid = next_owner->id;
-                next_owner->state = TASK_READY;
-                /* Clear any pending timeout since we're granting ownership */
-                next_owner->delay = 0;
+            if (likely(waiter_state_valid(next_owner))) {
+                mutex_stats_waited(m, next_owner);
+                mutex_set_owner(m, next_owner);
+                next_owner->blocked_on = NULL;
+                /* Also cancels any pending timeout */
+                sched_wakeup_task(next_owner);
+                /* The new owner inherits from the remaining waiters */
+                pi_propagate(next_owner);
+                woken = next_owner;
             } else {
                 /* Task state inconsistency */
                 panic(ERR_SEM_OPERATION);
             }
-        } else {
-            /* Should not happen if list was not empty */
-            m->owner_tid = 0;
         }
     }
 
+    /* Drop any priority inherited through this mutex */
+    pi_propagate(self);
+
+    /* Compare against our restored level: hand the CPU to the new owner
+     * right away if it now outranks us
+     */
+    bool preempt = woken && sched_wakeup_preempts(woken);
+
+    spin_unlock(&m->lock);
     NOSCHED_LEAVE();
+
+    if (preempt)
+        mo_task_yield();
     return ERR_OK;
 }
 
@@ -308,6 +484,20 @@ bool mo_mutex_owned_by_current(mutex_t *m)
     return (m->owner_tid == mo_task_id());
 }
 
+int32_t mo_mutex_set_policy(mutex_t *m, wait_policy_t policy)
+{
+    if (unlikely(!mutex_is_valid(m) || policy > WAIT_PRIO))
+        return ERR_FAIL;
+
+    NOSCHED_ENTER();
+    spin_lock(&m->lock);
+    m->waiters.policy = policy;
+    spin_unlock(&m->lock);
+    NOSCHED_LEAVE();
+
+    return ERR_OK;
+}
+
 int32_t mo_mutex_waiting_count(mutex_t *m)
 {
     if (unlikely(!mutex_is_valid(m)))
@@ -315,27 +505,100 @@ int32_t mo_mutex_waiting_count(mutex_t *m)
 
     int32_t count;
     NOSCHED_ENTER();
-    count = m->waiters ? (int32_t) m->waiters->length : 0;
+    spin_lock(&m->lock);
+    count = m->waiters.count;
+    spin_unlock(&m->lock);
     NOSCHED_LEAVE();
 
     return count;
 }
 
-int32_t mo_cond_init(cond_t *c)
+int32_t mo_mutex_stats(mutex_t *m, lock_stats_t *stats)
 {
-    if (unlikely(!c))
+#if CONFIG_LOCK_STATS
+    if (unlikely(!mutex_is_valid(m) || !stats))
+        return ERR_FAIL;
+
+    NOSCHED_ENTER();
+    spin_lock(&m->lock);
+    *stats = m->stats;
+    spin_unlock(&m->lock);
+    NOSCHED_LEAVE();
+
+    return ERR_OK;
+#else
+    (void) m;
+    (void) stats;
+    return ERR_FAIL;
+#endif
+}
+
+int32_t mo_mutex_stats_register(mutex_t *m, const char *name)
+{
+#if CONFIG_LOCK_STATS
+    if (unlikely(!mutex_is_valid(m)))
         return ERR_FAIL;
 
-    /* Initialize to known safe state */
-    c->waiters = NULL;
-    c->magic = 0;
+    _lock_stats_register(&m->stats, name);
+    return ERR_OK;
+#else
+    (void) m;
+    (void) name;
+    return ERR_FAIL;
+#endif
+}
+
+#if CONFIG_COND
+/* Pass a signalled condition waiter on to its mutex ("wait morphing").
+ * While the mutex is held, the waiter moves straight onto its wait queue
+ * and stays blocked until mo_mutex_unlock() hands it ownership; a free
+ * mutex is given to it at once. Either way it wakes exactly once, already
+ * owning the mutex, instead of waking only to block on the mutex again.
+ * A waiter whose timeout already fired, or that has not yet released the
+ * mutex, is simply woken and re-acquires the mutex itself.
+ *
+ * Returns true if the waiter was woken and should preempt the caller
+ */
+static bool cond_wake(tcb_t *waiter)
+{
+    if (unlikely(!waiter_state_valid(waiter)))
+        panic(ERR_SEM_OPERATION); /* Task state inconsistency */
+
+    mutex_t *m = waiter->cond_mutex;
+    if (waiter->state == TASK_BLOCKED && mutex_is_valid(m)) {
+        spin_lock(&m->lock);
+        if (m->owner != waiter) {
+            /* Either way, the condition wait is over: drop its timeout */
+            sched_cancel_delay(waiter);
+
+            if (m->owner_tid != 0) {
+                wq_push(&m->waiters, waiter);
+                waiter->blocked_on = m;
+                mutex_stats_queued(m, waiter);
+                TRACE_EVENT(TRACE_MUTEX_WAIT, 0, waiter->id, m->owner_tid);
+                pi_propagate(m->owner);
+                spin_unlock(&m->lock);
+                return false;
+            }
+            mutex_set_owner(m, waiter);
+        }
+        spin_unlock(&m->lock);
+    }
+
+    /* Also cancels any pending timeout */
+    sched_wakeup_task(waiter);
+    return sched_wakeup_preempts(waiter);
+}
 
-    /* Create waiters list */
-    c->waiters = list_create();
-    if (unlikely(!c->waiters))
+int32_t mo_cond_init(cond_t *c)
+{
+    if (unlikely(!c))
         return ERR_FAIL;
 
-    /* Mark as valid atomically */
+    wq_init(&c->waiters);
+    spin_lock_init(&c->lock);
+
+    /* Mark as valid last */
     c->magic = COND_MAGIC;
     return ERR_OK;
 }
@@ -349,22 +612,20 @@ int32_t mo_cond_destroy(cond_t *c)
         return ERR_FAIL;
 
     NOSCHED_ENTER();
+    spin_lock(&c->lock);
 
     /* Check if any tasks are waiting */
-    if (unlikely(!list_is_empty(c->waiters))) {
+    if (unlikely(!wq_empty(&c->waiters))) {
+        spin_unlock(&c->lock);
         NOSCHED_LEAVE();
         return ERR_TASK_BUSY;
     }
 
-    /* Invalidate atomically and cleanup */
+    /* Invalidate atomically */
     cond_invalidate(c);
-    list_t *waiters = c->waiters;
-    c->waiters = NULL;
 
+    spin_unlock(&c->lock);
     NOSCHED_LEAVE();
-
-    /* Clean up resources outside critical section */
-    list_destroy(waiters);
     return ERR_OK;
 }
 
@@ -379,15 +640,15 @@ int32_t mo_cond_wait(cond_t *c, mutex_t *m)
     if (unlikely(!mo_mutex_owned_by_current(m)))
         return ERR_NOT_OWNER;
 
-    tcb_t *self = kcb->task_current->data;
+    tcb_t *self = kcb->task_current;
 
     /* Atomically add to wait list */
     NOSCHED_ENTER();
-    if (unlikely(!list_pushback(c->waiters, self))) {
-        NOSCHED_LEAVE();
-        panic(ERR_SEM_OPERATION);
-    }
+    spin_lock(&c->lock);
+    self->cond_mutex = m;
+    wq_push(&c->waiters, self);
     self->state = TASK_BLOCKED;
+    spin_unlock(&c->lock);
     NOSCHED_LEAVE();
 
     /* Release mutex */
@@ -395,8 +656,10 @@ int32_t mo_cond_wait(cond_t *c, mutex_t *m)
     if (unlikely(unlock_result != ERR_OK)) {
         /* Failed to unlock - remove from wait list and restore state */
         NOSCHED_ENTER();
-        remove_self_from_waiters(c->waiters);
-        self->state = TASK_READY;
+        spin_lock(&c->lock);
+        remove_self_from_waiters(&c->waiters);
+        self->state = TASK_RUNNING;
+        spin_unlock(&c->lock);
         NOSCHED_LEAVE();
         return unlock_result;
     }
@@ -404,7 +667,9 @@ int32_t mo_cond_wait(cond_t *c, mutex_t *m)
     /* Yield and wait to be signaled */
     mo_task_yield();
 
-    /* Re-acquire mutex before returning */
+    /* A morphed wakeup already handed us the mutex */
+    if (mo_mutex_owned_by_current(m))
+        return ERR_OK;
     return mo_mutex_lock(m);
 }
 
@@ -421,16 +686,15 @@ int32_t mo_cond_timedwait(cond_t *c, mutex_t *m, uint32_t ticks)
         return ERR_TIMEOUT;
     }
 
-    tcb_t *self = kcb->task_current->data;
+    tcb_t *self = kcb->task_current;
 
     /* Atomically add to wait list with timeout */
     NOSCHED_ENTER();
-    if (unlikely(!list_pushback(c->waiters, self))) {
-        NOSCHED_LEAVE();
-        panic(ERR_SEM_OPERATION);
-    }
-    self->delay = ticks;
-    self->state = TASK_BLOCKED;
+    spin_lock(&c->lock);
+    self->cond_mutex = m;
+    wq_push(&c->waiters, self);
+    sched_delay_task(self, ticks);
+    spin_unlock(&c->lock);
     NOSCHED_LEAVE();
 
     /* Release mutex */
@@ -438,9 +702,11 @@ int32_t mo_cond_timedwait(cond_t *c, mutex_t *m, uint32_t ticks)
     if (unlikely(unlock_result != ERR_OK)) {
         /* Failed to unlock - cleanup and restore */
         NOSCHED_ENTER();
-        remove_self_from_waiters(c->waiters);
-        self->state = TASK_READY;
-        self->delay = 0;
+        spin_lock(&c->lock);
+        remove_self_from_waiters(&c->waiters);
+        sched_cancel_delay(self);
+        self->state = TASK_RUNNING;
+        spin_unlock(&c->lock);
         NOSCHED_LEAVE();
         return unlock_result;
     }
@@ -451,22 +717,24 @@ int32_t mo_cond_timedwait(cond_t *c, mutex_t *m, uint32_t ticks)
     /* Determine why we woke up */
     int32_t wait_status;
     NOSCHED_ENTER();
+    spin_lock(&c->lock);
 
-    if (self->state == TASK_BLOCKED) {
-        /* Timeout occurred - remove from wait list */
-        remove_self_from_waiters(c->waiters);
-        self->state = TASK_READY;
-        self->delay = 0;
+    if (remove_self_from_waiters(&c->waiters)) {
+        /* Nobody dequeued us, so the timeout expired */
         wait_status = ERR_TIMEOUT;
     } else {
         /* Signaled successfully */
         wait_status = ERR_OK;
     }
 
+    spin_unlock(&c->lock);
     NOSCHED_LEAVE();
 
-    /* Re-acquire mutex regardless of timeout status */
-    int32_t lock_result = mo_mutex_lock(m);
+    /* Re-acquire mutex regardless of timeout status, unless a morphed
+     * wakeup already handed it over
+     */
+    int32_t lock_result =
+        mo_mutex_owned_by_current(m) ? ERR_OK : mo_mutex_lock(m);
 
     /* Return timeout status if wait timed out, otherwise lock result */
     return (wait_status == ERR_TIMEOUT) ? ERR_TIMEOUT : lock_result;
@@ -477,24 +745,21 @@ int32_t mo_cond_signal(cond_t *c)
     if (unlikely(!cond_is_valid(c)))
         return ERR_FAIL;
 
+    bool preempt = false;
+
     NOSCHED_ENTER();
+    spin_lock(&c->lock);
 
-    if (!list_is_empty(c->waiters)) {
-        tcb_t *waiter = (tcb_t *) list_pop(c->waiters);
-        if (likely(waiter)) {
-            /* Validate task state before waking */
-            if (likely(waiter->state == TASK_BLOCKED)) {
-                waiter->state = TASK_READY;
-                /* Clear any pending timeout since we're signaling */
-                waiter->delay = 0;
-            } else {
-                /* Task state inconsistency */
-                panic(ERR_SEM_OPERATION);
-            }
-        }
-    }
+    tcb_t *waiter = wq_pop(&c->waiters);
+    if (waiter)
+        preempt = cond_wake(waiter);
 
+    spin_unlock(&c->lock);
     NOSCHED_LEAVE();
+
+    /* Run a higher-priority waiter now instead of at the next tick */
+    if (preempt)
+        mo_task_yield();
     return ERR_OK;
 }
 
@@ -503,25 +768,36 @@ int32_t mo_cond_broadcast(cond_t *c)
     if (unlikely(!cond_is_valid(c)))
         return ERR_FAIL;
 
+    bool preempt = false;
+
     NOSCHED_ENTER();
+    spin_lock(&c->lock);
 
-    /* Wake all waiting tasks */
-    while (!list_is_empty(c->waiters)) {
-        tcb_t *waiter = (tcb_t *) list_pop(c->waiters);
-        if (likely(waiter)) {
-            /* Validate task state before waking */
-            if (likely(waiter->state == TASK_BLOCKED)) {
-                waiter->state = TASK_READY;
-                /* Clear any pending timeout since we're broadcasting */
-                waiter->delay = 0;
-            } else {
-                /* Task state inconsistency */
-                panic(ERR_SEM_OPERATION);
-            }
-        }
-    }
+    /* Move every waiter to its mutex; at most one of them runs now */
+    tcb_t *waiter;
+    while ((waiter = wq_pop(&c->waiters)))
+        preempt |= cond_wake(waiter);
+
+    spin_unlock(&c->lock);
+    NOSCHED_LEAVE();
+
+    /* Yield once if any woken task outranks the caller */
+    if (preempt)
+        mo_task_yield();
+    return ERR_OK;
+}
+
+int32_t mo_cond_set_policy(cond_t *c, wait_policy_t policy)
+{
+    if (unlikely(!cond_is_valid(c) || policy > WAIT_PRIO))
+        return ERR_FAIL;
 
+    NOSCHED_ENTER();
+    spin_lock(&c->lock);
+    c->waiters.policy = policy;
+    spin_unlock(&c->lock);
     NOSCHED_LEAVE();
+
     return ERR_OK;
 }
 
@@ -532,8 +808,294 @@ int32_t mo_cond_waiting_count(cond_t *c)
 
     int32_t count;
     NOSCHED_ENTER();
-    count = c->waiters ? (int32_t) c->waiters->length : 0;
+    spin_lock(&c->lock);
+    count = c->waiters.count;
+    spin_unlock(&c->lock);
     NOSCHED_LEAVE();
 
     return count;
 }
+#endif /* CONFIG_COND */
+
+/* Reader-Writer Locks */
+
+static inline bool rwlock_is_valid(const rwlock_t *rw)
+{
+    return rw && rw->magic == RWLOCK_MAGIC;
+}
+
+/* A reader may enter only while no writer holds or waits for the lock */
+static inline bool rwlock_read_free(const rwlock_t *rw)
+{
+    return rw->writer_tid == 0 && wq_empty(&rw->wr_waiters);
+}
+
+static inline bool rwlock_write_free(const rwlock_t *rw)
+{
+    return rw->writer_tid == 0 && rw->readers == 0;
+}
+
+/* Hand a lock that was just released, or gave up a waiter, to whoever is
+ * next: one writer if the lock is idle, otherwise every waiting reader once
+ * no writer is left ahead of them. @readers_first admits queued readers
+ * ahead of a waiting writer (fair policy, after a write phase).
+ *
+ * Returns true if a woken task should preempt the caller
+ */
+static bool rwlock_handover(rwlock_t *rw, bool readers_first)
+{
+    bool preempt = false;
+
+    if (rw->writer_tid)
+        return false;
+
+    if (readers_first && wq_empty(&rw->rd_waiters))
+        readers_first = false;
+
+    if (!readers_first && rw->readers == 0 && !wq_empty(&rw->wr_waiters)) {
+        tcb_t *writer = wq_pop(&rw->wr_waiters);
+        if (unlikely(!waiter_state_valid(writer)))
+            panic(ERR_SEM_OPERATION);
+        rw->writer_tid = writer->id;
+        sched_wakeup_task(writer);
+        return sched_wakeup_preempts(writer);
+    }
+
+    if (!readers_first && !wq_empty(&rw->wr_waiters))
+        return false;
+
+    while (!wq_empty(&rw->rd_waiters)) {
+        tcb_t *reader = wq_pop(&rw->rd_waiters);
+        if (unlikely(!waiter_state_valid(reader)))
+            panic(ERR_SEM_OPERATION);
+        rw->readers++;
+        sched_wakeup_task(reader);
+        preempt |= sched_wakeup_preempts(reader);
+    }
+    return preempt;
+}
+
+/* Queue the caller on @q and switch away, for at most @ticks if non-zero.
+ * Called with the lock held and scheduling disabled; returns with neither.
+ */
+static void rwlock_block(rwlock_t *rw, wait_queue_t *q, uint32_t ticks)
+{
+    tcb_t *self = kcb->task_current;
+
+    wq_push(q, self);
+    if (ticks) {
+        sched_delay_task(self, ticks);
+    } else {
+        self->state = TASK_BLOCKED;
+        TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+    }
+    spin_unlock(&rw->lock);
+    NOSCHED_LEAVE();
+    mo_task_yield();
+}
+
+/* Leave @q after a timed wait. Returns ERR_OK if the lock was handed over
+ * first, ERR_TIMEOUT otherwise.
+ */
+static int32_t rwlock_timed_finish(rwlock_t *rw, wait_queue_t *q)
+{
+    bool preempt = false;
+    int32_t result = ERR_OK;
+
+    NOSCHED_ENTER();
+    spin_lock(&rw->lock);
+    if (remove_self_from_waiters(q)) {
+        result = ERR_TIMEOUT;
+        /* A writer that gives up may have been holding readers back */
+        if (q == &rw->wr_waiters)
+            preempt = rwlock_handover(rw, false);
+    }
+    spin_unlock(&rw->lock);
+    NOSCHED_LEAVE();
+
+    if (preempt)
+        mo_task_yield();
+    return result;
+}
+
+int32_t mo_rwlock_init(rwlock_t *rw, rwlock_policy_t policy)
+{
+    if (unlikely(!rw || policy > RWLOCK_FAIR))
+        return ERR_FAIL;
+
+    wq_init(&rw->rd_waiters);
+    wq_init(&rw->wr_waiters);
+    rw->readers = 0;
+    rw->writer_tid = 0;
+    rw->policy = policy;
+    spin_lock_init(&rw->lock);
+
+    /* Mark as valid last */
+    rw->magic = RWLOCK_MAGIC;
+    return ERR_OK;
+}
+
+int32_t mo_rwlock_destroy(rwlock_t *rw)
+{
+    if (!rw)
+        return ERR_OK; /* Destroying NULL is no-op */
+
+    if (unlikely(!rwlock_is_valid(rw)))
+        return ERR_FAIL;
+
+    NOSCHED_ENTER();
+    spin_lock(&rw->lock);
+
+    if (unlikely(!rwlock_write_free(rw) || !wq_empty(&rw->rd_waiters) ||
+                 !wq_empty(&rw->wr_waiters))) {
+        spin_unlock(&rw->lock);
+        NOSCHED_LEAVE();
+        return ERR_TASK_BUSY;
+    }
+
+    rw->magic = 0xDEADBEEF;
+
+    spin_unlock(&rw->lock);
+    NOSCHED_LEAVE();
+    return ERR_OK;
+}
+
+/* Shared body of the read lock calls; @ticks 0 blocks without a timeout */
+static int32_t rwlock_rdlock(rwlock_t *rw, bool wait, uint32_t ticks)
+{
+    if (unlikely(!rwlock_is_valid(rw)))
+        return ERR_FAIL;
+
+    NOSCHED_ENTER();
+    spin_lock(&rw->lock);
+
+    /* Reading under our own write lock would never be granted */
+    if (unlikely(rw->writer_tid == mo_task_id())) {
+        spin_unlock(&rw->lock);
+        NOSCHED_LEAVE();
+        return ERR_TASK_BUSY;
+    }
+
+    /* Fast path: no writer involved */
+    if (likely(rwlock_read_free(rw))) {
+        rw->readers++;
+        spin_unlock(&rw->lock);
+        NOSCHED_LEAVE();
+        return ERR_OK;
+    }
+
+    if (!wait) {
+        spin_unlock(&rw->lock);
+        NOSCHED_LEAVE();
+        return ERR_TASK_BUSY;
+    }
+
+    /* Slow path: woken by rwlock_handover() with the lock already ours */
+    rwlock_block(rw, &rw->rd_waiters, ticks);
+    return ticks ? rwlock_timed_finish(rw, &rw->rd_waiters) : ERR_OK;
+}
+
+int32_t mo_rwlock_rdlock(rwlock_t *rw)
+{
+    if (unlikely(!rwlock_is_valid(rw)))
+        panic(ERR_SEM_OPERATION); /* Invalid lock is programming error */
+
+    return rwlock_rdlock(rw, true, 0);
+}
+
+int32_t mo_rwlock_tryrdlock(rwlock_t *rw)
+{
+    return rwlock_rdlock(rw, false, 0);
+}
+
+int32_t mo_rwlock_timedrdlock(rwlock_t *rw, uint32_t ticks)
+{
+    return rwlock_rdlock(rw, ticks != 0, ticks);
+}
+
+/* Shared body of the write lock calls; @ticks 0 blocks without a timeout */
+static int32_t rwlock_wrlock(rwlock_t *rw, bool wait, uint32_t ticks)
+{
+    if (unlikely(!rwlock_is_valid(rw)))
+        return ERR_FAIL;
+
+    uint16_t self_tid = mo_task_id();
+
+    NOSCHED_ENTER();
+    spin_lock(&rw->lock);
+
+    /* Non-recursive: reject if caller already owns it */
+    if (unlikely(rw->writer_tid == self_tid)) {
+        spin_unlock(&rw->lock);
+        NOSCHED_LEAVE();
+        return ERR_TASK_BUSY;
+    }
+
+    /* Fast path: lock is idle */
+    if (likely(rwlock_write_free(rw))) {
+        rw->writer_tid = self_tid;
+        spin_unlock(&rw->lock);
+        NOSCHED_LEAVE();
+        return ERR_OK;
+    }
+
+    if (!wait) {
+        spin_unlock(&rw->lock);
+        NOSCHED_LEAVE();
+        return ERR_TASK_BUSY;
+    }
+
+    /* Slow path: woken by rwlock_handover() with the lock already ours */
+    rwlock_block(rw, &rw->wr_waiters, ticks);
+    return ticks ? rwlock_timed_finish(rw, &rw->wr_waiters) : ERR_OK;
+}
+
+int32_t mo_rwlock_wrlock(rwlock_t *rw)
+{
+    if (unlikely(!rwlock_is_valid(rw)))
+        panic(ERR_SEM_OPERATION); /* Invalid lock is programming error */
+
+    return rwlock_wrlock(rw, true, 0);
+}
+
+int32_t mo_rwlock_trywrlock(rwlock_t *rw)
+{
+    return rwlock_wrlock(rw, false, 0);
+}
+
+int32_t mo_rwlock_timedwrlock(rwlock_t *rw, uint32_t ticks)
+{
+    return rwlock_wrlock(rw, ticks != 0, ticks);
+}
+
+int32_t mo_rwlock_unlock(rwlock_t *rw)
+{
+    if (unlikely(!rwlock_is_valid(rw)))
+        return ERR_FAIL;
+
+    bool preempt = false;
+
+    NOSCHED_ENTER();
+    spin_lock(&rw->lock);
+
+    if (rw->writer_tid == mo_task_id()) {
+        rw->writer_tid = 0;
+        preempt = rwlock_handover(rw, rw->policy == RWLOCK_FAIR);
+    } else if (rw->readers > 0) {
+        /* The last reader out lets a waiting writer in */
+        if (--rw->readers == 0)
+            preempt = rwlock_handover(rw, false);
+    } else {
+        spin_unlock(&rw->lock);
+        NOSCHED_LEAVE();
+        return ERR_NOT_OWNER;
+    }
+
+    spin_unlock(&rw->lock);
+    NOSCHED_LEAVE();
+
+    /* Run a higher-priority new owner now instead of at the next tick */
+    if (preempt)
+        mo_task_yield();
+    return ERR_OK;
+}
@@ -1,14 +1,22 @@
 #include <lib/libc.h>
+#include <lib/slab.h>
 #include <sys/pipe.h>
+#include <sys/spinlock.h>
 #include <sys/task.h>
+#include <sys/trace.h>
 
 #include "private/error.h"
+#include "private/stdio.h"
 #include "private/utils.h"
 
+#if CONFIG_PIPE
+
 /* Minimum and maximum pipe sizes */
 #define PIPE_MIN_SIZE 4
 #define PIPE_MAX_SIZE 32768
 
+static slab_cache_t pipe_cache = SLAB_CACHE_INIT_HINT("pipe", pipe_t, MEM_FAST);
+
 /* Enhanced validation with comprehensive integrity checks */
 static inline bool pipe_is_valid(const pipe_t *p)
 {
@@ -37,6 +45,10 @@ static inline uint16_t pipe_free_space_internal(const pipe_t *p)
 /* bulk read operation within critical section */
 static uint16_t pipe_bulk_read(pipe_t *p, char *dst, uint16_t max_bytes)
 {
+    /* The head is in use by a zero-copy reader */
+    if (unlikely(p->rd_claim))
+        return 0;
+
     uint16_t bytes_read = 0;
     uint16_t available = p->used;
     uint16_t to_read = min(max_bytes, available);
@@ -61,6 +73,10 @@ static uint16_t pipe_bulk_read(pipe_t *p, char *dst, uint16_t max_bytes)
 /* bulk write operation within critical section */
 static uint16_t pipe_bulk_write(pipe_t *p, const char *src, uint16_t max_bytes)
 {
+    /* The tail is in use by a zero-copy writer */
+    if (unlikely(p->wr_claim))
+        return 0;
+
     uint16_t bytes_written = 0;
     uint16_t available_space = pipe_free_space_internal(p);
     uint16_t to_write = min(max_bytes, available_space);
@@ -82,6 +98,103 @@ static uint16_t pipe_bulk_write(pipe_t *p, const char *src, uint16_t max_bytes)
     return bytes_written;
 }
 
+/* Wakeups
+ *
+ * A task that cannot make progress queues itself on 'readers' or 'writers'
+ * and lowers the matching 'need' threshold to what it is waiting for. The
+ * other side wakes the whole queue once that much data or space is there;
+ * each woken task rechecks, so a threshold shared by several waiters only
+ * costs a spurious wakeup, never a lost one.
+ */
+
+/* Timeout used by the untimed blocking calls */
+#define PIPE_FOREVER 0xFFFFFFFFU
+
+/* 'need' value of a side nobody is waiting on */
+#define PIPE_NEED_NONE UINT16_MAX
+
+/* Wake every task on @q once @avail reaches its threshold @need. Called with
+ * the pipe lock held.
+ *
+ * Returns true if a woken task should preempt the caller
+ */
+static bool pipe_wake(wait_queue_t *q, uint16_t *need, uint16_t avail)
+{
+    if (wq_empty(q) || avail < *need)
+        return false;
+
+    bool preempt = false;
+    tcb_t *task;
+
+    *need = PIPE_NEED_NONE;
+    while ((task = wq_pop(q))) {
+        sched_wakeup_task(task);
+        preempt |= sched_wakeup_preempts(task);
+    }
+    return preempt;
+}
+
+/* After bytes were added: wake readers and pollers */
+static bool pipe_wake_readers(pipe_t *p)
+{
+    bool preempt = pipe_wake(&p->readers, &p->read_need, p->used);
+    if (p->pollers)
+        preempt |= _poll_wake(p->pollers);
+    return preempt;
+}
+
+/* After bytes were removed: wake writers */
+static bool pipe_wake_writers(pipe_t *p)
+{
+    return pipe_wake(&p->writers, &p->write_need,
+                     pipe_free_space_internal(p));
+}
+
+/* Reader wakeup from an interrupt handler, done inline when the scheduler
+ * allows it and deferred to pipe_isr_kick() otherwise. Called with the pipe
+ * lock held.
+ *
+ * Returns true if the handler should request a reschedule
+ */
+static bool pipe_isr_wake_readers(pipe_t *p)
+{
+    if (wq_empty(&p->readers) && !p->pollers)
+        return false;
+    if (sched_isr_may_wake())
+        return pipe_wake_readers(p);
+
+    mo_defer_post(&p->isr_work);
+    return true;
+}
+
+/* Writer counterpart of pipe_isr_wake_readers() */
+static bool pipe_isr_wake_writers(pipe_t *p)
+{
+    if (wq_empty(&p->writers))
+        return false;
+    if (sched_isr_may_wake())
+        return pipe_wake_writers(p);
+
+    mo_defer_post(&p->isr_work);
+    return true;
+}
+
+/* Deferred wakeup of either side; each only wakes once its threshold holds */
+static void pipe_isr_kick(void *arg)
+{
+    pipe_t *p = arg;
+    if (unlikely(!pipe_is_valid(p)))
+        return;
+
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    bool preempt = pipe_wake_readers(p);
+    preempt |= pipe_wake_writers(p);
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    if (preempt)
+        mo_defer_resched();
+}
+
 /* Invalidate pipe during destruction to prevent reuse */
 static inline void pipe_invalidate(pipe_t *p)
 {
@@ -105,7 +218,7 @@ pipe_t *mo_pipe_create(uint16_t size)
         size = nextpowerof2(size);
 
     /* Allocate pipe structure */
-    pipe_t *p = malloc(sizeof(pipe_t));
+    pipe_t *p = slab_alloc(&pipe_cache);
     if (unlikely(!p))
         return NULL;
 
@@ -114,11 +227,19 @@ pipe_t *mo_pipe_create(uint16_t size)
     p->mask = 0;
     p->head = p->tail = p->used = 0;
     p->magic = 0;
-
-    /* Allocate buffer with alignment for better performance */
-    p->buf = malloc(size);
+    p->pollers = NULL;
+    wq_init(&p->readers);
+    wq_init(&p->writers);
+    p->read_wm = p->write_wm = 1;
+    p->read_need = p->write_need = PIPE_NEED_NONE;
+    p->wr_claim = p->rd_claim = 0;
+    mo_defer_init(&p->isr_work, pipe_isr_kick, p);
+    spin_lock_init(&p->lock);
+
+    /* Data buffers are bulk memory; keep them out of fast regions */
+    p->buf = malloc_region(size, MEM_BULK);
     if (unlikely(!p->buf)) {
-        free(p);
+        slab_free(&pipe_cache, p);
         return NULL;
     }
 
@@ -138,6 +259,14 @@ int32_t mo_pipe_destroy(pipe_t *p)
     if (unlikely(!pipe_is_valid(p)))
         return ERR_FAIL;
 
+    /* Blocked tasks, or a pending kick, would be left on freed memory */
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    bool busy = !wq_empty(&p->readers) || !wq_empty(&p->writers) ||
+                p->isr_work.pending;
+    spin_unlock_irqrestore(&p->lock, flags);
+    if (unlikely(busy))
+        return ERR_TASK_BUSY;
+
     /* Invalidate structure to prevent further use */
     pipe_invalidate(p);
 
@@ -146,7 +275,7 @@ int32_t mo_pipe_destroy(pipe_t *p)
         free(p->buf);
         p->buf = NULL;
     }
-    free(p);
+    slab_free(&pipe_cache, p);
 
     return ERR_OK;
 }
@@ -156,9 +285,14 @@ void mo_pipe_flush(pipe_t *p)
     if (unlikely(!pipe_is_valid(p)))
         return;
 
-    CRITICAL_ENTER();
+    uint32_t flags = spin_lock_irqsave(&p->lock);
     p->head = p->tail = p->used = 0;
-    CRITICAL_LEAVE();
+    p->wr_claim = p->rd_claim = 0; /* Open regions are void */
+    bool preempt = pipe_wake_writers(p);
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    if (preempt)
+        mo_task_yield();
 }
 
 int32_t mo_pipe_size(pipe_t *p)
@@ -183,94 +317,175 @@ int32_t mo_pipe_free_space(pipe_t *p)
     if (unlikely(!pipe_is_valid(p)))
         return -1;
 
-    CRITICAL_ENTER();
+    uint32_t flags = spin_lock_irqsave(&p->lock);
     int32_t free_space = (int32_t) pipe_free_space_internal(p);
-    CRITICAL_LEAVE();
+    spin_unlock_irqrestore(&p->lock, flags);
 
     return free_space;
 }
 
-/* Blocking operations with proper yielding strategy */
-static void pipe_wait_until_readable(pipe_t *p)
+int32_t mo_pipe_set_watermarks(pipe_t *p, uint16_t read_wm, uint16_t write_wm)
 {
-    while (1) {
-        CRITICAL_ENTER();
-        if (!pipe_is_empty(p)) {
-            CRITICAL_LEAVE();
-            return;
-        }
-        /* Nothing to read – drop critical section and yield CPU */
-        CRITICAL_LEAVE();
-        mo_task_wfi(); /* Yield CPU without blocking task state */
-    }
+    if (unlikely(!pipe_is_valid(p)))
+        return ERR_FAIL;
+
+    uint16_t capacity = p->mask + 1;
+
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    p->read_wm = read_wm ? min(read_wm, capacity) : 1;
+    p->write_wm = write_wm ? min(write_wm, capacity) : 1;
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    return ERR_OK;
 }
 
-static void pipe_wait_until_writable(pipe_t *p)
+/* Blocking Operations */
+
+/* Sleep on @q until woken with @need bytes of progress possible, or until
+ * @deadline unless @timeout is PIPE_FOREVER. Called and returns with the
+ * pipe lock held; @flags carries the saved interrupt state across.
+ *
+ * Returns false without sleeping if the deadline has already passed
+ */
+static bool pipe_block(pipe_t *p,
+                       wait_queue_t *q,
+                       uint16_t *threshold,
+                       uint16_t need,
+                       uint32_t timeout,
+                       uint32_t deadline,
+                       uint32_t *flags)
 {
-    while (1) {
-        CRITICAL_ENTER();
-        if (!pipe_is_full(p)) {
-            CRITICAL_LEAVE();
-            return;
-        }
-        /* Buffer full – yield until space is available */
-        CRITICAL_LEAVE();
-        mo_task_wfi(); /* Yield CPU without blocking task state */
+    tcb_t *self = kcb->task_current;
+    uint32_t now = mo_ticks();
+
+    if (timeout != PIPE_FOREVER && tick_reached(now, deadline))
+        return false;
+
+    if (need < *threshold)
+        *threshold = need;
+    wq_push(q, self);
+    if (timeout == PIPE_FOREVER) {
+        self->state = TASK_BLOCKED;
+        TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+    } else {
+        sched_delay_task(self, deadline - now);
     }
+    spin_unlock_irqrestore(&p->lock, *flags);
+
+    mo_task_yield();
+
+    *flags = spin_lock_irqsave(&p->lock);
+    /* Still queued after a timeout: withdraw */
+    wq_remove(q, self);
+    if (wq_empty(q))
+        *threshold = PIPE_NEED_NONE;
+    return true;
 }
 
-/* Blocking read with optimized bulk operations */
-int32_t mo_pipe_read(pipe_t *p, char *dst, uint16_t len)
+/* Read @len bytes, sleeping for at most @timeout ticks in total */
+static int32_t pipe_read_wait(pipe_t *p,
+                              char *dst,
+                              uint16_t len,
+                              uint32_t timeout)
 {
-    if (unlikely(!pipe_is_valid(p) || !dst || !len))
-        return ERR_FAIL;
-
+    uint32_t deadline = mo_ticks() + timeout;
     uint16_t bytes_read = 0;
+    bool preempt = false;
 
-    while (bytes_read < len) {
-        /* Wait for data to become available */
-        pipe_wait_until_readable(p);
-
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    while (1) {
         /* Read as much as possible in one critical section */
-        CRITICAL_ENTER();
         uint16_t chunk = pipe_bulk_read(p, dst + bytes_read, len - bytes_read);
-        CRITICAL_LEAVE();
-
         bytes_read += chunk;
-
-        /* If we still need more data, the next iteration will wait properly */
+        if (chunk)
+            preempt |= pipe_wake_writers(p);
+        if (bytes_read == len)
+            break;
+
+        uint16_t need = min(p->read_wm, len - bytes_read);
+        if (!pipe_block(p, &p->readers, &p->read_need, need, timeout, deadline,
+                        &flags))
+            break;
     }
+    spin_unlock_irqrestore(&p->lock, flags);
 
+    if (preempt)
+        mo_task_yield();
     return (int32_t) bytes_read;
 }
 
-/* Blocking write with optimized bulk operations */
-int32_t mo_pipe_write(pipe_t *p, const char *src, uint16_t len)
+/* Write @len bytes, sleeping for at most @timeout ticks in total */
+static int32_t pipe_write_wait(pipe_t *p,
+                               const char *src,
+                               uint16_t len,
+                               uint32_t timeout)
 {
-    if (unlikely(!pipe_is_valid(p) || !src || len == 0))
-        return ERR_FAIL;
-
+    uint32_t deadline = mo_ticks() + timeout;
     uint16_t bytes_written = 0;
+    bool preempt = false;
 
-    while (bytes_written < len) {
-        /* Wait for space to become available */
-        pipe_wait_until_writable(p);
-
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    while (1) {
         /* Write as much as possible in one critical section */
-        CRITICAL_ENTER();
         uint16_t chunk =
             pipe_bulk_write(p, src + bytes_written, len - bytes_written);
-        CRITICAL_LEAVE();
-
         bytes_written += chunk;
-
-        /* If we still need to write more, the next iteration will wait properly
-         */
+        if (chunk)
+            preempt |= pipe_wake_readers(p);
+        if (bytes_written == len)
+            break;
+
+        uint16_t need = min(p->write_wm, len - bytes_written);
+        if (!pipe_block(p, &p->writers, &p->write_need, need, timeout,
+                        deadline, &flags))
+            break;
     }
+    spin_unlock_irqrestore(&p->lock, flags);
 
+    if (preempt)
+        mo_task_yield();
     return (int32_t) bytes_written;
 }
 
+/* Blocking read with optimized bulk operations */
+int32_t mo_pipe_read(pipe_t *p, char *dst, uint16_t len)
+{
+    if (unlikely(!pipe_is_valid(p) || !dst || !len))
+        return ERR_FAIL;
+
+    return pipe_read_wait(p, dst, len, PIPE_FOREVER);
+}
+
+/* Blocking write with optimized bulk operations */
+int32_t mo_pipe_write(pipe_t *p, const char *src, uint16_t len)
+{
+    if (unlikely(!pipe_is_valid(p) || !src || len == 0))
+        return ERR_FAIL;
+
+    return pipe_write_wait(p, src, len, PIPE_FOREVER);
+}
+
+int32_t mo_pipe_timedread(pipe_t *p, char *dst, uint16_t len, uint32_t ticks)
+{
+    if (unlikely(!pipe_is_valid(p) || !dst || !len))
+        return ERR_FAIL;
+
+    int32_t bytes_read = pipe_read_wait(p, dst, len, ticks);
+    return bytes_read ? bytes_read : ERR_TIMEOUT;
+}
+
+int32_t mo_pipe_timedwrite(pipe_t *p,
+                           const char *src,
+                           uint16_t len,
+                           uint32_t ticks)
+{
+    if (unlikely(!pipe_is_valid(p) || !src || !len))
+        return ERR_FAIL;
+
+    int32_t bytes_written = pipe_write_wait(p, src, len, ticks);
+    return bytes_written ? bytes_written : ERR_TIMEOUT;
+}
+
 /* Non-blocking read with optimized bulk operations */
 int32_t mo_pipe_nbread(pipe_t *p, char *dst, uint16_t len)
 {
@@ -279,10 +494,13 @@ int32_t mo_pipe_nbread(pipe_t *p, char *dst, uint16_t len)
 
     uint16_t bytes_read;
 
-    CRITICAL_ENTER();
+    uint32_t flags = spin_lock_irqsave(&p->lock);
     bytes_read = pipe_bulk_read(p, dst, len);
-    CRITICAL_LEAVE();
+    bool preempt = bytes_read && pipe_wake_writers(p);
+    spin_unlock_irqrestore(&p->lock, flags);
 
+    if (preempt)
+        mo_task_yield();
     return (int32_t) bytes_read;
 }
 
@@ -294,9 +512,198 @@ int32_t mo_pipe_nbwrite(pipe_t *p, const char *src, uint16_t len)
 
     uint16_t bytes_written;
 
-    CRITICAL_ENTER();
+    uint32_t flags = spin_lock_irqsave(&p->lock);
     bytes_written = pipe_bulk_write(p, src, len);
-    CRITICAL_LEAVE();
+    bool preempt = bytes_written && pipe_wake_readers(p);
+    spin_unlock_irqrestore(&p->lock, flags);
 
+    if (preempt)
+        mo_task_yield();
     return (int32_t) bytes_written;
 }
+
+int32_t mo_pipe_write_from_isr(pipe_t *p, const char *src, uint16_t len)
+{
+    if (unlikely(!pipe_is_valid(p) || !src || len == 0))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    uint16_t bytes_written = pipe_bulk_write(p, src, len);
+    bool resched = bytes_written && pipe_isr_wake_readers(p);
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    if (resched)
+        sched_isr_resched();
+    return (int32_t) bytes_written;
+}
+
+int32_t mo_pipe_read_from_isr(pipe_t *p, char *dst, uint16_t len)
+{
+    if (unlikely(!pipe_is_valid(p) || !dst || len == 0))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    uint16_t bytes_read = pipe_bulk_read(p, dst, len);
+    bool resched = bytes_read && pipe_isr_wake_writers(p);
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    if (resched)
+        sched_isr_resched();
+    return (int32_t) bytes_read;
+}
+
+/* Zero-copy Operations */
+
+/* Describe @count bytes of the ring starting at index @start */
+static void pipe_span(const pipe_t *p,
+                      uint16_t start,
+                      uint16_t count,
+                      pipe_span_t *span)
+{
+    uint16_t to_end = (p->mask + 1) - start;
+
+    span->data[0] = p->buf + start;
+    span->len[0] = min(count, to_end);
+    span->data[1] = p->buf;
+    span->len[1] = count - span->len[0];
+}
+
+int32_t mo_pipe_write_reserve(pipe_t *p, pipe_span_t *span, uint16_t max)
+{
+    if (unlikely(!pipe_is_valid(p) || !span))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    if (unlikely(p->wr_claim)) {
+        spin_unlock_irqrestore(&p->lock, flags);
+        return ERR_TASK_BUSY;
+    }
+
+    uint16_t count = min(max, pipe_free_space_internal(p));
+    pipe_span(p, p->tail, count, span);
+    p->wr_claim = count;
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    return (int32_t) count;
+}
+
+int32_t mo_pipe_write_commit(pipe_t *p, uint16_t size)
+{
+    if (unlikely(!pipe_is_valid(p)))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    if (unlikely(size > p->wr_claim)) {
+        spin_unlock_irqrestore(&p->lock, flags);
+        return ERR_FAIL;
+    }
+
+    p->tail = (p->tail + size) & p->mask;
+    p->used += size;
+    p->wr_claim = 0;
+
+    /* New data for readers; writers held off by the claim may go on */
+    bool preempt = size && pipe_wake_readers(p);
+    preempt |= pipe_wake_writers(p);
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    if (preempt)
+        mo_task_yield();
+    return ERR_OK;
+}
+
+int32_t mo_pipe_read_acquire(pipe_t *p, pipe_span_t *span, uint16_t max)
+{
+    if (unlikely(!pipe_is_valid(p) || !span))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    if (unlikely(p->rd_claim)) {
+        spin_unlock_irqrestore(&p->lock, flags);
+        return ERR_TASK_BUSY;
+    }
+
+    uint16_t count = min(max, p->used);
+    pipe_span(p, p->head, count, span);
+    p->rd_claim = count;
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    return (int32_t) count;
+}
+
+int32_t mo_pipe_read_release(pipe_t *p, uint16_t size)
+{
+    if (unlikely(!pipe_is_valid(p)))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    if (unlikely(size > p->rd_claim)) {
+        spin_unlock_irqrestore(&p->lock, flags);
+        return ERR_FAIL;
+    }
+
+    p->head = (p->head + size) & p->mask;
+    p->used -= size;
+    p->rd_claim = 0;
+
+    /* Space for writers; readers held off by the claim may go on */
+    bool preempt = size && pipe_wake_writers(p);
+    preempt |= pipe_wake(&p->readers, &p->read_need, p->used);
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    if (preempt)
+        mo_task_yield();
+    return ERR_OK;
+}
+
+int32_t mo_pipe_splice(pipe_t *p, pipe_sink_t sink, uint16_t len)
+{
+    if (unlikely(!pipe_is_valid(p) || !len))
+        return ERR_FAIL;
+    if (!sink)
+        sink = _putbuf;
+
+    /* Wait for data with the head free, then claim it for the sink */
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    while (pipe_is_empty(p) || p->rd_claim) {
+        uint16_t need = min(p->read_wm, len);
+        pipe_block(p, &p->readers, &p->read_need, need, PIPE_FOREVER, 0,
+                   &flags);
+    }
+
+    pipe_span_t span;
+    uint16_t count = min(len, p->used);
+    pipe_span(p, p->head, count, &span);
+    p->rd_claim = count;
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    /* The sink may sleep while it is full; writers still fill the tail */
+    uint16_t moved = 0;
+    int n = 0;
+    for (int part = 0; part < 2 && span.len[part]; part++) {
+        n = sink(span.data[part], span.len[part]);
+        if (n > 0)
+            moved += n < span.len[part] ? (uint16_t) n : span.len[part];
+        if (n < span.len[part])
+            break;
+    }
+
+    mo_pipe_read_release(p, moved);
+    return moved || n >= 0 ? (int32_t) moved : ERR_FAIL;
+}
+
+bool _pipe_poll(void *pipe, poll_link_t *link, bool attach)
+{
+    pipe_t *p = pipe;
+    if (unlikely(!pipe_is_valid(p)))
+        return false;
+
+    uint32_t flags = spin_lock_irqsave(&p->lock);
+    _poll_list_update(&p->pollers, link, attach);
+    bool ready = !pipe_is_empty(p);
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    return ready;
+}
+
+#endif /* CONFIG_PIPE */
@@ -0,0 +1,162 @@
+/* Wait-for-multiple-objects.
+ *
+ * A polling task sets TASK_FLAG_POLL before it registers with its objects
+ * and checks them. Any object that becomes ready clears the flag and, if
+ * the task has already blocked, wakes it. The task only blocks if the flag
+ * is still set after the scan, so a wakeup between the scan and the block
+ * is never lost.
+ */
+
+#include <hal.h>
+#include <sys/poll.h>
+#include <sys/task.h>
+#include <sys/trace.h>
+
+#include "private/error.h"
+#include "private/utils.h"
+
+void _poll_list_update(poll_link_t **head, poll_link_t *link, bool attach)
+{
+    poll_link_t **pp = head;
+    while (*pp && *pp != link)
+        pp = &(*pp)->next;
+
+    if (attach && !*pp) {
+        link->next = *head;
+        *head = link;
+    } else if (!attach && *pp) {
+        *pp = link->next;
+        link->next = NULL;
+    }
+}
+
+bool _poll_wake(poll_link_t *head)
+{
+    bool preempt = false;
+
+    for (poll_link_t *l = head; l; l = l->next) {
+        tcb_t *task = l->task;
+
+        int32_t irq = hal_interrupt_set(0);
+        bool polling = task->flags & TASK_FLAG_POLL;
+        task->flags &= ~TASK_FLAG_POLL;
+        hal_interrupt_set(irq);
+
+        if (polling && task->state == TASK_BLOCKED) {
+            sched_wakeup_task(task);
+            preempt |= sched_wakeup_preempts(task);
+        }
+    }
+    return preempt;
+}
+
+/* Returns true if @type names an object type this kernel was built with */
+static inline bool poll_type_valid(poll_type_t type)
+{
+    return type <= POLL_NOTIFY && (CONFIG_PIPE || type != POLL_PIPE) &&
+           (CONFIG_MQUEUE || type != POLL_MQ);
+}
+
+/* Attaches or detaches one item; returns whether it is ready */
+static bool poll_item_update(poll_item_t *it, tcb_t *self, bool attach)
+{
+    switch (it->type) {
+#if CONFIG_PIPE
+    case POLL_PIPE:
+        return _pipe_poll(it->obj, &it->link, attach);
+#endif
+#if CONFIG_MQUEUE
+    case POLL_MQ:
+        return _mq_poll(it->obj, &it->link, attach);
+#endif
+    case POLL_SEM:
+        return _sem_poll(it->obj, &it->link, attach);
+    default: /* POLL_NOTIFY */
+        return self->notify_value & (it->mask ? it->mask : ~0U);
+    }
+}
+
+/* Detaches every item and records which ones are ready */
+static int32_t poll_finish(poll_item_t *items, uint16_t count, tcb_t *self)
+{
+    int32_t ready = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        items[i].ready = poll_item_update(&items[i], self, false);
+        ready += items[i].ready;
+    }
+    return ready;
+}
+
+int32_t mo_poll(poll_item_t *items, uint16_t count, uint32_t timeout)
+{
+    if (unlikely(!items || !count))
+        return ERR_FAIL;
+
+    tcb_t *self = kcb->task_current;
+    uint32_t notify_mask = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        if (unlikely(!poll_type_valid(items[i].type) ||
+                     (items[i].type != POLL_NOTIFY && !items[i].obj)))
+            return ERR_FAIL;
+        if (items[i].type == POLL_NOTIFY)
+            notify_mask |= items[i].mask ? items[i].mask : ~0U;
+        items[i].link.next = NULL;
+        items[i].link.task = self;
+    }
+
+    uint32_t deadline = mo_ticks() + timeout;
+
+    while (1) {
+        NOSCHED_ENTER();
+
+        int32_t irq = hal_interrupt_set(0);
+        self->flags |= TASK_FLAG_POLL;
+        hal_interrupt_set(irq);
+
+        bool any = false;
+        for (uint16_t i = 0; i < count; i++)
+            any |= poll_item_update(&items[i], self, true);
+
+        uint32_t now = mo_ticks();
+        bool expired = timeout != POLL_FOREVER && tick_reached(now, deadline);
+
+        irq = hal_interrupt_set(0);
+        bool still_polling = self->flags & TASK_FLAG_POLL;
+        if (any || expired || !still_polling) {
+            self->flags &= ~TASK_FLAG_POLL;
+            hal_interrupt_set(irq);
+
+            int32_t ready = poll_finish(items, count, self);
+            NOSCHED_LEAVE();
+
+            /* Whatever signalled us was consumed again: keep waiting */
+            if (!ready && !expired)
+                continue;
+            return ready;
+        }
+
+        /* Notifications reach us through the regular notify wake path */
+        self->notify_mask = notify_mask;
+        if (timeout == POLL_FOREVER) {
+            self->state = TASK_BLOCKED;
+            TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+        } else {
+            sched_delay_task(self, deadline - now);
+        }
+        hal_interrupt_set(irq);
+        NOSCHED_LEAVE();
+
+        mo_task_yield();
+
+        /* Woken by an object, the timeout, a notification or a resume;
+         * rescan, and block again if it was spurious.
+         */
+        NOSCHED_ENTER();
+        irq = hal_interrupt_set(0);
+        self->flags &= ~TASK_FLAG_POLL;
+        hal_interrupt_set(irq);
+        self->notify_mask = 0;
+        NOSCHED_LEAVE();
+    }
+}
@@ -0,0 +1,274 @@
+/* fixed-block memory pools
+ *
+ * A free block stores the link to the next free block in its first word, so
+ * the free list costs no memory beyond the blocks themselves. Freeing wakes
+ * at most one waiter, which takes the block on its next attempt; if another
+ * task gets there first, the waiter goes back to sleep with what is left of
+ * its timeout, so a block never sits free while a task waits for it.
+ */
+
+#include <lib/libc.h>
+#include <lib/malloc.h>
+
+#include <sys/pool.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
+#include <sys/trace.h>
+
+#include "private/error.h"
+#include "private/utils.h"
+
+static void pool_isr_kick(void *arg);
+
+static inline bool pool_is_valid(const pool_t *pool)
+{
+    return pool && pool->base && pool->stride;
+}
+
+/* True if @block is the start of one of @pool's blocks */
+static inline bool pool_owns(const pool_t *pool, const void *block)
+{
+    const char *p = block;
+    return p >= pool->base && p < pool->end &&
+           (uint32_t) (p - pool->base) % pool->stride == 0;
+}
+
+int32_t mo_pool_init(pool_t *pool, void *storage, uint32_t size,
+                     uint16_t count)
+{
+    if (unlikely(!pool || !storage || !size || !count ||
+                 (size_t) storage & (sizeof(void *) - 1)))
+        return ERR_FAIL;
+
+    /* Every block must hold the free-list link and stay word-aligned */
+    uint32_t stride = ALIGN4(size < sizeof(void *) ? sizeof(void *) : size);
+    if (unlikely(stride > UINT32_MAX / count))
+        return ERR_FAIL;
+
+    pool->base = storage;
+    pool->end = pool->base + stride * count;
+    pool->stride = stride;
+    pool->count = pool->nfree = pool->min_free = count;
+    pool->owns_storage = false;
+
+    /* Link back to front, so the first allocation returns the first block */
+    pool->free_list = NULL;
+    for (uint16_t i = count; i-- > 0;) {
+        void **link = (void **) (pool->base + i * stride);
+        *link = pool->free_list;
+        pool->free_list = link;
+    }
+
+    wq_init(&pool->waiters);
+    mo_defer_init(&pool->isr_work, pool_isr_kick, pool);
+    spin_lock_init(&pool->lock);
+    return ERR_OK;
+}
+
+pool_t *mo_pool_create(uint32_t size, uint16_t count)
+{
+    if (unlikely(!size || !count || size > MALLOC_MAX_SIZE / count))
+        return NULL;
+
+    pool_t *pool = malloc(sizeof(pool_t));
+    if (unlikely(!pool))
+        return NULL;
+
+    void *storage = malloc(POOL_STORAGE_SIZE(size, count));
+    if (unlikely(!storage || mo_pool_init(pool, storage, size, count))) {
+        free(storage);
+        free(pool);
+        return NULL;
+    }
+
+    pool->owns_storage = true;
+    return pool;
+}
+
+int32_t mo_pool_destroy(pool_t *pool)
+{
+    if (unlikely(!pool))
+        return ERR_OK; /* Destroying NULL is no-op */
+
+    if (unlikely(!pool_is_valid(pool)))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&pool->lock);
+
+    /* Blocked tasks, or a pending kick, would be left on freed memory */
+    if (unlikely(!wq_empty(&pool->waiters) || pool->isr_work.pending)) {
+        spin_unlock_irqrestore(&pool->lock, flags);
+        return ERR_TASK_BUSY;
+    }
+
+    bool owned = pool->owns_storage;
+    void *storage = pool->base;
+    pool->base = NULL; /* Later calls on a static pool fail cleanly */
+    pool->stride = 0;
+    spin_unlock_irqrestore(&pool->lock, flags);
+
+    if (owned) {
+        free(storage);
+        free(pool);
+    }
+    return ERR_OK;
+}
+
+/* Unlink the first free block, if any. Called with the lock held. */
+static inline void *pool_take(pool_t *pool)
+{
+    void **block = pool->free_list;
+    if (!block)
+        return NULL;
+
+    pool->free_list = *block;
+    if (--pool->nfree < pool->min_free)
+        pool->min_free = pool->nfree;
+    return block;
+}
+
+/* Link @block back in. Called with the lock held.
+ *
+ * Returns false if every block is already free, i.e. on a double free
+ */
+static inline bool pool_put(pool_t *pool, void *block)
+{
+    if (unlikely(pool->nfree >= pool->count))
+        return false;
+
+    *(void **) block = pool->free_list;
+    pool->free_list = block;
+    pool->nfree++;
+    return true;
+}
+
+/* Wake the next waiter, if any. Called with the lock held.
+ *
+ * Returns true if the woken task should preempt the caller
+ */
+static bool pool_wake_one(pool_t *pool)
+{
+    tcb_t *task = wq_pop(&pool->waiters);
+    if (!task)
+        return false;
+
+    sched_wakeup_task(task);
+    return sched_wakeup_preempts(task);
+}
+
+/* Deferred half of mo_pool_free_from_isr(): one waiter per free block */
+static void pool_isr_kick(void *arg)
+{
+    pool_t *pool = arg;
+    bool preempt = false;
+
+    uint32_t flags = spin_lock_irqsave(&pool->lock);
+    for (uint16_t n = pool->nfree; n && !wq_empty(&pool->waiters); n--)
+        preempt |= pool_wake_one(pool);
+    spin_unlock_irqrestore(&pool->lock, flags);
+
+    if (preempt)
+        mo_defer_resched();
+}
+
+void *mo_pool_alloc(pool_t *pool, uint32_t timeout)
+{
+    if (unlikely(!pool_is_valid(pool)))
+        return NULL;
+
+    tcb_t *self = kcb->task_current;
+    uint32_t deadline = mo_ticks() + timeout;
+    void *block;
+
+    uint32_t flags = spin_lock_irqsave(&pool->lock);
+    while (!(block = pool_take(pool))) {
+        uint32_t now = mo_ticks();
+        if (timeout != POOL_WAIT_FOREVER && tick_reached(now, deadline))
+            break;
+
+        wq_push(&pool->waiters, self);
+        if (timeout == POOL_WAIT_FOREVER) {
+            self->state = TASK_BLOCKED;
+            TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+        } else {
+            sched_delay_task(self, deadline - now);
+        }
+        spin_unlock_irqrestore(&pool->lock, flags);
+
+        mo_task_yield();
+
+        flags = spin_lock_irqsave(&pool->lock);
+        /* Still queued after a timeout: withdraw */
+        wq_remove(&pool->waiters, self);
+    }
+    spin_unlock_irqrestore(&pool->lock, flags);
+
+    return block;
+}
+
+int32_t mo_pool_free(pool_t *pool, void *block)
+{
+    if (unlikely(!pool_is_valid(pool) || !pool_owns(pool, block)))
+        return ERR_FAIL;
+
+    uint32_t flags = spin_lock_irqsave(&pool->lock);
+    if (unlikely(!pool_put(pool, block))) {
+        spin_unlock_irqrestore(&pool->lock, flags);
+        return ERR_FAIL;
+    }
+    bool preempt = pool_wake_one(pool);
+    spin_unlock_irqrestore(&pool->lock, flags);
+
+    if (preempt)
+        mo_task_yield();
+    return ERR_OK;
+}
+
+void *mo_pool_alloc_from_isr(pool_t *pool)
+{
+    if (unlikely(!pool_is_valid(pool)))
+        return NULL;
+
+    uint32_t flags = spin_lock_irqsave(&pool->lock);
+    void *block = pool_take(pool);
+    spin_unlock_irqrestore(&pool->lock, flags);
+
+    return block;
+}
+
+int32_t mo_pool_free_from_isr(pool_t *pool, void *block)
+{
+    if (unlikely(!pool_is_valid(pool) || !pool_owns(pool, block)))
+        return ERR_FAIL;
+
+    bool resched = false;
+
+    uint32_t flags = spin_lock_irqsave(&pool->lock);
+    if (unlikely(!pool_put(pool, block))) {
+        spin_unlock_irqrestore(&pool->lock, flags);
+        return ERR_FAIL;
+    }
+    if (!wq_empty(&pool->waiters)) {
+        if (sched_isr_may_wake()) {
+            resched = pool_wake_one(pool);
+        } else {
+            mo_defer_post(&pool->isr_work);
+            resched = true;
+        }
+    }
+    spin_unlock_irqrestore(&pool->lock, flags);
+
+    if (resched)
+        sched_isr_resched();
+    return ERR_OK;
+}
+
+int32_t mo_pool_available(const pool_t *pool)
+{
+    return pool ? pool->nfree : -1;
+}
+
+int32_t mo_pool_min_available(const pool_t *pool)
+{
+    return pool ? pool->min_free : -1;
+}
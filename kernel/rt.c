@@ -0,0 +1,312 @@
+/* Built-in real-time schedulers for the kernel's rt_sched hook.
+ *
+ * Periodic tasks attach an 'rt_params_t' record through mo_task_rt_priority().
+ * Released jobs are kept in a binary min-heap ordered by the active policy:
+ * - EDF: earliest absolute deadline first
+ * - RM : shortest relative deadline first (rate-monotonic when D = T,
+ *        deadline-monotonic otherwise)
+ * Completed jobs wait for their next release in a second heap ordered by
+ * release tick. Each record sits in exactly one heap at a time and remembers
+ * its position, so insertion and removal are O(log n) and the next job is
+ * found at the heap root in O(1).
+ *
+ * Admission control uses task densities C/D in Q16 fixed point: EDF accepts
+ * a task set while the total stays at or below 1.0, RM while it stays within
+ * the Liu & Layland bound n(2^(1/n) - 1).
+ */
+
+#include <hal.h>
+#include <sys/rt.h>
+#include <sys/task.h>
+
+#include "private/error.h"
+#include "private/utils.h"
+
+/* Job states */
+#define RT_JOB_DETACHED 0 /* Not attached to any task */
+#define RT_JOB_READY 1    /* Released, queued in the ready heap */
+#define RT_JOB_WAITING 2  /* Completed, queued in the release heap */
+
+/* Q16 fixed-point utilization, 1.0 == RT_UTIL_ONE */
+#define RT_UTIL_SHIFT 16
+#define RT_UTIL_ONE (1U << RT_UTIL_SHIFT)
+
+/* Liu & Layland RM bound n(2^(1/n) - 1) in Q16, indexed by n - 1 */
+static const uint32_t rm_bound[RT_MAX_TASKS] = {
+    65536, 54291, 51102, 49599, 48725, 48154, 47751, 47452,
+    47221, 47037, 46887, 46763, 46658, 46569, 46492, 46424,
+};
+
+/* Min-heap of parameter records */
+typedef struct {
+    rt_params_t *items[RT_MAX_TASKS];
+    uint8_t count;
+    bool (*before)(const rt_params_t *a, const rt_params_t *b);
+} rt_heap_t;
+
+static bool edf_before(const rt_params_t *a, const rt_params_t *b)
+{
+    return (int32_t) (a->abs_deadline - b->abs_deadline) < 0;
+}
+
+static bool rm_before(const rt_params_t *a, const rt_params_t *b)
+{
+    if (a->deadline != b->deadline)
+        return a->deadline < b->deadline;
+    return edf_before(a, b);
+}
+
+static bool release_before(const rt_params_t *a, const rt_params_t *b)
+{
+    return (int32_t) (a->release - b->release) < 0;
+}
+
+static rt_heap_t ready_heap = {.before = edf_before};
+static rt_heap_t release_heap = {.before = release_before};
+static uint32_t total_util = 0; /* Sum of admitted densities (Q16) */
+static uint8_t attached = 0;    /* Number of attached tasks */
+
+/* Heap primitives */
+
+static inline void heap_place(rt_heap_t *h, uint8_t idx, rt_params_t *p)
+{
+    h->items[idx] = p;
+    p->heap_idx = idx;
+}
+
+static void heap_sift_up(rt_heap_t *h, uint8_t idx)
+{
+    rt_params_t *p = h->items[idx];
+
+    while (idx > 0) {
+        uint8_t parent = (idx - 1) >> 1;
+        if (!h->before(p, h->items[parent]))
+            break;
+        heap_place(h, idx, h->items[parent]);
+        idx = parent;
+    }
+    heap_place(h, idx, p);
+}
+
+static void heap_sift_down(rt_heap_t *h, uint8_t idx)
+{
+    rt_params_t *p = h->items[idx];
+
+    for (;;) {
+        uint8_t child = (idx << 1) + 1;
+        if (child >= h->count)
+            break;
+        if (child + 1 < h->count &&
+            h->before(h->items[child + 1], h->items[child]))
+            child++;
+        if (!h->before(h->items[child], p))
+            break;
+        heap_place(h, idx, h->items[child]);
+        idx = child;
+    }
+    heap_place(h, idx, p);
+}
+
+static void heap_push(rt_heap_t *h, rt_params_t *p)
+{
+    h->items[h->count] = p;
+    heap_sift_up(h, h->count++);
+}
+
+static void heap_remove(rt_heap_t *h, rt_params_t *p)
+{
+    uint8_t idx = (uint8_t) p->heap_idx;
+    rt_params_t *last = h->items[--h->count];
+
+    p->heap_idx = -1;
+    if (idx == h->count)
+        return;
+
+    heap_place(h, idx, last);
+    heap_sift_up(h, idx);
+    heap_sift_down(h, (uint8_t) last->heap_idx);
+}
+
+/* Job management */
+
+/* Starts the job released at p->release */
+static void job_release(rt_params_t *p)
+{
+    p->abs_deadline = p->release + p->deadline;
+    p->state = RT_JOB_READY;
+    heap_push(&ready_heap, p);
+}
+
+static void job_unlink(rt_params_t *p)
+{
+    if (p->state == RT_JOB_READY)
+        heap_remove(&ready_heap, p);
+    else if (p->state == RT_JOB_WAITING)
+        heap_remove(&release_heap, p);
+    p->state = RT_JOB_DETACHED;
+}
+
+static inline bool task_runnable(const tcb_t *task)
+{
+    return task->state == TASK_READY || task->state == TASK_RUNNING;
+}
+
+/* Scheduler hook: returns the task ID of the most urgent runnable job */
+static int32_t rt_schedule(void)
+{
+    uint32_t now = kcb->ticks;
+
+    /* Move jobs whose release time has come into the ready heap */
+    while (release_heap.count &&
+           tick_reached(now, release_heap.items[0]->release)) {
+        rt_params_t *p = release_heap.items[0];
+        heap_remove(&release_heap, p);
+        job_release(p);
+    }
+
+    if (!ready_heap.count)
+        return -1;
+
+    /* Common case: the most urgent job can run */
+    rt_params_t *best = ready_heap.items[0];
+    if (likely(task_runnable(best->task)))
+        return best->task->id;
+
+    /* The root job is blocked on a resource; pick the most urgent one that
+     * can run instead. Only this uncommon path is linear in the heap size.
+     */
+    best = NULL;
+    for (uint8_t i = 1; i < ready_heap.count; i++) {
+        rt_params_t *p = ready_heap.items[i];
+        if (task_runnable(p->task) && (!best || ready_heap.before(p, best)))
+            best = p;
+    }
+    return best ? best->task->id : -1;
+}
+
+/* Admission bound for @n tasks under the active policy */
+static uint32_t admission_bound(uint8_t n)
+{
+    if (ready_heap.before == edf_before)
+        return RT_UTIL_ONE;
+    return rm_bound[n - 1];
+}
+
+/* Attach hook, called by mo_task_rt_priority() with interrupts disabled */
+static int32_t rt_attach(tcb_t *task, void *params)
+{
+    rt_params_t *old = task->rt_prio;
+    rt_params_t *p = params;
+
+    /* Detach request, or re-attach with a different record */
+    if (!p || (old && old != p)) {
+        if (old && old->state != RT_JOB_DETACHED) {
+            job_unlink(old);
+            old->task = NULL;
+            total_util -= old->util;
+            attached--;
+        }
+        if (!p)
+            return ERR_OK;
+    }
+
+    if (unlikely(!p->period || !p->wcet))
+        return ERR_RT_PARAMS;
+    if (!p->deadline)
+        p->deadline = p->period;
+    if (unlikely(p->deadline > p->period || p->wcet > p->deadline))
+        return ERR_RT_PARAMS;
+
+    /* Same record re-attached: just restart the task's job sequence */
+    bool reattach = (p->state != RT_JOB_DETACHED && p->task == task);
+    if (reattach) {
+        job_unlink(p);
+        total_util -= p->util;
+        attached--;
+    } else if (unlikely(p->state != RT_JOB_DETACHED)) {
+        return ERR_RT_PARAMS; /* Record in use by another task */
+    }
+
+    uint32_t util = (uint32_t) ((((uint64_t) p->wcet << RT_UTIL_SHIFT) +
+                                 p->deadline - 1) /
+                                p->deadline);
+
+    if (unlikely(attached >= RT_MAX_TASKS ||
+                 total_util + util > admission_bound(attached + 1)))
+        return ERR_RT_ADMISSION;
+
+    p->task = task;
+    p->util = util;
+    p->jobs = 0;
+    p->misses = 0;
+    p->heap_idx = -1;
+    p->release = kcb->ticks;
+    total_util += util;
+    attached++;
+
+    job_release(p);
+    return ERR_OK;
+}
+
+int32_t mo_rt_init(rt_policy_t policy)
+{
+    if (unlikely(policy != RT_POLICY_EDF && policy != RT_POLICY_RM))
+        return ERR_RT_PARAMS;
+
+    CRITICAL_ENTER();
+    if (unlikely(attached)) {
+        CRITICAL_LEAVE();
+        return ERR_TASK_BUSY;
+    }
+
+    ready_heap.before = (policy == RT_POLICY_EDF) ? edf_before : rm_before;
+    kcb->rt_sched = rt_schedule;
+    kcb->rt_attach = rt_attach;
+    CRITICAL_LEAVE();
+
+    return ERR_OK;
+}
+
+void mo_rt_wait_period(void)
+{
+    NOSCHED_ENTER();
+
+    tcb_t *self = kcb->task_current;
+    rt_params_t *p = self->rt_prio;
+    if (unlikely(kcb->rt_attach != rt_attach || !p || p->task != self ||
+                 p->state != RT_JOB_READY)) {
+        NOSCHED_LEAVE();
+        return;
+    }
+
+    uint32_t now = kcb->ticks;
+
+    /* Job completion bookkeeping */
+    p->jobs++;
+    if (!tick_reached(p->abs_deadline, now))
+        p->misses++;
+
+    heap_remove(&ready_heap, p);
+    p->release += p->period;
+
+    if (tick_reached(now, p->release)) {
+        /* Overran into the next period: start the next job right away */
+        job_release(p);
+        NOSCHED_LEAVE();
+        mo_task_yield();
+        return;
+    }
+
+    /* Sleep until the release; rt_schedule() re-queues the job then */
+    p->state = RT_JOB_WAITING;
+    heap_push(&release_heap, p);
+    sched_delay_task(self, p->release - now);
+    NOSCHED_LEAVE();
+
+    mo_task_yield();
+}
+
+uint32_t mo_rt_utilization(void)
+{
+    return (total_util * 1000U) >> RT_UTIL_SHIFT;
+}
@@ -5,30 +5,71 @@
  * semaphore, blocking until a resource is available, and signal (post) to
  * release a resource, potentially waking up a waiting task.
  * The wait queue is served in strict First-In, First-Out (FIFO) order.
+ *
+ * The lock is taken under NOSCHED with a plain spin_lock, as for mutexes,
+ * so the task paths touch no CSR. Handlers never take it:
+ * mo_sem_signal_from_isr() banks its token in an atomic counter and posts
+ * sem_isr_kick(), which folds the banked tokens into the count under the
+ * lock at the next switch point and hands them to the waiters.
  */
 
 #include <hal.h>
+#include <lib/slab.h>
+#include <sys/defer.h>
+#include <sys/poll.h>
 #include <sys/semaphore.h>
+#include <sys/spinlock.h>
 #include <sys/task.h>
+#include <sys/trace.h>
 
 #include "private/error.h"
 #include "private/utils.h"
 
 /* Semaphore Control Block structure. */
 struct sem_t {
-    queue_t *wait_q;        /**< Queue of tasks blocked on this semaphore. */
+    wait_queue_t wait_q;    /**< Tasks blocked on this semaphore. */
     volatile int32_t count; /**< Number of available resources (tokens). */
-    uint16_t max_waiters;   /**< Maximum capacity of wait queue. */
     uint32_t magic;         /**< Magic number for validation. */
+    spinlock_t lock;        /**< Protects count and wait_q. */
+    poll_link_t *pollers;   /**< Tasks waiting in mo_poll() for a token. */
+    defer_work_t isr_work;  /**< Hands over the tokens banked by ISRs. */
+    atomic_t isr_tokens;    /**< Signals from ISRs not yet in 'count'. */
+#if CONFIG_LOCK_STATS
+    lock_stats_t stats; /**< Contention history, see <sys/lockstat.h>. */
+#endif
 };
 
 /* Magic number for semaphore validation */
 #define SEM_MAGIC 0x53454D00 /* "SEM\0" */
 
+static slab_cache_t sem_cache = SLAB_CACHE_INIT_HINT("sem", sem_t, MEM_FAST);
+
+#if CONFIG_LOCK_STATS
+#define sem_stats_taken(s) ((s)->stats.acquired++)
+
+/* Note that the current task queued on @s, and when */
+static inline void sem_stats_queued(sem_t *s, tcb_t *self)
+{
+    s->stats.contended++;
+    self->lock_wait_start = hal_clock_read();
+}
+
+/* Account the token handed over to the queued @task */
+static inline void sem_stats_handover(sem_t *s, tcb_t *task)
+{
+    s->stats.acquired++;
+    _lock_stats_wait(&s->stats, task->lock_wait_start);
+}
+#else
+#define sem_stats_taken(s) ((void) 0)
+#define sem_stats_queued(s, self) ((void) 0)
+#define sem_stats_handover(s, task) ((void) 0)
+#endif
+
 static inline bool sem_is_valid(const sem_t *s)
 {
-    return s && s->magic == SEM_MAGIC && s->wait_q && s->max_waiters > 0 &&
-           s->count >= 0 && s->count <= SEM_MAX_COUNT;
+    return s && s->magic == SEM_MAGIC && s->count >= 0 &&
+           s->count <= SEM_MAX_COUNT;
 }
 
 static inline void sem_invalidate(sem_t *s)
@@ -36,10 +77,48 @@ static inline void sem_invalidate(sem_t *s)
     if (s) {
         s->magic = 0xDEADBEEF; /* Clear magic to prevent reuse */
         s->count = -1;
-        s->max_waiters = 0;
     }
 }
 
+/* Deferred half of mo_sem_signal_from_isr(): moves the banked tokens into
+ * the count and passes them on to the tasks waiting for them.
+ */
+static void sem_isr_kick(void *arg)
+{
+    sem_t *s = arg;
+    if (unlikely(!sem_is_valid(s)))
+        return;
+
+    bool should_yield = false;
+
+    NOSCHED_ENTER();
+    spin_lock(&s->lock);
+
+    /* Only subtract what was read: a handler may bank another meanwhile */
+    uint32_t banked = atomic_read(&s->isr_tokens);
+    if (banked) {
+        atomic_add_return(&s->isr_tokens, -banked);
+        s->count = banked < (uint32_t) (SEM_MAX_COUNT - s->count)
+                       ? s->count + (int32_t) banked
+                       : SEM_MAX_COUNT;
+    }
+
+    while (s->count > 0 && !wq_empty(&s->wait_q)) {
+        tcb_t *task = wq_pop(&s->wait_q);
+        s->count--;
+        sem_stats_handover(s, task);
+        sched_wakeup_task(task);
+        should_yield |= sched_wakeup_preempts(task);
+    }
+    if (s->count > 0 && s->pollers)
+        should_yield |= _poll_wake(s->pollers);
+    spin_unlock(&s->lock);
+    NOSCHED_LEAVE();
+
+    if (should_yield)
+        mo_defer_resched();
+}
+
 sem_t *mo_sem_create(uint16_t max_waiters, int32_t initial_count)
 {
     /* Enhanced input validation */
@@ -47,26 +126,19 @@ sem_t *mo_sem_create(uint16_t max_waiters, int32_t initial_count)
                  initial_count > SEM_MAX_COUNT))
         return NULL;
 
-    sem_t *sem = malloc(sizeof(sem_t));
+    sem_t *sem = slab_alloc(&sem_cache);
     if (unlikely(!sem))
         return NULL;
 
-    /* Initialize structure to known safe state */
-    sem->wait_q = NULL;
-    sem->count = 0;
-    sem->max_waiters = 0;
-    sem->magic = 0;
-
-    /* Create wait queue */
-    sem->wait_q = queue_create(max_waiters);
-    if (unlikely(!sem->wait_q)) {
-        free(sem);
-        return NULL;
-    }
-
-    /* Initialize remaining fields atomically */
+    wq_init(&sem->wait_q);
     sem->count = initial_count;
-    sem->max_waiters = max_waiters;
+    sem->pollers = NULL;
+    mo_defer_init(&sem->isr_work, sem_isr_kick, sem);
+    atomic_set(&sem->isr_tokens, 0);
+    spin_lock_init(&sem->lock);
+#if CONFIG_LOCK_STATS
+    _lock_stats_init(&sem->stats, LOCK_STAT_SEM);
+#endif
     sem->magic = SEM_MAGIC; /* Mark as valid last to prevent races */
 
     return sem;
@@ -81,27 +153,31 @@ int32_t mo_sem_destroy(sem_t *s)
         return ERR_FAIL;
 
     NOSCHED_ENTER();
+    spin_lock(&s->lock);
 
-    /* Check if any tasks are waiting - unsafe to destroy if so */
-    if (unlikely(queue_count(s->wait_q) > 0)) {
+    /* Check if any tasks are waiting, or a kick is pending - unsafe to
+     * destroy if so
+     */
+    if (unlikely(!wq_empty(&s->wait_q) || s->isr_work.pending)) {
+        spin_unlock(&s->lock);
         NOSCHED_LEAVE();
         return ERR_TASK_BUSY;
     }
 
     /* Atomically invalidate the semaphore to prevent further use */
     sem_invalidate(s);
-    queue_t *wait_q = s->wait_q;
-    s->wait_q = NULL;
 
+    spin_unlock(&s->lock);
     NOSCHED_LEAVE();
 
-    /* Clean up resources outside critical section */
-    queue_destroy(wait_q);
-    free(s);
+#if CONFIG_LOCK_STATS
+    _lock_stats_unregister(&s->stats);
+#endif
+    slab_free(&sem_cache, s);
     return ERR_OK;
 }
 
-void mo_sem_wait(sem_t *s)
+__fast_text void mo_sem_wait(sem_t *s)
 {
     if (unlikely(!sem_is_valid(s))) {
         /* Invalid semaphore - this is a programming error */
@@ -109,28 +185,29 @@ void mo_sem_wait(sem_t *s)
     }
 
     NOSCHED_ENTER();
+    spin_lock(&s->lock);
 
     /* Fast path: resource available and no waiters (preserves FIFO ordering) */
-    if (likely(s->count > 0 && queue_count(s->wait_q) == 0)) {
+    if (likely(s->count > 0 && wq_empty(&s->wait_q))) {
         s->count--;
+        sem_stats_taken(s);
+        spin_unlock(&s->lock);
         NOSCHED_LEAVE();
         return;
     }
 
-    /* Slow path: must wait for resource */
-    /* Verify wait queue has capacity before attempting to block */
-    if (unlikely(queue_count(s->wait_q) >= s->max_waiters)) {
-        NOSCHED_LEAVE();
-        panic(ERR_SEM_OPERATION); /* Queue overflow - system error */
-    }
-
-    /* Block current task atomically. _sched_block will:
-     * 1. Add current task to wait queue
-     * 2. Set task state to BLOCKED
-     * 3. Call scheduler without releasing NOSCHED lock
-     * The lock is released when we context switch to another task.
+    /* Slow path: queue and mark the task blocked while still holding the
+     * lock, so a signal arriving after the unlock always finds us queued.
      */
-    _sched_block(s->wait_q);
+    tcb_t *self = kcb->task_current;
+    wq_push(&s->wait_q, self);
+    sem_stats_queued(s, self);
+    self->state = TASK_BLOCKED;
+    TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+    spin_unlock(&s->lock);
+    NOSCHED_LEAVE();
+
+    mo_task_yield();
 
     /* When we return here, we have been awakened and acquired the semaphore.
      * The signaling task passed the "token" directly to us without incrementing
@@ -138,7 +215,7 @@ void mo_sem_wait(sem_t *s)
      */
 }
 
-int32_t mo_sem_trywait(sem_t *s)
+__fast_text int32_t mo_sem_trywait(sem_t *s)
 {
     if (unlikely(!sem_is_valid(s)))
         return ERR_FAIL;
@@ -146,18 +223,21 @@ int32_t mo_sem_trywait(sem_t *s)
     int32_t result = ERR_FAIL;
 
     NOSCHED_ENTER();
+    spin_lock(&s->lock);
 
     /* Only succeed if resource available AND no waiters (preserves FIFO) */
-    if (s->count > 0 && queue_count(s->wait_q) == 0) {
+    if (s->count > 0 && wq_empty(&s->wait_q)) {
         s->count--;
+        sem_stats_taken(s);
         result = ERR_OK;
     }
 
+    spin_unlock(&s->lock);
     NOSCHED_LEAVE();
     return result;
 }
 
-void mo_sem_signal(sem_t *s)
+__fast_text void mo_sem_signal(sem_t *s)
 {
     if (unlikely(!sem_is_valid(s))) {
         /* Invalid semaphore - this is a programming error */
@@ -168,16 +248,18 @@ void mo_sem_signal(sem_t *s)
     tcb_t *awakened_task = NULL;
 
     NOSCHED_ENTER();
+    spin_lock(&s->lock);
 
     /* Check if any tasks are waiting for resources */
-    if (queue_count(s->wait_q) > 0) {
+    if (!wq_empty(&s->wait_q)) {
         /* Wake up the oldest waiting task (FIFO order) */
-        awakened_task = queue_dequeue(s->wait_q);
+        awakened_task = wq_pop(&s->wait_q);
         if (likely(awakened_task)) {
             /* Validate awakened task state consistency */
             if (likely(awakened_task->state == TASK_BLOCKED)) {
-                awakened_task->state = TASK_READY;
-                should_yield = true;
+                sem_stats_handover(s, awakened_task);
+                sched_wakeup_task(awakened_task);
+                should_yield = sched_wakeup_preempts(awakened_task);
             } else {
                 /* Task state inconsistency - this should not happen */
                 panic(ERR_SEM_OPERATION);
@@ -192,22 +274,39 @@ void mo_sem_signal(sem_t *s)
         /* No waiting tasks - increment available resource count */
         if (likely(s->count < SEM_MAX_COUNT))
             s->count++;
+        if (s->pollers)
+            should_yield = _poll_wake(s->pollers);
 
         /* Silently ignore overflow - semaphore remains at max count.
          * This prevents wraparound while maintaining system stability.
          */
     }
 
+    spin_unlock(&s->lock);
     NOSCHED_LEAVE();
 
-    /* Yield outside critical section if we awakened a task.
-     * This improves system responsiveness by allowing the awakened task to run
-     * immediately if it has higher priority.
+    /* Yield outside critical section only if the awakened task outranks us,
+     * so it runs immediately; a lower-priority waiter waits for its turn
+     * without costing a context switch now.
      */
     if (should_yield)
         mo_task_yield();
 }
 
+int32_t mo_sem_signal_from_isr(sem_t *s)
+{
+    if (unlikely(!sem_is_valid(s)))
+        return ERR_FAIL;
+
+    /* The drain runs at the switch this requests, ahead of the pick, so a
+     * waiter woken by the kick is already a candidate for it.
+     */
+    atomic_inc(&s->isr_tokens);
+    mo_defer_post(&s->isr_work);
+    sched_isr_resched();
+    return ERR_OK;
+}
+
 int32_t mo_sem_getvalue(sem_t *s)
 {
     if (unlikely(!sem_is_valid(s)))
@@ -229,8 +328,75 @@ int32_t mo_sem_waiting_count(sem_t *s)
     int32_t count;
 
     NOSCHED_ENTER();
-    count = queue_count(s->wait_q);
+    spin_lock(&s->lock);
+    count = s->wait_q.count;
+    spin_unlock(&s->lock);
     NOSCHED_LEAVE();
 
     return count;
 }
+
+int32_t mo_sem_stats(sem_t *s, lock_stats_t *stats)
+{
+#if CONFIG_LOCK_STATS
+    if (unlikely(!sem_is_valid(s) || !stats))
+        return ERR_FAIL;
+
+    NOSCHED_ENTER();
+    spin_lock(&s->lock);
+    *stats = s->stats;
+    spin_unlock(&s->lock);
+    NOSCHED_LEAVE();
+
+    return ERR_OK;
+#else
+    (void) s;
+    (void) stats;
+    return ERR_FAIL;
+#endif
+}
+
+int32_t mo_sem_stats_register(sem_t *s, const char *name)
+{
+#if CONFIG_LOCK_STATS
+    if (unlikely(!sem_is_valid(s)))
+        return ERR_FAIL;
+
+    _lock_stats_register(&s->stats, name);
+    return ERR_OK;
+#else
+    (void) s;
+    (void) name;
+    return ERR_FAIL;
+#endif
+}
+
+bool _sem_poll(void *sem, poll_link_t *link, bool attach)
+{
+    sem_t *s = sem;
+    if (unlikely(!sem_is_valid(s)))
+        return false;
+
+    NOSCHED_ENTER();
+    spin_lock(&s->lock);
+    _poll_list_update(&s->pollers, link, attach);
+    bool ready = s->count > 0;
+    spin_unlock(&s->lock);
+    NOSCHED_LEAVE();
+
+    return ready;
+}
+
+int32_t mo_sem_set_policy(sem_t *s, wait_policy_t policy)
+{
+    if (unlikely(!sem_is_valid(s) || policy > WAIT_PRIO))
+        return ERR_FAIL;
+
+    NOSCHED_ENTER();
+    spin_lock(&s->lock);
+    s->wait_q.policy = policy;
+    spin_unlock(&s->lock);
+    NOSCHED_LEAVE();
+
+    return ERR_OK;
+}
@@ -154,11 +154,7 @@ static int _read(int file, char *ptr, int len)
         return -1;
     }
 
-    int idx;
-    for (idx = 0; idx < len; idx++)
-        *ptr++ = _getchar();
-
-    return len;
+    return _getbuf(ptr, len);
 }
 
 static int _write(int file, char *ptr, int len)
@@ -173,11 +169,7 @@ static int _write(int file, char *ptr, int len)
         return -1;
     }
 
-    int idx;
-    for (idx = 0; idx < len; idx++)
-        _putchar(*ptr++);
-
-    return len;
+    return _putbuf(ptr, len);
 }
 
 static int _lseek(int file, int ptr, int dir)
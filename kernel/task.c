@@ -6,38 +6,66 @@
  */
 
 #include <hal.h>
+#include <lib/malloc.h>
 #include <lib/queue.h>
+#include <lib/slab.h>
+#include <sys/clock.h>
+#include <sys/defer.h>
 #include <sys/task.h>
+#include <sys/trace.h>
 
 #include "private/error.h"
 #include "private/utils.h"
 
 static int32_t noop_rtsched(void);
 void _timer_tick_handler(void);
+bool _timer_next_deadline(uint32_t *deadline);
+void _mutex_pi_refresh(tcb_t *task);
+void _mutex_task_exit(tcb_t *task);
 
 /* Kernel-wide control block (KCB) */
-static kcb_t kernel_state = {
-    .tasks = NULL,
+static __fast_data kcb_t kernel_state = {
+    .tasks = DLIST_INIT(kernel_state.tasks),
     .task_current = NULL,
     .rt_sched = noop_rtsched,
-    .timer_list = NULL, /* Managed by timer.c, but stored here. */
-    .next_tid = 1,      /* Start from 1 to avoid confusion with invalid ID 0 */
+    .rt_attach = NULL,
+    .next_slot = 1,     /* Slot 0 is reserved, so ID 0 is never handed out */
     .task_count = 0,
     .ticks = 0,
-    .preemptive = true, /* Default to preemptive mode */
+    .ticks_hi = 0,
+    .preempt_count = 0,
+    .resched_pending = false,
+    .preemptive = CONFIG_SCHED_MODE != SCHED_MODE_COOPERATIVE,
 };
 kcb_t *kcb = &kernel_state;
 
-/* timer work management for reduced latency */
-static volatile uint32_t timer_work_pending = 0;    /* timer work types */
-static volatile uint32_t timer_work_generation = 0; /* counter for coalescing */
+/* TCBs of heap-backed tasks; mo_task_spawn_static() brings its own */
+static slab_cache_t tcb_cache = SLAB_CACHE_INIT_HINT("tcb", tcb_t, MEM_FAST);
 
-/* Timer work types for prioritized processing */
-#define TIMER_WORK_TICK_HANDLER (1U << 0) /* Standard timer callbacks */
-#define TIMER_WORK_DELAY_UPDATE (1U << 1) /* Task delay processing */
-#define TIMER_WORK_CRITICAL (1U << 2)     /* High-priority timer work */
+#if CONFIG_FAST_RAM && CONFIG_FAST_TCBS
+/* The first TCBs, seeded into tcb_cache, sit in fast RAM with the KCB */
+static __fast_bss tcb_t tcb_fast[CONFIG_FAST_TCBS];
+#endif
+
+#if CONFIG_TIMER
+/* Tick work posted by the timer interrupt: wakes the timer service task */
+static void tick_work_fn(void *arg)
+{
+    (void) arg;
+    _timer_tick_handler();
+}
+
+static defer_work_t tick_work = DEFER_WORK_INIT(tick_work_fn, NULL);
+
+static inline void timer_tick_post(void)
+{
+    mo_defer_post(&tick_work);
+}
+#else
+static inline void timer_tick_post(void) {}
+#endif
 
-#if CONFIG_STACK_PROTECTION
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_CANARY
 /* Stack canary checking frequency - check every N context switches */
 #define STACK_CHECK_INTERVAL 32
 
@@ -47,14 +75,24 @@ static volatile uint32_t timer_work_generation = 0; /* counter for coalescing */
 
 /* Stack check counter for periodic validation (reduces overhead). */
 static uint32_t stack_check_counter = 0;
-#endif /* CONFIG_STACK_PROTECTION */
+#endif /* CONFIG_STACK_PROTECTION == STACK_PROTECT_CANARY */
 
-/* Task lookup cache to accelerate frequent ID searches */
-static struct {
-    uint16_t id;
-    tcb_t *task;
-} task_cache[TASK_CACHE_SIZE];
-static uint8_t cache_index = 0;
+#if CONFIG_STACK_WATERMARK
+/* Fill pattern for unused stack words, scanned by mo_task_stack_usage() */
+#define STACK_FILL_PATTERN 0xA5A5A5A5U
+
+/* Headroom added on top of the measured peak by the shrink recommendation */
+#define STACK_SLACK_MIN 64U
+
+/* First word the watermark scan may read: word 0 holds the low canary, and
+ * a PMP guard makes the bottom of the running task's stack unreadable.
+ */
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_PMP
+#define STACK_SCAN_FIRST (HAL_STACK_GUARD_SIZE / sizeof(uint32_t))
+#else
+#define STACK_SCAN_FIRST 1U
+#endif
+#endif
 
 /* Priority-to-timeslice mapping table */
 static const uint8_t priority_timeslices[TASK_PRIORITY_LEVELS] = {
@@ -68,7 +106,7 @@ static const uint8_t priority_timeslices[TASK_PRIORITY_LEVELS] = {
     TASK_TIMESLICE_IDLE      /* Priority 7: Idle */
 };
 
-/* Mark task as ready (state-based) */
+/* Mark task as ready and link it into its ready queue */
 static void sched_enqueue_task(tcb_t *task);
 
 /* Utility and Validation Functions */
@@ -113,25 +151,54 @@ static inline bool is_valid_task(tcb_t *task)
             task->entry && task->id);
 }
 
-/* Add task to lookup cache */
-static inline void cache_task(uint16_t id, tcb_t *task)
+/* Task Table Management */
+
+/* Compose the ID handed out for @slot at its current generation */
+static inline uint16_t slot_task_id(uint8_t slot)
 {
-    task_cache[cache_index].id = id;
-    task_cache[cache_index].task = task;
-    cache_index = (cache_index + 1) % TASK_CACHE_SIZE;
+    return (uint16_t) ((kcb->task_table[slot].gen << TASK_SLOT_BITS) | slot);
 }
 
-/* Quick cache lookup before expensive list traversal */
-static tcb_t *cache_lookup_task(uint16_t id)
+/* Claim a free slot for @task and assign its ID.
+ * Scanning starts after the most recently used slot so that freed slots,
+ * and thus their IDs, are not reused sooner than necessary.
+ * Returns false if the table is full.
+ */
+static bool task_table_insert(tcb_t *task)
 {
-    for (int i = 0; i < TASK_CACHE_SIZE; i++) {
-        if (task_cache[i].id == id && is_valid_task(task_cache[i].task))
-            return task_cache[i].task;
+    uint8_t slot = kcb->next_slot;
+
+    for (uint8_t n = 1; n < TASK_MAX_TASKS; n++) {
+        if (!kcb->task_table[slot].task) {
+            kcb->task_table[slot].task = task;
+            task->id = slot_task_id(slot);
+            kcb->next_slot = (slot + 1) & TASK_SLOT_MASK;
+            if (!kcb->next_slot)
+                kcb->next_slot = 1;
+            return true;
+        }
+        slot = (slot + 1) & TASK_SLOT_MASK;
+        if (!slot)
+            slot = 1;
     }
-    return NULL;
+    return false;
+}
+
+/* Release the slot of @task and retire its ID */
+static void task_table_remove(tcb_t *task)
+{
+    task_slot_t *entry = &kcb->task_table[task->id & TASK_SLOT_MASK];
+
+    entry->task = NULL;
+    entry->gen++;
+    /* Skip the generation whose ID for this slot would be UINT16_MAX, which
+     * mutexes use as an invalid owner marker.
+     */
+    if (slot_task_id(task->id & TASK_SLOT_MASK) == UINT16_MAX)
+        entry->gen++;
 }
 
-#if CONFIG_STACK_PROTECTION
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_CANARY
 /* Stack integrity check with reduced frequency */
 static void task_stack_check(void)
 {
@@ -142,10 +209,10 @@ static void task_stack_check(void)
     if (!should_check)
         return;
 
-    if (unlikely(!kcb || !kcb->task_current || !kcb->task_current->data))
+    if (unlikely(!kcb || !kcb->task_current))
         panic(ERR_STACK_CHECK);
 
-    tcb_t *self = kcb->task_current->data;
+    tcb_t *self = kcb->task_current;
     if (unlikely(!is_valid_task(self)))
         panic(ERR_STACK_CHECK);
 
@@ -162,132 +229,18 @@ static void task_stack_check(void)
         panic(ERR_STACK_CHECK);
     }
 }
-#endif /* CONFIG_STACK_PROTECTION */
-
-/* Batch delay processing for blocked tasks */
-static list_node_t *delay_update_batch(list_node_t *node, void *arg)
-{
-    uint32_t *ready_count = (uint32_t *) arg;
-    if (unlikely(!node || !node->data))
-        return NULL;
-
-    tcb_t *t = node->data;
-
-    /* Skip non-blocked tasks (common case) */
-    if (likely(t->state != TASK_BLOCKED))
-        return NULL;
-
-    /* Process delays only if tick actually advanced */
-    if (t->delay > 0) {
-        if (--t->delay == 0) {
-            t->state = TASK_READY;
-            /* Add to appropriate priority ready queue */
-            sched_enqueue_task(t);
-            (*ready_count)++;
-        }
-    }
-    return NULL;
-}
-
-/* timer work processing with coalescing and prioritization */
-static inline void process_timer_work(uint32_t work_mask)
-{
-    if (unlikely(!work_mask))
-        return;
-
-    /* Process high-priority timer work first */
-    if (work_mask & TIMER_WORK_CRITICAL) {
-        /* Handle critical timer callbacks immediately */
-        _timer_tick_handler();
-    } else if (work_mask & TIMER_WORK_TICK_HANDLER) {
-        /* Handle standard timer callbacks */
-        _timer_tick_handler();
-    }
-
-    /* Delay updates are handled separately in scheduler */
-}
-
-/* Fast timer work processing for yield points */
-static inline void process_deferred_timer_work(void)
-{
-    uint32_t work = timer_work_pending;
-    if (likely(!work))
-        return;
-
-    /* Atomic clear with generation check to prevent race conditions */
-    uint32_t current_gen = timer_work_generation;
-    timer_work_pending = 0;
-
-    process_timer_work(work);
-
-    /* Check if new work arrived while processing */
-    if (unlikely(timer_work_generation != current_gen)) {
-        /* New work arrived, will be processed on next yield */
-    }
-}
-
-/* delay update for cooperative mode */
-static list_node_t *delay_update(list_node_t *node, void *arg)
-{
-    (void) arg;
-    if (unlikely(!node || !node->data))
-        return NULL;
-
-    tcb_t *t = node->data;
-
-    /* Skip non-blocked tasks (common case) */
-    if (likely(t->state != TASK_BLOCKED))
-        return NULL;
-
-    /* Decrement delay and unblock task if expired */
-    if (t->delay > 0 && --t->delay == 0) {
-        t->state = TASK_READY;
-        /* Add to appropriate priority ready queue */
-        sched_enqueue_task(t);
-    }
-    return NULL;
-}
-
-/* Task search callbacks for finding tasks in the master list. */
-static list_node_t *idcmp(list_node_t *node, void *arg)
-{
-    return (node && node->data &&
-            ((tcb_t *) node->data)->id == (uint16_t) (size_t) arg)
-               ? node
-               : NULL;
-}
+#endif /* CONFIG_STACK_PROTECTION == STACK_PROTECT_CANARY */
 
-static list_node_t *refcmp(list_node_t *node, void *arg)
-{
-    return (node && node->data && ((tcb_t *) node->data)->entry == arg) ? node
-                                                                        : NULL;
-}
-
-/* Task lookup with caching */
-static list_node_t *find_task_node_by_id(uint16_t id)
+/* O(1) task lookup through the task table. IDs of cancelled tasks fail the
+ * ID comparison even after their slot has been reused.
+ */
+static tcb_t *find_task_by_id(uint16_t id)
 {
-    if (!kcb->tasks || id == 0)
+    if (id == 0)
         return NULL;
 
-    /* Try cache first */
-    tcb_t *cached = cache_lookup_task(id);
-    if (cached) {
-        /* Find the corresponding node - this is still faster than full search
-         */
-        list_node_t *node = kcb->tasks->head->next;
-        while (node != kcb->tasks->tail) {
-            if (node->data == cached)
-                return node;
-            node = node->next;
-        }
-    }
-
-    /* Fall back to full search and update cache */
-    list_node_t *node = list_foreach(kcb->tasks, idcmp, (void *) (size_t) id);
-    if (node && node->data)
-        cache_task(id, (tcb_t *) node->data);
-
-    return node;
+    tcb_t *task = kcb->task_table[id & TASK_SLOT_MASK].task;
+    return (task && task->id == id) ? task : NULL;
 }
 
 /* Fast priority validation using lookup table */
@@ -319,6 +272,9 @@ void panic(int32_t ecode)
         }
     }
     printf("\n*** KERNEL PANIC (%d) – %s\n", (int) ecode, msg);
+#if CONFIG_TRACE
+    mo_trace_dump(); /* Show what the scheduler did leading up to the panic */
+#endif
     hal_panic();
 }
 
@@ -328,15 +284,170 @@ void yield(void);
 void _dispatch(void) __attribute__((weak, alias("dispatch")));
 void _yield(void) __attribute__((weak, alias("yield")));
 
-/* Round-Robin Scheduler Implementation
+/* Priority Scheduler Implementation
+ *
+ * Each priority level owns a FIFO ready queue threaded through the TCBs, and
+ * bit N of 'kcb->ready_bitmap' is set whenever level N has a queued task.
+ * Selecting the next task is a find-first-set over the bitmap followed by
+ * popping that level's head, so the cost does not depend on the number of
+ * tasks in the system. The running task is kept out of the ready queues; it
+ * is re-queued at the tail of its level when it is preempted or yields,
+ * which gives round-robin scheduling among tasks of equal priority.
+ */
+
+/* Index of the lowest set bit in a non-zero ready bitmap (highest level) */
+static inline uint8_t find_first_level(uint8_t bitmap)
+{
+    uint8_t level = 0;
+
+    /* Binary search over 8 bits - no libgcc __ctzsi2 on plain RV32I */
+    if (!(bitmap & 0x0F)) {
+        bitmap >>= 4;
+        level += 4;
+    }
+    if (!(bitmap & 0x03)) {
+        bitmap >>= 2;
+        level += 2;
+    }
+    if (!(bitmap & 0x01))
+        level += 1;
+
+    return level;
+}
+
+/* A queued task is either the head of its level or has a predecessor */
+static inline bool rq_is_queued(const tcb_t *task)
+{
+    return task->rq_prev || kcb->ready_queue[task->prio_level].head == task;
+}
+
+/* O(1) append to the tail of the task's level */
+static __fast_text void rq_push_tail(tcb_t *task)
+{
+    ready_queue_t *rq = &kcb->ready_queue[task->prio_level];
+
+    task->rq_next = NULL;
+    task->rq_prev = rq->tail;
+    if (rq->tail)
+        rq->tail->rq_next = task;
+    else
+        rq->head = task;
+    rq->tail = task;
+
+    kcb->ready_bitmap |= (1U << task->prio_level);
+}
+
+/* O(1) unlink from anywhere in the task's level */
+static __fast_text void rq_remove(tcb_t *task)
+{
+    ready_queue_t *rq = &kcb->ready_queue[task->prio_level];
+
+    if (task->rq_prev)
+        task->rq_prev->rq_next = task->rq_next;
+    else
+        rq->head = task->rq_next;
+
+    if (task->rq_next)
+        task->rq_next->rq_prev = task->rq_prev;
+    else
+        rq->tail = task->rq_prev;
+
+    task->rq_next = task->rq_prev = NULL;
+
+    if (!rq->head)
+        kcb->ready_bitmap &= ~(1U << task->prio_level);
+}
+
+/* Sleep List
  *
- * Implements an efficient round-robin scheduler tweaked for small systems.
- * While not achieving true O(1) complexity, this design provides excellent
- * practical performance with strong guarantees for fairness and reliability.
+ * Tasks waiting for a timeout are kept in 'kcb->delay_list', sorted by the
+ * absolute tick at which they must wake. A tick therefore only looks at the
+ * head of the list and touches exactly the tasks that expire. Comparisons
+ * use signed differences so the ordering survives 32-bit tick wraparound as
+ * long as no delay exceeds 2^31 ticks.
  */
 
-/* Add task to ready state - simple state-based approach */
-static void sched_enqueue_task(tcb_t *task)
+static inline bool delay_is_queued(const tcb_t *task)
+{
+    return task->dl_prev || kcb->delay_list == task;
+}
+
+/* Sorted insert; equal wake ticks keep FIFO order */
+static void delay_list_insert(tcb_t *task)
+{
+    tcb_t *prev = NULL, *next = kcb->delay_list;
+
+    while (next && tick_reached(task->wake_tick, next->wake_tick)) {
+        prev = next;
+        next = next->dl_next;
+    }
+
+    task->dl_prev = prev;
+    task->dl_next = next;
+    if (prev)
+        prev->dl_next = task;
+    else
+        kcb->delay_list = task;
+    if (next)
+        next->dl_prev = task;
+}
+
+static void delay_list_remove(tcb_t *task)
+{
+    if (task->dl_prev)
+        task->dl_prev->dl_next = task->dl_next;
+    else
+        kcb->delay_list = task->dl_next;
+
+    if (task->dl_next)
+        task->dl_next->dl_prev = task->dl_prev;
+
+    task->dl_next = task->dl_prev = NULL;
+}
+
+/* Wake every sleeping task whose wake tick has been reached */
+static __fast_text void delay_list_expire(void)
+{
+    uint32_t now = kcb->ticks;
+    tcb_t *task;
+
+    if (!(task = kcb->delay_list) || !tick_reached(now, task->wake_tick))
+        return;
+
+#if CONFIG_TASK_RESPONSE
+    /* The release time of any periodic job this tick starts */
+    uint32_t stamp = hal_clock_read();
+#endif
+    do {
+#if CONFIG_TASK_RESPONSE
+        task->release_at = stamp;
+#endif
+        sched_wakeup_task(task); /* also unlinks it from the sleep list */
+    } while ((task = kcb->delay_list) && tick_reached(now, task->wake_tick));
+}
+
+void sched_delay_task(tcb_t *task, uint32_t ticks)
+{
+    if (unlikely(!task))
+        return;
+
+    if (delay_is_queued(task))
+        delay_list_remove(task);
+
+    task->wake_tick = kcb->ticks + ticks;
+    task->state = TASK_BLOCKED;
+    delay_list_insert(task);
+    TRACE_EVENT(TRACE_BLOCK, 0, task->id, ticks);
+}
+
+void sched_cancel_delay(tcb_t *task)
+{
+    if (likely(task) && delay_is_queued(task))
+        delay_list_remove(task);
+}
+
+/* Mark task as ready and queue it behind its same-priority peers */
+static __fast_text void sched_enqueue_task(tcb_t *task)
 {
     if (unlikely(!task))
         return;
@@ -345,28 +456,73 @@ static void sched_enqueue_task(tcb_t *task)
     task->time_slice = get_priority_timeslice(task->prio_level);
     task->state = TASK_READY;
 
-    /* Task selection is handled directly through the master task list */
+    if (!rq_is_queued(task))
+        rq_push_tail(task);
+}
+
+void sched_set_prio_level(tcb_t *task, uint8_t level)
+{
+    if (unlikely(!task) || task->prio_level == level)
+        return;
+
+    /* A queued task must move to the ready queue of its new level */
+    bool requeue = rq_is_queued(task);
+    if (requeue)
+        rq_remove(task);
+
+    task->prio_level = level;
+
+    if (requeue)
+        rq_push_tail(task);
 }
 
-/* Remove task from ready queues - state-based approach for compatibility */
-void sched_dequeue_task(tcb_t *task)
+/* Remove task from ready queues (suspend, cancel, priority change) */
+__fast_text void sched_dequeue_task(tcb_t *task)
 {
     if (unlikely(!task))
         return;
 
-    /* For tasks that need to be removed from ready state (suspended/cancelled),
-     * we rely on the state change. The scheduler will skip non-ready tasks
-     * when it encounters them during the round-robin traversal.
-     */
+    if (rq_is_queued(task))
+        rq_remove(task);
+}
+
+/* Charge one tick to @task's budget. Returns true if the budget is spent
+ * and the task has been blocked until it is replenished.
+ */
+static bool budget_charge(tcb_t *task)
+{
+    task_budget_t *b = task->budget;
+    uint32_t now = kcb->ticks;
+
+    if (tick_reached(now, b->start + b->period)) {
+        b->start = now;
+        b->used = 0;
+    }
+    if (b->used < b->budget)
+        b->used++;
+
+    /* Throttling a mutex owner would also stall whoever waits on it */
+    if (b->used < b->budget || task->held_mutexes)
+        return false;
+
+    b->throttles++;
+    sched_delay_task(task, b->start + b->period - now);
+    return true;
 }
 
 /* Handle time slice expiration for current task */
-void sched_tick_current_task(void)
+__fast_text void sched_tick_current_task(void)
 {
-    if (unlikely(!kcb->task_current || !kcb->task_current->data))
+    if (unlikely(!kcb->task_current))
         return;
 
-    tcb_t *current_task = kcb->task_current->data;
+    tcb_t *current_task = kcb->task_current;
+
+    /* A task whose budget is spent waits for the next period */
+    if (current_task->budget && budget_charge(current_task)) {
+        _dispatch();
+        return;
+    }
 
     /* Decrement time slice */
     if (current_task->time_slice > 0)
@@ -378,77 +534,116 @@ void sched_tick_current_task(void)
     }
 }
 
-/* Task wakeup - simple state transition approach */
-void sched_wakeup_task(tcb_t *task)
+/* Task wakeup - make runnable and link into its ready queue */
+__fast_text void sched_wakeup_task(tcb_t *task)
 {
     if (unlikely(!task))
         return;
 
-    /* Mark task as ready - scheduler will find it during round-robin traversal
-     */
+    /* An explicit wakeup wins over any pending timeout */
+    if (delay_is_queued(task))
+        delay_list_remove(task);
+
+    TRACE_EVENT(TRACE_WAKEUP, 0, task->id, 0);
+
     if (task->state != TASK_READY) {
         task->state = TASK_READY;
         /* Ensure task has time slice */
         if (task->time_slice == 0)
             task->time_slice = get_priority_timeslice(task->prio_level);
     }
+
+    if (!rq_is_queued(task))
+        rq_push_tail(task);
 }
 
-/* Efficient Round-Robin Task Selection with O(n) Complexity
- *
- * Selects the next ready task using circular traversal of the master task list.
+__fast_text bool sched_wakeup_preempts(const tcb_t *task)
+{
+    if (unlikely(!task || !kcb->task_current))
+        return false;
+
+    /* The real-time hook may rank tasks differently from their levels */
+    if (kcb->rt_sched != noop_rtsched)
+        return true;
+
+    tcb_t *current_task = kcb->task_current;
+    return task->prio_level < current_task->prio_level;
+}
+
+/* O(1) Priority Task Selection
  *
- * Complexity: O(n) where n = number of tasks
- * - Best case: O(1) when next task in sequence is ready
- * - Worst case: O(n) when only one task is ready and it's the last checked
- * - Typical case: O(k) where k << n (number of non-ready tasks to skip)
+ * Re-queues the outgoing task if it is still runnable, then takes the head
+ * of the highest non-empty priority level.
  *
- * Performance characteristics:
- * - Excellent for small-to-medium task counts (< 50 tasks)
- * - Simple and reliable implementation
- * - Good cache locality due to sequential list traversal
- * - Priority-aware time slice allocation
+ * Complexity: O(1) - one find-first-set over an 8-bit bitmap plus a
+ * constant-time dequeue, independent of the number of tasks.
  */
-uint16_t sched_select_next_task(void)
+__fast_text uint16_t sched_select_next_task(void)
 {
-    if (unlikely(!kcb->task_current || !kcb->task_current->data))
+    if (unlikely(!kcb->task_current))
         panic(ERR_NO_TASKS);
 
-    tcb_t *current_task = kcb->task_current->data;
+    tcb_t *current_task = kcb->task_current;
 
-    /* Mark current task as ready if it was running */
-    if (current_task->state == TASK_RUNNING)
-        current_task->state = TASK_READY;
+    /* Preempted or yielding task goes to the back of its level */
+    if (current_task->state == TASK_RUNNING ||
+        current_task->state == TASK_READY)
+        sched_enqueue_task(current_task);
 
-    /* Round-robin search: find next ready task in the master task list */
-    list_node_t *start_node = kcb->task_current;
-    list_node_t *node = start_node;
-    int iterations = 0; /* Safety counter to prevent infinite loops */
+    /* No ready tasks - this should not happen in normal operation */
+    if (unlikely(!kcb->ready_bitmap))
+        panic(ERR_NO_TASKS);
 
-    do {
-        /* Move to next task (circular) */
-        node = list_cnext(kcb->tasks, node);
-        if (!node || !node->data)
-            continue;
+    tcb_t *task = kcb->ready_queue[find_first_level(kcb->ready_bitmap)].head;
+    rq_remove(task);
 
-        tcb_t *task = node->data;
+    kcb->task_current = task;
+    task->state = TASK_RUNNING;
+    task->time_slice = get_priority_timeslice(task->prio_level);
 
-        /* Skip non-ready tasks */
-        if (task->state != TASK_READY)
-            continue;
+    return task->id;
+}
+
+/* Switch to the task chosen by the real-time scheduler hook.
+ * Returns false if the hook declined (negative ID) or named a task that
+ * cannot run, in which case the priority scheduler decides instead.
+ */
+static bool sched_select_rt_task(int32_t id)
+{
+    if (id <= 0)
+        return false;
+
+    tcb_t *task = find_task_by_id((uint16_t) id);
+    if (unlikely(!task))
+        return false;
 
-        /* Found a ready task */
-        kcb->task_current = node;
-        task->state = TASK_RUNNING;
-        task->time_slice = get_priority_timeslice(task->prio_level);
+    tcb_t *current_task = kcb->task_current;
 
-        return task->id;
+    if (task == current_task) {
+        /* Keep running the current task if it is still runnable */
+        if (task->state != TASK_RUNNING && task->state != TASK_READY)
+            return false;
+    } else {
+        if (task->state != TASK_READY)
+            return false;
+
+        if (current_task->state == TASK_RUNNING ||
+            current_task->state == TASK_READY)
+            sched_enqueue_task(current_task);
+    }
 
-    } while (node != start_node && ++iterations < SCHED_IMAX);
+    sched_dequeue_task(task);
+    kcb->task_current = task;
+    task->state = TASK_RUNNING;
+    task->time_slice = get_priority_timeslice(task->prio_level);
+    return true;
+}
 
-    /* No ready tasks found - this should not happen in normal operation */
-    panic(ERR_NO_TASKS);
-    return 0;
+/* Real-time hook first; fall back to the priority scheduler */
+static inline void sched_pick_next_task(void)
+{
+    if (!sched_select_rt_task(kcb->rt_sched()))
+        sched_select_next_task();
 }
 
 /* Default real-time scheduler stub. */
@@ -458,180 +653,519 @@ static int32_t noop_rtsched(void)
 }
 
 /* The main entry point from the system tick interrupt. */
-void dispatcher(void)
+__fast_text void dispatcher(void)
 {
-    kcb->ticks++;
+    _tick_advance(1);
+
+    /* The interrupted task is inside a NOSCHED section and may be halfway
+     * through updating the ready queues or the sleep list. Only count the
+     * tick here; the outermost NOSCHED_LEAVE() runs the reschedule.
+     */
+    if (unlikely(kcb->preempt_count)) {
+        kcb->resched_pending = true;
+        timer_tick_post();
+        return;
+    }
+
+    /* This switch point also serves a reschedule an interrupt handler
+     * requested since the last one.
+     */
+    kcb->resched_pending = false;
 
     /* Handle time slice for current task */
     sched_tick_current_task();
 
-    /* Set timer work with generation increment for coalescing */
-    timer_work_pending |= TIMER_WORK_TICK_HANDLER;
-    timer_work_generation++;
+    /* Timer callbacks run later in task context */
+    timer_tick_post();
+
+    _dispatch();
+}
+
+__fast_text void dispatcher_resched(void)
+{
+    if (!kcb->resched_pending || kcb->preempt_count)
+        return;
 
+    kcb->resched_pending = false;
     _dispatch();
 }
 
+void sched_isr_resched(void)
+{
+    if (!sched_preemptive())
+        return;
+
+    kcb->resched_pending = true;
+    if (!kcb->preempt_count)
+        hal_ipi_send(hal_hart_id());
+}
+
+/* CPU Accounting
+ *
+ * The machine timer is sampled once per scheduling decision. The interval
+ * since the previous sample is charged to the outgoing task, so the run
+ * times of all tasks add up to the time since scheduling started. With
+ * CONFIG_TASK_PMU the performance counters are sampled alongside.
+ */
+#if CONFIG_TASK_PMU
+static inline void sched_account_pmu(tcb_t *prev)
+{
+    uint32_t now[HAL_PMU_SLOTS];
+    hal_pmu_sample(now);
+    for (int i = 0; i < HAL_PMU_SLOTS; i++) {
+        prev->pmu[i] += (uint32_t) (now[i] - kcb->pmu_stamp[i]);
+        kcb->pmu_stamp[i] = now[i];
+    }
+}
+#endif
+
+static inline void sched_account_switch(tcb_t *prev, bool preempted)
+{
+    uint32_t now = hal_clock_read();
+    prev->run_time += (uint32_t) (now - kcb->switch_stamp);
+    kcb->switch_stamp = now;
+#if CONFIG_TASK_PMU
+    sched_account_pmu(prev);
+#endif
+
+    tcb_t *next = kcb->task_current;
+    if (next == prev)
+        return;
+
+    TRACE_EVENT(TRACE_SWITCH, preempted, prev->id, next->id);
+    next->switches++;
+    if (preempted && prev->state == TASK_READY)
+        prev->preemptions++;
+}
+
+/* Moves the hardware stack guard to the task that was just selected */
+static inline void task_stack_guard_switch(void)
+{
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_PMP
+    hal_stack_guard_set(kcb->task_current->stack);
+#endif
+}
+
 /* Top-level context-switch for preemptive scheduling. */
-void dispatch(void)
+__fast_text void dispatch(void)
 {
-    if (unlikely(!kcb || !kcb->task_current || !kcb->task_current->data))
+    if (unlikely(!kcb || !kcb->task_current))
         panic(ERR_NO_TASKS);
 
     /* Save current context using dedicated HAL routine that handles both
      * execution context and processor state for context switching.
      * Returns immediately if this is the restore path.
      */
-    if (hal_context_save(((tcb_t *) kcb->task_current->data)->context) != 0)
+    if (hal_context_save(kcb->task_current->context) != 0)
         return;
 
-#if CONFIG_STACK_PROTECTION
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_CANARY
     /* Do stack check less frequently to reduce overhead */
     if (unlikely((kcb->ticks & (STACK_CHECK_INTERVAL - 1)) == 0))
         task_stack_check();
 #endif
 
-    /* Batch process task delays for better efficiency */
-    uint32_t ready_count = 0;
-    list_foreach(kcb->tasks, delay_update_batch, &ready_count);
+    /* Wake only the sleepers whose deadline has arrived */
+    delay_list_expire();
 
     /* Hook for real-time scheduler - if it selects a task, use it */
-    if (kcb->rt_sched() < 0)
-        sched_select_next_task(); /* Use O(1) priority scheduler */
+    tcb_t *prev = kcb->task_current;
+    sched_pick_next_task();
+    sched_account_switch(prev, true);
+    task_stack_guard_switch();
 
     hal_interrupt_tick();
 
     /* Restore next task context */
-    hal_context_restore(((tcb_t *) kcb->task_current->data)->context, 1);
+    hal_context_restore(kcb->task_current->context, 1);
 }
 
-/* Cooperative context switch */
-void yield(void)
+/* Context switch from task context.
+ * @preempted : true when replaying a tick deferred by a NOSCHED section,
+ *              which wakes expired sleepers and counts as a preemption
+ *
+ * Unlike dispatch() there is no trap frame to preserve: the switch happens
+ * at a function call boundary, so hal_context_switch() saves just the
+ * callee-saved registers and returns straight into the caller once this
+ * task runs again. Timer work and stack checks happen only on the way out,
+ * and if the scheduler keeps the current task no context is touched at all.
+ */
+static __fast_text void task_switch(bool preempted)
 {
-    if (unlikely(!kcb || !kcb->task_current || !kcb->task_current->data))
-        return;
-
-    /* Process deferred timer work during yield */
-    process_deferred_timer_work();
+    /* Drain deferred work unless the caller is already committed to
+     * sleeping or blocking, where work functions must not run.
+     */
+    if (kcb->task_current->state == TASK_RUNNING)
+        _defer_drain(); /* A requested reschedule happens right below */
 
-    /* HAL context switching is used for preemptive scheduling. */
-    if (hal_context_save(((tcb_t *) kcb->task_current->data)->context) != 0)
-        return;
+    /* Keep the tick out while the ready queues and 'task_current' change;
+     * the mstatus restored with the next task re-enables interrupts.
+     */
+    CRITICAL_ENTER();
 
-#if CONFIG_STACK_PROTECTION
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_CANARY
     task_stack_check();
 #endif
 
-    /* In cooperative mode, delays are only processed on an explicit yield. */
-    if (!kcb->preemptive)
-        list_foreach(kcb->tasks, delay_update, NULL);
+    /* In cooperative mode there is no timer interrupt, so every explicit
+     * yield counts as one tick of the sleep clock.
+     */
+    if (!sched_preemptive()) {
+        _tick_advance(1);
+        delay_list_expire();
+    } else if (preempted) {
+        delay_list_expire();
+    }
+
+    tcb_t *prev = kcb->task_current;
+    sched_pick_next_task();
+    sched_account_switch(prev, preempted);
+
+    tcb_t *next = kcb->task_current;
+    if (next == prev) {
+        CRITICAL_LEAVE();
+        return;
+    }
 
-    sched_select_next_task(); /* Use O(1) priority scheduler */
-    hal_context_restore(((tcb_t *) kcb->task_current->data)->context, 1);
+    task_stack_guard_switch();
+    hal_context_switch(prev->context, next->context);
 }
 
-/* Stack initialization with minimal overhead */
-static bool init_task_stack(tcb_t *tcb, size_t stack_size)
+/* Cooperative context switch */
+__fast_text void yield(void)
 {
-    void *stack = malloc(stack_size);
-    if (!stack)
-        return false;
+    if (unlikely(!kcb || !kcb->task_current))
+        return;
 
-    /* Validate stack alignment */
-    if ((uintptr_t) stack & 0x3) {
-        free(stack);
-        return false;
-    }
+    task_switch(false);
+}
 
-#if CONFIG_STACK_PROTECTION
-    /* Only initialize essential parts to reduce overhead */
-    *(uint32_t *) stack = STACK_CANARY;
-    *(uint32_t *) ((uintptr_t) stack + stack_size - sizeof(uint32_t)) =
-        STACK_CANARY;
-#endif
+__fast_text void _sched_resched(void)
+{
+    kcb->resched_pending = false;
 
-    tcb->stack = stack;
-    tcb->stack_sz = stack_size;
-    return true;
+    if (unlikely(!kcb->task_current))
+        return;
+
+    task_switch(true);
 }
 
-/* Task Management API */
+/* Stack initialization with minimal overhead */
+/* Attach @stack to @tcb and place the overflow canaries */
+static void task_stack_prepare(tcb_t *tcb, void *stack, size_t stack_size)
+{
+#if CONFIG_STACK_WATERMARK
+    /* Paint the whole stack so the deepest write can be found later */
+    uint32_t *word = stack;
+    for (size_t i = 0; i < stack_size / sizeof(uint32_t); i++)
+        word[i] = STACK_FILL_PATTERN;
+#endif
 
-int32_t mo_task_spawn(void *task_entry, uint16_t stack_size_req)
+#if CONFIG_STACK_PROTECTION == STACK_PROTECT_CANARY
+    /* Only initialize essential parts to reduce overhead */
+    *(uint32_t *) stack = STACK_CANARY;
+    *(uint32_t *) ((uintptr_t) stack + stack_size - sizeof(uint32_t)) =
+        STACK_CANARY;
+#endif
+
+    tcb->stack = stack;
+    tcb->stack_sz = stack_size;
+}
+
+/* The arena, if any, sits right above the stack in the same heap block, so
+ * a stack overflow runs away from it and one free() releases both. @hint
+ * places the block, see malloc_region().
+ */
+static bool init_task_stack(tcb_t *tcb,
+                            size_t stack_size,
+                            uint32_t arena_size,
+                            uint32_t hint)
 {
-    if (!task_entry)
-        panic(ERR_TCB_ALLOC);
+    void *stack = malloc_region(stack_size + arena_size, hint);
+    if (!stack)
+        return false;
 
-    /* Ensure minimum stack size and proper alignment */
-    size_t new_stack_size = stack_size_req;
-    if (new_stack_size < MIN_TASK_STACK_SIZE)
-        new_stack_size = MIN_TASK_STACK_SIZE;
-    new_stack_size = (new_stack_size + 0xF) & ~0xFU;
+    /* Validate stack alignment */
+    if ((uintptr_t) stack & 0x3) {
+        free(stack);
+        return false;
+    }
 
-    /* Allocate and initialize TCB */
-    tcb_t *tcb = malloc(sizeof(tcb_t));
-    if (!tcb)
-        panic(ERR_TCB_ALLOC);
+    task_stack_prepare(tcb, stack, stack_size);
+    if (arena_size)
+        arena_init(&tcb->arena, (char *) stack + stack_size, arena_size);
+    return true;
+}
 
+/* Reset every TCB field to its initial, not-yet-scheduled value */
+static void task_init_tcb(tcb_t *tcb, void *task_entry, uint8_t flags)
+{
     tcb->entry = task_entry;
-    tcb->delay = 0;
+    tcb->wake_tick = 0;
+    tcb->dl_next = NULL;
+    tcb->dl_prev = NULL;
+    tcb->wq = NULL;
+    tcb->wq_next = NULL;
+    tcb->wq_prev = NULL;
     tcb->rt_prio = NULL;
+    tcb->budget = NULL;
     tcb->state = TASK_STOPPED;
-    tcb->flags = 0;
+    tcb->flags = flags;
+    tcb->rq_next = NULL;
+    tcb->rq_prev = NULL;
 
     /* Set default priority with proper scheduler fields */
     tcb->prio = TASK_PRIO_NORMAL;
     tcb->prio_level = extract_priority_level(TASK_PRIO_NORMAL);
+    tcb->base_level = tcb->prio_level;
     tcb->time_slice = get_priority_timeslice(tcb->prio_level);
+    tcb->held_mutexes = NULL;
+    tcb->blocked_on = NULL;
+    tcb->cond_mutex = NULL;
+    tcb->notify_value = 0;
+    tcb->notify_mask = 0;
+    arena_init(&tcb->arena, NULL, 0);
+
+    tcb->run_time = 0;
+    tcb->switches = 0;
+    tcb->preemptions = 0;
+#if CONFIG_TASK_PMU
+    memset(tcb->pmu, 0, sizeof(tcb->pmu));
+#endif
+    tcb->jobs = 0;
+    tcb->misses = 0;
+#if CONFIG_TASK_RESPONSE
+    tcb->resp_max = 0;
+    memset(tcb->resp_hist, 0, sizeof(tcb->resp_hist));
+#endif
+#if CONFIG_STDOUT_BUF
+    tcb->stdout_len = 0;
+#endif
+}
 
-    /* Initialize stack */
-    if (!init_task_stack(tcb, new_stack_size)) {
-        free(tcb);
-        panic(ERR_STACK_ALLOC);
-    }
+/* Link an initialized TCB with a prepared stack into the kernel and make it
+ * ready. Must be called inside a critical section.
+ * Returns false, with nothing linked, if all task slots are in use.
+ */
+static bool task_register(tcb_t *tcb)
+{
+    /* Assign unique ID */
+    if (!task_table_insert(tcb))
+        return false;
 
-    /* Minimize critical section duration */
-    CRITICAL_ENTER();
+    dlist_push_back(&kcb->tasks, &tcb->node);
+    kcb->task_count++; /* Cached count of active tasks for quick access */
 
-    if (!kcb->tasks) {
-        kcb->tasks = list_create();
-        if (!kcb->tasks) {
-            CRITICAL_LEAVE();
-            free(tcb->stack);
-            free(tcb);
-            panic(ERR_KCB_ALLOC);
+    if (!kcb->task_current)
+        kcb->task_current = tcb;
+
+    /* Initialize execution context before the task becomes selectable. */
+    hal_context_init(&tcb->context, (size_t) tcb->stack, tcb->stack_sz,
+                     (size_t) tcb->entry);
+
+    /* Mark ready */
+    sched_enqueue_task(tcb);
+    return true;
+}
+
+static void task_report_spawn(const tcb_t *tcb)
+{
+    printf("task %u: entry=%p stack=%p size=%u prio_level=%u time_slice=%u\n",
+           tcb->id, tcb->entry, tcb->stack, (unsigned int) tcb->stack_sz,
+           tcb->prio_level, tcb->time_slice);
+}
+
+#if CONFIG_TASK_RECYCLE
+/* Cancelled heap-backed tasks kept whole for reuse, under CRITICAL_ENTER() */
+static tcb_t *recycled[CONFIG_TASK_RECYCLE];
+static uint32_t recycled_count;
+
+/* Keeps a cancelled task instead of freeing it. Called in mo_task_cancel()'s
+ * critical section; returns false if @tcb does not qualify or no room is
+ * left. Arena tasks are not kept: their heap block is sized for the arena.
+ */
+static bool recycle_put(tcb_t *tcb)
+{
+    if ((tcb->flags & TASK_FLAG_STATIC) || tcb->arena.size ||
+        recycled_count == CONFIG_TASK_RECYCLE)
+        return false;
+
+    recycled[recycled_count++] = tcb;
+    return true;
+}
+
+/* Takes back a kept task whose stack is at least @stack_size bytes, in the
+ * same power-of-two class, and was asked of the same kind of memory.
+ */
+static tcb_t *recycle_take(size_t stack_size, uint8_t fast)
+{
+    uint32_t class = ilog2(stack_size);
+    tcb_t *tcb = NULL;
+
+    CRITICAL_ENTER();
+    for (uint32_t i = 0; i < recycled_count; i++) {
+        tcb_t *t = recycled[i];
+        if (t->stack_sz >= stack_size && ilog2(t->stack_sz) == class &&
+            (t->flags & TASK_FLAG_FAST) == fast) {
+            recycled[i] = recycled[--recycled_count];
+            tcb = t;
+            break;
         }
     }
+    CRITICAL_LEAVE();
+    return tcb;
+}
+#endif
 
-    list_node_t *node = list_pushback(kcb->tasks, tcb);
-    if (!node) {
+void mo_task_recycle_flush(void)
+{
+#if CONFIG_TASK_RECYCLE
+    while (1) {
+        CRITICAL_ENTER();
+        tcb_t *tcb = recycled_count ? recycled[--recycled_count] : NULL;
         CRITICAL_LEAVE();
+
+        if (!tcb)
+            return;
         free(tcb->stack);
-        free(tcb);
-        panic(ERR_TCB_ALLOC);
+        slab_free(&tcb_cache, tcb);
     }
+#endif
+}
 
-    /* Assign unique ID and update counts */
-    tcb->id = kcb->next_tid++;
-    kcb->task_count++; /* Cached count of active tasks for quick access */
+/* Allocates a TCB and its stack (and arena) into @out. A full heap may be
+ * full of kept stacks, so on failure they are released and the allocation
+ * retried. Returns ERR_OK, ERR_TCB_ALLOC or ERR_STACK_ALLOC.
+ */
+static int32_t task_alloc(tcb_t **out,
+                          void *task_entry,
+                          uint8_t flags,
+                          size_t stack_size,
+                          uint32_t arena_size,
+                          uint32_t hint)
+{
+    tcb_t *tcb = slab_alloc(&tcb_cache);
+    if (!tcb) {
+        mo_task_recycle_flush();
+        tcb = slab_alloc(&tcb_cache);
+        if (!tcb)
+            return ERR_TCB_ALLOC;
+    }
 
-    if (!kcb->task_current)
-        kcb->task_current = node;
+    task_init_tcb(tcb, task_entry, flags);
+    if (unlikely(arena_size > MALLOC_MAX_SIZE - stack_size)) {
+        slab_free(&tcb_cache, tcb);
+        return ERR_STACK_ALLOC;
+    }
+    if (!init_task_stack(tcb, stack_size, arena_size, hint)) {
+        mo_task_recycle_flush();
+        if (!init_task_stack(tcb, stack_size, arena_size, hint)) {
+            slab_free(&tcb_cache, tcb);
+            return ERR_STACK_ALLOC;
+        }
+    }
+    *out = tcb;
+    return ERR_OK;
+}
+
+/* Task Management API */
+
+static int32_t task_spawn(void *task_entry,
+                          uint16_t stack_size_req,
+                          uint32_t arena_size,
+                          uint32_t hint)
+{
+    if (!task_entry)
+        panic(ERR_TCB_ALLOC);
+
+    /* Ensure minimum stack size and proper alignment */
+    size_t new_stack_size = stack_size_req;
+    if (new_stack_size < MIN_TASK_STACK_SIZE)
+        new_stack_size = MIN_TASK_STACK_SIZE;
+    new_stack_size = (new_stack_size + 0xF) & ~0xFU;
+
+    arena_size &= ~(sizeof(void *) - 1);
+    uint8_t flags = hint == MEM_FAST ? TASK_FLAG_FAST : 0;
+    tcb_t *tcb = NULL;
 
+#if CONFIG_TASK_RECYCLE
+    /* A kept task only needs its TCB reset and its canaries rewritten */
+    if (!arena_size && (tcb = recycle_take(new_stack_size, flags))) {
+        task_init_tcb(tcb, task_entry, flags);
+        task_stack_prepare(tcb, tcb->stack, tcb->stack_sz);
+    }
+#endif
+
+    /* Allocate and initialize TCB and stack */
+    if (!tcb) {
+#if CONFIG_FAST_RAM && CONFIG_FAST_TCBS
+        if (unlikely(!tcb_cache.capacity))
+            slab_seed(&tcb_cache, tcb_fast, sizeof(tcb_fast));
+#endif
+        int32_t err = task_alloc(&tcb, task_entry, flags, new_stack_size,
+                                 arena_size, hint);
+        if (unlikely(err != ERR_OK))
+            return err;
+    }
+
+    /* Minimize critical section duration */
+    CRITICAL_ENTER();
+    if (!task_register(tcb)) {
+        CRITICAL_LEAVE();
+        free(tcb->stack);
+        slab_free(&tcb_cache, tcb);
+        return ERR_TCB_ALLOC;
+    }
     CRITICAL_LEAVE();
 
-    /* Initialize execution context outside critical section. */
-    hal_context_init(&tcb->context, (size_t) tcb->stack, new_stack_size,
-                     (size_t) task_entry);
+    task_report_spawn(tcb);
+    return tcb->id;
+}
 
-    printf("task %u: entry=%p stack=%p size=%u prio_level=%u time_slice=%u\n",
-           tcb->id, task_entry, tcb->stack, (unsigned int) new_stack_size,
-           tcb->prio_level, tcb->time_slice);
+int32_t mo_task_spawn(void *task_entry, uint16_t stack_size_req)
+{
+    return task_spawn(task_entry, stack_size_req, 0, MEM_ANY);
+}
 
-    /* Add to cache and mark ready */
-    cache_task(tcb->id, tcb);
-    sched_enqueue_task(tcb);
+int32_t mo_task_spawn_fast(void *task_entry, uint16_t stack_size_req)
+{
+    return task_spawn(task_entry, stack_size_req, 0, MEM_FAST);
+}
+
+int32_t mo_task_spawn_arena(void *task_entry,
+                            uint16_t stack_size_req,
+                            uint32_t arena_size)
+{
+    return task_spawn(task_entry, stack_size_req, arena_size, MEM_ANY);
+}
+
+int32_t mo_task_spawn_static(tcb_t *tcb,
+                             void *stack,
+                             size_t stack_size,
+                             void *task_entry)
+{
+    if (unlikely(!task_entry))
+        return ERR_TASK_INVALID_ENTRY;
+    if (unlikely(!tcb))
+        return ERR_TCB_ALLOC;
+
+    /* The caller's buffer cannot grow, so trim it to a 16-byte multiple */
+    stack_size &= ~0xFU;
+    if (unlikely(!stack || ((uintptr_t) stack & 0x3) ||
+                 stack_size < MIN_TASK_STACK_SIZE))
+        return ERR_STACK_ALLOC;
+
+    task_init_tcb(tcb, task_entry, TASK_FLAG_STATIC);
+    task_stack_prepare(tcb, stack, stack_size);
+
+    CRITICAL_ENTER();
+    bool ok = task_register(tcb);
+    CRITICAL_LEAVE();
+
+    if (unlikely(!ok))
+        return ERR_TCB_ALLOC;
 
+    task_report_spawn(tcb);
     return tcb->id;
 }
 
@@ -641,89 +1175,195 @@ int32_t mo_task_cancel(uint16_t id)
         return ERR_TASK_CANT_REMOVE;
 
     CRITICAL_ENTER();
-    list_node_t *node = find_task_node_by_id(id);
-    if (!node) {
+    tcb_t *tcb = find_task_by_id(id);
+    if (!tcb) {
         CRITICAL_LEAVE();
         return ERR_TASK_NOT_FOUND;
     }
 
-    tcb_t *tcb = node->data;
-    if (!tcb || tcb->state == TASK_RUNNING) {
+    if (tcb->state == TASK_RUNNING) {
         CRITICAL_LEAVE();
         return ERR_TASK_CANT_REMOVE;
     }
 
-    /* Remove from list and update count */
-    list_remove(kcb->tasks, node);
+    /* Release real-time scheduler resources held by the task */
+    if (tcb->rt_prio && kcb->rt_attach)
+        kcb->rt_attach(tcb, NULL);
+
+    /* Leave mutex wait lists and drop ownership back-references */
+    _mutex_task_exit(tcb);
+
+    /* Leave any other wait queue so it never points at freed memory */
+    if (tcb->wq)
+        wq_remove(tcb->wq, tcb);
+
+    /* Remove from scheduler queues and master list, then update count */
+    sched_dequeue_task(tcb);
+    sched_cancel_delay(tcb);
+    dlist_remove(&kcb->tasks, &tcb->node);
+    task_table_remove(tcb);
     kcb->task_count--;
 
-    /* Clear from cache */
-    for (int i = 0; i < TASK_CACHE_SIZE; i++) {
-        if (task_cache[i].task == tcb) {
-            task_cache[i].id = 0;
-            task_cache[i].task = NULL;
-        }
+#if CONFIG_TASK_RECYCLE
+    /* Retired from the task table above, so its old ID is already stale */
+    if (recycle_put(tcb)) {
+        CRITICAL_LEAVE();
+        return ERR_OK;
     }
-
+#endif
     CRITICAL_LEAVE();
 
+    /* Caller-provided storage is returned to the caller as is */
+    if (tcb->flags & TASK_FLAG_STATIC)
+        return ERR_OK;
+
     /* Free memory outside critical section */
     free(tcb->stack);
-    free(tcb);
-    free(node);
+    slab_free(&tcb_cache, tcb);
     return ERR_OK;
 }
 
-void mo_task_yield(void)
+void *mo_task_alloc(uint32_t size)
+{
+    tcb_t *self = kcb->task_current;
+    return arena_alloc(&self->arena, size);
+}
+
+void mo_task_arena_reset(void)
+{
+    tcb_t *self = kcb->task_current;
+    arena_reset(&self->arena);
+}
+
+__fast_text void mo_task_yield(void)
 {
     _yield();
 }
 
-void mo_task_delay(uint16_t ticks)
+void mo_task_delay(uint32_t ticks)
 {
-    /* Process deferred timer work before sleeping */
-    process_deferred_timer_work();
+    /* Last point before sleeping where deferred work may run */
+    _defer_run();
 
     if (!ticks)
         return;
 
     NOSCHED_ENTER();
-    if (unlikely(!kcb || !kcb->task_current || !kcb->task_current->data)) {
+    if (unlikely(!kcb || !kcb->task_current)) {
         NOSCHED_LEAVE();
         return;
     }
 
-    tcb_t *self = kcb->task_current->data;
+    tcb_t *self = kcb->task_current;
 
-    /* Set delay and blocked state - scheduler will skip blocked tasks */
-    self->delay = ticks;
-    self->state = TASK_BLOCKED;
+    /* Block until the absolute wake tick is reached */
+    sched_delay_task(self, ticks);
     NOSCHED_LEAVE();
 
     mo_task_yield();
 }
 
+static task_miss_hook_t miss_hook;
+
+void mo_task_miss_hook(task_miss_hook_t hook)
+{
+    miss_hook = hook;
+}
+
+#if CONFIG_TASK_RESPONSE
+/* Record the response time of @task's job that ends now */
+static void task_response_record(tcb_t *task, uint32_t stamp)
+{
+    uint32_t us = (uint32_t) mo_cycles_to_us(stamp - task->release_at);
+    uint32_t bucket = us ? ilog2(us) + 1 : 0;
+
+    if (bucket >= TASK_RESP_BUCKETS)
+        bucket = TASK_RESP_BUCKETS - 1;
+    task->resp_hist[bucket]++;
+    if (us > task->resp_max)
+        task->resp_max = us;
+}
+#endif
+
+int32_t mo_task_delay_until(uint32_t *last_wake, uint32_t period)
+{
+    if (unlikely(!last_wake || !period))
+        return ERR_FAIL;
+
+    /* Last point before sleeping where deferred work may run */
+    _defer_run();
+
+    NOSCHED_ENTER();
+    if (unlikely(!kcb || !kcb->task_current)) {
+        NOSCHED_LEAVE();
+        return ERR_FAIL;
+    }
+
+    tcb_t *self = kcb->task_current;
+    uint32_t now = kcb->ticks;
+    uint32_t next = *last_wake + period;
+
+    self->jobs++;
+#if CONFIG_TASK_RESPONSE
+    uint32_t stamp = hal_clock_read();
+    if (self->flags & TASK_FLAG_RELEASED)
+        task_response_record(self, stamp);
+#endif
+    self->flags |= TASK_FLAG_RELEASED;
+
+    if (unlikely(tick_reached(now, next))) {
+        /* Overran: skip to the latest release, which starts right away */
+        uint32_t missed = (now - *last_wake) / period;
+        *last_wake += missed * period;
+        self->misses++;
+#if CONFIG_TASK_RESPONSE
+        self->release_at = stamp;
+#endif
+        NOSCHED_LEAVE();
+
+        task_miss_hook_t hook = miss_hook;
+        if (hook)
+            hook(self->id, missed);
+        return ERR_TIMEOUT;
+    }
+
+    *last_wake = next;
+    do {
+        sched_delay_task(self, next - now);
+        NOSCHED_LEAVE();
+        mo_task_yield();
+
+        /* Woken early, e.g. by a resume: sleep out the rest */
+        NOSCHED_ENTER();
+        now = kcb->ticks;
+    } while (!tick_reached(now, next));
+    NOSCHED_LEAVE();
+
+    return ERR_OK;
+}
+
 int32_t mo_task_suspend(uint16_t id)
 {
     if (id == 0)
         return ERR_TASK_NOT_FOUND;
 
     CRITICAL_ENTER();
-    list_node_t *node = find_task_node_by_id(id);
-    if (!node) {
+    tcb_t *task = find_task_by_id(id);
+    if (!task) {
         CRITICAL_LEAVE();
         return ERR_TASK_NOT_FOUND;
     }
 
-    tcb_t *task = node->data;
-    if (!task || (task->state != TASK_READY && task->state != TASK_RUNNING &&
-                  task->state != TASK_BLOCKED)) {
+    if (task->state != TASK_READY && task->state != TASK_RUNNING &&
+        task->state != TASK_BLOCKED) {
         CRITICAL_LEAVE();
         return ERR_TASK_CANT_SUSPEND;
     }
 
+    sched_dequeue_task(task);
+    sched_cancel_delay(task);
     task->state = TASK_SUSPENDED;
-    bool is_current = (kcb->task_current == node);
+    bool is_current = (kcb->task_current == task);
 
     CRITICAL_LEAVE();
 
@@ -739,46 +1379,202 @@ int32_t mo_task_resume(uint16_t id)
         return ERR_TASK_NOT_FOUND;
 
     CRITICAL_ENTER();
-    list_node_t *node = find_task_node_by_id(id);
-    if (!node) {
+    tcb_t *task = find_task_by_id(id);
+    if (!task) {
         CRITICAL_LEAVE();
         return ERR_TASK_NOT_FOUND;
     }
 
-    tcb_t *task = node->data;
-    if (!task || task->state != TASK_SUSPENDED) {
+    if (task->state != TASK_SUSPENDED) {
         CRITICAL_LEAVE();
         return ERR_TASK_CANT_RESUME;
     }
 
-    /* mark as ready - scheduler will find it */
-    task->state = TASK_READY;
+    /* mark as ready and queue at its priority level */
+    sched_enqueue_task(task);
 
     CRITICAL_LEAVE();
     return ERR_OK;
 }
 
+/* Applies @action to @task's notification word. Called with interrupts
+ * disabled, since _from_isr callers update the word too.
+ */
+static bool notify_apply(tcb_t *task, uint32_t bits, notify_action_t action)
+{
+    switch (action) {
+    case NOTIFY_SET_BITS:
+        task->notify_value |= bits;
+        return true;
+    case NOTIFY_INCREMENT:
+        task->notify_value++;
+        return true;
+    case NOTIFY_OVERWRITE:
+        task->notify_value = bits;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Whether @task is blocked waiting for bits that are now set */
+static inline bool notify_ready(const tcb_t *task)
+{
+    return task->state == TASK_BLOCKED &&
+           (task->notify_value & task->notify_mask);
+}
+
+int32_t mo_task_notify(uint16_t id, uint32_t bits, notify_action_t action)
+{
+    NOSCHED_ENTER();
+    tcb_t *task = find_task_by_id(id);
+    if (unlikely(!task)) {
+        NOSCHED_LEAVE();
+        return ERR_TASK_NOT_FOUND;
+    }
+
+    int32_t irq = hal_interrupt_set(0);
+    if (unlikely(!notify_apply(task, bits, action))) {
+        hal_interrupt_set(irq);
+        NOSCHED_LEAVE();
+        return ERR_FAIL;
+    }
+
+    /* Wake the owner only once something it waits for has arrived */
+    bool preempt = false;
+    if (notify_ready(task)) {
+        task->notify_mask = 0;
+        sched_wakeup_task(task); /* Also cancels any pending timeout */
+        preempt = sched_wakeup_preempts(task);
+    }
+    hal_interrupt_set(irq);
+    NOSCHED_LEAVE();
+
+    if (preempt)
+        mo_task_yield();
+    return ERR_OK;
+}
+
+/* Deferred half of mo_task_notify_from_isr(): wakes every task whose
+ * notification arrived while the handler could not wake it.
+ */
+static void notify_isr_kick(void *arg)
+{
+    (void) arg;
+    bool preempt = false;
+
+    NOSCHED_ENTER();
+    int32_t irq = hal_interrupt_set(0);
+    for (uint32_t slot = 1; slot < TASK_MAX_TASKS; slot++) {
+        tcb_t *task = kcb->task_table[slot].task;
+        if (task && notify_ready(task)) {
+            task->notify_mask = 0;
+            sched_wakeup_task(task);
+            preempt |= sched_wakeup_preempts(task);
+        }
+    }
+    hal_interrupt_set(irq);
+    NOSCHED_LEAVE();
+
+    if (preempt)
+        mo_defer_resched();
+}
+
+static defer_work_t notify_isr_work = DEFER_WORK_INIT(notify_isr_kick, NULL);
+
+int32_t mo_task_notify_from_isr(uint16_t id,
+                                uint32_t bits,
+                                notify_action_t action)
+{
+    int32_t irq = hal_interrupt_set(0);
+    tcb_t *task = find_task_by_id(id);
+    if (unlikely(!task)) {
+        hal_interrupt_set(irq);
+        return ERR_TASK_NOT_FOUND;
+    }
+    if (unlikely(!notify_apply(task, bits, action))) {
+        hal_interrupt_set(irq);
+        return ERR_FAIL;
+    }
+
+    /* A task still scanning in mo_poll() must rescan before it blocks */
+    task->flags &= ~TASK_FLAG_POLL;
+
+    bool resched = false;
+    if (notify_ready(task)) {
+        if (sched_isr_may_wake()) {
+            task->notify_mask = 0;
+            sched_wakeup_task(task);
+            resched = sched_wakeup_preempts(task);
+        } else {
+            mo_defer_post(&notify_isr_work);
+            resched = true;
+        }
+    }
+    hal_interrupt_set(irq);
+
+    if (resched)
+        sched_isr_resched();
+    return ERR_OK;
+}
+
+uint32_t mo_task_notify_wait(uint32_t mask, uint32_t timeout)
+{
+    if (!mask)
+        mask = ~0U;
+
+    /* Interrupts stay off from the check to the block, so a notification
+     * from an interrupt handler cannot slip in between.
+     */
+    NOSCHED_ENTER();
+    int32_t irq = hal_interrupt_set(0);
+    tcb_t *self = kcb->task_current;
+    uint32_t bits = self->notify_value & mask;
+
+    if (!bits && timeout) {
+        self->notify_mask = mask;
+        if (timeout == NOTIFY_WAIT_FOREVER) {
+            self->state = TASK_BLOCKED;
+            TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+        } else {
+            sched_delay_task(self, timeout);
+        }
+        hal_interrupt_set(irq);
+        NOSCHED_LEAVE();
+
+        /* Woken by mo_task_notify(), the timeout, or a resume */
+        mo_task_yield();
+
+        NOSCHED_ENTER();
+        irq = hal_interrupt_set(0);
+        self->notify_mask = 0;
+        bits = self->notify_value & mask;
+    }
+
+    self->notify_value &= ~bits;
+    hal_interrupt_set(irq);
+    NOSCHED_LEAVE();
+    return bits;
+}
+
 int32_t mo_task_priority(uint16_t id, uint16_t priority)
 {
     if (id == 0 || !is_valid_priority(priority))
         return ERR_TASK_INVALID_PRIO;
 
     CRITICAL_ENTER();
-    list_node_t *node = find_task_node_by_id(id);
-    if (!node) {
-        CRITICAL_LEAVE();
-        return ERR_TASK_NOT_FOUND;
-    }
-
-    tcb_t *task = node->data;
+    tcb_t *task = find_task_by_id(id);
     if (!task) {
         CRITICAL_LEAVE();
         return ERR_TASK_NOT_FOUND;
     }
 
-    /* Update priority and level */
+    /* Update base priority; the effective level also honors any priority
+     * inherited through mutexes and is propagated to owners it waits on.
+     */
     task->prio = priority;
-    task->prio_level = extract_priority_level(priority);
+    task->base_level = extract_priority_level(priority);
+    _mutex_pi_refresh(task);
     task->time_slice = get_priority_timeslice(task->prio_level);
 
     CRITICAL_LEAVE();
@@ -791,55 +1587,373 @@ int32_t mo_task_rt_priority(uint16_t id, void *priority)
         return ERR_TASK_NOT_FOUND;
 
     CRITICAL_ENTER();
-    list_node_t *node = find_task_node_by_id(id);
-    if (!node) {
+    tcb_t *task = find_task_by_id(id);
+    if (!task) {
         CRITICAL_LEAVE();
         return ERR_TASK_NOT_FOUND;
     }
 
-    tcb_t *task = node->data;
+    /* Let an installed real-time scheduler validate and admit the task */
+    if (kcb->rt_attach) {
+        int32_t err = kcb->rt_attach(task, priority);
+        if (err != ERR_OK) {
+            CRITICAL_LEAVE();
+            return err;
+        }
+    }
+
+    task->rt_prio = priority;
+    CRITICAL_LEAVE();
+    return ERR_OK;
+}
+
+int32_t mo_task_budget(uint16_t id, task_budget_t *budget)
+{
+    if (budget && unlikely(!budget->budget || !budget->period ||
+                           budget->budget > budget->period))
+        return ERR_FAIL;
+
+    CRITICAL_ENTER();
+    tcb_t *task = find_task_by_id(id);
     if (!task) {
         CRITICAL_LEAVE();
         return ERR_TASK_NOT_FOUND;
     }
 
-    task->rt_prio = priority;
+    task->budget = budget;
     CRITICAL_LEAVE();
     return ERR_OK;
 }
 
 uint16_t mo_task_id(void)
 {
-    if (unlikely(!kcb || !kcb->task_current || !kcb->task_current->data))
+    if (unlikely(!kcb || !kcb->task_current))
         return 0;
-    return ((tcb_t *) kcb->task_current->data)->id;
+    return kcb->task_current->id;
 }
 
 int32_t mo_task_idref(void *task_entry)
 {
-    if (!task_entry || !kcb->tasks)
+    if (!task_entry)
         return ERR_TASK_NOT_FOUND;
 
+    int32_t id = ERR_TASK_NOT_FOUND;
+    tcb_t *task;
+
     CRITICAL_ENTER();
-    list_node_t *node = list_foreach(kcb->tasks, refcmp, task_entry);
+    dlist_for_each_entry(task, &kcb->tasks, tcb_t, node) {
+        if (task->entry == task_entry) {
+            id = task->id;
+            break;
+        }
+    }
     CRITICAL_LEAVE();
 
-    return node ? ((tcb_t *) node->data)->id : ERR_TASK_NOT_FOUND;
+    return id;
 }
 
+#if CONFIG_TICKLESS
+/* Ticks until the next task wakeup or software timer expiry, capped at
+ * UINT32_MAX when nothing is pending. Returns 0 if a deadline already passed.
+ */
+static uint32_t ticks_to_next_deadline(void)
+{
+    uint32_t now = kcb->ticks;
+    uint32_t sleep = UINT32_MAX;
+    uint32_t deadline;
+
+    if (kcb->delay_list) {
+        deadline = kcb->delay_list->wake_tick;
+        if (tick_reached(now, deadline))
+            return 0;
+        sleep = deadline - now;
+    }
+
+#if CONFIG_TIMER
+    if (_timer_next_deadline(&deadline)) {
+        if (tick_reached(now, deadline))
+            return 0;
+        if (deadline - now < sleep)
+            sleep = deadline - now;
+    }
+#endif
+
+    return sleep;
+}
+
+/* Stops the periodic tick while only idle-level work is runnable.
+ *
+ * The next timer interrupt is pushed out to the earliest pending deadline and
+ * the CPU waits with interrupts masked; WFI still resumes on the pending
+ * timer interrupt, which is then taken as soon as interrupts are re-enabled.
+ * The trap handler credits the skipped ticks to 'kcb->ticks'.
+ *
+ * Returns true if the CPU slept, false if a periodic wait is required.
+ */
+static bool tickless_idle(void)
+{
+    bool slept = false;
+
+    CRITICAL_ENTER();
+
+    tcb_t *self = kcb->task_current;
+    uint8_t busy = kcb->ready_bitmap & ~(1U << TASK_LOWEST_PRIORITY);
+
+    if (self->prio_level == TASK_LOWEST_PRIORITY && !busy &&
+        !_defer_pending()) {
+        uint32_t sleep = ticks_to_next_deadline();
+        if (sleep > 1) {
+            hal_timer_defer(sleep);
+            hal_cpu_idle();
+            slept = true;
+        }
+    }
+
+    CRITICAL_LEAVE();
+    return slept;
+}
+#endif /* CONFIG_TICKLESS */
+
 void mo_task_wfi(void)
 {
-    /* Process deferred timer work before waiting */
-    process_deferred_timer_work();
+    /* Run deferred work before the CPU idles */
+    _defer_run();
+
+    if (!sched_preemptive())
+        return;
 
-    if (!kcb->preemptive)
+#if CONFIG_TICKLESS
+    if (tickless_idle())
         return;
+#endif
 
+    /* Wake for the next tick, or for work an interrupt handler posted */
     volatile uint32_t current_ticks = kcb->ticks;
-    while (current_ticks == kcb->ticks)
+    while (current_ticks == kcb->ticks && !_defer_pending())
         hal_cpu_idle();
 }
 
+/* Run time of @task including the current, not yet charged interval */
+static uint64_t task_run_time(const tcb_t *task)
+{
+    uint64_t run_time = task->run_time;
+    if (task == kcb->task_current)
+        run_time += (uint32_t) (hal_clock_read() - kcb->switch_stamp);
+    return run_time;
+}
+
+/* Counter totals of @task including the current, not yet charged interval */
+static void task_pmu_read(const tcb_t *task, uint64_t *out)
+{
+#if CONFIG_TASK_PMU
+    uint32_t now[HAL_PMU_SLOTS];
+    hal_pmu_sample(now);
+    for (int i = 0; i < HAL_PMU_SLOTS; i++) {
+        out[i] = task->pmu[i];
+        if (task == kcb->task_current)
+            out[i] += (uint32_t) (now[i] - kcb->pmu_stamp[i]);
+    }
+#else
+    memset(out, 0, HAL_PMU_SLOTS * sizeof(uint64_t));
+#endif
+}
+
+int32_t mo_task_stats(uint16_t id, task_stats_t *stats)
+{
+    if (unlikely(!stats))
+        return ERR_FAIL;
+
+    CRITICAL_ENTER();
+    tcb_t *task = find_task_by_id(id);
+    if (!task) {
+        CRITICAL_LEAVE();
+        return ERR_TASK_NOT_FOUND;
+    }
+
+    uint64_t run_time = task_run_time(task);
+    stats->id = task->id;
+    stats->state = task->state;
+    stats->prio_level = task->prio_level;
+    stats->switches = task->switches;
+    stats->preemptions = task->preemptions;
+    stats->arena_size = task->arena.size;
+    stats->arena_peak = task->arena.peak;
+    task_pmu_read(task, stats->pmu);
+    CRITICAL_LEAVE();
+
+    stats->run_time_us = mo_cycles_to_us(run_time);
+    return ERR_OK;
+}
+
+int32_t mo_task_response(uint16_t id, task_response_t *resp)
+{
+    if (unlikely(!resp))
+        return ERR_FAIL;
+
+    CRITICAL_ENTER();
+    tcb_t *task = find_task_by_id(id);
+    if (!task) {
+        CRITICAL_LEAVE();
+        return ERR_TASK_NOT_FOUND;
+    }
+
+    resp->jobs = task->jobs;
+    resp->misses = task->misses;
+#if CONFIG_TASK_RESPONSE
+    resp->max_us = task->resp_max;
+    memcpy(resp->hist, task->resp_hist, sizeof(resp->hist));
+#else
+    resp->max_us = 0;
+    memset(resp->hist, 0, sizeof(resp->hist));
+#endif
+    CRITICAL_LEAVE();
+
+    return ERR_OK;
+}
+
+void mo_task_stats_dump(void)
+{
+    static const char *const state_names[] = {
+        "STOP", "READY", "RUN", "BLOCK", "SUSP",
+    };
+
+    if (unlikely(!kcb->task_current))
+        return;
+
+    /* Total across all tasks, for the CPU share column */
+    uint64_t total = 0;
+    tcb_t *task;
+    CRITICAL_ENTER();
+    dlist_for_each_entry(task, &kcb->tasks, tcb_t, node)
+        total += task_run_time(task);
+    CRITICAL_LEAVE();
+    if (!total)
+        total = 1;
+
+    /* printf() has no percent escape; emit the percent sign as a character */
+    printf("  ID STATE PRI  %cCPU    TIME(ms)  SWITCHES   PREEMPT", '%');
+#if CONFIG_TASK_PMU
+    printf("    IPC");
+#endif
+    printf("\n");
+    for (uint16_t slot = 1; slot < TASK_MAX_TASKS; slot++) {
+        task_stats_t st;
+        if (mo_task_stats(slot_task_id((uint8_t) slot), &st) != ERR_OK)
+            continue;
+
+        /* Share in tenths of a percent */
+        uint32_t permille =
+            (uint32_t) ((st.run_time_us * (F_CPU / 1000000U) * 1000U) / total);
+
+        printf("%4u %5s %3u %3lu.%lu %11lu %9lu %9lu", st.id,
+               st.state <= TASK_SUSPENDED ? state_names[st.state] : "?",
+               st.prio_level, permille / 10, permille % 10,
+               (uint32_t) (st.run_time_us / 1000U), st.switches,
+               st.preemptions);
+#if CONFIG_TASK_PMU
+        /* Instructions per cycle, in hundredths */
+        uint64_t cycles = st.pmu[HAL_PMU_CYCLES];
+        uint32_t ipc = cycles ? (uint32_t) (st.pmu[HAL_PMU_INSTRET] * 100U /
+                                            cycles)
+                              : 0;
+        printf(" %3lu.%02lu", ipc / 100, ipc % 100);
+#endif
+        printf("\n");
+    }
+}
+
+#if CONFIG_STACK_WATERMARK
+/* Deepest stack use of @task in bytes. The stack grows down, so the words
+ * still holding the fill pattern at the bottom were never touched.
+ */
+static uint32_t task_stack_peak(const tcb_t *task)
+{
+    const uint32_t *word = task->stack;
+    uint32_t words = task->stack_sz / sizeof(uint32_t);
+    uint32_t first = STACK_SCAN_FIRST;
+
+    while (first < words && word[first] == STACK_FILL_PATTERN)
+        first++;
+
+    return task->stack_sz - first * sizeof(uint32_t);
+}
+
+/* Stack size to configure for a task that peaked at @peak bytes: the peak
+ * plus a quarter (at least STACK_SLACK_MIN) of headroom, 16-byte aligned as
+ * the RISC-V ABI requires, and never below the kernel minimum.
+ */
+static uint32_t stack_recommend(uint32_t peak)
+{
+    uint32_t slack = peak / 4;
+    if (slack < STACK_SLACK_MIN)
+        slack = STACK_SLACK_MIN;
+
+    uint32_t size = (peak + slack + 15U) & ~15U;
+    return size < MIN_TASK_STACK_SIZE ? MIN_TASK_STACK_SIZE : size;
+}
+#endif /* CONFIG_STACK_WATERMARK */
+
+int32_t mo_task_stack_usage(uint16_t id)
+{
+#if CONFIG_STACK_WATERMARK
+    /* Keep the task from being cancelled while its stack is scanned */
+    NOSCHED_ENTER();
+    tcb_t *task = find_task_by_id(id);
+    if (!task) {
+        NOSCHED_LEAVE();
+        return ERR_TASK_NOT_FOUND;
+    }
+
+    int32_t peak = (int32_t) task_stack_peak(task);
+    NOSCHED_LEAVE();
+
+    return peak;
+#else
+    (void) id;
+    return ERR_FAIL; /* Stacks are not painted */
+#endif
+}
+
+void mo_task_stack_report(void)
+{
+#if CONFIG_STACK_WATERMARK
+    uint32_t total_size = 0, total_fit = 0;
+
+    printf("  ID  SIZE  PEAK  USED SUGGEST\n");
+    for (uint16_t slot = 1; slot < TASK_MAX_TASKS; slot++) {
+        uint16_t id = slot_task_id((uint8_t) slot);
+
+        NOSCHED_ENTER();
+        tcb_t *task = find_task_by_id(id);
+        if (!task) {
+            NOSCHED_LEAVE();
+            continue;
+        }
+        uint32_t size = task->stack_sz;
+        uint32_t peak = task_stack_peak(task);
+        NOSCHED_LEAVE();
+
+        uint32_t fit = stack_recommend(peak);
+        total_size += size;
+        total_fit += fit;
+
+        /* printf() has no percent escape; emit the percent sign as a char */
+        printf("%4u %5u %5u %4u%c %7u%s\n", id, size, peak,
+               (peak * 100U) / size, '%', fit,
+               peak >= size - sizeof(uint32_t) ? " overflow?" : "");
+    }
+
+    if (total_fit < total_size)
+        printf("Shrinking to the suggested sizes saves %u bytes\n",
+               total_size - total_fit);
+    else
+        printf("Stacks need %u more bytes for the suggested headroom\n",
+               total_fit - total_size);
+#else
+    printf("Stack watermarking is disabled (CONFIG_STACK_WATERMARK)\n");
+#endif
+}
+
 uint16_t mo_task_count(void)
 {
     return kcb->task_count;
@@ -850,26 +1964,44 @@ uint32_t mo_ticks(void)
     return kcb->ticks;
 }
 
-uint64_t mo_uptime(void)
+uint64_t mo_ticks64(void)
 {
-    return _read_us() / 1000;
+    uint32_t hi, lo;
+    do {
+        hi = kcb->ticks_hi;
+        lo = kcb->ticks;
+    } while (hi != kcb->ticks_hi); /* A tick carried in between. Retry. */
+    return ((uint64_t) hi << 32) | lo;
 }
 
-void _sched_block(queue_t *wait_q)
+uint64_t mo_uptime(void)
 {
-    if (unlikely(!wait_q || !kcb || !kcb->task_current ||
-                 !kcb->task_current->data))
-        panic(ERR_SEM_OPERATION);
-
-    /* Process deferred timer work before blocking */
-    process_deferred_timer_work();
+    return mo_cycles_to_ms(hal_clock_read64());
+}
 
-    tcb_t *self = kcb->task_current->data;
+uint64_t mo_time_ns(void)
+{
+    return mo_cycles_to_ns(hal_clock_read64());
+}
 
-    if (queue_enqueue(wait_q, self) != 0)
+__fast_text void _sched_block(wait_queue_t *wait_q)
+{
+    if (unlikely(!wait_q || !kcb || !kcb->task_current))
         panic(ERR_SEM_OPERATION);
 
+    tcb_t *self = kcb->task_current;
+    wq_push(wait_q, self);
+
     /* set blocked state - scheduler will skip blocked tasks */
     self->state = TASK_BLOCKED;
-    _yield();
+    TRACE_EVENT(TRACE_BLOCK, 0, self->id, 0);
+
+    /* End the caller's NOSCHED section. A tick deferred by it must still
+     * wake the sleepers that came due, so it is replayed by the switch,
+     * exactly as the outermost NOSCHED_LEAVE() would.
+     */
+    if (--kcb->preempt_count == 0 && kcb->resched_pending)
+        _sched_resched();
+    else
+        _yield();
 }
@@ -1,285 +1,332 @@
 /* Tick-based software timers for the kernel.
  *
- * This implementation uses an efficient approach for timer management:
- * 1. 'all_timers_list': Keeps all timers sorted by ID for O(log n) lookup
- * 2. 'kcb->timer_list': Active timers sorted by expiration for O(1) processing
- * 3. Timer node pool: Pre-allocated nodes to reduce malloc/free overhead
- * 4. Batch processing: Handle multiple expired timers efficiently
+ * Armed timers live in a hierarchical timing wheel of WHEEL_LEVELS levels
+ * with WHEEL_SLOTS slots each. Level 0 holds timers due within the next
+ * WHEEL_SLOTS ticks, one slot per tick; each level above covers WHEEL_SLOTS
+ * times the span of the one below it, one slot per slot-span. When the wheel
+ * time crosses a slot boundary of an upper level, the timers of that slot are
+ * cascaded down, so every timer is moved at most once per level before it
+ * expires. Starting, cancelling and expiring a timer are all O(1), and a
+ * hash keyed by ID (CONFIG_TIMER_HASH_SIZE buckets) replaces the old sorted
+ * lists and lookup cache.
+ *
+ * Callbacks run in a dedicated service task, spawned with the first timer at
+ * CONFIG_TIMER_DAEMON_PRIO. The tick only notifies it once the wheel has
+ * work due, and each pass drains every timer due by then, so callbacks never
+ * run on the time of whichever task happened to be switching. The service
+ * task times each callback and counts overruns (see mo_timer_stats()).
  */
 
 #include <hal.h>
-#include <lib/list.h>
-#include <lib/malloc.h>
+#include <lib/slab.h>
 #include <sys/task.h>
 #include <sys/timer.h>
+#include <sys/trace.h>
 
 #include "private/error.h"
 #include "private/utils.h"
 
-/* Pre-allocated node pool for reduced malloc/free overhead */
-#define TIMER_NODE_POOL_SIZE 16
-static list_node_t timer_node_pool[TIMER_NODE_POOL_SIZE];
-static uint16_t pool_free_mask = 0xFFFF; /* Bitmask for free nodes */
+#if CONFIG_TIMER
+
+#if CONFIG_TIMER_HASH_SIZE & (CONFIG_TIMER_HASH_SIZE - 1)
+#error "CONFIG_TIMER_HASH_SIZE must be a power of two"
+#endif
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1U << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+
+/* Furthest deadline the top level can hold; later ones are parked at this
+ * distance and re-placed when their slot cascades.
+ */
+#define WHEEL_MAX_DELTA ((1U << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+#define TIMER_HASH_SIZE CONFIG_TIMER_HASH_SIZE
+
+static timer_t *wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static uint16_t level_count[WHEEL_LEVELS]; /* Armed timers per level */
+static uint32_t wheel_time; /* Next tick the wheel has yet to process */
+static uint32_t armed;      /* Armed timers across all levels */
 
-/* Master list of all created timers, kept sorted by ID for faster lookup */
-static list_t *all_timers_list = NULL;
-static bool timer_initialized = false;
+static uint32_t wheel_wake; /* Tick by which the service task has work */
 
-/* Timer lookup cache to accelerate frequent ID searches */
-static struct {
-    uint16_t id;
-    timer_t *timer;
-} timer_cache[4];
-static uint8_t timer_cache_index = 0;
+static timer_t *timer_hash[TIMER_HASH_SIZE];
+static slab_cache_t timer_cache = SLAB_CACHE_INIT("timer", timer_t);
 
-/* Get a node from the pool, fall back to malloc if pool is empty */
-static list_node_t *get_timer_node(void)
+/* Timer service task, spawned with the first timer */
+#define TIMER_DAEMON_WAKE 1U /* Notification bit posted by the tick */
+
+static tcb_t daemon_tcb;
+static uint32_t daemon_stack[CONFIG_TIMER_DAEMON_STACK / 4];
+static uint16_t daemon_id;
+
+/* Callback in flight; destroying its timer clears this */
+static timer_t *timer_running;
+
+static timer_t *timer_find(uint16_t id)
 {
-    /* Find first free node in pool */
-    for (int i = 0; i < TIMER_NODE_POOL_SIZE; i++) {
-        if (pool_free_mask & (1 << i)) {
-            pool_free_mask &= ~(1 << i);
-            return &timer_node_pool[i];
-        }
-    }
-    /* Pool exhausted, fall back to malloc */
-    return malloc(sizeof(list_node_t));
+    timer_t *t = timer_hash[id & (TIMER_HASH_SIZE - 1)];
+
+    while (t && t->id != id)
+        t = t->hash_next;
+    return t;
 }
 
-/* Return a node to the pool, or free if it's not from pool */
-static void return_timer_node(list_node_t *node)
+/* Places @t by its deadline relative to the wheel time. Appending keeps
+ * timers that share a slot in the order they were armed.
+ */
+static void wheel_insert(timer_t *t)
 {
-    /* Check if node is from our pool */
-    if (node >= timer_node_pool &&
-        node < timer_node_pool + TIMER_NODE_POOL_SIZE) {
-        int index = node - timer_node_pool;
-        pool_free_mask |= (1 << index);
+    uint32_t when = t->deadline_ticks;
+    int32_t delta = (int32_t) (when - wheel_time);
+    uint32_t level = 0;
+
+    if (delta < 0) {
+        when = wheel_time; /* Already due: run on the next tick processed */
+    } else {
+        if ((uint32_t) delta > WHEEL_MAX_DELTA)
+            when = wheel_time + WHEEL_MAX_DELTA;
+        while (level < WHEEL_LEVELS - 1 &&
+               (when - wheel_time) >> (WHEEL_BITS * (level + 1)))
+            level++;
+    }
+
+    timer_t **slot =
+        &wheel[level][(when >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    if (*slot) {
+        t->next = *slot;
+        t->prev = (*slot)->prev;
+        (*slot)->prev->next = t;
+        (*slot)->prev = t;
     } else {
-        free(node);
+        t->next = t->prev = t;
+        *slot = t;
     }
+    t->slot = slot;
+    level_count[level]++;
 }
 
-/* Add timer to lookup cache */
-static inline void cache_timer(uint16_t id, timer_t *timer)
+static void wheel_remove(timer_t *t)
 {
-    timer_cache[timer_cache_index].id = id;
-    timer_cache[timer_cache_index].timer = timer;
-    timer_cache_index = (timer_cache_index + 1) % 4;
+    timer_t **slot = t->slot;
+
+    if (t->next == t) {
+        *slot = NULL;
+    } else {
+        t->prev->next = t->next;
+        t->next->prev = t->prev;
+        if (*slot == t)
+            *slot = t->next;
+    }
+    level_count[(slot - &wheel[0][0]) / WHEEL_SLOTS]--;
+    t->slot = NULL;
 }
 
-/* Quick cache lookup before expensive list traversal */
-static timer_t *cache_lookup_timer(uint16_t id)
+static void timer_arm(timer_t *t)
 {
-    for (int i = 0; i < 4; i++) {
-        if (timer_cache[i].id == id && timer_cache[i].timer)
-            return timer_cache[i].timer;
+    if (!armed) {
+        wheel_time = mo_ticks(); /* An empty wheel does not keep time */
+        wheel_wake = t->deadline_ticks;
+    } else if (tick_reached(wheel_wake, t->deadline_ticks)) {
+        wheel_wake = t->deadline_ticks;
     }
-    return NULL;
+    wheel_insert(t);
+    armed++;
 }
 
-/* Initializes the timer subsystem's data structures. */
-static int32_t timer_subsystem_init(void)
+static void timer_disarm(timer_t *t)
 {
-    if (unlikely(timer_initialized))
-        return ERR_OK;
+    wheel_remove(t);
+    armed--;
+}
 
-    NOSCHED_ENTER();
-    if (timer_initialized) {
-        NOSCHED_LEAVE();
-        return ERR_OK;
-    }
+/* Moves every timer of upper-level slot @idx down to where it now belongs */
+static void wheel_cascade(uint32_t level, uint32_t idx)
+{
+    timer_t *t;
 
-    all_timers_list = list_create();
-    kcb->timer_list = list_create();
+    while ((t = wheel[level][idx])) {
+        wheel_remove(t);
+        wheel_insert(t);
+    }
+}
 
-    if (unlikely(!all_timers_list || !kcb->timer_list)) {
-        if (all_timers_list) {
-            list_destroy(all_timers_list);
-            all_timers_list = NULL;
-        }
-        if (kcb->timer_list) {
-            list_destroy(kcb->timer_list);
-            kcb->timer_list = NULL;
+/* Earliest tick at which the wheel has work: exact for level 0, the next
+ * cascade point for upper levels (waking for one is early but harmless).
+ */
+static uint32_t wheel_next(void)
+{
+    uint32_t best = WHEEL_MAX_DELTA;
+
+    if (level_count[0]) {
+        for (uint32_t i = 0; i < WHEEL_SLOTS; i++) {
+            if (wheel[0][(wheel_time + i) & WHEEL_MASK]) {
+                best = i;
+                break;
+            }
         }
-        NOSCHED_LEAVE();
-        return ERR_FAIL;
     }
 
-    /* Initialize node pool */
-    for (int i = 0; i < TIMER_NODE_POOL_SIZE; i++) {
-        timer_node_pool[i].data = NULL;
-        timer_node_pool[i].next = NULL;
+    for (uint32_t level = 1; level < WHEEL_LEVELS; level++) {
+        if (!level_count[level])
+            continue;
+
+        uint32_t shift = WHEEL_BITS * level;
+        uint32_t span = 1U << shift;
+        uint32_t first = (wheel_time + span - 1) & ~(span - 1);
+        for (uint32_t i = 0; i < WHEEL_SLOTS; i++) {
+            uint32_t at = first + i * span;
+            if (at - wheel_time >= best)
+                break;
+            if (wheel[level][(at >> shift) & WHEEL_MASK]) {
+                best = at - wheel_time;
+                break;
+            }
+        }
     }
 
-    timer_initialized = true;
-    NOSCHED_LEAVE();
-    return ERR_OK;
+    return wheel_time + best;
 }
 
-/* Fast removal of timer from active list by data pointer */
-static void timer_remove_item_by_data(list_t *list, void *data)
+/* Runs @t's callback and charges it to the timer. Entered and left inside
+ * NOSCHED, which is dropped for the call itself.
+ */
+static void timer_fire(timer_t *t, uint32_t late)
 {
-    if (unlikely(!list || list_is_empty(list)))
-        return;
-
-    list_node_t *prev = list->head;
-    list_node_t *curr = prev->next;
-
-    while (curr != list->tail) {
-        if (curr->data == data) {
-            prev->next = curr->next;
-            return_timer_node(curr);
-            list->length--;
-            return;
-        }
-        prev = curr;
-        curr = curr->next;
-    }
+    void *(*callback)(void *arg) = t->callback;
+    void *arg = t->arg;
+    uint32_t period = t->period_ticks;
+
+    TRACE_EVENT(TRACE_TIMER, 0, t->id, 0);
+    timer_running = t;
+    NOSCHED_LEAVE();
+
+    uint32_t start = hal_clock_read();
+    if (likely(callback))
+        callback(arg);
+    uint32_t cycles = hal_clock_read() - start;
+
+    NOSCHED_ENTER();
+    if (timer_running != t)
+        return; /* The callback destroyed its own timer */
+    timer_running = NULL;
+
+    t->fires++;
+    if (late > t->max_late_ticks)
+        t->max_late_ticks = late;
+    if (cycles > t->max_run_cycles)
+        t->max_run_cycles = cycles;
+
+    /* Ran a whole period late, or took longer than one to run */
+    if (late >= period || cycles >= (uint64_t) period * (F_CPU / F_TIMER))
+        t->overruns++;
 }
 
-/* Sorted insert with early termination for common cases */
-static int32_t timer_sorted_insert(timer_t *timer)
+/* One pass of the service task: processes every tick up to now */
+static void timer_expire(void)
 {
-    list_node_t *new_node = get_timer_node();
-    if (unlikely(!new_node))
-        return ERR_FAIL;
-    new_node->data = timer;
-
-    /* Fast path: if list is empty or timer should go at end */
-    list_node_t *prev = kcb->timer_list->head;
-    if (prev->next == kcb->timer_list->tail) {
-        /* Empty list */
-        new_node->next = kcb->timer_list->tail;
-        prev->next = new_node;
-        kcb->timer_list->length++;
-        return ERR_OK;
-    }
+    NOSCHED_ENTER();
+
+    uint32_t now = mo_ticks();
 
-    /* Find insertion point */
-    while (prev->next != kcb->timer_list->tail) {
-        timer_t *current_timer = (timer_t *) prev->next->data;
-        if (timer->deadline_ticks < current_timer->deadline_ticks)
+    while (tick_reached(now, wheel_time)) {
+        if (!armed) {
+            wheel_time = now + 1;
             break;
-        prev = prev->next;
-    }
+        }
 
-    new_node->next = prev->next;
-    prev->next = new_node;
-    kcb->timer_list->length++;
-    return ERR_OK;
-}
+        /* Crossing a level-0 lap: pull down the upper slots that start here */
+        if (!(wheel_time & WHEEL_MASK)) {
+            for (uint32_t level = 1; level < WHEEL_LEVELS; level++) {
+                uint32_t idx =
+                    (wheel_time >> (WHEEL_BITS * level)) & WHEEL_MASK;
+                if (level_count[level])
+                    wheel_cascade(level, idx);
+                if (idx)
+                    break;
+            }
+        }
 
-/* Binary search for timer lookup in sorted ID list */
-static timer_t *timer_find_by_id_fast(uint16_t id)
-{
-    /* Try cache first */
-    timer_t *cached = cache_lookup_timer(id);
-    if (cached && cached->id == id)
-        return cached;
-
-    if (unlikely(!all_timers_list || list_is_empty(all_timers_list)))
-        return NULL;
-
-    /* Linear search for now - could be optimized to binary search if needed */
-    list_node_t *node = all_timers_list->head->next;
-    while (node != all_timers_list->tail) {
-        timer_t *timer = (timer_t *) node->data;
-        if (timer->id == id) {
-            cache_timer(id, timer);
-            return timer;
+        timer_t **slot = &wheel[0][wheel_time & WHEEL_MASK];
+        timer_t *t;
+        while ((t = *slot)) {
+            uint32_t late = mo_ticks() - t->deadline_ticks;
+            timer_disarm(t);
+
+            /* Re-arm from the missed deadline, not from now, so the period
+             * does not drift; periods that were skipped entirely are dropped.
+             */
+            if (t->mode == TIMER_AUTORELOAD) {
+                t->deadline_ticks += t->period_ticks;
+                if (tick_reached(now, t->deadline_ticks))
+                    t->deadline_ticks +=
+                        ((now - t->deadline_ticks) / t->period_ticks + 1) *
+                        t->period_ticks;
+                timer_arm(t);
+            } else {
+                t->mode = TIMER_DISABLED; /* One-shot timers are done */
+            }
+
+            /* The callback may start, cancel or destroy any timer */
+            timer_fire(t, late);
         }
-        /* Early termination if list is sorted by ID */
-        if (timer->id > id)
-            break;
-        node = node->next;
+
+        /* With level 0 empty, nothing happens until the next lap starts */
+        if (!level_count[0] && tick_reached(now, wheel_time | WHEEL_MASK))
+            wheel_time |= WHEEL_MASK;
+        wheel_time++;
     }
-    return NULL;
+
+    if (armed)
+        wheel_wake = wheel_next();
+
+    NOSCHED_LEAVE();
 }
 
-/* Find timer node for removal operations */
-static list_node_t *timer_find_node_by_id(uint16_t id)
+static void timer_daemon(void)
 {
-    if (unlikely(!all_timers_list))
-        return NULL;
-
-    list_node_t *node = all_timers_list->head->next;
-    while (node != all_timers_list->tail) {
-        if (((timer_t *) node->data)->id == id)
-            return node;
-        node = node->next;
+    while (1) {
+        mo_task_notify_wait(TIMER_DAEMON_WAKE, NOTIFY_WAIT_FOREVER);
+        timer_expire();
     }
-    return NULL;
 }
 
-/* Reduce timer batch processing size for tighter interrupt latency bounds */
-#define TIMER_BATCH_SIZE 4
-
+/* Called from the tick's deferred work: hands due timers to the service
+ * task, whose priority then decides when they run.
+ */
 void _timer_tick_handler(void)
 {
-    if (unlikely(!timer_initialized || !kcb->timer_list ||
-                 list_is_empty(kcb->timer_list)))
-        return;
-
-    uint32_t now = mo_ticks();
-    timer_t *expired_timers[TIMER_BATCH_SIZE]; /* Smaller batch size */
-    int expired_count = 0;
-
-    /* Collect expired timers in one pass, limited to batch size */
-    while (!list_is_empty(kcb->timer_list) &&
-           expired_count < TIMER_BATCH_SIZE) {
-        list_node_t *node = kcb->timer_list->head->next;
-        timer_t *t = (timer_t *) node->data;
-
-        if (now >= t->deadline_ticks) {
-            expired_timers[expired_count++] = t;
-            kcb->timer_list->head->next = node->next;
-            kcb->timer_list->length--;
-            return_timer_node(node);
-        } else {
-            /* First timer not expired, so none further down are */
-            break;
-        }
-    }
-
-    /* Process all expired timers */
-    for (int i = 0; i < expired_count; i++) {
-        timer_t *t = expired_timers[i];
+    if (daemon_id && armed && tick_reached(mo_ticks(), wheel_wake))
+        mo_task_notify(daemon_id, TIMER_DAEMON_WAKE, NOTIFY_SET_BITS);
+}
 
-        /* Execute callback */
-        if (likely(t->callback))
-            t->callback(t->arg);
+/* Earliest tick at which the wheel has work, used by tickless idle with
+ * interrupts masked. Returns false when no timer is armed.
+ */
+bool _timer_next_deadline(uint32_t *deadline)
+{
+    if (!armed)
+        return false;
 
-        /* Handle auto-reload timers */
-        if (t->mode == TIMER_AUTORELOAD) {
-            t->deadline_ticks = now + MS_TO_TICKS(t->period_ms);
-            timer_sorted_insert(t); /* Re-insert for next expiration */
-        } else {
-            t->mode = TIMER_DISABLED; /* One-shot timers are done */
-        }
-    }
+    *deadline = wheel_wake;
+    return true;
 }
 
-/* Insert timer into sorted position in all_timers_list */
-static int32_t timer_insert_sorted_by_id(timer_t *timer)
+/* Spawns the service task on first use. Called inside NOSCHED. */
+static bool timer_daemon_start(void)
 {
-    list_node_t *new_node = get_timer_node();
-    if (unlikely(!new_node))
-        return ERR_FAIL;
-    new_node->data = timer;
+    if (likely(daemon_id))
+        return true;
 
-    /* Find insertion point to maintain ID sort order */
-    list_node_t *prev = all_timers_list->head;
-    while (prev->next != all_timers_list->tail) {
-        timer_t *current = (timer_t *) prev->next->data;
-        if (timer->id < current->id)
-            break;
-        prev = prev->next;
-    }
+    int32_t id = mo_task_spawn_static(&daemon_tcb, daemon_stack,
+                                      sizeof(daemon_stack), timer_daemon);
+    if (unlikely(id < 0))
+        return false;
 
-    new_node->next = prev->next;
-    prev->next = new_node;
-    all_timers_list->length++;
-    return ERR_OK;
+    mo_task_priority((uint16_t) id, CONFIG_TIMER_DAEMON_PRIO);
+    daemon_id = (uint16_t) id;
+    return true;
 }
 
 int32_t mo_timer_create(void *(*callback)(void *arg),
@@ -290,33 +337,36 @@ int32_t mo_timer_create(void *(*callback)(void *arg),
 
     if (unlikely(!callback || !period_ms))
         return ERR_FAIL;
-    if (unlikely(timer_subsystem_init() != ERR_OK))
-        return ERR_FAIL;
 
-    timer_t *t = malloc(sizeof(timer_t));
+    timer_t *t = slab_alloc(&timer_cache);
     if (unlikely(!t))
         return ERR_FAIL;
 
-    NOSCHED_ENTER();
+    uint32_t period_ticks = MS_TO_TICKS(period_ms);
 
-    /* Initialize timer */
-    t->id = next_id++;
     t->callback = callback;
     t->arg = arg;
     t->period_ms = period_ms;
+    t->period_ticks = period_ticks ? period_ticks : 1;
     t->deadline_ticks = 0;
     t->mode = TIMER_DISABLED;
     t->_reserved = 0;
+    t->slot = NULL;
+    t->fires = t->overruns = 0;
+    t->max_late_ticks = t->max_run_cycles = 0;
 
-    /* Insert into sorted all_timers_list */
-    if (unlikely(timer_insert_sorted_by_id(t) != ERR_OK)) {
+    NOSCHED_ENTER();
+
+    if (unlikely(!timer_daemon_start())) {
         NOSCHED_LEAVE();
-        free(t);
+        slab_free(&timer_cache, t);
         return ERR_FAIL;
     }
 
-    /* Add to cache */
-    cache_timer(t->id, t);
+    t->id = next_id++;
+    timer_t **bucket = &timer_hash[t->id & (TIMER_HASH_SIZE - 1)];
+    t->hash_next = *bucket;
+    *bucket = t;
 
     NOSCHED_LEAVE();
     return t->id;
@@ -324,45 +374,26 @@ int32_t mo_timer_create(void *(*callback)(void *arg),
 
 int32_t mo_timer_destroy(uint16_t id)
 {
-    if (unlikely(!timer_initialized))
-        return ERR_FAIL;
-
     NOSCHED_ENTER();
 
-    list_node_t *node = timer_find_node_by_id(id);
-    if (unlikely(!node)) {
+    timer_t **link = &timer_hash[id & (TIMER_HASH_SIZE - 1)];
+    while (*link && (*link)->id != id)
+        link = &(*link)->hash_next;
+
+    timer_t *t = *link;
+    if (unlikely(!t)) {
         NOSCHED_LEAVE();
         return ERR_FAIL;
     }
 
-    timer_t *t = (timer_t *) node->data;
-
-    /* Remove from active list if running */
-    if (t->mode != TIMER_DISABLED)
-        timer_remove_item_by_data(kcb->timer_list, t);
-
-    /* Remove from cache */
-    for (int i = 0; i < 4; i++) {
-        if (timer_cache[i].timer == t) {
-            timer_cache[i].id = 0;
-            timer_cache[i].timer = NULL;
-        }
-    }
-
-    /* Remove from master list */
-    list_node_t *prev = all_timers_list->head;
-    while (prev->next != all_timers_list->tail && prev->next != node)
-        prev = prev->next;
-
-    if (likely(prev->next == node)) {
-        prev->next = node->next;
-        all_timers_list->length--;
-    }
-
-    free(t);
-    return_timer_node(node);
+    if (t->slot)
+        timer_disarm(t);
+    if (t == timer_running)
+        timer_running = NULL;
+    *link = t->hash_next;
 
     NOSCHED_LEAVE();
+    slab_free(&timer_cache, t);
     return ERR_OK;
 }
 
@@ -370,51 +401,65 @@ int32_t mo_timer_start(uint16_t id, uint8_t mode)
 {
     if (unlikely(mode != TIMER_ONESHOT && mode != TIMER_AUTORELOAD))
         return ERR_FAIL;
-    if (unlikely(!timer_initialized))
-        return ERR_FAIL;
 
     NOSCHED_ENTER();
 
-    timer_t *t = timer_find_by_id_fast(id);
+    timer_t *t = timer_find(id);
     if (unlikely(!t)) {
         NOSCHED_LEAVE();
         return ERR_FAIL;
     }
 
-    /* Remove from active list if already running */
-    if (t->mode != TIMER_DISABLED)
-        timer_remove_item_by_data(kcb->timer_list, t);
+    /* Restarting a running timer pushes its deadline out */
+    if (t->slot)
+        timer_disarm(t);
 
-    /* Configure and start timer */
     t->mode = mode;
-    t->deadline_ticks = mo_ticks() + MS_TO_TICKS(t->period_ms);
+    t->deadline_ticks = mo_ticks() + t->period_ticks;
+    timer_arm(t);
+
+    NOSCHED_LEAVE();
+    return ERR_OK;
+}
 
-    if (unlikely(timer_sorted_insert(t) != ERR_OK)) {
-        t->mode = TIMER_DISABLED;
+int32_t mo_timer_cancel(uint16_t id)
+{
+    NOSCHED_ENTER();
+
+    timer_t *t = timer_find(id);
+    if (unlikely(!t || t->mode == TIMER_DISABLED)) {
         NOSCHED_LEAVE();
         return ERR_FAIL;
     }
 
+    if (t->slot)
+        timer_disarm(t);
+    t->mode = TIMER_DISABLED;
+
     NOSCHED_LEAVE();
     return ERR_OK;
 }
 
-int32_t mo_timer_cancel(uint16_t id)
+int32_t mo_timer_stats(uint16_t id, timer_stats_t *stats)
 {
-    if (unlikely(!timer_initialized))
+    if (unlikely(!stats))
         return ERR_FAIL;
 
     NOSCHED_ENTER();
 
-    timer_t *t = timer_find_by_id_fast(id);
-    if (unlikely(!t || t->mode == TIMER_DISABLED)) {
+    timer_t *t = timer_find(id);
+    if (unlikely(!t)) {
         NOSCHED_LEAVE();
         return ERR_FAIL;
     }
 
-    timer_remove_item_by_data(kcb->timer_list, t);
-    t->mode = TIMER_DISABLED;
+    stats->fires = t->fires;
+    stats->overruns = t->overruns;
+    stats->max_late_ticks = t->max_late_ticks;
+    stats->max_run_us = (uint32_t) mo_cycles_to_us(t->max_run_cycles);
 
     NOSCHED_LEAVE();
     return ERR_OK;
 }
+
+#endif /* CONFIG_TIMER */
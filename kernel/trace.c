@@ -0,0 +1,85 @@
+/* Scheduler event trace ring buffer.
+ *
+ * Events are stored by value in a power-of-two array indexed by free-running
+ * head and tail counters. Recording only disables interrupts for the few
+ * stores it performs, so it can be called from any context.
+ */
+
+#include <hal.h>
+#include <lib/libc.h>
+#include <sys/trace.h>
+
+#if CONFIG_TRACE
+
+#if CONFIG_TRACE_EVENTS & (CONFIG_TRACE_EVENTS - 1)
+#error "CONFIG_TRACE_EVENTS must be a power of two"
+#endif
+
+#define TRACE_MASK (CONFIG_TRACE_EVENTS - 1)
+
+static trace_event_t trace_buf[CONFIG_TRACE_EVENTS];
+static uint32_t trace_head; /* Next slot to write */
+static uint32_t trace_tail; /* Oldest buffered event */
+static uint32_t trace_lost; /* Events overwritten before being dumped */
+
+void _trace_record(uint8_t type, uint8_t aux, uint16_t a, uint32_t b)
+{
+    int32_t irq = hal_interrupt_set(0);
+
+    trace_event_t *e = &trace_buf[trace_head & TRACE_MASK];
+    e->ts = hal_clock_read();
+    e->type = type;
+    e->aux = aux;
+    e->a = a;
+    e->b = b;
+
+    /* Full: drop the oldest event */
+    if (++trace_head - trace_tail > CONFIG_TRACE_EVENTS) {
+        trace_tail++;
+        trace_lost++;
+    }
+
+    if (irq)
+        _ei();
+}
+
+void mo_trace_dump(void)
+{
+    /* Snapshot the window; events recorded meanwhile stay for the next dump */
+    int32_t irq = hal_interrupt_set(0);
+    uint32_t tail = trace_tail;
+    uint32_t head = trace_head;
+    uint32_t lost = trace_lost;
+    trace_lost = 0;
+    if (irq)
+        _ei();
+
+    printf("trace: begin hz=%lu count=%lu lost=%lu\n", (uint32_t) F_CPU,
+           head - tail, lost);
+
+    for (; tail != head; tail++) {
+        trace_event_t e;
+
+        /* Copy atomically, and skip events overwritten while printing */
+        irq = hal_interrupt_set(0);
+        bool valid = (trace_head - tail) <= CONFIG_TRACE_EVENTS;
+        if (valid) {
+            e = trace_buf[tail & TRACE_MASK];
+            trace_tail = tail + 1;
+        }
+        if (irq)
+            _ei();
+
+        if (valid)
+            printf("trace: %08lx %02x %02x %04x %08lx\n", e.ts, e.type, e.aux,
+                   e.a, e.b);
+    }
+
+    printf("trace: end\n");
+}
+
+#else /* !CONFIG_TRACE */
+
+void mo_trace_dump(void) {}
+
+#endif /* CONFIG_TRACE */
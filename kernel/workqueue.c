@@ -0,0 +1,147 @@
+/* Work queues over a copy-in message queue.
+ *
+ * Task entries take no argument, so a new worker learns its queue from its
+ * creator through its notification word: the descriptor's address is
+ * written there with NOTIFY_OVERWRITE right after the spawn, and the word
+ * holds it even if the worker only starts waiting later.
+ *
+ * All workers take jobs from one shared queue, only through work_take(). Once
+ * the kernel schedules several harts, per-hart queues with idle workers
+ * stealing from their siblings can replace it there without changing the
+ * API.
+ *
+ * A job with no function is a stop request: the worker counts itself in
+ * 'stopped' and suspends, and mo_workqueue_destroy() then cancels it.
+ */
+
+#include <lib/libc.h>
+#include <lib/malloc.h>
+
+#include <sys/mqueue.h>
+#include <sys/spinlock.h>
+#include <sys/task.h>
+#include <sys/workqueue.h>
+
+#include "private/error.h"
+#include "private/utils.h"
+
+#if CONFIG_MQUEUE
+
+typedef struct {
+    void (*fn)(void *arg);
+    void *arg;
+    uint32_t done_bits; /* Notification for the submitter, or 0 */
+    uint16_t submitter; /* Task ID to notify */
+} work_job_t;
+
+static inline void work_take(workqueue_t *wq, work_job_t *job)
+{
+    while (mo_mq_receive_copy(wq->jobs, job, MQ_WAIT_FOREVER) != ERR_OK)
+        ;
+}
+
+static void work_main(void)
+{
+    uint32_t word = mo_task_notify_wait(0, NOTIFY_WAIT_FOREVER);
+    workqueue_t *wq = (workqueue_t *) (uintptr_t) word;
+    work_job_t job;
+
+    while (1) {
+        work_take(wq, &job);
+
+        if (unlikely(!job.fn)) {
+            atomic_inc(&wq->stopped);
+            while (1)
+                mo_task_suspend(mo_task_id());
+        }
+
+        job.fn(job.arg);
+        atomic_inc(&wq->completed);
+
+        /* A submitter that has since been cancelled is simply not found */
+        if (job.done_bits)
+            mo_task_notify(job.submitter, job.done_bits, NOTIFY_SET_BITS);
+    }
+}
+
+workqueue_t *mo_workqueue_create(uint8_t workers,
+                                 uint16_t priority,
+                                 uint16_t depth,
+                                 uint16_t stack_size)
+{
+    if (unlikely(!workers || !depth))
+        return NULL;
+
+    workqueue_t *wq = malloc(sizeof(*wq) + workers * sizeof(uint16_t));
+    if (unlikely(!wq))
+        return NULL;
+
+    wq->jobs = mo_mq_create_fixed(depth, sizeof(work_job_t), 1);
+    if (unlikely(!wq->jobs)) {
+        free(wq);
+        return NULL;
+    }
+    atomic_set(&wq->completed, 0);
+    atomic_set(&wq->stopped, 0);
+    wq->count = workers;
+
+    for (uint8_t i = 0; i < workers; i++) {
+        int32_t id = mo_task_spawn(work_main, stack_size);
+        if (unlikely(id < 0)) {
+            /* Those spawned so far never see a job; nothing else owns them */
+            while (i)
+                mo_task_cancel(wq->workers[--i]);
+            mo_mq_destroy(wq->jobs);
+            free(wq);
+            return NULL;
+        }
+        wq->workers[i] = (uint16_t) id;
+        mo_task_priority((uint16_t) id, priority);
+        mo_task_notify((uint16_t) id, (uint32_t) (uintptr_t) wq,
+                       NOTIFY_OVERWRITE);
+    }
+    return wq;
+}
+
+int32_t mo_workqueue_destroy(workqueue_t *wq)
+{
+    if (unlikely(!wq || !wq->jobs))
+        return ERR_FAIL;
+
+    uint16_t self = mo_task_id();
+    for (uint8_t i = 0; i < wq->count; i++) {
+        if (wq->workers[i] == self)
+            return ERR_FAIL;
+    }
+
+    /* Queued behind the pending jobs, one per worker */
+    work_job_t stop = {NULL, NULL, 0, 0};
+    for (uint8_t i = 0; i < wq->count; i++)
+        mo_mq_send_copy(wq->jobs, &stop, 0, MQ_WAIT_FOREVER);
+
+    while (atomic_read(&wq->stopped) < wq->count)
+        mo_task_delay(1);
+
+    for (uint8_t i = 0; i < wq->count; i++)
+        mo_task_cancel(wq->workers[i]);
+
+    mo_mq_destroy(wq->jobs);
+    wq->jobs = NULL;
+    free(wq);
+    return ERR_OK;
+}
+
+int32_t mo_workqueue_submit(workqueue_t *wq,
+                            void (*fn)(void *arg),
+                            void *arg,
+                            uint32_t done_bits,
+                            uint32_t timeout)
+{
+    if (unlikely(!wq || !wq->jobs || !fn))
+        return ERR_FAIL;
+
+    work_job_t job = {fn, arg, done_bits, mo_task_id()};
+    return mo_mq_send_copy(wq->jobs, &job, 0, timeout);
+}
+
+#endif /* CONFIG_MQUEUE */
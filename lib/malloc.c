@@ -1,32 +1,86 @@
 /* libc: memory allocation. */
 
 #include <lib/libc.h>
+#include <lib/malloc.h>
 #include <sys/task.h>
 #include <types.h>
 
 #include "private/error.h"
 #include "private/utils.h"
 
-/* Memory allocator using first-fit strategy with selective coalescing.
+/* Memory allocator using Two-Level Segregated Fit (TLSF).
+ *
+ * Free blocks are kept on segregated lists indexed by size class. The first
+ * level splits sizes by power of two; the second level splits each power of
+ * two into SL_COUNT linear steps. Two bitmaps record which lists are
+ * non-empty, so finding a fitting block takes a fixed number of bit scans.
  *
  * Performance characteristics:
- * - malloc(): O(n) worst case; searches linearly from heap start; coalesces
- *             free blocks when fragmentation threshold is reached.
- * - free(): O(1) average case; marks memory areas as unused with immediate
- *           forward coalescing and optional backward coalescing.
+ * - malloc(): O(1); the request is rounded up to the next size class, so the
+ *             first block of any non-empty class at or above it fits.
+ * - free(): O(1); every block records its physical predecessor, so both
+ *           neighbours are coalesced immediately without walking any list.
+ *
+ * Every block boundary is cross-checked against its neighbours on the way in
+ * and out, so a clobbered header or an invalid or double free still stops
+ * the system with ERR_HEAP_CORRUPT.
  *
- * This implementation prioritizes fast allocation/deallocation with proper
- * fragmentation management to minimize memory waste.
+ * The statistics counters are updated wherever a block enters or leaves a
+ * free list or changes hands, which keeps mo_heap_stats() free of any heap
+ * walk.
+ *
+ * Each memory region is an independent TLSF heap with its own lists,
+ * bitmaps and counters; blocks never span or merge across regions. An
+ * allocation searches the regions of the kind its hint prefers, then, if
+ * the hint allows, those of the other kind.
  */
 
 typedef struct __memblock {
-    struct __memblock *next; /* pointer to the next block */
-    size_t size;             /* block size, LSB = used flag */
+    struct __memblock *prev_phys; /* physically preceding block, or NULL */
+    size_t size;                  /* payload size, LSB = used flag */
+
+    /* Free blocks only; these overlay the first payload bytes */
+    struct __memblock *next_free; /* next block in the same size class */
+    struct __memblock *prev_free; /* previous block in the same size class */
 } memblock_t;
 
-static memblock_t *first_free;
-static void *heap_start, *heap_end;
-static uint32_t free_blocks_count; /* track fragmentation */
+/* Header kept on every block; the free-list links live in the payload */
+#define BLOCK_HDR __builtin_offsetof(memblock_t, next_free)
+
+/* Smallest payload, large enough to hold the free-list links */
+#define BLOCK_MIN_SIZE (sizeof(memblock_t) - BLOCK_HDR)
+
+/* Size classes: SL_COUNT linear steps per power of two. Everything below
+ * SMALL_SIZE shares the first level, in steps of the 4-byte alignment.
+ */
+#define ALIGN_SHIFT 2
+#define SL_BITS 4
+#define SL_COUNT (1U << SL_BITS)
+#define FL_SHIFT (SL_BITS + ALIGN_SHIFT)
+#define SMALL_SIZE (1U << FL_SHIFT)
+#define FL_MAX_BITS 31 /* Sizes below 2^31, see MALLOC_MAX_SIZE */
+#define FL_COUNT (FL_MAX_BITS - FL_SHIFT + 1)
+
+typedef struct {
+    uint32_t fl_bitmap;           /* bit f: some list of level f is used */
+    uint16_t sl_bitmap[FL_COUNT]; /* bit s: list [f][s] is non-empty */
+    memblock_t *free_lists[FL_COUNT][SL_COUNT];
+    void *start, *end; /* Bounds, the end marker block included */
+    uint32_t flags;    /* HEAP_REGION_* attributes */
+
+    /* Statistics, see heap_stats_t */
+    uint32_t total, used, peak, free;
+    uint32_t free_count, alloc_count, fail_count;
+    uint32_t fl_blocks[FL_COUNT]; /* Free blocks per first level */
+} heap_region_t;
+
+static heap_region_t regions[CONFIG_HEAP_REGIONS];
+static uint32_t region_count;
+
+/* Totals across all regions: the peak of the sum is not the sum of the
+ * regions' peaks, and a request served by a fallback region did not fail.
+ */
+static uint32_t used_bytes, peak_bytes, fail_count;
 
 /* Block manipulation macros */
 #define IS_USED(b) ((b)->size & 1L)
@@ -34,108 +88,141 @@ static uint32_t free_blocks_count; /* track fragmentation */
 #define MARK_USED(b) ((b)->size |= 1L)
 #define MARK_FREE(b) ((b)->size &= ~1L)
 
+/* Physically following block; the heap ends in a used zero-size block */
+#define PHYS_NEXT(b) \
+    ((memblock_t *) ((uint8_t *) (b) + BLOCK_HDR + GET_SIZE(b)))
+
 /* Memory layout validation */
-#define IS_VALID_BLOCK(b)                                     \
-    ((void *) (b) >= heap_start && (void *) (b) < heap_end && \
+#define IS_VALID_BLOCK(h, b)                                  \
+    ((void *) (b) >= (h)->start && (void *) (b) < (h)->end && \
      (size_t) (b) % sizeof(size_t) == 0)
 
-/* Fragmentation threshold - coalesce when free blocks exceed this ratio */
-#define COALESCE_THRESHOLD 8
-
-/* Validate block integrity */
-static inline bool validate_block(memblock_t *block)
+/* Validate block integrity: the header must be in range, and both physical
+ * neighbours must agree about where this block starts and ends.
+ */
+static inline bool validate_block(heap_region_t *h, memblock_t *block)
 {
-    if (unlikely(!IS_VALID_BLOCK(block)))
+    if (unlikely(!IS_VALID_BLOCK(h, block)))
         return false;
 
     size_t size = GET_SIZE(block);
-    if (unlikely(!size || size > MALLOC_MAX_SIZE))
+    if (unlikely(size < BLOCK_MIN_SIZE || size > MALLOC_MAX_SIZE))
         return false;
 
     /* Check if block extends beyond heap */
-    if (unlikely((uint8_t *) block + sizeof(memblock_t) + size >
-                 (uint8_t *) heap_end))
+    if (unlikely((uint8_t *) block + BLOCK_HDR + size >
+                 (uint8_t *) h->end - BLOCK_HDR))
         return false;
 
-    if (unlikely(block->next &&
-                 (uint8_t *) block + sizeof(memblock_t) + GET_SIZE(block) !=
-                     (uint8_t *) block->next))
+    if (unlikely(PHYS_NEXT(block)->prev_phys != block))
+        return false;
+
+    memblock_t *prev = block->prev_phys;
+    if (prev &&
+        unlikely(!IS_VALID_BLOCK(h, prev) || PHYS_NEXT(prev) != block))
         return false;
 
     return true;
 }
 
-/* O(1) with immediate forward coalescing, conditional backward coalescing */
-void free(void *ptr)
+/* Size class of a free block of @size bytes */
+static inline void mapping(size_t size, uint32_t *fl, uint32_t *sl)
 {
-    if (!ptr)
-        return;
-
-    CRITICAL_ENTER();
-
-    memblock_t *p = ((memblock_t *) ptr) - 1;
-
-    /* Validate the block being freed */
-    if (unlikely(!validate_block(p) || !IS_USED(p))) {
-        CRITICAL_LEAVE();
-        panic(ERR_HEAP_CORRUPT);
-        return; /* Invalid or double-free */
-    }
-
-    MARK_FREE(p);
-    free_blocks_count++;
-
-    /* Forward merge if the next block is free and physically adjacent */
-    if (p->next && !IS_USED(p->next)) {
-        p->size = GET_SIZE(p) + sizeof(memblock_t) + GET_SIZE(p->next);
-        p->next = p->next->next;
-        free_blocks_count--;
+    if (size < SMALL_SIZE) {
+        *fl = 0;
+        *sl = size >> ALIGN_SHIFT;
+    } else {
+        uint32_t f = ilog2(size);
+        *sl = (size >> (f - SL_BITS)) ^ SL_COUNT;
+        *fl = f - FL_SHIFT + 1;
     }
+}
 
-    /* Backward merge: optimized single-pass search with early termination */
-    memblock_t *prev = NULL;
-    memblock_t *current = first_free;
-    while (current && current != p) {
-        prev = current;
-        current = current->next;
-    }
+static void free_insert(heap_region_t *h, memblock_t *b)
+{
+    uint32_t fl, sl;
+
+    mapping(GET_SIZE(b), &fl, &sl);
+    b->prev_free = NULL;
+    b->next_free = h->free_lists[fl][sl];
+    if (b->next_free)
+        b->next_free->prev_free = b;
+    h->free_lists[fl][sl] = b;
+    h->fl_bitmap |= 1U << fl;
+    h->sl_bitmap[fl] |= 1U << sl;
+
+    h->free += GET_SIZE(b);
+    h->free_count++;
+    h->fl_blocks[fl]++;
+}
 
-    if (prev && !IS_USED(prev)) {
-        if (unlikely(!validate_block(prev))) {
-            CRITICAL_LEAVE();
-            panic(ERR_HEAP_CORRUPT);
-            return;
+static void free_remove(heap_region_t *h, memblock_t *b)
+{
+    uint32_t fl, sl;
+
+    mapping(GET_SIZE(b), &fl, &sl);
+    if (b->next_free)
+        b->next_free->prev_free = b->prev_free;
+    if (b->prev_free) {
+        b->prev_free->next_free = b->next_free;
+    } else {
+        h->free_lists[fl][sl] = b->next_free;
+        if (!h->free_lists[fl][sl]) {
+            h->sl_bitmap[fl] &= ~(1U << sl);
+            if (!h->sl_bitmap[fl])
+                h->fl_bitmap &= ~(1U << fl);
         }
-        prev->size = GET_SIZE(prev) + sizeof(memblock_t) + GET_SIZE(p);
-        prev->next = p->next;
-        free_blocks_count--;
     }
 
-    CRITICAL_LEAVE();
+    h->free -= GET_SIZE(b);
+    h->free_count--;
+    h->fl_blocks[fl]--;
 }
 
-/* Selective coalescing: only when fragmentation becomes significant */
-static void selective_coalesce(void)
+/* Takes a free block of at least @size bytes off a list of @h, or NULL */
+static memblock_t *find_fit(heap_region_t *h, size_t size)
 {
-    memblock_t *p = first_free;
+    uint32_t fl, sl;
+    memblock_t *b;
+
+    /* Round up to the next class boundary, so any block in it is enough */
+    size_t rounded = size;
+    if (size >= SMALL_SIZE)
+        rounded += (1U << (ilog2(size) - SL_BITS)) - 1;
+    mapping(rounded, &fl, &sl);
+
+    uint32_t sl_map = fl < FL_COUNT ? h->sl_bitmap[fl] & (~0U << sl) : 0;
+    uint32_t fl_map = fl < FL_COUNT ? h->fl_bitmap & (~0U << (fl + 1)) : 0;
+    if (sl_map) {
+        sl = ctz32(sl_map);
+    } else if (fl_map) {
+        fl = ctz32(fl_map);
+        sl = ctz32(h->sl_bitmap[fl]);
+    } else {
+        /* Nothing above: the head of the request's own class may still be
+         * big enough, which keeps a near-whole-heap request satisfiable.
+         */
+        mapping(size, &fl, &sl);
+        b = fl < FL_COUNT ? h->free_lists[fl][sl] : NULL;
+        if (!b || GET_SIZE(b) < size)
+            return NULL;
+    }
 
-    while (p && p->next) {
-        /* Merge only when blocks are FREE *and* adjacent in memory */
-        if (unlikely(!validate_block(p))) {
-            panic(ERR_HEAP_CORRUPT);
-            return;
-        }
-        if (!IS_USED(p) && !IS_USED(p->next)) {
-            p->size = GET_SIZE(p) + sizeof(memblock_t) + GET_SIZE(p->next);
-            p->next = p->next->next;
-            free_blocks_count--;
-        } else {
-            p = p->next;
-        }
+    b = h->free_lists[fl][sl];
+    if (unlikely(!validate_block(h, b) || IS_USED(b))) {
+        panic(ERR_HEAP_CORRUPT);
+        return NULL;
     }
+    free_remove(h, b);
+    return b;
 }
 
-static inline void split_block(memblock_t *block, size_t size)
+/* Trim @block, whose list membership is already settled, to @size bytes;
+ * the remainder becomes a free block if it is large enough to be useful.
+ */
+static inline void split_block(heap_region_t *h,
+                               memblock_t *block,
+                               size_t size)
 {
     size_t remaining;
     memblock_t *new_block;
@@ -146,89 +233,349 @@ static inline void split_block(memblock_t *block, size_t size)
     }
     remaining = GET_SIZE(block) - size;
     /* Split only when remaining memory is large enough */
-    if (remaining < sizeof(memblock_t) + MALLOC_MIN_SIZE)
+    if (remaining < BLOCK_HDR + BLOCK_MIN_SIZE)
         return;
-    new_block = (memblock_t *) ((size_t) block + sizeof(memblock_t) + size);
-    new_block->next = block->next;
-    new_block->size = remaining - sizeof(memblock_t);
-    MARK_FREE(new_block);
-    block->next = new_block;
+
+    memblock_t *next = PHYS_NEXT(block);
     block->size = size | IS_USED(block);
-    free_blocks_count++; /* New free block created */
+    new_block = PHYS_NEXT(block);
+    new_block->prev_phys = block;
+    new_block->size = remaining - BLOCK_HDR;
+    next->prev_phys = new_block;
+
+    /* The old successor may itself be free: keep free blocks maximal */
+    if (!IS_USED(next)) {
+        free_remove(h, next);
+        new_block->size += BLOCK_HDR + GET_SIZE(next);
+        PHYS_NEXT(new_block)->prev_phys = new_block;
+    }
+    free_insert(h, new_block);
 }
 
-/* O(n) first-fit allocation with selective coalescing */
-void *malloc(uint32_t size)
+/* Absorbs the free block physically following @b into it */
+static inline void merge_next(heap_region_t *h, memblock_t *b)
 {
-    /* Input validation */
-    if (unlikely(!size || size > MALLOC_MAX_SIZE))
-        return NULL;
+    memblock_t *next = PHYS_NEXT(b);
 
+    free_remove(h, next);
+    b->size += BLOCK_HDR + GET_SIZE(next);
+    PHYS_NEXT(b)->prev_phys = b;
+}
+
+/* Payload size that malloc() rounds @size to */
+static inline size_t adjust_size(uint32_t size)
+{
     size = ALIGN4(size);
+    return size < BLOCK_MIN_SIZE ? BLOCK_MIN_SIZE : size;
+}
 
-    /* Ensure minimum allocation size */
-    if (size < MALLOC_MIN_SIZE)
-        size = MALLOC_MIN_SIZE;
+/* Charge a change of @old_size to @new_size bytes held by allocations */
+static inline void account_used(heap_region_t *h,
+                                size_t old_size,
+                                size_t new_size)
+{
+    h->used += new_size - old_size;
+    if (h->used > h->peak)
+        h->peak = h->used;
 
-    CRITICAL_ENTER();
+    used_bytes += new_size - old_size;
+    if (used_bytes > peak_bytes)
+        peak_bytes = used_bytes;
+}
 
-    /* Trigger coalescing only when fragmentation is high */
-    if (free_blocks_count > COALESCE_THRESHOLD)
-        selective_coalesce();
+/* Region holding the block header at @b, or NULL */
+static heap_region_t *region_of(const void *b)
+{
+    for (uint32_t i = 0; i < region_count; i++) {
+        if (b >= regions[i].start && b < regions[i].end)
+            return &regions[i];
+    }
+    return NULL;
+}
 
-    memblock_t *p = first_free;
-    while (p) {
-        if (unlikely(!validate_block(p))) {
-            CRITICAL_LEAVE();
-            panic(ERR_HEAP_CORRUPT);
-            return NULL; /* Heap corruption detected */
+static inline bool region_fast(const heap_region_t *h)
+{
+    return h->flags & HEAP_REGION_FAST;
+}
+
+/* Takes a block of @size bytes from the first region of the wanted kind
+ * that has one, setting *@out to that region. Returns NULL if none has.
+ */
+static memblock_t *region_fit(bool fast, size_t size, heap_region_t **out)
+{
+    for (uint32_t i = 0; i < region_count; i++) {
+        heap_region_t *h = &regions[i];
+        if (region_fast(h) != fast)
+            continue;
+
+        memblock_t *b = find_fit(h, size);
+        if (b) {
+            *out = h;
+            return b;
         }
+        h->fail_count++;
+    }
+    return NULL;
+}
 
-        if (!IS_USED(p) && GET_SIZE(p) >= size) {
-            /* Split block only if remainder is large enough to be useful */
-            split_block(p, size);
+#if CONFIG_HEAP_TRACE
 
-            MARK_USED(p);
-            if (unlikely(free_blocks_count <= 0)) {
-                panic(ERR_HEAP_CORRUPT);
-                return NULL;
-            }
-            free_blocks_count--;
+#if CONFIG_HEAP_TRACE_ENTRIES & (CONFIG_HEAP_TRACE_ENTRIES - 1)
+#error "CONFIG_HEAP_TRACE_ENTRIES must be a power of two"
+#endif
 
-            CRITICAL_LEAVE();
-            return (void *) (p + 1);
-        }
-        p = p->next;
+#define HEAP_TRACE_MASK (CONFIG_HEAP_TRACE_ENTRIES - 1)
+
+static heap_trace_t trace_ring[CONFIG_HEAP_TRACE_ENTRIES];
+static uint32_t trace_head; /* Next slot to write */
+static uint32_t trace_tail; /* Oldest buffered record */
+static uint32_t trace_lost; /* Records overwritten before being read */
+
+static void heap_trace(uint8_t op, void *caller, void *ptr, uint32_t size)
+{
+    int32_t irq = hal_interrupt_set(0);
+
+    heap_trace_t *r = &trace_ring[trace_head & HEAP_TRACE_MASK];
+    r->caller = (uint32_t) (size_t) caller;
+    r->ptr = ptr;
+    r->size = size;
+    r->task = mo_task_id();
+    r->op = op;
+    r->reserved = 0;
+
+    /* Full: drop the oldest record */
+    if (++trace_head - trace_tail > CONFIG_HEAP_TRACE_ENTRIES) {
+        trace_tail++;
+        trace_lost++;
+    }
+
+    if (irq)
+        _ei();
+}
+
+/* Must be expanded in the public entry point, so the caller is the user's */
+#define HEAP_TRACE(op, ptr, size) \
+    heap_trace((op), __builtin_return_address(0), (ptr), (size))
+
+uint32_t mo_heap_trace_read(heap_trace_t *out, uint32_t max)
+{
+    if (unlikely(!out))
+        return 0;
+
+    int32_t irq = hal_interrupt_set(0);
+    uint32_t n = 0;
+    for (; n < max && trace_tail != trace_head; n++)
+        out[n] = trace_ring[trace_tail++ & HEAP_TRACE_MASK];
+    if (irq)
+        _ei();
+
+    return n;
+}
+
+uint32_t mo_heap_trace_lost(void)
+{
+    int32_t irq = hal_interrupt_set(0);
+    uint32_t lost = trace_lost;
+    trace_lost = 0;
+    if (irq)
+        _ei();
+
+    return lost;
+}
+
+#else /* !CONFIG_HEAP_TRACE */
+
+#define HEAP_TRACE(op, ptr, size) \
+    do {                          \
+    } while (0)
+
+uint32_t mo_heap_trace_read(heap_trace_t *out, uint32_t max)
+{
+    (void) out;
+    (void) max;
+    return 0;
+}
+
+uint32_t mo_heap_trace_lost(void)
+{
+    return 0;
+}
+
+#endif /* CONFIG_HEAP_TRACE */
+
+/* O(1) with immediate coalescing of both neighbours */
+static void heap_free(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    CRITICAL_ENTER();
+
+    memblock_t *p = (memblock_t *) ((uint8_t *) ptr - BLOCK_HDR);
+    heap_region_t *h = region_of(p);
+
+    /* Validate the block being freed */
+    if (unlikely(!h || !validate_block(h, p) || !IS_USED(p))) {
+        CRITICAL_LEAVE();
+        panic(ERR_HEAP_CORRUPT);
+        return; /* Invalid or double-free */
+    }
+
+    MARK_FREE(p);
+    account_used(h, GET_SIZE(p), 0);
+    h->alloc_count--;
+
+    /* Forward merge if the next block is free */
+    if (!IS_USED(PHYS_NEXT(p)))
+        merge_next(h, p);
+
+    /* Backward merge through the physical predecessor link */
+    memblock_t *prev = p->prev_phys;
+    if (prev && !IS_USED(prev)) {
+        free_remove(h, prev);
+        prev->size += BLOCK_HDR + GET_SIZE(p);
+        PHYS_NEXT(prev)->prev_phys = prev;
+        p = prev;
     }
 
+    free_insert(h, p);
     CRITICAL_LEAVE();
-    return NULL; /* allocation failed */
 }
 
-/* Initializes memory allocator with enhanced validation */
-void mo_heap_init(size_t *zone, uint32_t len)
+/* O(1) good-fit allocation in each region searched */
+static void *heap_alloc(uint32_t size, uint32_t hint)
+{
+    /* Input validation */
+    if (unlikely(!size || size > MALLOC_MAX_SIZE || hint > MEM_BULK))
+        return NULL;
+
+    size_t want = adjust_size(size);
+    bool fast = hint == MEM_FAST || hint == MEM_FAST_ONLY;
+    bool fallback = hint == MEM_ANY || hint == MEM_FAST;
+    heap_region_t *h = NULL;
+
+    CRITICAL_ENTER();
+
+    memblock_t *p = region_fit(fast, want, &h);
+    if (!p && fallback)
+        p = region_fit(!fast, want, &h);
+    if (unlikely(!p)) {
+        fail_count++;
+        CRITICAL_LEAVE();
+        return NULL; /* allocation failed */
+    }
+
+    MARK_USED(p);
+    split_block(h, p, want);
+    account_used(h, 0, GET_SIZE(p));
+    h->alloc_count++;
+
+    CRITICAL_LEAVE();
+    return (uint8_t *) p + BLOCK_HDR;
+}
+
+void free(void *ptr)
+{
+    if (ptr)
+        HEAP_TRACE(HEAP_OP_FREE, ptr, 0);
+    heap_free(ptr);
+}
+
+void *malloc(uint32_t size)
+{
+    void *p = heap_alloc(size, MEM_ANY);
+    HEAP_TRACE(HEAP_OP_MALLOC, p, size);
+    return p;
+}
+
+void *malloc_region(uint32_t size, uint32_t hint)
+{
+    void *p = heap_alloc(size, hint);
+    HEAP_TRACE(HEAP_OP_MALLOC, p, size);
+    return p;
+}
+
+/* Turns the @len bytes at @zone, a word aligned address, into region @h:
+ * one free block followed by the end marker.
+ */
+static void region_init(heap_region_t *h,
+                        size_t *zone,
+                        uint32_t len,
+                        uint32_t flags)
 {
     memblock_t *start, *end;
 
-    if (unlikely(!zone || len < 2 * sizeof(memblock_t) + MALLOC_MIN_SIZE))
-        return; /* Invalid parameters */
+    memset(h, 0, sizeof(*h));
+    h->flags = flags;
 
-    len = ALIGN4(len);
     start = (memblock_t *) zone;
-    end = (memblock_t *) ((size_t) zone + len - sizeof(memblock_t));
-
-    start->next = end;
-    start->size = len - 2 * sizeof(memblock_t);
+    start->prev_phys = NULL;
+    start->size = len - 2 * BLOCK_HDR;
+    if (start->size > MALLOC_MAX_SIZE)
+        start->size = MALLOC_MAX_SIZE & ~3U; /* Rest of the zone is unused */
     MARK_FREE(start);
 
-    end->next = NULL;
+    end = PHYS_NEXT(start);
+    end->prev_phys = start;
     end->size = 0;
     MARK_USED(end); /* end block marks heap boundary */
 
-    first_free = start;
-    heap_start = (void *) zone;
-    heap_end = (void *) ((size_t) end + sizeof(memblock_t));
-    free_blocks_count = 1;
+    h->start = (void *) zone;
+    h->end = (void *) ((size_t) end + BLOCK_HDR);
+    h->total = (uint32_t) ((uint8_t *) h->end - (uint8_t *) h->start);
+    free_insert(h, start);
+}
+
+/* Initializes memory allocator with enhanced validation */
+void mo_heap_init(size_t *zone, uint32_t len)
+{
+    len &= ~3U;
+    if (unlikely(!zone || len < 2 * BLOCK_HDR + BLOCK_MIN_SIZE))
+        return; /* Invalid parameters */
+
+    used_bytes = peak_bytes = fail_count = 0;
+    region_init(&regions[0], zone, len, 0);
+    region_count = 1;
+}
+
+int32_t mo_heap_add_region(void *base, uint32_t len, uint32_t flags)
+{
+    if (unlikely(!base || !region_count))
+        return ERR_FAIL;
+
+    /* Word-align the start, and the length with it */
+    uint32_t skew = ALIGN4(base) - (uint32_t) (size_t) base;
+    if (unlikely(len < skew + 2 * BLOCK_HDR + BLOCK_MIN_SIZE))
+        return ERR_FAIL;
+    size_t *zone = (size_t *) ((uint8_t *) base + skew);
+    len = (len - skew) & ~3U;
+    uint8_t *limit = (uint8_t *) zone + len;
+
+    CRITICAL_ENTER();
+    for (uint32_t i = 0; i < region_count; i++) {
+        if ((uint8_t *) zone < (uint8_t *) regions[i].end &&
+            limit > (uint8_t *) regions[i].start) {
+            CRITICAL_LEAVE();
+            return ERR_FAIL; /* Overlaps region i */
+        }
+    }
+    if (unlikely(region_count >= CONFIG_HEAP_REGIONS)) {
+        CRITICAL_LEAVE();
+        return ERR_FAIL;
+    }
+
+    region_init(&regions[region_count], zone, len, flags);
+    int32_t index = (int32_t) region_count++;
+    CRITICAL_LEAVE();
+    return index;
+}
+
+int32_t mo_heap_region(const void *ptr)
+{
+    CRITICAL_ENTER();
+    heap_region_t *h = region_of(ptr);
+    CRITICAL_LEAVE();
+    return h ? (int32_t) (h - regions) : -1;
 }
 
 /* Allocates zero-initialized memory with overflow protection */
@@ -239,7 +586,8 @@ void *calloc(uint32_t nmemb, uint32_t size)
         return NULL;
 
     uint32_t total_size = ALIGN4(nmemb * size);
-    void *buf = malloc(total_size);
+    void *buf = heap_alloc(total_size, MEM_ANY);
+    HEAP_TRACE(HEAP_OP_MALLOC, buf, total_size);
 
     if (buf)
         memset(buf, 0, total_size);
@@ -247,69 +595,181 @@ void *calloc(uint32_t nmemb, uint32_t size)
     return buf;
 }
 
-/* Reallocates memory with improved efficiency */
-void *realloc(void *ptr, uint32_t size)
+/* Resizes in place when the block or its free successor allows it */
+static void *heap_realloc(void *ptr, uint32_t size)
 {
     if (unlikely(size > MALLOC_MAX_SIZE))
         return NULL;
 
     if (!ptr)
-        return malloc(size);
+        return heap_alloc(size, MEM_ANY);
 
     if (!size) {
-        free(ptr);
+        heap_free(ptr);
         return NULL;
     }
 
-    size = ALIGN4(size);
+    size_t want = adjust_size(size);
+
+    CRITICAL_ENTER();
 
-    memblock_t *old_block = ((memblock_t *) ptr) - 1;
+    memblock_t *old_block = (memblock_t *) ((uint8_t *) ptr - BLOCK_HDR);
+    heap_region_t *h = region_of(old_block);
 
     /* Validate the existing block */
-    if (unlikely(!validate_block(old_block) || !IS_USED(old_block))) {
+    if (unlikely(!h || !validate_block(h, old_block) ||
+                 !IS_USED(old_block))) {
+        CRITICAL_LEAVE();
         panic(ERR_HEAP_CORRUPT);
         return NULL;
     }
 
     size_t old_size = GET_SIZE(old_block);
 
-    /* If shrinking or size is close, reuse existing block */
-    if (size <= old_size &&
-        old_size - size < sizeof(memblock_t) + MALLOC_MIN_SIZE)
-        return ptr;
-
-    /* fast path for shrinking */
-    if (size <= old_size) {
-        split_block(old_block, size);
-        /* Trigger coalescing only when fragmentation is high */
-        if (free_blocks_count > COALESCE_THRESHOLD)
-            selective_coalesce();
+    /* Shrinking: give the tail back */
+    if (want <= old_size) {
+        split_block(h, old_block, want);
+        account_used(h, old_size, GET_SIZE(old_block));
         CRITICAL_LEAVE();
-        return (void *) (old_block + 1);
+        return ptr;
     }
 
-    /* fast path for growing */
-    if (old_block->next && !IS_USED(old_block->next) &&
-        GET_SIZE(old_block) + sizeof(memblock_t) + GET_SIZE(old_block->next) >=
-            size) {
-        old_block->size = GET_SIZE(old_block) + sizeof(memblock_t) +
-                          GET_SIZE(old_block->next);
-        old_block->next = old_block->next->next;
-        free_blocks_count--;
-        split_block(old_block, size);
-        /* Trigger coalescing only when fragmentation is high */
-        if (free_blocks_count > COALESCE_THRESHOLD)
-            selective_coalesce();
+    /* Growing into a free successor */
+    memblock_t *next = PHYS_NEXT(old_block);
+    if (!IS_USED(next) && old_size + BLOCK_HDR + GET_SIZE(next) >= want) {
+        merge_next(h, old_block);
+        split_block(h, old_block, want);
+        account_used(h, old_size, GET_SIZE(old_block));
         CRITICAL_LEAVE();
-        return (void *) (old_block + 1);
+        return ptr;
     }
 
+    /* Moving: stay in the same kind of memory if possible */
+    uint32_t hint = region_fast(h) ? MEM_FAST : MEM_ANY;
+    CRITICAL_LEAVE();
 
-    void *new_buf = malloc(size);
+    void *new_buf = heap_alloc(size, hint);
     if (new_buf) {
-        memcpy(new_buf, ptr, min(old_size, size));
-        free(ptr);
+        memcpy(new_buf, ptr, min(old_size, want));
+        heap_free(ptr);
     }
 
     return new_buf;
 }
+
+void *realloc(void *ptr, uint32_t size)
+{
+    void *p = heap_realloc(ptr, size);
+    HEAP_TRACE(ptr ? HEAP_OP_REALLOC : HEAP_OP_MALLOC, p, size);
+    return p;
+}
+
+/* Largest free block: the biggest one in the highest non-empty class */
+static uint32_t largest_free(const heap_region_t *h)
+{
+    if (!h->fl_bitmap)
+        return 0;
+
+    uint32_t fl = ilog2(h->fl_bitmap);
+    uint32_t best = 0;
+    for (memblock_t *b = h->free_lists[fl][ilog2(h->sl_bitmap[fl])]; b;
+         b = b->next_free) {
+        if (GET_SIZE(b) > best)
+            best = GET_SIZE(b);
+    }
+    return best;
+}
+
+/* Adds the counters of @h to @stats */
+static void region_stats_add(const heap_region_t *h, heap_stats_t *stats)
+{
+    uint32_t largest = largest_free(h);
+
+    stats->total += h->total;
+    stats->used += h->used;
+    stats->free += h->free;
+    if (largest > stats->largest_free)
+        stats->largest_free = largest;
+    stats->free_blocks += h->free_count;
+    stats->allocs += h->alloc_count;
+    for (uint32_t i = 0; i < HEAP_HIST_BUCKETS; i++)
+        stats->free_hist[i] += h->fl_blocks[i];
+    stats->regions++;
+    stats->flags |= h->flags;
+}
+
+static void stats_frag(heap_stats_t *stats)
+{
+    /* Scale down first for large heaps, so the product stays in 32 bits */
+    uint32_t scattered = stats->free - stats->largest_free;
+    if (!stats->free)
+        stats->frag_pct = 0;
+    else if (stats->free < (1U << 24))
+        stats->frag_pct = scattered * 100 / stats->free;
+    else
+        stats->frag_pct = scattered / (stats->free / 100);
+}
+
+void mo_heap_stats(heap_stats_t *stats)
+{
+    if (unlikely(!stats))
+        return;
+
+    memset(stats, 0, sizeof(*stats));
+    CRITICAL_ENTER();
+    for (uint32_t i = 0; i < region_count; i++)
+        region_stats_add(&regions[i], stats);
+    stats->peak = peak_bytes;
+    stats->failures = fail_count;
+    CRITICAL_LEAVE();
+
+    stats_frag(stats);
+}
+
+int32_t mo_heap_region_stats(uint32_t region, heap_stats_t *stats)
+{
+    if (unlikely(!stats))
+        return ERR_FAIL;
+
+    memset(stats, 0, sizeof(*stats));
+    CRITICAL_ENTER();
+    if (unlikely(region >= region_count)) {
+        CRITICAL_LEAVE();
+        return ERR_FAIL;
+    }
+    const heap_region_t *h = &regions[region];
+    region_stats_add(h, stats);
+    stats->peak = h->peak;
+    stats->failures = h->fail_count;
+    CRITICAL_LEAVE();
+
+    stats_frag(stats);
+    return ERR_OK;
+}
+
+void mo_heap_dump(void)
+{
+    heap_stats_t st;
+    mo_heap_stats(&st);
+
+    printf("heap: total=%lu used=%lu peak=%lu free=%lu largest=%lu "
+           "frag=%lu\n",
+           st.total, st.used, st.peak, st.free, st.largest_free, st.frag_pct);
+    printf("heap: allocs=%lu free_blocks=%lu failures=%lu\n", st.allocs,
+           st.free_blocks, st.failures);
+    for (uint32_t i = 0; i < HEAP_HIST_BUCKETS; i++) {
+        if (st.free_hist[i])
+            printf("heap:   >=%8lu bytes: %lu\n", i ? 1UL << (i + 5) : 0UL,
+                   st.free_hist[i]);
+    }
+
+    uint32_t count = st.regions;
+    for (uint32_t r = 0; count > 1 && r < count; r++) {
+        if (mo_heap_region_stats(r, &st) != ERR_OK)
+            break;
+        printf("heap: region %lu%s: total=%lu used=%lu peak=%lu free=%lu "
+               "largest=%lu\n",
+               r, (st.flags & HEAP_REGION_FAST) ? " (fast)" : "", st.total,
+               st.used, st.peak, st.free, st.largest_free);
+    }
+}
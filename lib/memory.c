@@ -4,42 +4,138 @@
 
 #include "private/utils.h"
 
+/* Word copies run eight words per iteration once the destination is
+ * aligned. When source and destination differ in word alignment, the source
+ * is still read in aligned words and each output word is merged from two
+ * neighbours with shifts, since the target has no fast misaligned access
+ * (-mstrict-align). Reading whole aligned words never touches memory outside
+ * the words that hold the requested bytes.
+ */
+
+/* Below this many bytes the alignment preamble costs more than it saves */
+#define MEM_SMALL 12
+
+/* Forward copy of @len bytes from any @s8 to a word-aligned @d32 */
+static void copy_fwd_aligned(uint32_t *d32, const uint8_t *s8, uint32_t len)
+{
+    uint32_t off = (uint32_t) s8 & 3;
+
+    if (!off) {
+        const uint32_t *s32 = (const uint32_t *) s8;
+        for (; len >= 32; len -= 32, d32 += 8, s32 += 8) {
+            uint32_t a = s32[0], b = s32[1], c = s32[2], d = s32[3];
+            uint32_t e = s32[4], f = s32[5], g = s32[6], h = s32[7];
+            d32[0] = a;
+            d32[1] = b;
+            d32[2] = c;
+            d32[3] = d;
+            d32[4] = e;
+            d32[5] = f;
+            d32[6] = g;
+            d32[7] = h;
+        }
+        for (; len >= 4; len -= 4)
+            *d32++ = *s32++;
+        s8 = (const uint8_t *) s32;
+    } else if (len >= 4) {
+        /* Little endian: the low bytes of an output word come from the
+         * upper part of one source word, the rest from the next one.
+         */
+        uint32_t lo = off * 8, hi = 32 - lo;
+        const uint32_t *s32 = (const uint32_t *) (s8 - off);
+        uint32_t w = *s32++;
+
+        for (; len >= 16; len -= 16, d32 += 4, s32 += 4) {
+            uint32_t a = s32[0], b = s32[1], c = s32[2], d = s32[3];
+            d32[0] = (w >> lo) | (a << hi);
+            d32[1] = (a >> lo) | (b << hi);
+            d32[2] = (b >> lo) | (c << hi);
+            d32[3] = (c >> lo) | (d << hi);
+            w = d;
+        }
+        for (; len >= 4; len -= 4) {
+            uint32_t a = *s32++;
+            *d32++ = (w >> lo) | (a << hi);
+            w = a;
+        }
+        s8 = (const uint8_t *) s32 - 4 + off;
+    }
+
+    uint8_t *d8 = (uint8_t *) d32;
+    while (len--)
+        *d8++ = *s8++;
+}
+
 void *memcpy(void *dst, const void *src, uint32_t len)
 {
     uint8_t *d8 = dst;
     const uint8_t *s8 = src;
 
-    /* If source and destination are aligned to the same word boundary */
-    if (((uint32_t) d8 & 3) == ((uint32_t) s8 & 3)) {
-        /* Copy initial bytes until destination is word-aligned. */
-        uint32_t bound = ALIGN4(d8);
-        while (len && (uint32_t) d8 < bound) {
+    if (len < MEM_SMALL) {
+        while (len--)
             *d8++ = *s8++;
-            len--;
-        }
+        return dst;
+    }
+
+    /* Copy initial bytes until destination is word-aligned. */
+    while ((uint32_t) d8 & 3) {
+        *d8++ = *s8++;
+        len--;
+    }
+
+    copy_fwd_aligned((uint32_t *) d8, s8, len);
+    return dst;
+}
+
+/* Backward copy of @len bytes ending just below @s8 into the bytes ending
+ * just below the word-aligned @d32, the mirror of copy_fwd_aligned().
+ */
+static void copy_bwd_aligned(uint32_t *d32, const uint8_t *s8, uint32_t len)
+{
+    uint32_t off = (uint32_t) s8 & 3;
 
-        /* Word-aligned copy */
-        uint32_t *d32 = (uint32_t *) d8;
+    if (!off) {
         const uint32_t *s32 = (const uint32_t *) s8;
-        while (len >= 4) {
-            *d32++ = *s32++;
-            len -= 4;
+        for (; len >= 32; len -= 32) {
+            d32 -= 8;
+            s32 -= 8;
+            uint32_t a = s32[0], b = s32[1], c = s32[2], d = s32[3];
+            uint32_t e = s32[4], f = s32[5], g = s32[6], h = s32[7];
+            d32[7] = h;
+            d32[6] = g;
+            d32[5] = f;
+            d32[4] = e;
+            d32[3] = d;
+            d32[2] = c;
+            d32[1] = b;
+            d32[0] = a;
         }
-
-        /* Back to byte copy for any remaining bytes */
-        d8 = (uint8_t *) d32;
+        for (; len >= 4; len -= 4)
+            *--d32 = *--s32;
         s8 = (const uint8_t *) s32;
+    } else if (len >= 4) {
+        uint32_t lo = off * 8, hi = 32 - lo;
+        const uint32_t *s32 = (const uint32_t *) (s8 - off);
+        uint32_t w = *s32; /* Holds the 'off' bytes just below s8 */
+
+        for (; len >= 4; len -= 4) {
+            uint32_t a = *--s32;
+            *--d32 = (a >> lo) | (w << hi);
+            w = a;
+        }
+        s8 = (const uint8_t *) s32 + off;
     }
 
-    /* Byte-by-byte copy for any remaining bytes or if not word-aligned */
+    uint8_t *d8 = (uint8_t *) d32;
     while (len--)
-        *d8++ = *s8++;
-    return dst;
+        *--d8 = *--s8;
 }
 
 void *memmove(void *dst, const void *src, uint32_t len)
 {
-    /* If no overlap, use memcpy */
+    /* If no overlap, or the destination is below the source, copy forward;
+     * memcpy() reads every source word before writing below it.
+     */
     if (dst <= src || (uintptr_t) dst >= (uintptr_t) src + len)
         return memcpy(dst, src, len);
 
@@ -47,31 +143,19 @@ void *memmove(void *dst, const void *src, uint32_t len)
     uint8_t *d8 = (uint8_t *) dst + len;
     const uint8_t *s8 = (const uint8_t *) src + len;
 
-    /* If source and destination are aligned to the same word boundary */
-    if (((uint32_t) d8 & 3) == ((uint32_t) s8 & 3)) {
-        /* Copy initial bytes backwards until destination is word-aligned. */
-        uint32_t bound = ALIGN4(d8);
-        while (len && (uint32_t) d8 > bound) {
+    if (len < MEM_SMALL) {
+        while (len--)
             *--d8 = *--s8;
-            len--;
-        }
-
-        /* Word-aligned copy backwards */
-        uint32_t *d32 = (uint32_t *) d8;
-        const uint32_t *s32 = (const uint32_t *) s8;
-        while (len >= 4) {
-            *--d32 = *--s32;
-            len -= 4;
-        }
-
-        /* Back to byte copy for any remaining bytes */
-        d8 = (uint8_t *) d32;
-        s8 = (const uint8_t *) s32;
+        return dst;
     }
 
-    /* Byte-by-byte copy backwards for any remaining bytes */
-    while (len--)
+    /* Copy final bytes backwards until the destination end is aligned. */
+    while ((uint32_t) d8 & 3) {
         *--d8 = *--s8;
+        len--;
+    }
+
+    copy_bwd_aligned((uint32_t *) d8, s8, len);
     return dst;
 }
 
@@ -84,18 +168,25 @@ void *memset(void *dst, int32_t c, uint32_t len)
     word |= word << 16;
 
     /* Copy initial bytes until destination is word-aligned. */
-    uint32_t bound = ALIGN4(d8);
-    while (len && (uint32_t) d8 < bound) {
+    while (len && ((uint32_t) d8 & 3)) {
         *d8++ = (uint8_t) c;
         len--;
     }
 
-    /* Word-aligned fill */
+    /* Word-aligned fill, eight words per iteration */
     uint32_t *d32 = (uint32_t *) d8;
-    while (len >= 4) {
-        *d32++ = word;
-        len -= 4;
+    for (; len >= 32; len -= 32, d32 += 8) {
+        d32[0] = word;
+        d32[1] = word;
+        d32[2] = word;
+        d32[3] = word;
+        d32[4] = word;
+        d32[5] = word;
+        d32[6] = word;
+        d32[7] = word;
     }
+    for (; len >= 4; len -= 4)
+        *d32++ = word;
 
     /* Byte-by-byte fill for any remaining bytes */
     d8 = (uint8_t *) d32;
@@ -104,11 +195,36 @@ void *memset(void *dst, int32_t c, uint32_t len)
     return dst;
 }
 
-/* Compares two memory blocks byte by byte. */
+/* Compares two memory blocks, a word at a time when their alignment
+ * agrees. Bytes compare as unsigned char.
+ */
 int32_t memcmp(const void *cs, const void *ct, uint32_t n)
 {
-    char *r1 = (char *) cs;
-    char *r2 = (char *) ct;
+    const uint8_t *r1 = cs;
+    const uint8_t *r2 = ct;
+
+    if (n >= MEM_SMALL && ((uint32_t) r1 & 3) == ((uint32_t) r2 & 3)) {
+        for (; (uint32_t) r1 & 3; ++r1, ++r2, --n) {
+            if (*r1 != *r2)
+                return (*r1 < *r2) ? -1 : 1;
+        }
+
+        const uint32_t *w1 = (const uint32_t *) r1;
+        const uint32_t *w2 = (const uint32_t *) r2;
+        for (; n >= 4; n -= 4, ++w1, ++w2) {
+            uint32_t diff = *w1 ^ *w2;
+            if (diff) {
+                /* Little-endian: the lowest differing bit is in the
+                 * first differing byte.
+                 */
+                uint32_t shift = ctz32(diff) & ~7u;
+                uint32_t b1 = (*w1 >> shift) & 0xFF, b2 = (*w2 >> shift) & 0xFF;
+                return (b1 < b2) ? -1 : 1;
+            }
+        }
+        r1 = (const uint8_t *) w1;
+        r2 = (const uint8_t *) w2;
+    }
 
     /* Compare bytes until a difference is found or n bytes are processed. */
     while (n && (*r1 == *r2)) {
@@ -117,7 +233,7 @@ int32_t memcmp(const void *cs, const void *ct, uint32_t n)
         --n;
     }
 
-    /* Return 0 if all n bytes matched, otherwise the difference of the first
+    /* Return 0 if all n bytes matched, otherwise the order of the first
      * mismatching bytes.
      */
     return (n == 0) ? 0 : ((*r1 < *r2) ? -1 : 1);
@@ -1,3 +1,4 @@
+#include <hal.h>
 #include <lib/libc.h>
 #include <lib/malloc.h>
 #include <lib/queue.h>
@@ -77,3 +78,107 @@ void *queue_peek(const queue_t *q)
         return NULL;
     return q->buf[q->head];
 }
+
+/* Multi-producer, multi-consumer queue */
+
+mpmc_queue_t *mpmc_create(uint32_t capacity)
+{
+    if (unlikely(capacity < 2))
+        capacity = 2;
+
+    if (!ispowerof2(capacity))
+        capacity = nextpowerof2(capacity);
+
+    mpmc_queue_t *q = malloc(sizeof(mpmc_queue_t));
+    if (unlikely(!q))
+        return NULL;
+
+    q->cells = malloc(capacity * sizeof(mpmc_cell_t));
+    if (unlikely(!q->cells)) {
+        free(q);
+        return NULL;
+    }
+
+    /* Cell i is first filled by the producer at position i */
+    for (uint32_t i = 0; i < capacity; i++)
+        q->cells[i].seq = i;
+
+    q->mask = capacity - 1;
+    q->enq_pos = q->deq_pos = 0;
+    return q;
+}
+
+int32_t mpmc_destroy(mpmc_queue_t *q)
+{
+    if (unlikely(!q || mpmc_count(q)))
+        return ERR_FAIL;
+
+    free(q->cells);
+    free(q);
+    return ERR_OK;
+}
+
+/* A cell is free for the producer at @pos when its sequence equals @pos,
+ * and holds data for the consumer at @pos when it equals @pos + 1. The
+ * consumer then hands it to the producer one lap later.
+ */
+int32_t mpmc_enqueue(mpmc_queue_t *q, void *ptr)
+{
+    if (unlikely(!q))
+        return ERR_FAIL;
+
+    uint32_t pos = q->enq_pos;
+    mpmc_cell_t *cell;
+
+    while (1) {
+        cell = &q->cells[pos & q->mask];
+        int32_t diff = (int32_t) (cell->seq - pos);
+
+        if (diff == 0) {
+            uint32_t seen = hal_atomic_cas(&q->enq_pos, pos, pos + 1);
+            if (seen == pos)
+                break;
+            pos = seen; /* Another producer took it */
+        } else if (diff < 0) {
+            return ERR_FAIL; /* Full: the consumer is a lap behind */
+        } else {
+            pos = q->enq_pos;
+        }
+    }
+
+    cell->data = ptr;
+    hal_fence(); /* Release: data is visible before the cell is */
+    cell->seq = pos + 1;
+    return ERR_OK;
+}
+
+void *mpmc_dequeue(mpmc_queue_t *q)
+{
+    if (unlikely(!q))
+        return NULL;
+
+    uint32_t pos = q->deq_pos;
+    mpmc_cell_t *cell;
+
+    while (1) {
+        cell = &q->cells[pos & q->mask];
+        int32_t diff = (int32_t) (cell->seq - (pos + 1));
+
+        if (diff == 0) {
+            uint32_t seen = hal_atomic_cas(&q->deq_pos, pos, pos + 1);
+            if (seen == pos)
+                break;
+            pos = seen;
+        } else if (diff < 0) {
+            return NULL; /* Empty, or the producer has not published yet */
+        } else {
+            pos = q->deq_pos;
+        }
+    }
+
+    hal_fence(); /* Acquire: read data only after seeing the sequence */
+    void *item = cell->data;
+    hal_fence();
+    cell->seq = pos + q->mask + 1;
+    return item;
+}
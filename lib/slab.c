@@ -0,0 +1,130 @@
+/* Object caches for fixed-size kernel objects, on top of the heap.
+ *
+ * The free list and counters are updated inside a critical section, like the
+ * heap itself. Growing calls malloc() outside it and splices the new chunk in
+ * afterwards, so the heap's own critical section never nests in this one.
+ */
+
+#include <lib/libc.h>
+#include <lib/malloc.h>
+#include <lib/slab.h>
+#include <sys/task.h>
+
+#include "private/utils.h"
+
+/* Caches that have grown at least once, for slab_dump() */
+static slab_cache_t *slab_caches;
+
+static inline uint32_t chunk_bytes(const slab_cache_t *c)
+{
+    return c->size > SLAB_CHUNK_SIZE ? c->size : SLAB_CHUNK_SIZE;
+}
+
+/* Frees the @count objects laid out at @mem into @c; @heap tells whether
+ * @mem is a chunk taken from the heap.
+ */
+static void slab_splice(slab_cache_t *c, char *mem, uint32_t count, bool heap)
+{
+    /* Thread the objects into a list before touching the shared state */
+    for (uint32_t i = 0; i + 1 < count; i++)
+        *(void **) (mem + i * c->size) = mem + (i + 1) * c->size;
+
+    CRITICAL_ENTER();
+    *(void **) (mem + (count - 1) * c->size) = c->free_list;
+    c->free_list = mem;
+    if (!c->capacity) {
+        c->next = slab_caches;
+        slab_caches = c;
+    }
+    c->capacity += count;
+    if (heap && !c->chunks++)
+        c->per_chunk = (uint16_t) count;
+    CRITICAL_LEAVE();
+}
+
+/* Takes one chunk from the heap and frees all of its objects into @c */
+static bool slab_grow(slab_cache_t *c)
+{
+    uint32_t per_chunk = chunk_bytes(c) / c->size;
+    char *chunk = malloc_region(per_chunk * c->size, c->hint);
+    if (unlikely(!chunk))
+        return false;
+
+    slab_splice(c, chunk, per_chunk, true);
+    return true;
+}
+
+void slab_seed(slab_cache_t *c, void *mem, uint32_t bytes)
+{
+    if (unlikely(!c || !mem || bytes < c->size))
+        return;
+
+    slab_splice(c, mem, bytes / c->size, false);
+}
+
+void *slab_alloc(slab_cache_t *c)
+{
+    if (unlikely(!c))
+        return NULL;
+
+    while (1) {
+        CRITICAL_ENTER();
+        void *obj = c->free_list;
+        if (likely(obj)) {
+            c->free_list = *(void **) obj;
+            if (++c->in_use > c->peak)
+                c->peak = c->in_use;
+            CRITICAL_LEAVE();
+            return obj;
+        }
+        CRITICAL_LEAVE();
+
+        if (unlikely(!slab_grow(c))) {
+            CRITICAL_ENTER();
+            c->failures++;
+            CRITICAL_LEAVE();
+            return NULL;
+        }
+    }
+}
+
+void slab_free(slab_cache_t *c, void *obj)
+{
+    if (unlikely(!c || !obj))
+        return;
+
+    CRITICAL_ENTER();
+    *(void **) obj = c->free_list;
+    c->free_list = obj;
+    c->in_use--;
+    CRITICAL_LEAVE();
+}
+
+void slab_stats(const slab_cache_t *c, slab_stats_t *st)
+{
+    if (unlikely(!c || !st))
+        return;
+
+    CRITICAL_ENTER();
+    st->size = c->size;
+    st->in_use = c->in_use;
+    st->peak = c->peak;
+    st->capacity = c->capacity;
+    st->chunks = c->chunks;
+    st->failures = c->failures;
+    CRITICAL_LEAVE();
+}
+
+void slab_dump(void)
+{
+    printf("CACHE     SIZE  USED  PEAK   CAP  BYTES\n");
+    for (slab_cache_t *c = slab_caches; c; c = c->next) {
+        slab_stats_t st;
+        slab_stats(c, &st);
+        printf("%s", c->name);
+        for (uint32_t n = strlen(c->name); n < 8; n++)
+            printf(" ");
+        printf(" %5lu %5lu %5lu %5lu %6lu\n", st.size, st.in_use, st.peak,
+               st.capacity, st.chunks * chunk_bytes(c));
+    }
+}
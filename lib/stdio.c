@@ -5,8 +5,11 @@
  * allow a consistent I/O interface regardless of the underlying hardware.
  */
 
+#include <hal.h>
 #include <lib/libc.h>
 #include <stdarg.h>
+#include <sys/mutex.h>
+#include <sys/task.h>
 
 #include "private/stdio.h"
 
@@ -29,12 +32,18 @@ static int poll_null(void)
     return 0;
 }
 
+/* Buffer hooks default to looping over the single-character ones */
+static int stdwrite_bytes(const char *buf, int len);
+static int stdread_bytes(char *buf, int len);
+
 /* Active hooks, initialized to default no-op handlers.
  * These pointers will be updated by board-specific initialization code.
  */
 static int (*stdout_hook)(int) = stdout_null;
 static int (*stdin_hook)(void) = stdin_null;
 static int (*poll_hook)(void) = poll_null;
+static int (*stdwrite_hook)(const char *, int) = stdwrite_bytes;
+static int (*stdread_hook)(char *, int) = stdread_bytes;
 
 /* Hook installers: Register the provided I/O functions. */
 void _stdout_install(int (*hook)(int))
@@ -52,6 +61,16 @@ void _stdpoll_install(int (*hook)(void))
     poll_hook = (hook) ? hook : poll_null;
 }
 
+void _stdwrite_install(int (*hook)(const char *, int))
+{
+    stdwrite_hook = (hook) ? hook : stdwrite_bytes;
+}
+
+void _stdread_install(int (*hook)(char *, int))
+{
+    stdread_hook = (hook) ? hook : stdread_bytes;
+}
+
 /* I/O helpers: Dispatch to the currently installed hooks. */
 
 /* Calls the registered stdout hook to output a character. */
@@ -77,6 +96,103 @@ int _kbhit(void)
     return poll_hook();
 }
 
+static int stdwrite_bytes(const char *buf, int len)
+{
+    for (int i = 0; i < len; i++)
+        stdout_hook(buf[i]);
+    return len;
+}
+
+static int stdread_bytes(char *buf, int len)
+{
+    for (int i = 0; i < len; i++)
+        buf[i] = (char) _getchar();
+    return len;
+}
+
+/* Calls the registered buffer hooks to move @len bytes at once. */
+int _putbuf(const char *buf, int len)
+{
+    return stdwrite_hook(buf, len);
+}
+
+int _getbuf(char *buf, int len)
+{
+    return stdread_hook(buf, len);
+}
+
+/* Buffered Task Output (CONFIG_STDOUT_BUF)
+ *
+ * printf() and puts() from a task fill the task's own line buffer, which is
+ * handed to _putbuf() in one call, under a lock all tasks share, when it
+ * ends a line, runs full or is flushed. A record is then never split by
+ * another task's output, and the lock is taken once per line rather than
+ * held around every print. Interrupt handlers, code with interrupts or
+ * scheduling off and boot code cannot wait for the lock, so their output
+ * still goes straight out, possibly ahead of a task's unfinished line.
+ */
+#if CONFIG_STDOUT_BUF
+static mutex_t stdout_lock;
+
+/* The running task, if its output may be buffered */
+static tcb_t *stdout_task(void)
+{
+    tcb_t *self = kcb->task_current;
+    if (!self || kcb->preempt_count || hal_irq_active() ||
+        !(read_csr(mstatus) & (1U << 3))) /* MSTATUS_MIE */
+        return NULL;
+    return self;
+}
+
+static void stdout_flush(tcb_t *self)
+{
+    if (!self->stdout_len)
+        return;
+
+    /* The first flush sets up the lock; no other can run meanwhile */
+    if (unlikely(stdout_lock.magic != MUTEX_MAGIC)) {
+        NOSCHED_ENTER();
+        if (stdout_lock.magic != MUTEX_MAGIC)
+            mo_mutex_init(&stdout_lock);
+        NOSCHED_LEAVE();
+    }
+
+    mo_mutex_lock(&stdout_lock);
+    _putbuf(self->stdout_buf, self->stdout_len);
+    self->stdout_len = 0;
+    mo_mutex_unlock(&stdout_lock);
+}
+
+static void stdout_putc(char c)
+{
+    tcb_t *self = stdout_task();
+    if (!self) {
+        _putchar(c);
+        return;
+    }
+
+    self->stdout_buf[self->stdout_len++] = c;
+    if (c == '\n' || self->stdout_len == CONFIG_STDOUT_BUF)
+        stdout_flush(self);
+}
+#else
+static inline void stdout_putc(char c)
+{
+    _putchar(c);
+}
+#endif
+
+int fflush(void *f)
+{
+    (void) f;
+#if CONFIG_STDOUT_BUF
+    tcb_t *self = stdout_task();
+    if (self)
+        stdout_flush(self);
+#endif
+    return 0;
+}
+
 /* Base-10 string conversion without division (shared with ctype.c logic) */
 static char *__str_base10(uint32_t value, char *buffer, int *length)
 {
@@ -136,7 +252,7 @@ static inline void printchar(char **str, int32_t c, int *len)
         **str = c;
         ++(*str);
     } else if (c) {
-        _putchar(c);
+        stdout_putc(c);
     }
     (*len)++;
 }
@@ -283,8 +399,8 @@ int32_t sprintf(char *out, const char *fmt, ...)
 int32_t puts(const char *str)
 {
     while (*str)
-        _putchar(*str++);
-    _putchar('\n');
+        stdout_putc(*str++);
+    stdout_putc('\n');
 
     return 0;
 }
@@ -292,6 +408,7 @@ int32_t puts(const char *str)
 /* Reads a single character from stdin. */
 int getchar(void)
 {
+    fflush(NULL); /* Show a pending prompt before waiting */
     return _getchar(); /* Use HAL's getchar implementation. */
 }
 
@@ -302,6 +419,7 @@ char *gets(char *s)
     int32_t c;
     char *cs = s;
 
+    fflush(NULL);
     /* Read characters until newline or end of input. */
     while ((c = _getchar()) != '\n' && c >= 0)
         *cs++ = c;
@@ -321,6 +439,7 @@ char *fgets(char *s, int n, void *f)
     int ch;
     char *p = s;
 
+    fflush(NULL);
     /* Read characters until 'n-1' are read, or newline, or EOF. */
     while (n > 1) {
         ch = _getchar();
@@ -341,6 +460,7 @@ char *getline(char *s)
     int32_t c, i = 0;
     char *cs = s;
 
+    fflush(NULL);
     /* Read characters until newline or EOF, or buffer limit is reached. */
     while ((c = _getchar()) != '\n' && c >= 0) {
         if (++i == 80) {
@@ -4,19 +4,33 @@
 
 #include "private/utils.h"
 
+/* Returns a mask flagging the zero bytes of @v: non-zero iff @v holds a
+ * zero byte, and its lowest set bit always lies in the first (lowest
+ * addressed) one. Higher bytes may be flagged spuriously by the portable
+ * version, so only the lowest flag is meaningful.
+ */
+static inline uint32_t zero_bytes(uint32_t v)
+{
+#ifdef __riscv_zbb
+    uint32_t r;
+    /* orc.b turns every non-zero byte into 0xff and every zero byte into 0 */
+    __asm__("orc.b %0, %1" : "=r"(r) : "r"(v));
+    return ~r;
+#else
+    return (v - 0x01010101u) & ~v & 0x80808080u;
+#endif
+}
+
 /* Checks for any zero byte in a 32-bit word. */
 static inline int byte_is_zero(uint32_t v)
 {
-    /* bitwise check for zero bytes. */
-    return ((v - 0x01010101u) & ~v & 0x80808080u) != 0;
+    return zero_bytes(v) != 0;
 }
 
-/* Checks if a 32-bit word @w matches the pattern @pat in all bytes. */
-static inline int byte_is_match(uint32_t w, uint32_t pat)
+/* Byte offset within a word of the lowest set bit of @mask (non-zero) */
+static inline uint32_t first_byte(uint32_t mask)
 {
-    uint32_t t = w ^ pat; /* t will be zero for matching bytes. */
-    /* Similar logic to byte_is_zero, but applied to the XORed result. */
-    return ((t - 0x01010101u) & ~t & 0x80808080u) != 0;
+    return ctz32(mask) >> 3;
 }
 
 /* strlen that scans by words whenever possible for efficiency. */
@@ -33,16 +47,12 @@ size_t strlen(const char *s)
 
     /* Word scan: Iterate through 32-bit words as long as no byte is zero. */
     const uint32_t *w = (const uint32_t *) p;
-    while (!byte_is_zero(*w))
+    uint32_t zeros;
+    while (!(zeros = zero_bytes(*w)))
         w++;
 
-    /* Final byte scan: Within the word that contained the zero byte, find the
-     * exact position.
-     */
-    p = (const char *) w;
-    while (*p) /* Scan byte-by-byte until the null terminator. */
-        p++;
-    return (size_t) (p - s); /* Return total length. */
+    /* The lowest flag marks the terminator within the last word */
+    return (size_t) ((const char *) w - s) + first_byte(zeros);
 }
 
 char *strcpy(char *dst, const char *src)
@@ -115,8 +125,10 @@ int32_t strcmp(const char *s1, const char *s2)
         s2++;
     }
 
-    /* If alignment causes one to hit null or inequality first */
-    if (((uint32_t) s1 & 3) == ((uint32_t) s2 & 3)) {
+    /* Word comparison needs both aligned; the loop above may have stopped
+     * early on a terminator or a difference instead.
+     */
+    if (!((uint32_t) s1 & 3) && !((uint32_t) s2 & 3)) {
         const uint32_t *w1 = (const uint32_t *) s1;
         const uint32_t *w2 = (const uint32_t *) s2;
 
@@ -127,9 +139,10 @@ int32_t strcmp(const char *s1, const char *s2)
 
             /* Exit if words differ or if a zero byte is found in either word */
             if (!equal_word(v1, v2) || byte_is_zero(v1)) {
-                s1 = (const char *) w1;
-                s2 = (const char *) w2;
-                break;
+                /* First byte that differs or ends both strings */
+                uint32_t shift = first_byte(zero_bytes(v1) | (v1 ^ v2)) * 8;
+                return (int32_t) ((v1 >> shift) & 0xFF) -
+                       (int32_t) ((v2 >> shift) & 0xFF);
             }
         }
     }
@@ -151,7 +164,7 @@ int32_t strncmp(const char *s1, const char *s2, int32_t n)
         return 0;
 
     /* Align pointers to word boundary */
-    while (((uint32_t) s1 & 3) && *s1 && *s1 == *s2) {
+    while (n && ((uint32_t) s1 & 3) && *s1 && *s1 == *s2) {
         s1++;
         s2++;
         n--;
@@ -162,7 +175,7 @@ int32_t strncmp(const char *s1, const char *s2, int32_t n)
         goto tail;
 
     /* Word comparison loop */
-    if (((uint32_t) s1 & 3) == ((uint32_t) s2 & 3)) {
+    if (!((uint32_t) s1 & 3) && !((uint32_t) s2 & 3)) {
         const uint32_t *w1 = (const uint32_t *) s1;
         const uint32_t *w2 = (const uint32_t *) s2;
 
@@ -203,8 +216,8 @@ char *strchr(const char *s, int32_t c)
 
     /* Byte-by-byte scan until word-aligned */
     while (((uint32_t) s & 3)) {
-        if (*s == ch || *s == 0) /* Found char or end of string */
-            return (*s == ch) ? (char *) s : 0;
+        if ((uint8_t) *s == ch || *s == 0) /* Found char or end of string */
+            return ((uint8_t) *s == ch) ? (char *) s : 0;
         s++;
     }
 
@@ -215,12 +228,11 @@ char *strchr(const char *s, int32_t c)
     for (;; ++w) {
         uint32_t v = *w;
         /* Exit if word contains zero or matches the pattern */
-        if (byte_is_zero(v) || byte_is_match(v, pat)) {
-            s = (const char *) w;  /* Reset to start of word */
-            while (*s && *s != ch) /* Byte scan within the word */
-                s++;
-
-            return (*s == ch) ? (char *) s : 0; /* Return if found */
+        uint32_t hits = zero_bytes(v) | zero_bytes(v ^ pat);
+        if (hits) {
+            /* The first hit is either the character or the terminator */
+            s = (const char *) w + first_byte(hits);
+            return ((uint8_t) *s == ch) ? (char *) s : 0;
         }
     }
 }
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Decode a Linmo deferred log dump into text using the ELF image.
+
+Capture the UART output of a program that calls mo_log_dump() (its lines
+start with 'log: '; all other lines are ignored) and run:
+
+    scripts/log2text.py build/image.elf uart.log
+
+Each record's format string is read from the ELF image at the address the
+target recorded, then formatted with the record's arguments. Every output
+line starts with the timestamp in microseconds and the task ID, like the
+lines mo_log_flush() prints on the target. '%s' arguments point into target
+RAM, so they are printed as addresses unless they fall inside the image.
+"""
+
+import re
+import struct
+import sys
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+CONV = re.compile(r"%([0 #+']*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z)?([diuxXcspo%])")
+
+
+class Image:
+    """Loadable sections of a little-endian ELF32 file."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("%s: not a little-endian ELF32 file" % path)
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2e)
+        self.sections = []
+        for i in range(shnum):
+            (_, stype, flags, addr, offset,
+             size) = struct.unpack_from("<IIIIII", data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and stype != SHT_NOBITS and size:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, addr):
+        """Return the C string at target address addr, or None."""
+        for base, blob in self.sections:
+            if base <= addr < base + len(blob):
+                end = blob.find(b"\0", addr - base)
+                if end < 0:
+                    end = len(blob)
+                return blob[addr - base:end].decode("latin-1")
+        return None
+
+
+def signed(v):
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def format_record(image, fmt, args):
+    """Apply a printf() format string to a list of raw 32-bit arguments."""
+    args = list(args)
+
+    def conv(m):
+        flags, width, prec, _, spec = m.groups()
+        if spec == "%":
+            return "%"
+        v = args.pop(0) if args else 0
+        if spec in "di":
+            text = str(signed(v))
+        elif spec == "u":
+            text = str(v)
+        elif spec in "xX":
+            text = "%x" % v if spec == "x" else "%X" % v
+        elif spec == "o":
+            text = "%o" % v
+        elif spec == "p":
+            text = "0x%08x" % v
+        elif spec == "c":
+            text = chr(v & 0xff)
+        else:
+            s = image.string(v)
+            text = s if s is not None else "<0x%08x>" % v
+            if prec:
+                text = text[:int(prec)]
+        pad = "0" if "0" in flags and spec not in "cs" else " "
+        return text.rjust(int(width or 0), pad)
+
+    return CONV.sub(conv, fmt)
+
+
+def decode(image, lines, out):
+    hz = 1000000
+    last = None
+    high = 0
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("log: "):
+            continue
+        body = line[len("log: "):]
+        if body.startswith("begin"):
+            fields = dict(f.split("=") for f in body.split()[1:])
+            hz = int(fields.get("hz", hz))
+            if int(fields.get("lost", "0")):
+                sys.stderr.write("warning: %s records lost\n" % fields["lost"])
+            continue
+        if body == "end":
+            continue
+        fmt, ts, task, nargs, *args = body.split()
+        ts = int(ts, 16)
+        # The target records the low 32 bits of mtime, which wrap
+        if last is not None and ts < last:
+            high += 1 << 32
+        last = ts
+        args = [int(a, 16) for a in args][:int(nargs)]
+        text = image.string(int(fmt, 16))
+        if text is None:
+            text = "<unknown format 0x%s>" % fmt
+        msg = format_record(image, text, args).rstrip("\n")
+        us = (high + ts) * 1000000 // hz
+        out.write("[%d %d] %s\n" % (us, int(task, 16), msg))
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.stderr.write("usage: %s image.elf [uart.log]\n" % sys.argv[0])
+        sys.exit(2)
+    image = Image(sys.argv[1])
+    src = open(sys.argv[2]) if len(sys.argv) > 2 else sys.stdin
+    decode(image, src, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
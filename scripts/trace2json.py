@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Convert a Linmo scheduler trace dump into Chrome trace / Perfetto JSON.
+
+Capture the UART output of a build with CONFIG_TRACE enabled (the lines
+written by mo_trace_dump() start with 'trace: '; all other lines are
+ignored) and run:
+
+    scripts/trace2json.py uart.log > trace.json
+
+Open the result in https://ui.perfetto.dev or chrome://tracing. Each task
+gets its own track showing when it ran; wakeups, blocks, timer callbacks
+and mutex contention appear as instant events, and traps as slices on a
+separate 'ISR' track.
+"""
+
+import json
+import sys
+
+TRACE_SWITCH = 1
+TRACE_WAKEUP = 2
+TRACE_BLOCK = 3
+TRACE_TIMER = 4
+TRACE_ISR_ENTER = 5
+TRACE_ISR_EXIT = 6
+TRACE_MUTEX_WAIT = 7
+
+PID = 1
+ISR_TID = 0
+
+
+def parse(lines):
+    """Yield (hz, events) per dump, with timestamps unwrapped to 64 bits."""
+    hz = None
+    events = []
+    last = None
+    high = 0
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("trace: "):
+            continue
+        body = line[len("trace: "):]
+        if body.startswith("begin"):
+            fields = dict(f.split("=") for f in body.split()[1:])
+            hz = int(fields["hz"])
+            if int(fields.get("lost", "0")):
+                sys.stderr.write("warning: %s events lost\n" % fields["lost"])
+            continue
+        if body == "end":
+            continue
+        ts, etype, aux, a, b = (int(f, 16) for f in body.split())
+        # The target records the low 32 bits of mtime, which wrap
+        if last is not None and ts < last:
+            high += 1 << 32
+        last = ts
+        events.append((high + ts, etype, aux, a, b))
+    return hz or 1000000, events
+
+
+def to_us(ticks, hz):
+    return ticks * 1000000.0 / hz
+
+
+def convert(hz, events):
+    out = []
+    running = None  # (task id, start timestamp)
+    isr_start = None
+    tasks = set()
+
+    def close_task(ts):
+        if running:
+            tid, start = running
+            out.append({"name": "task %d" % tid, "ph": "X", "pid": PID,
+                        "tid": tid, "ts": to_us(start, hz),
+                        "dur": to_us(ts - start, hz)})
+
+    def close_isr(ts):
+        out.append({"name": "trap", "ph": "X", "pid": PID, "tid": ISR_TID,
+                    "ts": to_us(isr_start, hz),
+                    "dur": to_us(ts - isr_start, hz)})
+
+    def instant(name, ts, tid, args=None):
+        ev = {"name": name, "ph": "i", "s": "t", "pid": PID, "tid": tid,
+              "ts": to_us(ts, hz)}
+        if args:
+            ev["args"] = args
+        out.append(ev)
+
+    for ts, etype, aux, a, b in events:
+        if etype == TRACE_SWITCH:
+            if running is None:
+                running = (a, events[0][0])
+            close_task(ts)
+            tasks.update((a, b))
+            running = (b, ts)
+            instant("switch", ts, a, {"to": b, "preempted": bool(aux)})
+        elif etype == TRACE_WAKEUP:
+            tasks.add(a)
+            instant("wakeup", ts, a)
+        elif etype == TRACE_BLOCK:
+            tasks.add(a)
+            instant("block", ts, a, {"timeout": b} if b else None)
+        elif etype == TRACE_TIMER:
+            instant("timer %d" % a, ts, ISR_TID)
+        elif etype == TRACE_MUTEX_WAIT:
+            tasks.add(a)
+            instant("mutex wait", ts, a, {"owner": b})
+        elif etype == TRACE_ISR_ENTER:
+            if isr_start is not None:
+                close_isr(ts)
+            isr_start = ts
+        elif etype == TRACE_ISR_EXIT and isr_start is not None:
+            close_isr(ts)
+            isr_start = None
+
+    if events:
+        close_task(events[-1][0])
+
+    meta = [{"name": "thread_name", "ph": "M", "pid": PID, "tid": ISR_TID,
+             "args": {"name": "ISR"}}]
+    for tid in sorted(tasks):
+        meta.append({"name": "thread_name", "ph": "M", "pid": PID,
+                     "tid": tid, "args": {"name": "task %d" % tid}})
+    return {"traceEvents": meta + out, "displayTimeUnit": "ns"}
+
+
+def main():
+    src = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    hz, events = parse(src)
+    json.dump(convert(hz, events), sys.stdout, indent=1)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()